@@ -0,0 +1,57 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Cost of sealing tunnel frames of typical sizes with both supported
+ * algorithms, in frames per second and CPU nanoseconds per frame.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "../src/Crypto/Aead.h"
+
+using namespace std;
+using namespace Crypto;
+using namespace Packets;
+
+typedef chrono::steady_clock Clock;
+
+
+int
+main(int argc, char *argv[])
+{
+  const size_t count = argc > 1 ? atoi(argv[1]) : 200000;
+  const Aead::Key key = Aead::DeriveKey("benchmark", "benchmark");
+
+  cout << "preferred algorithm: " << Aead::GetName(Aead::GetPreferredAlgorithm()) << "\n";
+  cout << setw(20) << "algorithm" << setw(8) << "bytes"
+       << setw(14) << "frames/s" << setw(10) << "ns/frame" << setw(10) << "MB/s" << "\n";
+
+  for (auto algorithm : { Aead::Algorithm::AES_256_GCM, Aead::Algorithm::CHACHA20_POLY1305 })
+    for (size_t size : { 64, 512, 1400 })
+    {
+      Aead sender(algorithm, key);
+      Packet::Data frame;
+      frame.reserve(size + Aead::OVERHEAD);
+
+      const auto start = Clock::now();
+      for (size_t i = 0; i < count; i++)
+      {
+        frame.assign(size, 0x5A);
+        sender.Seal(frame);
+      }
+      const chrono::duration<double> elapsed = Clock::now() - start;
+
+      cout << setw(20) << Aead::GetName(algorithm) << setw(8) << size
+           << setw(14) << fixed << setprecision(0) << count / elapsed.count()
+           << setw(10) << elapsed.count() * 1e9 / count
+           << setw(10) << count * size / elapsed.count() / 1e6 << "\n";
+    }
+
+  return 0;
+}
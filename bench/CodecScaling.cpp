@@ -0,0 +1,224 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Throughput of the codec with its work done in 1 to N worker threads,
+ * compared with the codec working in a single thread (0 workers). Every
+ * IP packet is sealed, split into fragments and dumped by the encoder,
+ * the decoder parses the fragments, reassembles, opens and delivers it.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/Codec/Sender.h"
+#include "../src/Codec/Receiver.h"
+#include "../src/Codec/ParallelSender.h"
+#include "../src/Codec/ParallelReceiver.h"
+#include "../src/Crypto/Aead.h"
+#include "../src/Packets/PseudoDNS.h"
+
+using namespace std;
+using namespace Packets;
+using namespace Codec;
+
+typedef chrono::steady_clock Clock;
+
+constexpr size_t PACKET_SIZE = 1400;
+constexpr size_t FLOWS = 8;
+
+const Crypto::Aead::Key KEY = Crypto::Aead::DeriveKey("benchmark", "benchmark");
+
+
+unique_ptr<Packet>
+CreatePrototype()
+{
+  unique_ptr<PseudoDNS> prototype(new PseudoDNS());
+  prototype->SetChecksum(true);
+
+  return prototype;
+}
+
+
+unique_ptr<Sender>
+CreateSender(const size_t &count)
+{
+  unique_ptr<Sender> sender(new Sender(CreatePrototype(), 0));
+
+  // every packet is queued up front, none may be dropped
+  sender->SetQueueManagement(count, chrono::hours(1), chrono::hours(1));
+  sender->SetEncryption(unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::GetPreferredAlgorithm(), KEY)));
+
+  return sender;
+}
+
+
+unique_ptr<Receiver>
+CreateReceiver()
+{
+  unique_ptr<Receiver> receiver(new Receiver(CreatePrototype()));
+  receiver->SetEncryption(unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::GetPreferredAlgorithm(), KEY)));
+
+  return receiver;
+}
+
+
+// IPv4/UDP packets of a few flows
+vector<Packet::Data>
+MakePackets(const size_t &count)
+{
+  vector<Packet::Data> packets;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    Packet::Data p(PACKET_SIZE, static_cast<uint8_t>(i));
+    const uint8_t header[] = { 0x45, 0x00, uint8_t(PACKET_SIZE >> 8), uint8_t(PACKET_SIZE),
+                               0x00, 0x00, 0x40, 0x00, 0x40, 0x11, 0x00, 0x00,
+                               10, 0, 0, 1, 10, 0, 0, 2,
+                               0x04, uint8_t(i % FLOWS), 0x00, 0x35 };
+    copy(begin(header), end(header), p.begin());
+    packets.push_back(p);
+  }
+
+  return packets;
+}
+
+
+// packets per second, the dumps are appended to datagrams
+double
+Encode(const size_t &workers, const vector<Packet::Data> &packets,
+       vector<Packet::Data> &datagrams)
+{
+  vector<Packet::Data> input(packets);
+  Packet::Data datagram;
+
+  unique_ptr<Sender> sender;
+  unique_ptr<ParallelSender> encoder;
+  if (workers == 0)
+    sender = CreateSender(packets.size());
+  else
+    encoder.reset(new ParallelSender([&packets]() { return CreateSender(packets.size()); },
+                                     workers));
+
+  const auto start = Clock::now();
+
+  for (auto &p : input)
+    (sender ? *sender : encoder->GetSender()).Push(p, start);
+
+  if (sender)
+    while (sender->Pull(datagram, Clock::now()))
+      datagrams.push_back(move(datagram));
+  else
+    while (encoder->HasPendingData())
+      // leave the CPU to workers on small machines
+      if (!encoder->Poll(datagrams, Clock::now()))
+        this_thread::yield();
+
+  const chrono::duration<double> elapsed = Clock::now() - start;
+  return packets.size() / elapsed.count();
+}
+
+
+// packets per second, delivered is set to the number of IP packets
+double
+Decode(const size_t &workers, const vector<Packet::Data> &datagrams, size_t &delivered)
+{
+  vector<Packet::Data> input(datagrams);
+  vector<Packet::Data> packets;
+  delivered = 0;
+
+  unique_ptr<Receiver> receiver;
+  unique_ptr<ParallelReceiver> decoder;
+  if (workers == 0)
+    receiver = CreateReceiver();
+  else
+    decoder.reset(new ParallelReceiver(CreateReceiver, workers));
+
+  const auto start = Clock::now();
+
+  if (receiver)
+    for (auto &d : input)
+    {
+      receiver->Push(d, packets, Clock::now());
+      delivered += packets.size();
+      packets.clear();
+    }
+  else
+  {
+    size_t next = 0;
+
+    while (next < input.size() || decoder->HasPendingData())
+    {
+      bool busy = false;
+
+      while (next < input.size() && decoder->Push(move(input[next])))
+      {
+        next++;
+        busy = true;
+      }
+
+      busy |= decoder->Poll(packets, Clock::now());
+      delivered += packets.size();
+      packets.clear();
+
+      if (!busy)
+        this_thread::yield();
+    }
+  }
+
+  const chrono::duration<double> elapsed = Clock::now() - start;
+  return delivered / elapsed.count();
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const size_t max_workers = argc > 1 ? atoi(argv[1])
+                                      : max(1u, thread::hardware_concurrency());
+  const size_t count = argc > 2 ? atoi(argv[2]) : 20000;
+  const vector<Packet::Data> packets = MakePackets(count);
+
+  cout << "codec workers, " << count << " packets of " << PACKET_SIZE << " bytes, "
+       << Crypto::Aead::GetName(Crypto::Aead::GetPreferredAlgorithm()) << "\n";
+  cout << setw(8) << "workers"
+       << setw(14) << "encode pps" << setw(10) << "speedup"
+       << setw(14) << "decode pps" << setw(10) << "speedup" << "\n";
+
+  double encode_base = 0, decode_base = 0;
+  for (size_t workers = 0; workers <= max_workers; workers++)
+  {
+    vector<Packet::Data> datagrams;
+    size_t delivered;
+    const double encode = Encode(workers, packets, datagrams);
+    const double decode = Decode(workers, datagrams, delivered);
+
+    if (workers == 0)
+    {
+      encode_base = encode;
+      decode_base = decode;
+    }
+
+    cout << setw(8) << workers
+         << setw(14) << fixed << setprecision(0) << encode
+         << setw(10) << setprecision(2) << encode / encode_base
+         << setw(14) << setprecision(0) << decode
+         << setw(10) << setprecision(2) << decode / decode_base;
+
+    if (delivered != count)
+      cout << "  (" << count - delivered << " packets lost)";
+    cout << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Harness.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+using namespace std;
+
+
+namespace
+{
+
+atomic<uint64_t> allocation_count(0);
+
+void*
+Allocate(const size_t &size)
+{
+  allocation_count.fetch_add(1, memory_order_relaxed);
+
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw bad_alloc();
+
+  return p;
+}
+
+}
+
+
+// every allocation of the benchmark binary goes through here
+void*
+operator new(size_t size)
+{
+  return Allocate(size);
+}
+
+
+void*
+operator new[](size_t size)
+{
+  return Allocate(size);
+}
+
+
+void*
+operator new(size_t size, const nothrow_t&) noexcept
+{
+  try
+  {
+    return Allocate(size);
+  }
+  catch (bad_alloc&)
+  {
+    return nullptr;
+  }
+}
+
+
+void*
+operator new[](size_t size, const nothrow_t&) noexcept
+{
+  return operator new(size, nothrow);
+}
+
+
+void
+operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+
+void
+operator delete[](void *p) noexcept
+{
+  free(p);
+}
+
+
+void
+operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
+
+void
+operator delete[](void *p, size_t) noexcept
+{
+  free(p);
+}
+
+
+namespace Bench
+{
+
+constexpr uint64_t Harness::MAX_ITERATIONS;
+
+
+uint64_t
+GetAllocationCount()
+{
+  return allocation_count.load(memory_order_relaxed);
+}
+
+
+Harness::Harness(int argc, char *argv[]) :
+  min_time(200)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const string argument = argv[i];
+
+    if (argument.compare(0, 9, "--filter=") == 0)
+      filter = argument.substr(9);
+    else if (argument.compare(0, 7, "--json=") == 0)
+      json_path = argument.substr(7);
+    else if (argument.compare(0, 11, "--min-time=") == 0)
+      min_time = chrono::milliseconds(atoi(argument.c_str() + 11));
+    else
+      throw invalid_argument("Unknown argument: " + argument);
+  }
+
+  cout << setw(36) << left << "benchmark" << right
+       << setw(8) << "bytes"
+       << setw(12) << "ns/op"
+       << setw(12) << "MB/s"
+       << setw(12) << "allocs/op" << "\n";
+}
+
+
+const vector<Harness::Result>&
+Harness::GetResults() const
+{
+  return results;
+}
+
+
+int
+Harness::Finish() const
+{
+  if (!json_path.empty())
+    WriteJson();
+
+  return 0;
+}
+
+
+bool
+Harness::IsSelected(const string &name) const
+{
+  return filter.empty() || name.find(filter) != string::npos;
+}
+
+
+void
+Harness::Record(const string &name, const size_t &bytes,
+                const uint64_t &iterations, const Clock::duration &elapsed,
+                const uint64_t &allocations)
+{
+  const double seconds = chrono::duration<double>(elapsed).count();
+
+  Result result;
+  result.name = name;
+  result.bytes = bytes;
+  result.iterations = iterations;
+  result.ns_per_op = seconds * 1e9 / iterations;
+  result.bytes_per_second = seconds > 0 ? bytes * iterations / seconds : 0;
+  result.allocations_per_op = static_cast<double>(allocations) / iterations;
+
+  Print(result);
+  results.push_back(result);
+}
+
+
+void
+Harness::Print(const Result &result) const
+{
+  cout << setw(36) << left << result.name << right
+       << setw(8) << result.bytes
+       << setw(12) << fixed << setprecision(1) << result.ns_per_op
+       << setw(12) << setprecision(1) << result.bytes_per_second / 1e6
+       << setw(12) << setprecision(2) << result.allocations_per_op << endl;
+}
+
+
+void
+Harness::WriteJson() const
+{
+  ofstream file(json_path);
+  if (!file)
+    throw runtime_error("Can't write " + json_path);
+
+  // names are built by the benchmarks, no escaping needed
+  file << "{\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const Result &r = results[i];
+
+    file << "    {\"name\": \"" << r.name << "\""
+         << ", \"bytes\": " << r.bytes
+         << ", \"iterations\": " << r.iterations
+         << fixed << setprecision(3)
+         << ", \"ns_per_op\": " << r.ns_per_op
+         << ", \"bytes_per_second\": " << r.bytes_per_second
+         << ", \"allocations_per_op\": " << r.allocations_per_op
+         << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  file << "  ]\n}\n";
+}
+
+}
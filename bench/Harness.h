@@ -0,0 +1,107 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef _HARNESS_H_
+#define _HARNESS_H_
+
+
+namespace Bench
+{
+
+// heap allocations made by the whole program so far, counted by the
+// operator new replacement in Harness.cpp
+std::uint64_t GetAllocationCount();
+
+// keeps the compiler from dropping a computation whose result is unused
+template <typename T>
+inline void
+DoNotOptimize(const T &value)
+{
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+
+/*
+ * Runs each benchmark in batches, doubling the batch until one takes at
+ * least the minimum time, and reports the last batch per operation:
+ * time, payload throughput and heap allocations. Results are printed as
+ * a table and, with --json=FILE, written as JSON so runs can be compared
+ * by scripts.
+ *
+ * Options: --filter=TEXT runs only benchmarks whose name contains TEXT,
+ * --min-time=MS sets the minimum batch time (default 200 ms).
+ */
+class Harness
+{
+public:
+  struct Result
+  {
+    std::string name;
+    std::size_t bytes;
+    std::uint64_t iterations;
+    double ns_per_op;
+    double bytes_per_second;
+    double allocations_per_op;
+  };
+
+  Harness(int argc, char *argv[]);
+
+  // bytes is the payload handled by one operation, zero when throughput
+  // doesn't make sense
+  template <typename Operation>
+  void Run(const std::string &name, const std::size_t &bytes, Operation operation)
+  {
+    if (!IsSelected(name))
+      return;
+
+    for (std::uint64_t iterations = 1; ; iterations *= 2)
+    {
+      const std::uint64_t allocations = GetAllocationCount();
+      const auto start = Clock::now();
+
+      for (std::uint64_t i = 0; i < iterations; i++)
+        operation();
+
+      const auto elapsed = Clock::now() - start;
+      if (elapsed >= min_time || iterations >= MAX_ITERATIONS)
+      {
+        Record(name, bytes, iterations, elapsed, GetAllocationCount() - allocations);
+        return;
+      }
+    }
+  }
+
+  const std::vector<Result>& GetResults() const;
+
+  // writes the JSON file if requested, returns the exit code
+  int Finish() const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr std::uint64_t MAX_ITERATIONS = 1ULL << 30;
+
+  std::string filter;
+  std::string json_path;
+  std::chrono::milliseconds min_time;
+  std::vector<Result> results;
+
+  bool IsSelected(const std::string &name) const;
+  void Record(const std::string &name, const std::size_t &bytes,
+              const std::uint64_t &iterations, const Clock::duration &elapsed,
+              const std::uint64_t &allocations);
+  void Print(const Result &result) const;
+  void WriteJson() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,419 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+/*
+ * The whole tunnel in one unprivileged process: a client and a server
+ * PrimitiveReaderAndWriter on memory TUN devices, talking over UDP on
+ * the loopback interface. A generator injects IPv4 packets into the
+ * client device, a collector takes them out of the server device and
+ * measures how long they took. Reports packets/s, goodput (IP bytes
+ * delivered per second), loss, packets delivered damaged and latency
+ * percentiles for several packet size mixes.
+ *
+ * Usage: loopback_bench [seconds per mix] [packets/s, 0 = as fast as
+ * the tunnel takes them] [path options]
+ *
+ * Path options put a relay with an Impairment in each direction between
+ * client and server: --loss=P, --burst-loss=GOOD_TO_BAD,BAD_TO_GOOD,LOSS
+ * (Gilbert-Elliott), --duplicate=P, --reorder=P, --delay=US, --jitter=US,
+ * --rate-limit=BYTES_PER_SECOND and --seed=N.
+ *
+ * Resolver options put the resolver emulator in front of the server (after
+ * the impaired relay, if any): --cache-ttl=MS, --retry=MS,COUNT, --qps=N,
+ * --edns-size=BYTES, --rewrite-ids and --drop-unsolicited.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include "../src/PrimitiveReaderAndWriter.h"
+#include "../src/Interfaces/MemoryTun.h"
+#include "../src/Interfaces/Impairment.h"
+#include "../src/Interfaces/ImpairedInterface.h"
+#include "../src/Resolver/Proxy.h"
+#include "../src/Interfaces/Socket.h"
+#include "../src/Packets/PseudoDNS.h"
+#include "../src/Metrics/Histogram.h"
+#include "../src/Logging/Logger.h"
+#include "ResolverOptions.h"
+
+using namespace std;
+using namespace Interfaces;
+using namespace Packets;
+
+typedef chrono::steady_clock Clock;
+
+
+// IP packet sizes with their weights
+struct Mix
+{
+  const char *name;
+  vector<pair<size_t, unsigned>> sizes;
+};
+
+const vector<Mix> MIXES = {
+  { "small", { {64, 1} } },
+  // simple IMIX, 64 instead of 40 bytes so the probe fits
+  { "imix", { {64, 7}, {576, 4}, {1500, 1} } },
+  { "large", { {1400, 1} } }
+};
+
+constexpr size_t IP_HEADER_SIZE = 20;
+constexpr size_t UDP_HEADER_SIZE = 8;
+// sequence number and send time after the UDP header
+constexpr size_t PROBE_OFFSET = TunTap::PACKET_INFO_SIZE + IP_HEADER_SIZE + UDP_HEADER_SIZE;
+constexpr size_t PROBE_SIZE = 16;
+static_assert(IP_HEADER_SIZE + UDP_HEADER_SIZE + PROBE_SIZE <= 64,
+              "the smallest packet of the mixes has to hold the probe");
+
+
+MemoryTun::Packet
+MakePacket(const size_t &ip_size, const uint64_t &sequence)
+{
+  MemoryTun::Packet p(TunTap::PACKET_INFO_SIZE + ip_size, 0x5A);
+  uint8_t *ip = p.data() + TunTap::PACKET_INFO_SIZE;
+
+  // packet info: no flags, IPv4
+  p[0] = 0; p[1] = 0; p[2] = 0x08; p[3] = 0x00;
+
+  const uint8_t header[IP_HEADER_SIZE + UDP_HEADER_SIZE] = {
+    0x45, 0x00, uint8_t(ip_size >> 8), uint8_t(ip_size), 0x00, 0x00, 0x40, 0x00,
+    0x40, 0x11, 0x00, 0x00, 10, 0, 0, 1, 10, 0, 0, 2,
+    0x13, 0x88, 0x13, 0x89, uint8_t((ip_size - IP_HEADER_SIZE) >> 8), uint8_t(ip_size - IP_HEADER_SIZE), 0x00, 0x00
+  };
+  memcpy(ip, header, sizeof(header));
+
+  const int64_t now = chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+  memcpy(p.data() + PROBE_OFFSET, &sequence, sizeof(sequence));
+  memcpy(p.data() + PROBE_OFFSET + sizeof(sequence), &now, sizeof(now));
+
+  return p;
+}
+
+
+// reassembly can join fragments of different packets after losses
+bool
+IsComplete(const MemoryTun::Packet &p)
+{
+  if (p.size() < PROBE_OFFSET + PROBE_SIZE)
+    return false;
+
+  const uint8_t *ip = p.data() + TunTap::PACKET_INFO_SIZE;
+  return p.size() - TunTap::PACKET_INFO_SIZE == (size_t(ip[2]) << 8 | ip[3]);
+}
+
+
+// what datagrams go through between client and server
+struct Path
+{
+  bool impaired;
+  Impairment::Profile profile;
+  uint32_t seed;
+
+  bool resolver;
+  Resolver::Emulator::Config resolver_config;
+};
+
+
+struct Result
+{
+  uint64_t sent;
+  uint64_t delivered;
+  uint64_t malformed;
+  uint64_t delivered_bytes;
+  double seconds;
+  Metrics::Histogram::Summary latency;
+  Impairment::Stats upstream;
+  Resolver::Emulator::Stats resolver;
+};
+
+
+// Forwards datagrams between the sockets facing the client and the
+// server, each direction impaired separately, until running is cleared.
+// Returns statistics of the client to server direction.
+Impairment::Stats
+Relay(shared_ptr<Socket> client_side, shared_ptr<Socket> server_side,
+      const Path &path, const atomic<bool> &running)
+{
+  ImpairedInterface upstream(client_side, path.profile, path.seed);
+  ImpairedInterface downstream(server_side, path.profile, path.seed + 1);
+  vector<uint8_t> buffer(ImpairedInterface::MAX_PACKET_SIZE);
+
+  while (running)
+  {
+    bool idle = true;
+
+    if (upstream.IsReadyToRead())
+    {
+      server_side->Write(buffer.data(), upstream.Read(buffer.data(), buffer.size()));
+      idle = false;
+    }
+
+    if (downstream.IsReadyToRead())
+    {
+      client_side->Write(buffer.data(), downstream.Read(buffer.data(), buffer.size()));
+      idle = false;
+    }
+
+    if (idle)
+      usleep(10);
+  }
+
+  client_side->Close();
+  server_side->Close();
+  return upstream.GetStats();
+}
+
+
+Result
+RunMix(const Mix &mix, const chrono::seconds &duration, const unsigned &rate, const Path &path)
+{
+  shared_ptr<Packet> prototype(new PseudoDNS());
+
+  shared_ptr<MemoryTun> client_device(new MemoryTun());
+  shared_ptr<MemoryTun> server_device(new MemoryTun());
+  shared_ptr<TunTap> client_tun = client_device;
+  shared_ptr<TunTap> server_tun = server_device;
+
+  shared_ptr<Socket> server_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  server_socket->Bind(0, "127.0.0.1");
+  shared_ptr<Socket> client_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  client_socket->Bind(0, "127.0.0.1");
+
+  Result result {0, 0, 0, 0, 0, {}, {}, {}};
+  Endpoint target = server_socket->GetLocalEndpoint();
+
+  unique_ptr<Resolver::Proxy> proxy;
+  thread proxy_thread;
+  if (path.resolver)
+  {
+    proxy.reset(new Resolver::Proxy(Endpoint("127.0.0.1", 0), target, path.resolver_config, path.seed));
+    target = proxy->GetLocalEndpoint();
+    proxy_thread = thread(&Resolver::Proxy::Run, proxy.get());
+  }
+
+  atomic<bool> relaying(true);
+  thread relay;
+
+  if (path.impaired)
+  {
+    shared_ptr<Socket> client_side(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+    client_side->Bind(0, "127.0.0.1");
+    client_side->Connect(client_socket->GetLocalEndpoint());
+    shared_ptr<Socket> server_side(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+    server_side->Connect(target);
+
+    client_socket->Connect(client_side->GetLocalEndpoint());
+    relay = thread([&result, client_side, server_side, &path, &relaying]() {
+      result.upstream = Relay(client_side, server_side, path, relaying);
+    });
+  }
+  else
+    client_socket->Connect(target);
+
+  PrimitiveReaderAndWriter client(client_tun, client_socket, prototype);
+  PrimitiveReaderAndWriter server(server_tun, server_socket, prototype);
+  thread client_thread(&PrimitiveReaderAndWriter::Run, &client);
+  thread server_thread(&PrimitiveReaderAndWriter::Run, &server);
+
+  Metrics::Histogram latency("sdnst_bench_loopback_latency_nanoseconds",
+                             "TUN to TUN latency of the loopback benchmark.",
+                             string("mix=\"") + mix.name + "\"");
+  atomic<bool> collecting(true);
+
+  thread collector([&]() {
+    MemoryTun::Packet p;
+
+    while (collecting)
+    {
+      if (!server_device->Extract(p))
+      {
+        usleep(10);
+        continue;
+      }
+
+      if (!IsComplete(p))
+      {
+        result.malformed++;
+        continue;
+      }
+
+      int64_t sent_time;
+      memcpy(&sent_time, p.data() + PROBE_OFFSET + sizeof(uint64_t), sizeof(sent_time));
+      const int64_t now = chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+
+      latency.Record(chrono::nanoseconds(now - sent_time));
+      result.delivered++;
+      result.delivered_bytes += p.size() - TunTap::PACKET_INFO_SIZE;
+    }
+  });
+
+  // weighted choice of sizes, same sequence in every run
+  vector<size_t> sizes;
+  for (auto &s : mix.sizes)
+    sizes.insert(sizes.end(), s.second, s.first);
+  mt19937 random(1);
+
+  const auto start = Clock::now();
+  auto next = start;
+  while (Clock::now() - start < duration)
+  {
+    if (rate)
+    {
+      next += chrono::nanoseconds(1000000000 / rate);
+      this_thread::sleep_until(next);
+    }
+
+    // the packet is moved only when it is accepted
+    MemoryTun::Packet p = MakePacket(sizes[random() % sizes.size()], result.sent);
+    bool injected;
+    while (!(injected = client_device->Inject(move(p))) && Clock::now() - start < duration)
+      this_thread::yield();
+
+    if (injected)
+      result.sent++;
+  }
+  result.seconds = chrono::duration<double>(Clock::now() - start).count();
+
+  // packets on the way still count
+  usleep(200000);
+  collecting = false;
+  collector.join();
+
+  client.Stop();
+  server.Stop();
+  client_thread.join();
+  server_thread.join();
+  relaying = false;
+  if (relay.joinable())
+    relay.join();
+  if (proxy)
+  {
+    proxy->Stop();
+    proxy_thread.join();
+    result.resolver = proxy->GetStats();
+  }
+  client_socket->Close();
+  server_socket->Close();
+
+  result.latency = latency.GetSnapshot().Summarize();
+  return result;
+}
+
+
+// fills the profile from one path option, false when it isn't one
+bool
+ParsePathOption(const string &argument, Path &path)
+{
+  const size_t equals = argument.find('=');
+  if (argument.compare(0, 2, "--") != 0 || equals == string::npos)
+    return false;
+
+  const string name = argument.substr(2, equals - 2);
+  const string value = argument.substr(equals + 1);
+  Impairment::Profile &p = path.profile;
+
+  if (name == "loss")
+    p.loss = stod(value);
+  else if (name == "burst-loss")
+  {
+    if (sscanf(value.c_str(), "%lf,%lf,%lf", &p.good_to_bad, &p.bad_to_good, &p.bad_loss) != 3)
+      return false;
+  }
+  else if (name == "duplicate")
+    p.duplicate = stod(value);
+  else if (name == "reorder")
+    p.reorder = stod(value);
+  else if (name == "delay")
+    p.delay = chrono::microseconds(stoll(value));
+  else if (name == "jitter")
+    p.jitter = chrono::microseconds(stoll(value));
+  else if (name == "rate-limit")
+    p.rate = stoull(value);
+  else if (name == "seed")
+    path.seed = stoul(value);
+  else
+    return false;
+
+  path.impaired = true;
+  return true;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  vector<string> positional;
+  Path path {false, Impairment::Profile(), 1, false, Resolver::Emulator::Config()};
+
+  for (int i = 1; i < argc; i++)
+    if (argv[i][0] != '-')
+      positional.push_back(argv[i]);
+    else if (Bench::ParseResolverOption(argv[i], path.resolver_config))
+      path.resolver = true;
+    else if (!ParsePathOption(argv[i], path))
+    {
+      cerr << "Unknown option: " << argv[i] << endl;
+      return 1;
+    }
+
+  const chrono::seconds duration((positional.size() > 0) ? atoi(positional[0].c_str()) : 2);
+  const unsigned rate = (positional.size() > 1) ? atoi(positional[1].c_str()) : 0;
+
+  // only problems of the tunnel, not its progress messages
+  Logging::Logger::GetInstance().SetSink([](const Logging::Entry &entry) {
+    if (entry.level >= Logging::warning)
+      cerr << string(entry.text, entry.length) << "\n";
+  });
+
+  cout << setw(8) << "mix" << setw(12) << "sent/s" << setw(12) << "packets/s"
+       << setw(8) << "loss%" << setw(8) << "bad" << setw(12) << "Mbit/s"
+       << setw(10) << "p50 us" << setw(10) << "p90 us"
+       << setw(10) << "p99 us" << setw(10) << "p99.9 us" << "\n";
+
+  for (const Mix &mix : MIXES)
+  {
+    const Result r = RunMix(mix, duration, rate, path);
+    const double loss = r.sent ? 100.0 * (r.sent - min(r.delivered, r.sent)) / r.sent : 0;
+    auto us = [](const chrono::nanoseconds &ns) { return ns.count() / 1000.0; };
+
+    cout << setw(8) << mix.name
+         << setw(12) << fixed << setprecision(0) << r.sent / r.seconds
+         << setw(12) << r.delivered / r.seconds
+         << setw(8) << setprecision(2) << loss
+         << setw(8) << r.malformed
+         << setw(12) << setprecision(1) << r.delivered_bytes * 8 / r.seconds / 1e6
+         << setw(10) << us(r.latency.p50)
+         << setw(10) << us(r.latency.p90)
+         << setw(10) << us(r.latency.p99)
+         << setw(10) << us(r.latency.p999) << endl;
+
+    if (path.impaired)
+      cout << setw(8) << "" << "  path to server: " << r.upstream.received << " datagrams, "
+           << r.upstream.lost << " lost, " << r.upstream.rate_dropped << " over rate, "
+           << r.upstream.duplicated << " duplicated, " << r.upstream.reordered << " reordered" << endl;
+
+    if (path.resolver)
+      cout << setw(8) << "" << "  resolver: " << r.resolver.queries << " queries, "
+           << r.resolver.forwarded << " forwarded, " << r.resolver.cache_hits << " cache hits, "
+           << r.resolver.rate_limited << " rate limited, " << r.resolver.retried << " retried, "
+           << r.resolver.timed_out << " timed out, " << r.resolver.truncated << " truncated" << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Cost of the packet code on its own, without sockets or threads:
+ * PseudoDNS Dump, FillFromDump and Clone for fragment sizes up to
+ * MAX_DATA_SIZE, Encapsulator Encapsulate and Decapsulate for payloads
+ * up to a full Ethernet MTU, and the whole round trip of one payload
+ * through fragments and dumps. Run with --json=FILE to keep the results.
+ */
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Harness.h"
+#include "../src/Packets/Encapsulator.h"
+#include "../src/Packets/PseudoDNS.h"
+
+using namespace std;
+using namespace Packets;
+using namespace Bench;
+
+
+const vector<size_t> FRAGMENT_SIZES = {0, 16, 32, PseudoDNS::MAX_DATA_SIZE};
+const vector<size_t> PAYLOAD_SIZES = {0, 64, 256, 512, 1024, 1500};
+
+
+string
+Name(const string &benchmark, const size_t &size)
+{
+  return benchmark + "/" + to_string(size);
+}
+
+
+PseudoDNS
+MakeFragment(const size_t &size)
+{
+  PseudoDNS packet;
+  packet.SetStreamId(0x1234);
+  packet.SetSessionId(0x5678);
+  packet.SetChecksum(true);
+  packet.SetData(Packet::Data(size, 0x5A));
+
+  return packet;
+}
+
+
+void
+BenchFragments(Harness &harness)
+{
+  for (const size_t &size : FRAGMENT_SIZES)
+  {
+    const PseudoDNS packet = MakeFragment(size);
+    const Packet::Data dump = packet.Dump();
+
+    harness.Run(Name("PseudoDNS/Dump", size), size, [&packet]() {
+      Packet::Data d = packet.Dump();
+      DoNotOptimize(d);
+    });
+
+    PseudoDNS parsed;
+    harness.Run(Name("PseudoDNS/FillFromDump", size), size, [&parsed, &dump]() {
+      parsed.FillFromDump(dump);
+      DoNotOptimize(parsed);
+    });
+
+    harness.Run(Name("PseudoDNS/Clone", size), size, [&packet]() {
+      unique_ptr<Packet> copy = packet.Clone();
+      DoNotOptimize(copy);
+    });
+  }
+}
+
+
+void
+BenchPayloads(Harness &harness)
+{
+  const Encapsulator encapsulator(unique_ptr<Packet>(new PseudoDNS()));
+
+  for (const size_t &size : PAYLOAD_SIZES)
+  {
+    const Packet::Data payload(size, 0x5A);
+    const vector<unique_ptr<Packet>> fragments = encapsulator.Encapsulate(payload);
+
+    harness.Run(Name("Encapsulator/Encapsulate", size), size, [&encapsulator, &payload]() {
+      vector<unique_ptr<Packet>> f = encapsulator.Encapsulate(payload);
+      DoNotOptimize(f);
+    });
+
+    harness.Run(Name("Encapsulator/Decapsulate", size), size, [&encapsulator, &fragments]() {
+      Packet::Data d = encapsulator.Decapsulate(fragments);
+      DoNotOptimize(d);
+    });
+
+    // what one payload costs between the TUN device and the socket and back
+    harness.Run(Name("Encapsulator/RoundTrip", size), size, [&encapsulator, &payload]() {
+      vector<unique_ptr<Packet>> received;
+
+      for (const auto &f : encapsulator.Encapsulate(payload))
+      {
+        unique_ptr<Packet> p(new PseudoDNS());
+        p->FillFromDump(f->Dump());
+        received.push_back(move(p));
+      }
+
+      Packet::Data d = encapsulator.Decapsulate(received);
+      DoNotOptimize(d);
+    });
+  }
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  try
+  {
+    Harness harness(argc, argv);
+
+    BenchFragments(harness);
+    BenchPayloads(harness);
+
+    return harness.Finish();
+  }
+  catch (exception &ex)
+  {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+}
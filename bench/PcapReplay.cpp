@@ -0,0 +1,445 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Replays a capture through the codec as fast as it goes, to reproduce
+ * decoder problems and slowdowns seen in production.
+ *
+ * Capture of tunnel datagrams (default): every UDP payload is parsed
+ * with FillFromDump, fragments are reassembled per flow and stream id,
+ * every transmission is opened (--key) and encapsulated again like the
+ * sender does.
+ *
+ * Capture of TUN-side IP packets (--tun): every packet goes through
+ * the whole tunnel: sealed (--key), encapsulated, dumped, parsed,
+ * reassembled and opened, and is compared with the original.
+ *
+ * Usage:
+ *   pcap_replay FILE [--tun] [--port=N] [--checksum] [--key=SECRET]
+ *               [--from=client|server] [--repeat=N] [--json=FILE]
+ *
+ * --port keeps datagrams from or to the port only, --checksum expects
+ * CRC32C in datagrams, --from tells which side sent the datagrams, so
+ * which key opens them. The capture is mapped, not read into memory.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Harness.h"
+#include "../src/Capture/PcapReader.h"
+#include "../src/Capture/CaptureException.h"
+#include "../src/Crypto/Aead.h"
+#include "../src/Crypto/AuthenticationFailedException.h"
+#include "../src/Interfaces/TunTap.h"
+#include "../src/Packets/Aggregator.h"
+#include "../src/Packets/ChecksumMismatchException.h"
+#include "../src/Packets/CorruptedPacketException.h"
+#include "../src/Packets/Encapsulator.h"
+#include "../src/Packets/PseudoDNS.h"
+#include "../src/Packets/WrongMagicNumberException.h"
+
+using namespace std;
+using namespace Capture;
+using namespace Packets;
+
+typedef chrono::steady_clock Clock;
+
+
+struct Options
+{
+  string path;
+  bool tun;
+  int port;
+  bool checksum;
+  string key;
+  bool from_client;
+  unsigned repeat;
+  string json;
+};
+
+
+struct Result
+{
+  uint64_t records;
+  // bytes of datagrams or IP packets going through the codec
+  uint64_t bytes;
+  uint64_t datagrams;
+  uint64_t transmissions;
+  uint64_t packets;
+  // fragments made by Encapsulate
+  uint64_t fragments;
+  uint64_t allocations;
+  double seconds;
+  map<string, uint64_t> skipped;
+  map<string, uint64_t> errors;
+};
+
+
+class Replay
+{
+public:
+  Replay(const Options &options) :
+    options(options),
+    prototype(new PseudoDNS()),
+    result()
+  {
+    prototype->SetChecksum(options.checksum);
+    encapsulator.reset(new Encapsulator(prototype->Clone()));
+
+    if (!options.key.empty())
+    {
+      const bool client = options.from_client || options.tun;
+      const auto key = Crypto::Aead::DeriveKey(options.key, client ? "client to server"
+                                                                   : "server to client");
+      aead.reset(new Crypto::Aead(Crypto::Aead::GetPreferredAlgorithm(), key));
+    }
+  }
+
+  Result Run(PcapReader &capture)
+  {
+    PcapReader::Record record;
+    const uint64_t allocations = Bench::GetAllocationCount();
+    const Clock::time_point start = Clock::now();
+
+    for (unsigned pass = 0; pass < options.repeat; pass++)
+    {
+      capture.Rewind();
+      streams.clear();
+
+      while (capture.Next(record))
+      {
+        result.records++;
+
+        if (record.length < record.original_length)
+          result.skipped["snapped"]++;
+        else if (options.tun)
+          RoundTrip(capture, record);
+        else
+          Decode(capture, record);
+      }
+
+      for (auto &s : streams)
+        if (!s.second.empty())
+          result.errors["unfinished"]++;
+    }
+
+    result.seconds = chrono::duration<double>(Clock::now() - start).count();
+    result.allocations = Bench::GetAllocationCount() - allocations;
+
+    if (capture.IsTruncated())
+      result.errors["truncated_capture"]++;
+
+    return result;
+  }
+
+private:
+  Options options;
+  unique_ptr<PseudoDNS> prototype;
+  unique_ptr<Encapsulator> encapsulator;
+  unique_ptr<Crypto::Aead> aead;
+  Result result;
+
+  map<pair<uint64_t, uint16_t>, vector<unique_ptr<Packet>>> streams;
+  Packet::Data dump;
+  Packet::Data original;
+
+  void Decode(const PcapReader &capture, const PcapReader::Record &record)
+  {
+    PcapReader::Datagram datagram;
+    if (!capture.FindUdpDatagram(record, datagram))
+    {
+      result.skipped["not_udp"]++;
+      return;
+    }
+
+    if (options.port && datagram.source_port != options.port
+        && datagram.destination_port != options.port)
+    {
+      result.skipped["port"]++;
+      return;
+    }
+
+    result.datagrams++;
+    result.bytes += datagram.payload_length;
+    dump.assign(datagram.payload, datagram.payload + datagram.payload_length);
+
+    unique_ptr<Packet> packet = Parse(dump);
+    if (!packet)
+      return;
+
+    if (packet->GetType() == Packet::Type::CONTROL
+        && (packet->GetControlType() == Packet::Control::ECHO_REQUEST
+            || packet->GetControlType() == Packet::Control::ECHO_REPLY))
+    {
+      result.skipped["echo"]++;
+      return;
+    }
+
+    auto &fragments = streams[make_pair(datagram.flow, packet->GetStreamId())];
+
+    if (packet->GetType() != Packet::Type::CONTROL)
+    {
+      fragments.push_back(move(packet));
+      return;
+    }
+
+    Packet::Data data = encapsulator->Decapsulate(fragments);
+    fragments.clear();
+    result.transmissions++;
+
+    if (!Open(data))
+      return;
+
+    // what the sender does with the same transmission
+    result.fragments += encapsulator->Encapsulate(data).size();
+
+    if (packet->GetControlType() != Packet::Control::END_OF_AGGREGATE)
+    {
+      CheckIpPacket(data);
+      return;
+    }
+
+    try {
+      for (auto &p : Aggregator::Split(data))
+        CheckIpPacket(p);
+    }
+    catch (CorruptedPacketException &ex) {
+      result.errors["bad_aggregate"]++;
+    }
+  }
+
+  void RoundTrip(const PcapReader &capture, const PcapReader::Record &record)
+  {
+    const uint8_t *ip;
+    size_t length;
+    if (!capture.FindIpPacket(record, ip, length))
+    {
+      result.skipped["not_ip"]++;
+      return;
+    }
+
+    result.bytes += length;
+
+    // as read from the TUN device
+    original.assign(Interfaces::TunTap::PACKET_INFO_SIZE, 0);
+    original[2] = (ip[0] >> 4 == 4) ? 0x08 : 0x86;
+    original[3] = (ip[0] >> 4 == 4) ? 0x00 : 0xDD;
+    original.insert(original.end(), ip, ip + length);
+
+    Packet::Data data = original;
+    if (aead)
+      aead->Seal(data);
+
+    vector<unique_ptr<Packet>> fragments;
+    for (auto &f : encapsulator->Encapsulate(data))
+    {
+      result.fragments++;
+      result.datagrams++;
+      dump = f->Dump();
+
+      unique_ptr<Packet> packet = Parse(dump);
+      if (!packet)
+        return;
+
+      if (packet->GetType() != Packet::Type::CONTROL)
+        fragments.push_back(move(packet));
+    }
+
+    data = encapsulator->Decapsulate(fragments);
+    result.transmissions++;
+
+    if (!Open(data))
+      return;
+
+    if (data != original)
+    {
+      result.errors["mismatch"]++;
+      return;
+    }
+
+    result.packets++;
+  }
+
+  // nullptr when the datagram is damaged
+  unique_ptr<Packet> Parse(const Packet::Data &datagram)
+  {
+    unique_ptr<Packet> packet = prototype->Clone();
+
+    try {
+      packet->FillFromDump(datagram);
+      return packet;
+    }
+    catch (WrongMagicNumberException &ex) {
+      result.errors["wrong_magic"]++;
+    }
+    catch (ChecksumMismatchException &ex) {
+      result.errors["checksum"]++;
+    }
+    catch (CorruptedPacketException &ex) {
+      result.errors["corrupted"]++;
+    }
+
+    return nullptr;
+  }
+
+  bool Open(Packet::Data &data)
+  {
+    if (!aead)
+      return true;
+
+    try {
+      aead->Open(data);
+      return true;
+    }
+    catch (Crypto::AuthenticationFailedException &ex) {
+      result.errors["authentication"]++;
+      return false;
+    }
+  }
+
+  // reassembly joins fragments of different transmissions after losses
+  void CheckIpPacket(const Packet::Data &data)
+  {
+    const size_t offset = Interfaces::TunTap::PACKET_INFO_SIZE;
+    size_t length = 0;
+
+    if (data.size() > offset + 40 && data[offset] >> 4 == 6)
+      length = 40 + (data[offset + 4] << 8 | data[offset + 5]);
+    else if (data.size() > offset + 20 && data[offset] >> 4 == 4)
+      length = data[offset + 2] << 8 | data[offset + 3];
+
+    if (length != data.size() - offset)
+    {
+      result.errors["incomplete_ip"]++;
+      return;
+    }
+
+    result.packets++;
+  }
+};
+
+
+void
+Print(const Options &options, const Result &r)
+{
+  const double records = r.records ? r.records : 1;
+  const double seconds = r.seconds > 0 ? r.seconds : 1;
+
+  cout << fixed << setprecision(2)
+       << options.path << ": " << r.records << " records in " << r.seconds << " s, "
+       << r.records / seconds / 1e6 << " M records/s, "
+       << r.bytes / seconds / 1e6 << " MB/s, "
+       << r.seconds * 1e9 / records << " ns/record, "
+       << r.allocations / records << " allocations/record\n"
+       << "  datagrams: " << r.datagrams << ", transmissions: " << r.transmissions
+       << ", packets: " << r.packets << ", fragments encapsulated: " << r.fragments << "\n";
+
+  for (auto &s : r.skipped)
+    cout << "  skipped " << s.first << ": " << s.second << "\n";
+  for (auto &e : r.errors)
+    cout << "  error " << e.first << ": " << e.second << "\n";
+
+  cout.flush();
+}
+
+
+void
+WriteJson(const Options &options, const Result &r)
+{
+  ofstream json(options.json);
+
+  auto write_map = [&](const map<string, uint64_t> &m) {
+    json << "{";
+    for (auto i = m.begin(); i != m.end(); ++i)
+      json << (i == m.begin() ? "" : ", ") << "\"" << i->first << "\": " << i->second;
+    json << "}";
+  };
+
+  json << "{\"capture\": \"" << options.path << "\", \"mode\": \""
+       << (options.tun ? "tun" : "datagrams") << "\", \"records\": " << r.records
+       << ", \"bytes\": " << r.bytes << ", \"seconds\": " << r.seconds
+       << ", \"allocations\": " << r.allocations << ", \"datagrams\": " << r.datagrams
+       << ", \"transmissions\": " << r.transmissions << ", \"packets\": " << r.packets
+       << ", \"fragments\": " << r.fragments << ", \"skipped\": ";
+  write_map(r.skipped);
+  json << ", \"errors\": ";
+  write_map(r.errors);
+  json << "}\n";
+}
+
+
+bool
+ParseOptions(const int &argc, char *argv[], Options &options)
+{
+  options = Options { "", false, 0, false, "", true, 1, "" };
+
+  for (int i = 1; i < argc; i++)
+  {
+    const string arg = argv[i];
+    auto value = [&](const string &name) { return arg.substr(name.size()); };
+
+    if (arg == "--tun")
+      options.tun = true;
+    else if (arg.compare(0, 7, "--port=") == 0)
+      options.port = atoi(value("--port=").c_str());
+    else if (arg == "--checksum")
+      options.checksum = true;
+    else if (arg.compare(0, 6, "--key=") == 0)
+      options.key = value("--key=");
+    else if (arg == "--from=client" || arg == "--from=server")
+      options.from_client = (arg == "--from=client");
+    else if (arg.compare(0, 9, "--repeat=") == 0)
+      options.repeat = atoi(value("--repeat=").c_str());
+    else if (arg.compare(0, 7, "--json=") == 0)
+      options.json = value("--json=");
+    else if (options.path.empty() && arg.compare(0, 2, "--") != 0)
+      options.path = arg;
+    else
+      return false;
+  }
+
+  return !options.path.empty() && options.repeat > 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  Options options;
+  if (!ParseOptions(argc, argv, options))
+  {
+    cerr << "Usage: " << argv[0] << " FILE [--tun] [--port=N] [--checksum] [--key=SECRET]\n"
+         << "       [--from=client|server] [--repeat=N] [--json=FILE]" << endl;
+    return 1;
+  }
+
+  try
+  {
+    PcapReader capture(options.path);
+    Replay replay(options);
+    const Result result = replay.Run(capture);
+
+    Print(options, result);
+    if (!options.json.empty())
+      WriteJson(options, result);
+  }
+  catch (exception &ex)
+  {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
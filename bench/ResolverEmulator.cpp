@@ -0,0 +1,83 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Stand-in for a caching recursive resolver between a tunnel client and
+ * its server: point the client at LISTEN_PORT, the emulator forwards to
+ * the server at SERVER_ADDRESS:SERVER_PORT. Prints what it did every
+ * second.
+ *
+ * Usage: resolver_emulator LISTEN_PORT SERVER_ADDRESS SERVER_PORT
+ *        [--cache-ttl=MS] [--retry=MS,COUNT] [--qps=N] [--edns-size=BYTES]
+ *        [--rewrite-ids] [--drop-unsolicited] [--seed=N]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "ResolverOptions.h"
+#include "../src/Resolver/Proxy.h"
+
+using namespace std;
+using namespace Resolver;
+
+
+int
+main(int argc, char *argv[])
+{
+  if (argc < 4)
+  {
+    cerr << "Usage: " << argv[0] << " LISTEN_PORT SERVER_ADDRESS SERVER_PORT [options]" << endl;
+    return 1;
+  }
+
+  Emulator::Config config;
+  unsigned seed = 1;
+
+  for (int i = 4; i < argc; i++)
+  {
+    const string argument = argv[i];
+
+    if (argument.compare(0, 7, "--seed=") == 0)
+      seed = stoul(argument.substr(7));
+    else if (!Bench::ParseResolverOption(argument, config))
+    {
+      cerr << "Unknown option: " << argument << endl;
+      return 1;
+    }
+  }
+
+  try
+  {
+    const Interfaces::Endpoint server(argv[2], atoi(argv[3]));
+    Proxy proxy(Interfaces::Endpoint(server.GetFamily() == AF_INET6 ? "::1" : "127.0.0.1",
+                                     atoi(argv[1])),
+                server, config, seed);
+    thread proxy_thread(&Proxy::Run, &proxy);
+
+    cout << "Listening on " << proxy.GetLocalEndpoint().ToString()
+         << ", forwarding to " << server.ToString() << endl;
+
+    while (true)
+    {
+      this_thread::sleep_for(chrono::seconds(1));
+
+      const Emulator::Stats s = proxy.GetStats();
+      cout << "queries: " << s.queries << ", forwarded: " << s.forwarded
+           << ", cache hits: " << s.cache_hits << ", rate limited: " << s.rate_limited
+           << ", retried: " << s.retried << ", timed out: " << s.timed_out
+           << ", responses: " << s.responses << ", unsolicited: " << s.unsolicited
+           << ", truncated: " << s.truncated << endl;
+    }
+  }
+  catch (exception &ex)
+  {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+}
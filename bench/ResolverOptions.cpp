@@ -0,0 +1,43 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ResolverOptions.h"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+
+namespace Bench
+{
+
+bool
+ParseResolverOption(const string &argument, Resolver::Emulator::Config &config)
+{
+  if (argument == "--rewrite-ids")
+    config.rewrite_ids = true;
+  else if (argument == "--drop-unsolicited")
+    config.drop_unsolicited = true;
+  else if (argument.compare(0, 12, "--cache-ttl=") == 0)
+    config.cache_ttl = chrono::milliseconds(stoll(argument.substr(12)));
+  else if (argument.compare(0, 8, "--retry=") == 0)
+  {
+    long long timeout;
+    if (sscanf(argument.c_str() + 8, "%lld,%u", &timeout, &config.retries) != 2)
+      return false;
+    config.retry_timeout = chrono::milliseconds(timeout);
+  }
+  else if (argument.compare(0, 6, "--qps=") == 0)
+    config.qps = stoul(argument.substr(6));
+  else if (argument.compare(0, 12, "--edns-size=") == 0)
+    config.edns_size = stoul(argument.substr(12));
+  else
+    return false;
+
+  return true;
+}
+
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <string>
+
+#include "../src/Resolver/Emulator.h"
+
+#ifndef _RESOLVEROPTIONS_H_
+#define _RESOLVEROPTIONS_H_
+
+
+namespace Bench
+{
+
+/*
+ * Fills the resolver emulator configuration from one option:
+ * --cache-ttl=MS, --retry=MS,COUNT, --qps=N, --edns-size=BYTES,
+ * --rewrite-ids, --drop-unsolicited. False when it isn't one of them.
+ */
+bool ParseResolverOption(const std::string &argument, Resolver::Emulator::Config &config);
+
+}
+
+#endif
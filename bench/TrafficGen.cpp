@@ -0,0 +1,281 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+/*
+ * UDP traffic for a tunnel set up by netns_bench.sh, sent and received
+ * through the TUN devices. Every datagram carries a sequence number and
+ * its send time. Results are printed as one JSON object.
+ *
+ * Usage:
+ *   traffic_gen send ADDRESS PORT SECONDS SIZE RATE   one way, what was sent
+ *   traffic_gen sink PORT                             what came, ends after
+ *                                                     a second of silence
+ *   traffic_gen ping ADDRESS PORT SECONDS SIZE RATE   round trip times
+ *                                                     through a reflector
+ *   traffic_gen reflect PORT                          sends everything back
+ *
+ * SIZE is the UDP payload, RATE is datagrams per second, 0 sends as fast
+ * as the socket takes them.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "../src/Interfaces/Socket.h"
+#include "../src/Metrics/Histogram.h"
+#include "../src/Logging/Logger.h"
+
+using namespace std;
+using namespace Interfaces;
+
+typedef chrono::steady_clock Clock;
+
+// sequence number and send time
+constexpr size_t PROBE_SIZE = 16;
+constexpr size_t MAX_DATAGRAM_SIZE = 65536;
+constexpr chrono::seconds SILENCE(1);
+
+
+int64_t
+Now()
+{
+  return chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+
+unique_ptr<Socket>
+CreateSocket()
+{
+  return Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+}
+
+
+void
+PrintRate(const uint64_t &count, const uint64_t &bytes, const double &seconds)
+{
+  cout << "\"seconds\": " << seconds
+       << ", \"pps\": " << (seconds > 0 ? count / seconds : 0)
+       << ", \"mbps\": " << (seconds > 0 ? bytes * 8 / seconds / 1e6 : 0);
+}
+
+
+// calls send for every datagram, paced when rate isn't zero
+template <typename Send>
+double
+Generate(const chrono::seconds &duration, const unsigned &rate, Send send)
+{
+  const auto start = Clock::now();
+  auto next = start;
+
+  for (uint64_t sequence = 0; Clock::now() - start < duration; sequence++)
+  {
+    if (rate)
+    {
+      next += chrono::nanoseconds(1000000000 / rate);
+      this_thread::sleep_until(next);
+    }
+
+    send(sequence);
+  }
+
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+void
+FillProbe(vector<uint8_t> &datagram, const uint64_t &sequence)
+{
+  const int64_t now = Now();
+  memcpy(datagram.data(), &sequence, sizeof(sequence));
+  memcpy(datagram.data() + sizeof(sequence), &now, sizeof(now));
+}
+
+
+int
+Send(const Endpoint &destination, const chrono::seconds &duration,
+     const size_t &size, const unsigned &rate)
+{
+  unique_ptr<Socket> socket = CreateSocket();
+  socket->Connect(destination);
+
+  vector<uint8_t> datagram(max(size, PROBE_SIZE), 0x5A);
+  uint64_t sent = 0;
+
+  const double seconds = Generate(duration, rate, [&](const uint64_t &sequence) {
+    FillProbe(datagram, sequence);
+    socket->Write(datagram.data(), datagram.size());
+    sent++;
+  });
+
+  cout << "{\"sent\": " << sent << ", \"bytes\": " << sent * datagram.size() << ", ";
+  PrintRate(sent, sent * datagram.size(), seconds);
+  cout << "}" << endl;
+
+  socket->Close();
+  return 0;
+}
+
+
+int
+Sink(const int &port)
+{
+  unique_ptr<Socket> socket = CreateSocket();
+  socket->Bind(port, "0.0.0.0");
+
+  vector<uint8_t> buffer(MAX_DATAGRAM_SIZE);
+  uint64_t received = 0, bytes = 0, highest = 0;
+  Clock::time_point first, last;
+
+  while (received == 0 || Clock::now() - last < SILENCE)
+  {
+    if (!socket->IsReadyToRead())
+    {
+      usleep(100);
+      continue;
+    }
+
+    const size_t n = socket->Read(buffer.data(), buffer.size());
+    last = Clock::now();
+    if (received++ == 0)
+      first = last;
+    bytes += n;
+
+    uint64_t sequence = 0;
+    if (n >= PROBE_SIZE)
+      memcpy(&sequence, buffer.data(), sizeof(sequence));
+    highest = max(highest, sequence + 1);
+  }
+
+  cout << "{\"received\": " << received << ", \"bytes\": " << bytes
+       << ", \"highest_sequence\": " << highest << ", ";
+  PrintRate(received, bytes, chrono::duration<double>(last - first).count());
+  cout << "}" << endl;
+
+  socket->Close();
+  return 0;
+}
+
+
+int
+Ping(const Endpoint &destination, const chrono::seconds &duration,
+     const size_t &size, const unsigned &rate)
+{
+  unique_ptr<Socket> socket = CreateSocket();
+  socket->Connect(destination);
+
+  Metrics::Histogram rtt("sdnst_bench_rtt_nanoseconds", "Round trip time through the tunnel.");
+  vector<uint8_t> datagram(max(size, PROBE_SIZE), 0x5A);
+  vector<uint8_t> buffer(MAX_DATAGRAM_SIZE);
+  uint64_t sent = 0, received = 0;
+
+  auto receive = [&]() {
+    while (socket->IsReadyToRead())
+    {
+      if (socket->Read(buffer.data(), buffer.size()) < PROBE_SIZE)
+        continue;
+
+      int64_t time;
+      memcpy(&time, buffer.data() + sizeof(uint64_t), sizeof(time));
+      rtt.Record(chrono::nanoseconds(Now() - time));
+      received++;
+    }
+  };
+
+  const double seconds = Generate(duration, rate, [&](const uint64_t &sequence) {
+    FillProbe(datagram, sequence);
+    socket->Write(datagram.data(), datagram.size());
+    sent++;
+    receive();
+  });
+
+  // late replies
+  const auto end = Clock::now() + SILENCE;
+  while (received < sent && Clock::now() < end)
+  {
+    receive();
+    usleep(100);
+  }
+
+  const Metrics::Histogram::Summary s = rtt.GetSnapshot().Summarize();
+  auto us = [](const chrono::nanoseconds &ns) { return ns.count() / 1000.0; };
+
+  cout << "{\"sent\": " << sent << ", \"received\": " << received << ", ";
+  PrintRate(received, received * datagram.size(), seconds);
+  cout << ", \"rtt_us\": {\"p50\": " << us(s.p50) << ", \"p90\": " << us(s.p90)
+       << ", \"p99\": " << us(s.p99) << ", \"p999\": " << us(s.p999)
+       << ", \"max\": " << us(s.max) << "}}" << endl;
+
+  socket->Close();
+  return 0;
+}
+
+
+int
+Reflect(const int &port)
+{
+  unique_ptr<Socket> socket = CreateSocket();
+  socket->Bind(port, "0.0.0.0");
+
+  vector<uint8_t> buffer(MAX_DATAGRAM_SIZE);
+  Endpoint source;
+
+  while (true)
+  {
+    const size_t n = socket->RecvFrom(buffer.data(), buffer.size(), source);
+    socket->SendTo(buffer.data(), n, source);
+  }
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  // sockets log at info level, the output is JSON only
+  Logging::Logger::GetInstance().SetSink([](const Logging::Entry &entry) {
+    if (entry.level >= Logging::warning)
+      cerr << string(entry.text, entry.length) << "\n";
+  });
+
+  const string mode = (argc > 1) ? argv[1] : "";
+
+  try
+  {
+    if ((mode == "send" || mode == "ping") && argc == 7)
+    {
+      const Endpoint destination(argv[2], atoi(argv[3]));
+      const chrono::seconds duration(atoi(argv[4]));
+      const size_t size = atoi(argv[5]);
+      const unsigned rate = atoi(argv[6]);
+
+      if (mode == "send")
+        return Send(destination, duration, size, rate);
+      return Ping(destination, duration, size, rate);
+    }
+
+    if (mode == "sink" && argc == 3)
+      return Sink(atoi(argv[2]));
+
+    if (mode == "reflect" && argc == 3)
+      return Reflect(atoi(argv[2]));
+  }
+  catch (exception &ex)
+  {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  cerr << "Usage: " << argv[0] << " send|ping ADDRESS PORT SECONDS SIZE RATE\n"
+       << "       " << argv[0] << " sink|reflect PORT" << endl;
+  return 1;
+}
@@ -0,0 +1,345 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Runs the tunnel protocol on a virtual clock over simulated links, see
+ * Simulation::TunnelSimulation. Prints throughput, loss and latency
+ * percentiles of each direction; with --sweep=OPTION:FROM:TO:STEP the
+ * simulation is run for every value of the option, with --timeline the
+ * delivered bytes and latency of every 100 ms are printed too.
+ *
+ * Usage: tunnel_sim [options] [--sweep=OPTION:FROM:TO:STEP] [--timeline]
+ *        [--json=FILE]
+ *
+ * Traffic: --duration=MS, --seed=N, --up-rate=PPS, --down-rate=PPS,
+ * --size=BYTES, --poisson, and an interactive flow next to the upstream
+ * traffic: --interactive-rate=PPS, --interactive-size=BYTES.
+ * Tunnel: --poll=US, --burst=DATAGRAMS (sent per poll, 0 = all),
+ * --aggregate-size=BYTES, --aggregate-delay=US, --queue=PACKETS,
+ * --codel-target=US, --codel-interval=US, --drr=0|1 (interleaving of
+ * flows, default 1), --checksum, --encrypt.
+ *
+ * Latency of interactive packets behind bulk traffic, without and with
+ * deficit round robin:
+ *   tunnel_sim --size=1400 --up-rate=180 --interactive-rate=50 --poisson
+ *              --poll=200 --burst=1 --sweep=drr:0:1:1
+ * Both links: --link-rate=BYTES_PER_SECOND, --link-buffer=BYTES,
+ * --loss=P, --duplicate=P, --reorder=P, --delay=US, --jitter=US.
+ * Resolver emulator in front of the server: --cache-ttl=MS,
+ * --retry=MS,COUNT, --qps=N, --edns-size=BYTES, --rewrite-ids and
+ * --drop-unsolicited.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ResolverOptions.h"
+#include "../src/Simulation/TunnelSimulation.h"
+#include "../src/Logging/Logger.h"
+
+using namespace std;
+using namespace Simulation;
+
+
+namespace
+{
+
+struct Point
+{
+  string value;
+  TunnelSimulation::Result result;
+  double wall_seconds;
+};
+
+
+// fills the configuration from one option, false when it isn't one
+bool
+ParseOption(const string &argument, TunnelSimulation::Config &config)
+{
+  if (argument == "--poisson")
+    config.upstream.poisson = config.downstream.poisson = true;
+  else if (argument == "--checksum")
+    config.checksum = true;
+  else if (argument == "--encrypt")
+    config.encryption = true;
+  else if (Bench::ParseResolverOption(argument, config.resolver_config))
+    config.resolver = true;
+  else
+  {
+    const size_t equals = argument.find('=');
+    if (argument.compare(0, 2, "--") != 0 || equals == string::npos)
+      return false;
+
+    const string name = argument.substr(2, equals - 2);
+    const double value = stod(argument.substr(equals + 1));
+    Interfaces::Impairment::Profile &up = config.uplink.path;
+    Interfaces::Impairment::Profile &down = config.downlink.path;
+
+    if (name == "duration")
+      config.duration = chrono::milliseconds(static_cast<long>(value));
+    else if (name == "seed")
+      config.seed = value;
+    else if (name == "up-rate")
+      config.upstream.rate = value;
+    else if (name == "down-rate")
+      config.downstream.rate = value;
+    else if (name == "size")
+      config.upstream.size = config.downstream.size = value;
+    else if (name == "interactive-rate")
+      config.interactive.rate = value;
+    else if (name == "interactive-size")
+      config.interactive.size = value;
+    else if (name == "drr")
+      config.flow_scheduling = value != 0;
+    else if (name == "poll")
+      config.poll_interval = chrono::microseconds(static_cast<long>(value));
+    else if (name == "burst")
+      config.datagrams_per_poll = value;
+    else if (name == "aggregate-size")
+      config.aggregate_size = value;
+    else if (name == "aggregate-delay")
+      config.aggregate_delay = chrono::microseconds(static_cast<long>(value));
+    else if (name == "queue")
+      config.max_queue_size = value;
+    else if (name == "codel-target")
+      config.codel_target = chrono::microseconds(static_cast<long>(value));
+    else if (name == "codel-interval")
+      config.codel_interval = chrono::microseconds(static_cast<long>(value));
+    else if (name == "link-rate")
+      config.uplink.rate = config.downlink.rate = value;
+    else if (name == "link-buffer")
+      config.uplink.buffer = config.downlink.buffer = value;
+    else if (name == "loss")
+      up.loss = down.loss = value;
+    else if (name == "duplicate")
+      up.duplicate = down.duplicate = value;
+    else if (name == "reorder")
+      up.reorder = down.reorder = value;
+    else if (name == "delay")
+      up.delay = down.delay = chrono::microseconds(static_cast<long>(value));
+    else if (name == "jitter")
+      up.jitter = down.jitter = chrono::microseconds(static_cast<long>(value));
+    else
+      return false;
+  }
+
+  return true;
+}
+
+
+vector<string>
+SweepValues(const string &sweep, string &option)
+{
+  char name[64];
+  double from, to, step;
+  if (sscanf(sweep.c_str(), "%63[^:]:%lf:%lf:%lf", name, &from, &to, &step) != 4 || step <= 0)
+    return vector<string>();
+
+  option = name;
+  vector<string> values;
+
+  // counted, so rounding doesn't lose the last value
+  const int count = static_cast<int>((to - from) / step + 1e-9) + 1;
+  for (int i = 0; i < count; i++)
+  {
+    ostringstream value;
+    value << from + i * step;
+    values.push_back(value.str());
+  }
+
+  return values;
+}
+
+
+void
+PrintDirection(const string &label, const TunnelSimulation::Direction &d, const double &seconds)
+{
+  const double loss = d.offered ? 100.0 * (d.offered - d.delivered) / d.offered : 0;
+  auto ms = [](const chrono::nanoseconds &ns) { return ns.count() / 1e6; };
+
+  cout << setw(6) << label
+       << setw(10) << fixed << setprecision(0) << d.offered / seconds
+       << setw(10) << d.delivered / seconds
+       << setw(8) << setprecision(2) << loss
+       << setw(8) << d.damaged
+       << setw(10) << setprecision(1) << d.throughput / 1000
+       << setw(9) << setprecision(2) << ms(d.latency.p50)
+       << setw(9) << ms(d.latency.p90)
+       << setw(9) << ms(d.latency.p99)
+       << setw(9) << ms(d.latency.max);
+}
+
+
+void
+PrintTimeline(const TunnelSimulation::Result &r)
+{
+  cout << "\n" << setw(8) << "time ms" << setw(12) << "up kB" << setw(12) << "up ms"
+       << setw(12) << "down kB" << setw(12) << "down ms" << "\n";
+
+  for (size_t i = 0; i < r.upstream.timeline.size(); i++)
+  {
+    const TunnelSimulation::Sample &up = r.upstream.timeline[i];
+    const TunnelSimulation::Sample &down = r.downstream.timeline[i];
+
+    cout << setw(8) << (i + 1) * 100
+         << setw(12) << setprecision(1) << up.delivered_bytes / 1000.0
+         << setw(12) << setprecision(2) << up.mean_latency.count() / 1e6
+         << setw(12) << setprecision(1) << down.delivered_bytes / 1000.0
+         << setw(12) << setprecision(2) << down.mean_latency.count() / 1e6 << "\n";
+  }
+}
+
+
+void
+WriteDirection(ostream &out, const TunnelSimulation::Direction &d)
+{
+  out << "{\"offered\": " << d.offered << ", \"delivered\": " << d.delivered
+      << ", \"duplicated\": " << d.duplicated << ", \"damaged\": " << d.damaged
+      << ", \"datagrams\": " << d.datagrams
+      << ", \"throughput\": " << d.throughput
+      << ", \"queue_dropped\": " << d.queue.tail_dropped + d.queue.codel_dropped
+      << ", \"p50_ns\": " << d.latency.p50.count() << ", \"p90_ns\": " << d.latency.p90.count()
+      << ", \"p99_ns\": " << d.latency.p99.count() << ", \"max_ns\": " << d.latency.max.count()
+      << ", \"timeline\": [";
+
+  for (size_t i = 0; i < d.timeline.size(); i++)
+    out << (i ? ", " : "") << "[" << d.timeline[i].delivered_bytes
+        << ", " << d.timeline[i].mean_latency.count() << "]";
+
+  out << "]}";
+}
+
+
+void
+WriteJson(const string &path, const string &option, const vector<Point> &points)
+{
+  ofstream out(path);
+  out << "[\n";
+
+  for (size_t i = 0; i < points.size(); i++)
+  {
+    const Point &p = points[i];
+    out << "  {\"option\": \"" << option << "\", \"value\": \"" << p.value
+        << "\", \"events\": " << p.result.events << ", \"wall_seconds\": " << p.wall_seconds
+        << ",\n   \"upstream\": ";
+    WriteDirection(out, p.result.upstream);
+    out << ",\n   \"downstream\": ";
+    WriteDirection(out, p.result.downstream);
+    out << ",\n   \"interactive\": ";
+    WriteDirection(out, p.result.interactive);
+    out << "}" << (i + 1 < points.size() ? "," : "") << "\n";
+  }
+
+  out << "]\n";
+}
+
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  TunnelSimulation::Config config;
+  config.upstream.rate = 1000;
+  vector<string> sweep_values(1);
+  string sweep_option;
+  string json_path;
+  bool timeline = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const string argument = argv[i];
+
+    try
+    {
+      if (argument.compare(0, 8, "--sweep=") == 0)
+      {
+        sweep_values = SweepValues(argument.substr(8), sweep_option);
+        if (sweep_values.empty())
+          throw invalid_argument(argument);
+      }
+      else if (argument.compare(0, 7, "--json=") == 0)
+        json_path = argument.substr(7);
+      else if (argument == "--timeline")
+        timeline = true;
+      else if (!ParseOption(argument, config))
+        throw invalid_argument(argument);
+    }
+    catch (exception&)
+    {
+      cerr << "Bad option: " << argument << endl;
+      return 1;
+    }
+  }
+
+  TunnelSimulation::Config checked = config;
+  if (!sweep_option.empty() && !ParseOption("--" + sweep_option + "=" + sweep_values[0], checked))
+  {
+    cerr << "Option can't be swept: " << sweep_option << endl;
+    return 1;
+  }
+
+  // only problems of the tunnel, damaged datagrams are expected on bad paths
+  Logging::Logger::GetInstance().SetSink([](const Logging::Entry &entry) {
+    if (entry.level >= Logging::error)
+      cerr << string(entry.text, entry.length) << "\n";
+  });
+
+  cout << setw(10) << (sweep_option.empty() ? "" : sweep_option) << setw(6) << "dir"
+       << setw(10) << "offered/s" << setw(10) << "pkts/s" << setw(8) << "loss%" << setw(8) << "bad"
+       << setw(10) << "kB/s" << setw(9) << "p50 ms" << setw(9) << "p90 ms"
+       << setw(9) << "p99 ms" << setw(9) << "max ms" << setw(12) << "sim s/s" << "\n";
+
+  vector<Point> points;
+
+  for (const string &value : sweep_values)
+  {
+    TunnelSimulation::Config point_config = config;
+    if (!sweep_option.empty())
+      ParseOption("--" + sweep_option + "=" + value, point_config);
+
+    const auto start = chrono::steady_clock::now();
+    TunnelSimulation simulation(point_config);
+    const TunnelSimulation::Result r = simulation.Run();
+    const double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    const double simulated = chrono::duration<double>(point_config.duration + point_config.drain).count();
+    const double point_seconds = chrono::duration<double>(point_config.duration).count();
+
+    cout << setw(10) << value;
+    PrintDirection("up", r.upstream, point_seconds);
+    cout << setw(12) << setprecision(1) << simulated / wall << "\n";
+
+    if (point_config.interactive.rate > 0)
+    {
+      cout << setw(10) << "";
+      PrintDirection("int", r.interactive, point_seconds);
+      cout << "\n";
+    }
+
+    if (point_config.downstream.rate > 0)
+    {
+      cout << setw(10) << "";
+      PrintDirection("down", r.downstream, point_seconds);
+      cout << "\n";
+    }
+
+    if (timeline)
+      PrintTimeline(r);
+
+    points.push_back(Point {value, r, wall});
+  }
+
+  if (!json_path.empty())
+    WriteJson(json_path, sweep_option, points);
+
+  return 0;
+}
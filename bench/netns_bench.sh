@@ -0,0 +1,177 @@
+#!/bin/sh
+#
+# Copyright 2014-2015 Adam Chyła, adam@chyla.org
+# All rights reserved. Distributed under the terms of the MIT License.
+#
+# Runs sdnst client and server in two network namespaces joined by a veth
+# pair, with real TUN devices, and drives traffic_gen through the tunnel.
+# Needs root, no network access. Prints one JSON object, e.g. to compare
+# commits:
+#
+#   sudo bench/netns_bench.sh > before.json
+#
+# Environment:
+#   SDNST        sdnst binary (src/sdnst)
+#   TRAFFIC_GEN  traffic_gen binary (bench/traffic_gen)
+#   SDNST_OPTS   more options for both sides, e.g. "--pipeline"
+#   SECONDS_PER_PHASE, SIZE, RATE   traffic of every phase (5, 1000, 0)
+#   PING_RATE    datagrams per second of the RTT phase (1000)
+#
+
+set -e
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+SDNST=${SDNST:-$DIR/../src/sdnst}
+TRAFFIC_GEN=${TRAFFIC_GEN:-$DIR/traffic_gen}
+SECONDS_PER_PHASE=${SECONDS_PER_PHASE:-5}
+SIZE=${SIZE:-1000}
+RATE=${RATE:-0}
+PING_RATE=${PING_RATE:-1000}
+
+CLIENT_NS=sdnst-bench-c
+SERVER_NS=sdnst-bench-s
+CLIENT_VETH=192.168.77.1
+SERVER_VETH=192.168.77.2
+CLIENT_TUN=10.77.0.1
+SERVER_TUN=10.77.0.2
+TUNNEL_PORT=5353
+TRAFFIC_PORT=9000
+
+WORK=$(mktemp -d)
+
+fail() {
+  echo "netns_bench: $*" >&2
+  exit 1
+}
+
+cleanup() {
+  for pid in $REFLECTOR $SINK $CLIENT $SERVER; do
+    kill "$pid" 2>/dev/null || true
+  done
+  wait 2>/dev/null || true
+  ip netns del $CLIENT_NS 2>/dev/null || true
+  ip netns del $SERVER_NS 2>/dev/null || true
+  rm -rf "$WORK"
+}
+
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+[ "$(id -u)" = 0 ] || fail "needs root"
+[ -x "$SDNST" ] || fail "no $SDNST, run make first"
+[ -x "$TRAFFIC_GEN" ] || fail "no $TRAFFIC_GEN, run make -C bench traffic_gen first"
+[ -c /dev/net/tun ] || fail "no /dev/net/tun"
+
+# namespaces and the path between them
+ip netns add $CLIENT_NS
+ip netns add $SERVER_NS
+ip link add sdnst-veth-c type veth peer name sdnst-veth-s
+ip link set sdnst-veth-c netns $CLIENT_NS
+ip link set sdnst-veth-s netns $SERVER_NS
+ip -n $CLIENT_NS addr add $CLIENT_VETH/24 dev sdnst-veth-c
+ip -n $SERVER_NS addr add $SERVER_VETH/24 dev sdnst-veth-s
+for ns in $CLIENT_NS $SERVER_NS; do
+  ip -n $ns link set lo up
+done
+ip -n $CLIENT_NS link set sdnst-veth-c up
+ip -n $SERVER_NS link set sdnst-veth-s up
+
+wait_for_tun() {
+  for i in $(seq 50); do
+    ip -n "$1" link show tun0 >/dev/null 2>&1 && return 0
+    kill -0 "$2" 2>/dev/null || { cat "$WORK"/*.out >&2; fail "sdnst exited in $1"; }
+    sleep 0.1
+  done
+  fail "no tun0 in $1"
+}
+
+# every namespace gets tun0 of its own sdnst, writing to a device that is
+# still down fails, so the server is up before the client says hello
+ip netns exec $SERVER_NS "$SDNST" --mode server --address $SERVER_VETH \
+  --port $TUNNEL_PORT $SDNST_OPTS >"$WORK/server.out" 2>&1 &
+SERVER=$!
+wait_for_tun $SERVER_NS $SERVER
+ip -n $SERVER_NS addr add $SERVER_TUN peer $CLIENT_TUN dev tun0
+ip -n $SERVER_NS link set tun0 up
+
+ip netns exec $CLIENT_NS "$SDNST" --mode client --address $SERVER_VETH \
+  --port $TUNNEL_PORT $SDNST_OPTS >"$WORK/client.out" 2>&1 &
+CLIENT=$!
+wait_for_tun $CLIENT_NS $CLIENT
+ip -n $CLIENT_NS addr add $CLIENT_TUN peer $SERVER_TUN dev tun0
+ip -n $CLIENT_NS link set tun0 up
+
+# user and system time of a process, in clock ticks
+cpu_ticks() {
+  awk '{ print $14 + $15 }' "/proc/$1/stat"
+}
+
+TICKS=$(getconf CLK_TCK)
+
+# runs a phase, prints the CPU seconds of client and server as JSON members
+run_phase() {
+  client_before=$(cpu_ticks $CLIENT)
+  server_before=$(cpu_ticks $SERVER)
+  "$@"
+  client_after=$(cpu_ticks $CLIENT)
+  server_after=$(cpu_ticks $SERVER)
+
+  awk -v c=$((client_after - client_before)) -v s=$((server_after - server_before)) \
+      -v t="$TICKS" 'BEGIN { printf "\"client_cpu_seconds\": %.2f, \"server_cpu_seconds\": %.2f", c / t, s / t }' \
+      >"$WORK/cpu"
+
+  kill -0 $CLIENT 2>/dev/null && kill -0 $SERVER 2>/dev/null \
+    || { cat "$WORK"/*.out >&2; fail "sdnst exited during $1"; }
+}
+
+# the client speaks first, so the server knows where its peer is
+rtt() {
+  ip netns exec $SERVER_NS "$TRAFFIC_GEN" reflect $TRAFFIC_PORT &
+  REFLECTOR=$!
+  sleep 0.2
+  ip netns exec $CLIENT_NS "$TRAFFIC_GEN" ping $SERVER_TUN $TRAFFIC_PORT \
+    "$SECONDS_PER_PHASE" "$SIZE" "$PING_RATE" >"$WORK/rtt.json"
+  kill $REFLECTOR
+  wait $REFLECTOR 2>/dev/null || true
+  REFLECTOR=
+}
+
+one_way() {
+  ip netns exec "$2" "$TRAFFIC_GEN" sink $TRAFFIC_PORT >"$WORK/$1.sink.json" &
+  SINK=$!
+  sleep 0.2
+  ip netns exec "$3" "$TRAFFIC_GEN" send "$4" $TRAFFIC_PORT \
+    "$SECONDS_PER_PHASE" "$SIZE" "$RATE" >"$WORK/$1.send.json"
+  wait $SINK
+  SINK=
+}
+
+upstream() {
+  one_way upstream $SERVER_NS $CLIENT_NS $SERVER_TUN
+}
+
+downstream() {
+  one_way downstream $CLIENT_NS $SERVER_NS $CLIENT_TUN
+}
+
+run_phase rtt
+RTT_CPU=$(cat "$WORK/cpu")
+run_phase upstream
+UPSTREAM_CPU=$(cat "$WORK/cpu")
+run_phase downstream
+DOWNSTREAM_CPU=$(cat "$WORK/cpu")
+
+COMMIT=$(git -C "$DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+cat <<EOF
+{
+  "commit": "$COMMIT",
+  "sdnst_options": "$SDNST_OPTS",
+  "seconds": $SECONDS_PER_PHASE,
+  "size": $SIZE,
+  "rate": $RATE,
+  "rtt": { "traffic": $(cat "$WORK/rtt.json"), $RTT_CPU },
+  "upstream": { "sent": $(cat "$WORK/upstream.send.json"), "received": $(cat "$WORK/upstream.sink.json"), $UPSTREAM_CPU },
+  "downstream": { "sent": $(cat "$WORK/downstream.send.json"), "received": $(cat "$WORK/downstream.sink.json"), $DOWNSTREAM_CPU }
+}
+EOF
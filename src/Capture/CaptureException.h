@@ -0,0 +1,27 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <stdexcept>
+#include <string>
+
+#ifndef _CAPTUREEXCEPTION_H_
+#define _CAPTUREEXCEPTION_H_
+
+
+namespace Capture
+{
+
+class CaptureException : public std::runtime_error
+{
+public:
+  CaptureException(const std::string &message) :
+    std::runtime_error(message)
+  {
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "PcapReader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CaptureException.h"
+
+using namespace std;
+
+
+namespace Capture
+{
+
+namespace
+{
+
+constexpr uint32_t MAGIC_MICROSECONDS = 0xA1B2C3D4;
+constexpr uint32_t MAGIC_NANOSECONDS = 0xA1B23C4D;
+
+constexpr size_t ETHERNET_HEADER_SIZE = 14;
+constexpr size_t VLAN_TAG_SIZE = 4;
+constexpr size_t SLL_HEADER_SIZE = 16;
+constexpr size_t NULL_HEADER_SIZE = 4;
+constexpr size_t IPV6_HEADER_SIZE = 40;
+constexpr size_t UDP_HEADER_SIZE = 8;
+constexpr uint8_t PROTOCOL_UDP = 17;
+
+uint32_t
+Swap32(const uint32_t &value)
+{
+  return __builtin_bswap32(value);
+}
+
+uint16_t
+Get16(const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+
+uint64_t
+Hash(uint64_t hash, const uint8_t *data, const size_t &length)
+{
+  // FNV-1a
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ data[i]) * 0x100000001B3;
+
+  return hash;
+}
+
+}
+
+constexpr uint32_t PcapReader::LINKTYPE_NULL;
+constexpr uint32_t PcapReader::LINKTYPE_ETHERNET;
+constexpr uint32_t PcapReader::LINKTYPE_RAW;
+constexpr uint32_t PcapReader::LINKTYPE_LINUX_SLL;
+constexpr uint32_t PcapReader::LINKTYPE_IPV4;
+constexpr uint32_t PcapReader::LINKTYPE_IPV6;
+constexpr size_t PcapReader::FILE_HEADER_SIZE;
+constexpr size_t PcapReader::RECORD_HEADER_SIZE;
+constexpr size_t PcapReader::RELEASE_SIZE;
+
+
+PcapReader::PcapReader(const string &path) :
+  file(nullptr),
+  size(0),
+  offset(FILE_HEADER_SIZE),
+  released(0),
+  swapped(false),
+  nanoseconds(false),
+  link_type(0),
+  truncated(false)
+{
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw CaptureException(path + ": " + strerror(errno));
+
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+  {
+    const int error = errno;
+    close(fd);
+    throw CaptureException(path + ": " + strerror(error));
+  }
+  size = st.st_size;
+
+  if (size < FILE_HEADER_SIZE)
+  {
+    close(fd);
+    throw CaptureException(path + ": not a pcap file");
+  }
+
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  const int error = errno;
+  close(fd);
+
+  if (mapping == MAP_FAILED)
+    throw CaptureException(path + ": " + strerror(error));
+
+  file = static_cast<const uint8_t*>(mapping);
+  madvise(mapping, size, MADV_SEQUENTIAL);
+
+  const uint32_t magic = Read32(0);
+  if (magic == Swap32(MAGIC_MICROSECONDS) || magic == Swap32(MAGIC_NANOSECONDS))
+    swapped = true;
+  else if (magic != MAGIC_MICROSECONDS && magic != MAGIC_NANOSECONDS)
+  {
+    munmap(mapping, size);
+    throw CaptureException(path + ": not a pcap file, pcapng isn't supported");
+  }
+
+  nanoseconds = (Read32(0) == MAGIC_NANOSECONDS);
+  link_type = Read32(20) & 0xFFFF;
+}
+
+
+PcapReader::~PcapReader()
+{
+  munmap(const_cast<uint8_t*>(file), size);
+}
+
+
+uint32_t
+PcapReader::GetLinkType() const
+{
+  return link_type;
+}
+
+
+size_t
+PcapReader::GetFileSize() const
+{
+  return size;
+}
+
+
+bool
+PcapReader::Next(Record &record)
+{
+  if (offset == size)
+    return false;
+
+  if (size - offset < RECORD_HEADER_SIZE)
+  {
+    truncated = true;
+    offset = size;
+    return false;
+  }
+
+  const uint64_t seconds = Read32(offset);
+  const uint64_t fraction = Read32(offset + 4);
+  record.length = Read32(offset + 8);
+  record.original_length = Read32(offset + 12);
+  record.timestamp_ns = seconds * 1000000000 + (nanoseconds ? fraction : fraction * 1000);
+
+  if (size - offset - RECORD_HEADER_SIZE < record.length)
+  {
+    truncated = true;
+    offset = size;
+    return false;
+  }
+
+  // everything before this record was read
+  Release();
+
+  record.data = file + offset + RECORD_HEADER_SIZE;
+  offset += RECORD_HEADER_SIZE + record.length;
+  return true;
+}
+
+
+void
+PcapReader::Rewind()
+{
+  offset = FILE_HEADER_SIZE;
+  released = 0;
+  truncated = false;
+}
+
+
+bool
+PcapReader::IsTruncated() const
+{
+  return truncated;
+}
+
+
+bool
+PcapReader::FindIpPacket(const Record &record, const uint8_t *&ip, size_t &length) const
+{
+  size_t header = 0;
+
+  switch (link_type)
+  {
+  case LINKTYPE_RAW:
+  case LINKTYPE_IPV4:
+  case LINKTYPE_IPV6:
+    break;
+
+  case LINKTYPE_NULL:
+    header = NULL_HEADER_SIZE;
+    break;
+
+  case LINKTYPE_LINUX_SLL:
+    header = SLL_HEADER_SIZE;
+    break;
+
+  case LINKTYPE_ETHERNET:
+  {
+    header = ETHERNET_HEADER_SIZE;
+    if (record.length < header)
+      return false;
+
+    uint16_t type = Get16(record.data + 12);
+    if (type == 0x8100 && record.length >= header + VLAN_TAG_SIZE)
+    {
+      type = Get16(record.data + 16);
+      header += VLAN_TAG_SIZE;
+    }
+
+    if (type != 0x0800 && type != 0x86DD)
+      return false;
+    break;
+  }
+
+  default:
+    return false;
+  }
+
+  if (record.length <= header)
+    return false;
+
+  ip = record.data + header;
+  length = record.length - header;
+
+  const uint8_t version = ip[0] >> 4;
+  return version == 4 || version == 6;
+}
+
+
+bool
+PcapReader::FindUdpDatagram(const Record &record, Datagram &datagram) const
+{
+  if (!FindIpPacket(record, datagram.ip, datagram.ip_length))
+    return false;
+
+  const uint8_t *ip = datagram.ip;
+  size_t header;
+  size_t total;
+
+  if (ip[0] >> 4 == 4)
+  {
+    header = (ip[0] & 0x0F) * 4;
+    if (datagram.ip_length < 20 || header < 20)
+      return false;
+
+    total = Get16(ip + 2);
+    // fragments of bigger datagrams
+    const bool fragment = (Get16(ip + 6) & 0x3FFF) != 0;
+    if (ip[9] != PROTOCOL_UDP || fragment)
+      return false;
+
+    datagram.flow = Hash(0xCBF29CE484222325, ip + 12, 8);
+  }
+  else
+  {
+    header = IPV6_HEADER_SIZE;
+    if (datagram.ip_length < header)
+      return false;
+
+    // extension headers aren't followed
+    total = header + Get16(ip + 4);
+    if (ip[6] != PROTOCOL_UDP)
+      return false;
+
+    datagram.flow = Hash(0xCBF29CE484222325, ip + 8, 32);
+  }
+
+  if (total > datagram.ip_length || total < header + UDP_HEADER_SIZE)
+    return false;
+
+  const uint8_t *udp = ip + header;
+  datagram.source_port = Get16(udp);
+  datagram.destination_port = Get16(udp + 2);
+  datagram.flow = Hash(datagram.flow, udp, 4);
+
+  const size_t udp_length = Get16(udp + 4);
+  if (udp_length < UDP_HEADER_SIZE || udp_length > total - header)
+    return false;
+
+  datagram.ip_length = total;
+  datagram.payload = udp + UDP_HEADER_SIZE;
+  datagram.payload_length = udp_length - UDP_HEADER_SIZE;
+  return true;
+}
+
+
+uint32_t
+PcapReader::Read32(const size_t &position) const
+{
+  uint32_t value;
+  memcpy(&value, file + position, sizeof(value));
+
+  return swapped ? Swap32(value) : value;
+}
+
+
+void
+PcapReader::Release()
+{
+  const size_t page = sysconf(_SC_PAGESIZE);
+  const size_t end = offset / page * page;
+
+  if (end - released < RELEASE_SIZE)
+    return;
+
+  madvise(const_cast<uint8_t*>(file) + released, end - released, MADV_DONTNEED);
+  released = end;
+}
+
+}
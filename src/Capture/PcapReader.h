@@ -0,0 +1,97 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <boost/noncopyable.hpp>
+
+#ifndef _PCAPREADER_H_
+#define _PCAPREADER_H_
+
+
+namespace Capture
+{
+
+/*
+ * Reads records of a pcap file (the classic format, any byte order,
+ * micro- or nanosecond timestamps) mapped into memory. Pages behind the
+ * reader are given back to the kernel, so captures larger than memory
+ * can be read. Records point into the mapping and are valid until the
+ * reader is destroyed or rewound.
+ */
+class PcapReader : private boost::noncopyable
+{
+public:
+  // link types, as in the pcap file header
+  static constexpr std::uint32_t LINKTYPE_NULL = 0;
+  static constexpr std::uint32_t LINKTYPE_ETHERNET = 1;
+  static constexpr std::uint32_t LINKTYPE_RAW = 101;
+  static constexpr std::uint32_t LINKTYPE_LINUX_SLL = 113;
+  static constexpr std::uint32_t LINKTYPE_IPV4 = 228;
+  static constexpr std::uint32_t LINKTYPE_IPV6 = 229;
+
+  static constexpr std::size_t FILE_HEADER_SIZE = 24;
+  static constexpr std::size_t RECORD_HEADER_SIZE = 16;
+  // how much has to be read before it is dropped from memory
+  static constexpr std::size_t RELEASE_SIZE = 64 << 20;
+
+  struct Record
+  {
+    const std::uint8_t *data;
+    // captured, may be less than the length on the wire
+    std::size_t length;
+    std::size_t original_length;
+    std::uint64_t timestamp_ns;
+  };
+
+  // IP packet of a record and the UDP datagram in it
+  struct Datagram
+  {
+    const std::uint8_t *ip;
+    std::size_t ip_length;
+    const std::uint8_t *payload;
+    std::size_t payload_length;
+    std::uint16_t source_port;
+    std::uint16_t destination_port;
+    // hash of addresses and ports, every direction has its own
+    std::uint64_t flow;
+  };
+
+  // throws CaptureException when the file can't be mapped or isn't pcap
+  PcapReader(const std::string &path);
+  ~PcapReader();
+
+  std::uint32_t GetLinkType() const;
+  std::size_t GetFileSize() const;
+
+  // false at the end of the file; a record cut short by the end of the
+  // file ends it too, and is counted as truncated
+  bool Next(Record &record);
+  void Rewind();
+  bool IsTruncated() const;
+
+  // false when the link layer isn't supported or doesn't carry IP
+  bool FindIpPacket(const Record &record, const std::uint8_t *&ip, std::size_t &length) const;
+  // false when the record isn't a whole, unfragmented UDP datagram
+  bool FindUdpDatagram(const Record &record, Datagram &datagram) const;
+
+private:
+  const std::uint8_t *file;
+  std::size_t size;
+  std::size_t offset;
+  std::size_t released;
+  bool swapped;
+  bool nanoseconds;
+  std::uint32_t link_type;
+  bool truncated;
+
+  std::uint32_t Read32(const std::size_t &position) const;
+  void Release();
+};
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "../Metrics/Histogram.h"
+
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+
+namespace Codec
+{
+
+/*
+ * Latency of every stage of the tunnel, shared by the codec and the
+ * threads doing I/O. Any thread may record.
+ */
+struct Latency
+{
+  struct Stats
+  {
+    Metrics::Histogram::Summary tun_to_socket;
+    Metrics::Histogram::Summary encode;
+    Metrics::Histogram::Summary decode;
+    Metrics::Histogram::Summary reassembly;
+    Metrics::Histogram::Summary round_trip;
+  };
+
+  // from queueing an IP packet to sending the last fragment of its transmission
+  Metrics::Histogram tun_to_socket;
+  // dequeueing, sealing, fragmenting and dumping one datagram
+  Metrics::Histogram encode;
+  // parsing and reassembling one datagram
+  Metrics::Histogram decode;
+  // from the first to the last fragment of a transmission
+  Metrics::Histogram reassembly;
+  // echo request to echo reply
+  Metrics::Histogram round_trip;
+
+  Latency() :
+    tun_to_socket("sdnst_stage_latency_seconds", STAGE_HELP, "stage=\"tun_to_socket\""),
+    encode("sdnst_stage_latency_seconds", STAGE_HELP, "stage=\"encode\""),
+    decode("sdnst_stage_latency_seconds", STAGE_HELP, "stage=\"decode\""),
+    reassembly("sdnst_stage_latency_seconds", STAGE_HELP, "stage=\"reassembly\""),
+    round_trip("sdnst_round_trip_time_seconds", "Tunnel round trip time measured with echo requests.")
+  {
+  }
+
+  Stats GetStats() const
+  {
+    return {
+      tun_to_socket.GetSnapshot().Summarize(),
+      encode.GetSnapshot().Summarize(),
+      decode.GetSnapshot().Summarize(),
+      reassembly.GetSnapshot().Summarize(),
+      round_trip.GetSnapshot().Summarize()
+    };
+  }
+
+private:
+  static constexpr const char *STAGE_HELP = "Time spent in stages of the tunnel.";
+};
+
+}
+
+#endif
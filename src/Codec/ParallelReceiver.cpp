@@ -0,0 +1,126 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ParallelReceiver.h"
+
+#include <utility>
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Codec
+{
+
+constexpr size_t ParallelReceiver::WORKER_QUEUE_SIZE;
+constexpr size_t ParallelReceiver::PARSE_BATCH_SIZE;
+
+
+ParallelReceiver::ParallelReceiver(const ReceiverFactory &factory, const size_t &workers,
+                                   const shared_ptr<Latency> &latency) :
+  receiver(factory()),
+  pool(workers, WORKER_QUEUE_SIZE, [factory, latency]() {
+    shared_ptr<Receiver> worker(factory());
+
+    return [worker, latency](Item &in, Item &out) {
+      return Work(*worker, latency, in, out);
+    };
+  })
+{
+}
+
+
+Receiver&
+ParallelReceiver::GetReceiver()
+{
+  return *receiver;
+}
+
+
+bool
+ParallelReceiver::Push(Packet::Data &&datagram)
+{
+  if (batch.datagrams.size() == PARSE_BATCH_SIZE)
+    return false;
+
+  batch.datagrams.push_back(move(datagram));
+  return true;
+}
+
+
+bool
+ParallelReceiver::Poll(vector<Packet::Data> &packets, const Receiver::Clock::time_point &now)
+{
+  bool busy = false;
+  Item result;
+
+  while (pool.TryCollect(result))
+  {
+    for (auto &fragment : result.fragments)
+    {
+      Item item;
+      if (receiver->Reassemble(move(fragment), item.transmission, now))
+        transmissions.push_back(move(item));
+    }
+
+    if (result.decoded && receiver->Accept(result.transmission, result.packets.size()))
+      for (auto &packet : result.packets)
+        packets.push_back(move(packet));
+
+    busy = true;
+  }
+
+  // reassembled transmissions first, they don't wait for new datagrams
+  while (!transmissions.empty() && pool.TrySubmit(move(transmissions.front())))
+  {
+    transmissions.pop_front();
+    busy = true;
+  }
+
+  if (transmissions.empty() && !batch.datagrams.empty() && pool.TrySubmit(move(batch)))
+  {
+    batch.datagrams.clear();
+    busy = true;
+  }
+
+  return busy;
+}
+
+
+bool
+ParallelReceiver::HasPendingData() const
+{
+  return !batch.datagrams.empty() || !transmissions.empty() || pool.GetInFlightCount() != 0;
+}
+
+
+bool
+ParallelReceiver::Work(Receiver &receiver, const shared_ptr<Latency> &latency,
+                       Item &in, Item &out)
+{
+  const auto start = Receiver::Clock::now();
+  out = move(in);
+  out.fragments.clear();
+  out.packets.clear();
+
+  // damaged datagrams are counted and dropped by Parse()
+  for (auto &datagram : out.datagrams)
+  {
+    auto fragment = receiver.Parse(datagram);
+    if (fragment)
+      out.fragments.push_back(move(fragment));
+  }
+  out.datagrams.clear();
+
+  out.decoded = !out.transmission.fragments.empty()
+                && receiver.Decode(out.transmission, out.packets);
+
+  if (latency)
+    latency->decode.Record(Receiver::Clock::now() - start);
+
+  return true;
+}
+
+}
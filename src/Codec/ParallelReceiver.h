@@ -0,0 +1,89 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "Receiver.h"
+#include "Latency.h"
+#include "../Packets/Packet.h"
+#include "../Pipeline/WorkerPool.h"
+
+#ifndef _PARALLELRECEIVER_H_
+#define _PARALLELRECEIVER_H_
+
+
+namespace Codec
+{
+
+/*
+ * Receiver doing its work in a pool of threads. Workers parse datagrams
+ * in batches and open and split reassembled transmissions, the calling
+ * thread only reassembles and rejects replayed transmissions. Results
+ * come back in the order they were handed over.
+ */
+class ParallelReceiver : private boost::noncopyable
+{
+public:
+  // every worker gets its own Receiver, set up like the one reassembling
+  typedef std::function<std::unique_ptr<Receiver>()> ReceiverFactory;
+
+  // items queued per worker
+  static constexpr std::size_t WORKER_QUEUE_SIZE = 64;
+  // datagrams parsed by one job, a single datagram isn't worth the
+  // handover
+  static constexpr std::size_t PARSE_BATCH_SIZE = 16;
+
+  // latency records the time of every job, nullptr disables
+  ParallelReceiver(const ReceiverFactory &factory, const std::size_t &workers,
+                   const std::shared_ptr<Latency> &latency = nullptr);
+  virtual ~ParallelReceiver() = default;
+
+  // reassembling side, for echo replies and the handoff state
+  virtual Receiver& GetReceiver();
+
+  // Takes the datagram, false when PARSE_BATCH_SIZE datagrams wait for
+  // a worker already. The datagram is left untouched then.
+  virtual bool Push(Packets::Packet::Data &&datagram);
+
+  // Hands datagrams and transmissions to the workers and appends IP
+  // packets they decoded, in the order of reassembly. Returns false when
+  // nothing was done.
+  virtual bool Poll(std::vector<Packets::Packet::Data> &packets,
+                    const Receiver::Clock::time_point &now);
+
+  virtual bool HasPendingData() const;
+
+protected:
+  // datagrams to parse, or a transmission to decode
+  struct Item
+  {
+    std::vector<Packets::Packet::Data> datagrams;
+    std::vector<std::unique_ptr<Packets::Packet>> fragments;
+    Receiver::Transmission transmission;
+    std::vector<Packets::Packet::Data> packets;
+    bool decoded;
+  };
+
+  typedef Pipeline::WorkerPool<Item, Item> Pool;
+
+  std::unique_ptr<Receiver> receiver;
+  Pool pool;
+
+  // waiting for a free worker
+  Item batch;
+  std::deque<Item> transmissions;
+
+  static bool Work(Receiver &receiver, const std::shared_ptr<Latency> &latency,
+                   Item &in, Item &out);
+};
+
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ParallelSender.h"
+
+#include <utility>
+#include <exception>
+
+#include "../Logging/Log.h"
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Codec
+{
+
+constexpr size_t ParallelSender::WORKER_QUEUE_SIZE;
+constexpr size_t ParallelSender::DUMP_BATCH_SIZE;
+constexpr size_t ParallelSender::MAX_SPARE_DATAGRAMS;
+
+
+ParallelSender::ParallelSender(const SenderFactory &factory, const size_t &workers,
+                               const shared_ptr<Latency> &latency) :
+  sender(factory()),
+  pool(workers, WORKER_QUEUE_SIZE, [factory, latency]() {
+    shared_ptr<Sender> worker(factory());
+
+    return [worker, latency](Item &in, Item &out) {
+      return Work(*worker, latency, in, out);
+    };
+  }),
+  transmission_pending(false)
+{
+}
+
+
+Sender&
+ParallelSender::GetSender()
+{
+  return *sender;
+}
+
+
+bool
+ParallelSender::Poll(vector<Packet::Data> &datagrams, const Sender::Clock::time_point &now)
+{
+  bool busy = false;
+  Item result;
+
+  // finished trains make room for the next transmissions
+  while (pool.TryCollect(result))
+  {
+    if (result.failed)
+      sender->DropTransmission(result.transmission);
+    else if (result.datagrams.empty())
+      sender->QueueTrain(result.transmission);
+
+    for (auto &datagram : result.datagrams)
+      datagrams.push_back(move(datagram));
+
+    busy = true;
+  }
+
+  while (transmission_pending || sender->PullTransmission(transmission.transmission, now))
+  {
+    transmission_pending = !pool.TrySubmit(move(transmission));
+    if (transmission_pending)
+      break;
+
+    busy = true;
+  }
+
+  while (true)
+  {
+    while (batch.fragments.size() < DUMP_BATCH_SIZE)
+    {
+      auto fragment = sender->PullFragment(now);
+      if (!fragment)
+        break;
+
+      batch.fragments.push_back(move(fragment));
+    }
+
+    while (batch.datagrams.size() < batch.fragments.size() && !spare_datagrams.empty())
+    {
+      batch.datagrams.push_back(move(spare_datagrams.back()));
+      spare_datagrams.pop_back();
+    }
+
+    if (batch.fragments.empty() || !pool.TrySubmit(move(batch)))
+      break;
+
+    batch.fragments.clear();
+    batch.datagrams.clear();
+    busy = true;
+  }
+
+  return busy;
+}
+
+
+void
+ParallelSender::Recycle(Packet::Data &&datagram)
+{
+  if (spare_datagrams.size() < MAX_SPARE_DATAGRAMS)
+    spare_datagrams.push_back(move(datagram));
+}
+
+
+bool
+ParallelSender::HasPendingData() const
+{
+  return sender->HasPendingData() || transmission_pending || !batch.fragments.empty()
+         || pool.GetInFlightCount() != 0;
+}
+
+
+bool
+ParallelSender::Work(Sender &sender, const shared_ptr<Latency> &latency,
+                     Item &in, Item &out)
+{
+  const auto start = Sender::Clock::now();
+  const bool encapsulate = in.fragments.empty();
+  out = move(in);
+  out.datagrams.resize(out.fragments.size());
+  out.failed = false;
+
+  try {
+    if (encapsulate)
+      sender.Encapsulate(out.transmission);
+
+    for (size_t i = 0; i < out.fragments.size(); i++)
+      out.fragments[i]->Dump(out.datagrams[i]);
+  }
+  catch (exception &ex) {
+    LOG(warning) << "Encoder dropped " << (encapsulate ? "transmission" : "fragments")
+                 << ": " << ex.what();
+
+    // dropped fragments are no longer counted by the sender
+    if (!encapsulate)
+      return false;
+
+    out.transmission.train.clear();
+    out.failed = true;
+  }
+  out.fragments.clear();
+
+  if (latency)
+    latency->encode.Record(Sender::Clock::now() - start);
+
+  return true;
+}
+
+}
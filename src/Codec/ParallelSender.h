@@ -0,0 +1,92 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "Sender.h"
+#include "Latency.h"
+#include "../Packets/Packet.h"
+#include "../Pipeline/WorkerPool.h"
+
+#ifndef _PARALLELSENDER_H_
+#define _PARALLELSENDER_H_
+
+
+namespace Codec
+{
+
+/*
+ * Sender doing its work in a pool of threads. The calling thread only
+ * queues packets and decides the order of fragments, workers seal and
+ * split transmissions and dump fragments in batches. Results come back
+ * in the order they were handed over.
+ */
+class ParallelSender : private boost::noncopyable
+{
+public:
+  // every worker gets its own Sender, set up like the one queueing
+  typedef std::function<std::unique_ptr<Sender>()> SenderFactory;
+
+  // items queued per worker
+  static constexpr std::size_t WORKER_QUEUE_SIZE = 64;
+  // fragments dumped by one job, a single fragment isn't worth the
+  // handover
+  static constexpr std::size_t DUMP_BATCH_SIZE = 16;
+  // buffers of sent datagrams kept for the next dumps
+  static constexpr std::size_t MAX_SPARE_DATAGRAMS = 4 * DUMP_BATCH_SIZE;
+
+  // latency records the time of every job, nullptr disables
+  ParallelSender(const SenderFactory &factory, const std::size_t &workers,
+                 const std::shared_ptr<Latency> &latency = nullptr);
+  virtual ~ParallelSender() = default;
+
+  // queueing side, for Push() and the queue stats
+  virtual Sender& GetSender();
+
+  // Hands transmissions and fragments to the workers and appends dumps
+  // they finished, in the order of sending. Returns false when nothing
+  // was done.
+  virtual bool Poll(std::vector<Packets::Packet::Data> &datagrams,
+                    const Sender::Clock::time_point &now);
+  // takes a buffer of a sent datagram, workers dump into it again
+  virtual void Recycle(Packets::Packet::Data &&datagram);
+
+  virtual bool HasPendingData() const;
+
+protected:
+  // a transmission to seal and split, or fragments to dump into the
+  // datagram buffers
+  struct Item
+  {
+    Sender::Transmission transmission;
+    std::vector<std::unique_ptr<Packets::Packet>> fragments;
+    std::vector<Packets::Packet::Data> datagrams;
+    // the transmission couldn't be sealed or split, it comes back anyway
+    // to be dropped by the sender which counts it in flight
+    bool failed;
+  };
+
+  typedef Pipeline::WorkerPool<Item, Item> Pool;
+
+  std::unique_ptr<Sender> sender;
+  Pool pool;
+
+  // waiting for a free worker
+  Item transmission;
+  bool transmission_pending;
+  Item batch;
+  std::vector<Packets::Packet::Data> spare_datagrams;
+
+  static bool Work(Sender &sender, const std::shared_ptr<Latency> &latency,
+                   Item &in, Item &out);
+};
+
+}
+
+#endif
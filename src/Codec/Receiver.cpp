@@ -0,0 +1,390 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Receiver.h"
+#include "../Packets/Aggregator.h"
+#include "../Packets/CorruptedPacketException.h"
+#include "../Packets/WrongMagicNumberException.h"
+#include "../Crypto/AuthenticationFailedException.h"
+#include "../Logging/Log.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "../Metrics/Counter.h"
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Codec
+{
+
+namespace
+{
+
+// a peer can send any number of bad datagrams, so drops are counted here
+// and logged only at the debug level, compiled out of release builds
+Metrics::Counter corrupted("sdnst_dropped_datagrams_total",
+                           "Received datagrams and transmissions dropped by the decoder.",
+                           "reason=\"corrupted\"");
+Metrics::Counter unauthenticated("sdnst_dropped_datagrams_total",
+                                 "Received datagrams and transmissions dropped by the decoder.",
+                                 "reason=\"authentication\"");
+Metrics::Counter replayed("sdnst_dropped_datagrams_total",
+                          "Received datagrams and transmissions dropped by the decoder.",
+                          "reason=\"replay\"");
+Metrics::Counter abandoned("sdnst_dropped_datagrams_total",
+                           "Received datagrams and transmissions dropped by the decoder.",
+                           "reason=\"reassembly\"");
+Metrics::Counter delivered("sdnst_delivered_packets_total",
+                           "IP packets decoded from the tunnel.");
+
+}
+
+constexpr size_t Receiver::MAX_PENDING_REPLIES;
+constexpr chrono::milliseconds Receiver::DEFAULT_STREAM_TIMEOUT;
+constexpr size_t Receiver::DEFAULT_MAX_STREAM_SIZE;
+constexpr size_t Receiver::DEFAULT_MAX_STREAMS;
+
+
+Receiver::Receiver(unique_ptr<Packet> &&prototype) :
+  prototype(std::move(prototype)),
+  encapsulator(this->prototype->Clone()),
+  stream_timeout(DEFAULT_STREAM_TIMEOUT),
+  max_stream_fragments(DEFAULT_MAX_STREAM_SIZE / this->prototype->GetMaximumDataSize()),
+  max_streams(DEFAULT_MAX_STREAMS),
+  next_expiry()
+{
+}
+
+
+void
+Receiver::SetEncryption(unique_ptr<Crypto::Aead> &&aead)
+{
+  this->aead = move(aead);
+}
+
+
+void
+Receiver::SetLatency(const shared_ptr<Latency> &latency)
+{
+  this->latency = latency;
+}
+
+
+void
+Receiver::SetReassemblyLimits(const chrono::milliseconds &timeout,
+                              const size_t &max_stream_size,
+                              const size_t &max_streams)
+{
+  stream_timeout = timeout;
+  max_stream_fragments = max<size_t>(max_stream_size / prototype->GetMaximumDataSize(), 1);
+  this->max_streams = max<size_t>(max_streams, 1);
+  next_expiry = Clock::time_point();
+}
+
+
+void
+Receiver::Push(const Packet::Data &datagram, vector<Packet::Data> &packets,
+               const Clock::time_point &now)
+{
+  // damaged datagrams are dropped before they reach reassembly
+  unique_ptr<Packet> packet = Parse(datagram);
+  if (packet)
+    Push(move(packet), packets, now);
+}
+
+
+void
+Receiver::Push(unique_ptr<Packet> &&packet, vector<Packet::Data> &packets,
+               const Clock::time_point &now)
+{
+  Transmission transmission;
+  const size_t first = packets.size();
+
+  if (Reassemble(move(packet), transmission, now)
+      && Decode(transmission, packets)
+      && !Accept(transmission, packets.size() - first))
+    packets.resize(first);
+}
+
+
+unique_ptr<Packet>
+Receiver::Parse(const Packet::Data &datagram) const
+{
+  auto packet = prototype->Clone();
+
+  try {
+    packet->FillFromDump(datagram);
+  }
+  catch (CorruptedPacketException &ex) {
+    LOG(debug) << "Dropping datagram: " << ex.what();
+    corrupted.Add();
+    return nullptr;
+  }
+  catch (WrongMagicNumberException &ex) {
+    LOG(debug) << "Dropping datagram: " << ex.what();
+    corrupted.Add();
+    return nullptr;
+  }
+
+  return packet;
+}
+
+
+bool
+Receiver::Reassemble(unique_ptr<Packet> &&packet, Transmission &transmission,
+                     const Clock::time_point &now)
+{
+  const uint16_t stream_id = packet->GetStreamId();
+
+  if (packet->GetType() == Packet::Type::CONTROL
+      && (packet->GetControlType() == Packet::Control::ECHO_REQUEST
+          || packet->GetControlType() == Packet::Control::ECHO_REPLY))
+  {
+    HandleEcho(move(packet), now);
+    return false;
+  }
+
+  ExpireStreams(now);
+
+  if (packet->GetType() != Packet::Type::CONTROL)
+  {
+    Stream &stream = GetStream(stream_id, now);
+    stream.last_fragment_time = now;
+
+    if (!stream.overflowed && stream.fragments.size() == max_stream_fragments)
+    {
+      LOG(debug) << "Dropping transmission of stream " << stream_id << ": too long.";
+      DropStream(stream);
+      stream.overflowed = true;
+    }
+
+    if (stream.overflowed)
+    {
+      abandoned.Add();
+      return false;
+    }
+
+    if (stream.fragments.empty())
+      stream.first_fragment_time = now;
+
+    stream.fragments.push_back(move(packet));
+    return false;
+  }
+
+  // the fragments were dropped, or the end came again
+  auto found = streams.find(stream_id);
+  if (found == streams.end() || found->second.fragments.empty())
+  {
+    if (found != streams.end())
+      streams.erase(found);
+
+    abandoned.Add();
+    return false;
+  }
+
+  if (latency)
+    latency->reassembly.Record(now - found->second.first_fragment_time);
+
+  transmission.end = packet->GetControlType();
+  transmission.fragments = move(found->second.fragments);
+  streams.erase(found);
+
+  return true;
+}
+
+
+bool
+Receiver::Decode(Transmission &transmission, vector<Packet::Data> &packets)
+{
+  Packet::Data data = encapsulator.Decapsulate(transmission.fragments);
+  transmission.fragments.clear();
+
+  if (aead)
+  {
+    try {
+      aead->Open(data, transmission.epoch, transmission.sequence);
+    }
+    catch (Crypto::AuthenticationFailedException &ex) {
+      LOG(debug) << "Dropping transmission: " << ex.what();
+      unauthenticated.Add();
+      return false;
+    }
+  }
+
+  if (transmission.end != Packet::Control::END_OF_AGGREGATE)
+  {
+    packets.push_back(move(data));
+    return true;
+  }
+
+  try {
+    auto split = Aggregator::Split(data);
+
+    for (auto &p : split)
+      packets.push_back(move(p));
+  }
+  catch (CorruptedPacketException &ex) {
+    LOG(debug) << "Dropping transmission: " << ex.what();
+    corrupted.Add();
+    return false;
+  }
+
+  return true;
+}
+
+
+bool
+Receiver::Accept(const Transmission &transmission, const size_t &packet_count)
+{
+  if (aead && !replay_window.Accept(transmission.epoch, transmission.sequence))
+  {
+    LOG(debug) << "Dropping transmission: sequence " << transmission.sequence
+               << " of epoch " << transmission.epoch << " was received before.";
+    replayed.Add();
+    return false;
+  }
+
+  delivered.Add(packet_count);
+  return true;
+}
+
+
+bool
+Receiver::PullReply(Packet::Data &datagram)
+{
+  if (replies.empty())
+    return false;
+
+  datagram = move(replies.front());
+  replies.pop_front();
+  return true;
+}
+
+
+vector<Packet::Data>
+Receiver::GetPendingFragments() const
+{
+  vector<Packet::Data> dumps;
+
+  for (auto &stream : streams)
+    for (auto &fragment : stream.second.fragments)
+      dumps.push_back(fragment->Dump());
+
+  return dumps;
+}
+
+
+const Crypto::ReplayWindow&
+Receiver::GetReplayWindow() const
+{
+  return replay_window;
+}
+
+
+void
+Receiver::SetReplayWindow(const Crypto::ReplayWindow &window)
+{
+  replay_window = window;
+}
+
+
+size_t
+Receiver::GetStreamCount() const
+{
+  return streams.size();
+}
+
+
+void
+Receiver::HandleEcho(unique_ptr<Packet> &&packet, const Clock::time_point &now)
+{
+  // the payload is the time of our own clock, so the peer just returns it
+  if (packet->GetControlType() == Packet::Control::ECHO_REQUEST)
+  {
+    if (replies.size() == MAX_PENDING_REPLIES)
+      return;
+
+    packet->SetControlType(Packet::Control::ECHO_REPLY);
+    replies.push_back(packet->Dump());
+    return;
+  }
+
+  const Packet::Data timestamp = packet->GetData();
+  if (!latency || timestamp.size() != 8)
+    return;
+
+  uint64_t sent = 0;
+  for (auto byte : timestamp)
+    sent = (sent << 8) | byte;
+
+  const Clock::time_point sent_time(chrono::duration_cast<Clock::duration>(chrono::nanoseconds(sent)));
+  latency->round_trip.Record(now - sent_time);
+}
+
+
+
+Receiver::Stream&
+Receiver::GetStream(const uint16_t &stream_id, const Clock::time_point &now)
+{
+  auto found = streams.find(stream_id);
+  if (found != streams.end())
+  {
+    // the end of the last train of the stream was lost
+    if (now - found->second.last_fragment_time > stream_timeout)
+    {
+      DropStream(found->second);
+      found->second.overflowed = false;
+    }
+
+    return found->second;
+  }
+
+  if (streams.size() >= max_streams)
+  {
+    auto idle = min_element(streams.begin(), streams.end(),
+                            [](const pair<const uint16_t, Stream> &a, const pair<const uint16_t, Stream> &b) {
+                              return a.second.last_fragment_time < b.second.last_fragment_time;
+                            });
+    LOG(debug) << "Dropping transmission of stream " << idle->first << ": too many streams.";
+    DropStream(idle->second);
+    streams.erase(idle);
+  }
+
+  Stream &stream = streams[stream_id];
+  stream.overflowed = false;
+  return stream;
+}
+
+
+void
+Receiver::ExpireStreams(const Clock::time_point &now)
+{
+  if (now < next_expiry)
+    return;
+
+  next_expiry = now + stream_timeout / 2;
+
+  for (auto it = streams.begin(); it != streams.end(); )
+    if (now - it->second.last_fragment_time > stream_timeout)
+    {
+      DropStream(it->second);
+      it = streams.erase(it);
+    }
+    else
+      it++;
+}
+
+
+void
+Receiver::DropStream(Stream &stream)
+{
+  abandoned.Add(stream.fragments.size());
+  stream.fragments.clear();
+}
+
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../Packets/Packet.h"
+#include "../Packets/Encapsulator.h"
+#include "../Crypto/Aead.h"
+#include "../Crypto/ReplayWindow.h"
+#include "Latency.h"
+
+#ifndef _RECEIVER_H_
+#define _RECEIVER_H_
+
+
+namespace Codec
+{
+
+/*
+ * Socket to TUN direction of the tunnel without any I/O: parses
+ * datagrams, reassembles fragment trains (one per stream id) and splits
+ * aggregated transmissions. Trains whose end never comes are dropped
+ * after a while, so a lost fragment doesn't spoil the next train of
+ * the stream and the peer can't make the receiver buffer without bound.
+ */
+class Receiver
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr std::size_t MAX_PENDING_REPLIES = 16;
+
+  // the Sender keeps MAX_TRAINS_IN_FLIGHT streams open and makes
+  // transmissions of at most 64 KiB, some room is left for reordering
+  static constexpr std::chrono::milliseconds DEFAULT_STREAM_TIMEOUT{1000};
+  static constexpr std::size_t DEFAULT_MAX_STREAM_SIZE = 128 * 1024;
+  static constexpr std::size_t DEFAULT_MAX_STREAMS = 256;
+
+  // fragments of a reassembled transmission, Decode() makes IP packets
+  // of them and sets the epoch and sequence number of the opened frame
+  struct Transmission
+  {
+    Packets::Packet::Control end;
+    std::vector<std::unique_ptr<Packets::Packet>> fragments;
+    std::uint64_t epoch;
+    std::uint64_t sequence;
+  };
+
+  Receiver(std::unique_ptr<Packets::Packet> &&prototype);
+  virtual ~Receiver() = default;
+
+  // transmissions failing authentication or opened before are dropped,
+  // nullptr disables
+  virtual void SetEncryption(std::unique_ptr<Crypto::Aead> &&aead);
+
+  // records the reassembly stage and round trip times, nullptr disables
+  virtual void SetLatency(const std::shared_ptr<Latency> &latency);
+
+  // Streams without a fragment for the timeout are dropped. A stream
+  // buffering more than max_stream_size bytes (every fragment counts as
+  // a full one) is dropped up to its end of transmission. When a new
+  // stream doesn't fit, the one idle for the longest time is dropped.
+  virtual void SetReassemblyLimits(const std::chrono::milliseconds &timeout,
+                                   const std::size_t &max_stream_size,
+                                   const std::size_t &max_streams);
+
+  // appends IP packets completed by this datagram, damaged datagrams
+  // are dropped
+  virtual void Push(const Packets::Packet::Data &datagram,
+                    std::vector<Packets::Packet::Data> &packets,
+                    const Clock::time_point &now);
+
+  // same as above for a datagram parsed with Parse()
+  virtual void Push(std::unique_ptr<Packets::Packet> &&packet,
+                    std::vector<Packets::Packet::Data> &packets,
+                    const Clock::time_point &now);
+
+  // Push() in steps, so the caller can parse datagrams and decode
+  // transmissions in other threads, each with a Receiver of its own.
+  // Only Reassemble() and Accept() change the receiver state.
+  //
+  // nullptr for damaged datagrams, they are counted as corrupted
+  virtual std::unique_ptr<Packets::Packet> Parse(const Packets::Packet::Data &datagram) const;
+  // true when the packet ended a transmission
+  virtual bool Reassemble(std::unique_ptr<Packets::Packet> &&packet,
+                          Transmission &transmission,
+                          const Clock::time_point &now);
+  // appends IP packets of the transmission, false when it was damaged
+  // and dropped
+  virtual bool Decode(Transmission &transmission,
+                      std::vector<Packets::Packet::Data> &packets);
+  // Called in the order of reassembly for every decoded transmission,
+  // false when it was opened before and its packets must be dropped.
+  virtual bool Accept(const Transmission &transmission, const std::size_t &packet_count);
+
+  // Dump of a reply to a received echo request, false when there is
+  // nothing to send. Replies should be sent right away, they are not
+  // queued in the Sender.
+  virtual bool PullReply(Packets::Packet::Data &datagram);
+
+  // dumps of fragments of unfinished transmissions, pushing them to
+  // another Receiver restores the reassembly state
+  virtual std::vector<Packets::Packet::Data> GetPendingFragments() const;
+  // frames opened so far, the process taking over rejects them too
+  virtual const Crypto::ReplayWindow& GetReplayWindow() const;
+  virtual void SetReplayWindow(const Crypto::ReplayWindow &window);
+
+  virtual std::size_t GetStreamCount() const;
+
+protected:
+  struct Stream
+  {
+    std::vector<std::unique_ptr<Packets::Packet>> fragments;
+    Clock::time_point first_fragment_time;
+    Clock::time_point last_fragment_time;
+    // over the size limit, fragments are dropped until the end
+    bool overflowed;
+  };
+
+  std::unique_ptr<Packets::Packet> prototype;
+  Packets::Encapsulator encapsulator;
+  std::unique_ptr<Crypto::Aead> aead;
+  Crypto::ReplayWindow replay_window;
+  std::shared_ptr<Latency> latency;
+  std::unordered_map<std::uint16_t, Stream> streams;
+  std::deque<Packets::Packet::Data> replies;
+
+  std::chrono::milliseconds stream_timeout;
+  std::size_t max_stream_fragments;
+  std::size_t max_streams;
+  // idle streams are looked for at most every half of the timeout
+  Clock::time_point next_expiry;
+
+  void HandleEcho(std::unique_ptr<Packets::Packet> &&packet, const Clock::time_point &now);
+  Stream& GetStream(const std::uint16_t &stream_id, const Clock::time_point &now);
+  void ExpireStreams(const Clock::time_point &now);
+  void DropStream(Stream &stream);
+};
+
+}
+
+#endif
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Sender.h"
+
+#include <utility>
+
+using namespace std;
+using namespace Packets;
+using namespace Scheduling;
+
+
+namespace Codec
+{
+
+constexpr size_t Sender::MAX_TRAINS_IN_FLIGHT;
+constexpr size_t Sender::AGGREGATE_FLOW;
+constexpr size_t Sender::MAX_SPARE_BUFFERS;
+
+
+Sender::Sender(unique_ptr<Packet> &&prototype, const size_t &ip_header_offset) :
+  prototype(std::move(prototype)),
+  ip_header_offset(ip_header_offset),
+  encapsulator(this->prototype->Clone()),
+  aggregator(0, chrono::microseconds(0)),
+  aggregate(false),
+  classifier(ip_header_offset),
+  scheduler(PriorityScheduler::DEFAULT_WEIGHTS, ip_header_offset),
+  flow_scheduling(true),
+  pulled_transmissions(0),
+  echo_interval(0)
+{
+}
+
+
+void
+Sender::SetAggregation(const size_t &max_frame_size,
+                       const chrono::microseconds &max_delay)
+{
+  aggregator = Aggregator(max_frame_size, max_delay);
+  aggregate = max_delay.count() > 0;
+}
+
+
+void
+Sender::SetQueueManagement(const size_t &max_queue_size,
+                           const chrono::microseconds &target,
+                           const chrono::microseconds &interval)
+{
+  scheduler = PriorityScheduler(PriorityScheduler::DEFAULT_WEIGHTS, ip_header_offset,
+                                max_queue_size, target, interval);
+}
+
+
+void
+Sender::SetFlowScheduling(const bool &enabled)
+{
+  flow_scheduling = enabled;
+}
+
+
+void
+Sender::SetEncryption(unique_ptr<Crypto::Aead> &&aead)
+{
+  this->aead = move(aead);
+}
+
+
+void
+Sender::SetLatency(const shared_ptr<Latency> &latency)
+{
+  this->latency = latency;
+}
+
+
+void
+Sender::SetEchoInterval(const chrono::milliseconds &interval)
+{
+  echo_interval = interval;
+}
+
+
+bool
+Sender::Push(Packet::Data &packet, const Clock::time_point &now)
+{
+  const TrafficClass traffic_class = classifier.Classify(packet);
+  const bool queued = scheduler.Enqueue(traffic_class, move(packet), now);
+
+  Recycle(packet);
+  return queued;
+}
+
+
+bool
+Sender::Pull(Packet::Data &datagram, const Clock::time_point &now)
+{
+  auto fragment = PullPacket(now);
+  if (!fragment)
+    return false;
+
+  fragment->Dump(datagram);
+  return true;
+}
+
+
+unique_ptr<Packet>
+Sender::PullPacket(const Clock::time_point &now)
+{
+  while (PullTransmission(transmission, now))
+  {
+    Encapsulate(transmission);
+    QueueTrain(transmission);
+  }
+
+  return PullFragment(now);
+}
+
+
+bool
+Sender::PullTransmission(Transmission &transmission, const Clock::time_point &now)
+{
+  // keep only a few trains in flight, the rest waits in priority queues
+  while (flows.GetTrainCount() + pulled_transmissions < MAX_TRAINS_IN_FLIGHT
+         && scheduler.Dequeue(packet, now))
+  {
+    const Clock::time_point origin = now - scheduler.GetLastSojournTime();
+
+    if (!aggregate)
+    {
+      Describe(transmission, classifier.GetFlow(packet),
+               Packet::Control::END_OF_TRANSMISSION, origin);
+      transmission.data.swap(packet);
+      Stash(packet);
+      return true;
+    }
+
+    if (!aggregator.Add(packet, now))
+    {
+      Describe(transmission, AGGREGATE_FLOW, Packet::Control::END_OF_AGGREGATE,
+               aggregate_origin);
+      transmission.data = aggregator.Flush();
+      aggregator.Add(packet, now);
+      aggregate_origin = origin;
+      Stash(packet);
+      return true;
+    }
+
+    if (aggregator.GetPacketCount() == 1)
+      aggregate_origin = origin;
+
+    Stash(packet);
+  }
+
+  if (!aggregator.IsReadyToFlush(now))
+    return false;
+
+  Describe(transmission, AGGREGATE_FLOW, Packet::Control::END_OF_AGGREGATE,
+           aggregate_origin);
+  transmission.data = aggregator.Flush();
+  return true;
+}
+
+
+void
+Sender::Encapsulate(Transmission &transmission)
+{
+  if (aead)
+    aead->Seal(transmission.data, transmission.epoch, transmission.sequence);
+
+  transmission.train = encapsulator.Encapsulate(transmission.data);
+
+  auto last = prototype->Clone();
+  last->SetType(Packet::Type::CONTROL);
+  last->SetControlType(transmission.end);
+  transmission.train.push_back(move(last));
+}
+
+
+void
+Sender::QueueTrain(Transmission &transmission)
+{
+  if (latency)
+    train_origins.push_back(make_pair(transmission.train.back().get(), transmission.origin));
+
+  // a single flow is first in, first out
+  flows.Enqueue(flow_scheduling ? transmission.flow : AGGREGATE_FLOW,
+                move(transmission.train));
+  transmission.train.clear();
+  pulled_transmissions--;
+}
+
+
+void
+Sender::DropTransmission(Transmission &transmission)
+{
+  transmission.train.clear();
+  pulled_transmissions--;
+}
+
+
+unique_ptr<Packet>
+Sender::PullFragment(const Clock::time_point &now)
+{
+  if (echo_interval.count() > 0 && now - last_echo >= echo_interval)
+  {
+    last_echo = now;
+    return CreateEchoRequest(now);
+  }
+
+  auto fragment = flows.Dequeue();
+  if (fragment && latency && fragment->GetType() == Packet::Type::CONTROL)
+    RecordTransmission(fragment.get(), now);
+
+  return fragment;
+}
+
+
+bool
+Sender::HasPendingData() const
+{
+  return !flows.IsEmpty() || pulled_transmissions > 0 || !scheduler.IsEmpty()
+         || !aggregator.IsEmpty();
+}
+
+
+QueueStats
+Sender::GetQueueStats() const
+{
+  return scheduler.GetStats();
+}
+
+
+uint16_t
+Sender::GetNextStreamId() const
+{
+  return flows.GetNextStreamId();
+}
+
+
+void
+Sender::SetNextStreamId(const uint16_t &stream_id)
+{
+  flows.SetNextStreamId(stream_id);
+}
+
+
+void
+Sender::Describe(Transmission &transmission,
+                 const size_t &flow,
+                 const Packet::Control &end_of_transmission,
+                 const Clock::time_point &origin)
+{
+  transmission.flow = flow;
+  transmission.end = end_of_transmission;
+  transmission.origin = origin;
+  pulled_transmissions++;
+
+  // numbered here, so sealing in other threads never reuses a nonce
+  if (aead)
+  {
+    transmission.epoch = aead->GetEpoch();
+    transmission.sequence = aead->TakeSequence();
+  }
+}
+
+
+void
+Sender::RecordTransmission(const Packet *last, const Clock::time_point &now)
+{
+  // at most MAX_TRAINS_IN_FLIGHT entries
+  for (auto it = train_origins.begin(); it != train_origins.end(); ++it)
+    if (it->first == last)
+    {
+      latency->tun_to_socket.Record(now - it->second);
+      train_origins.erase(it);
+      return;
+    }
+}
+
+
+unique_ptr<Packet>
+Sender::CreateEchoRequest(const Clock::time_point &now)
+{
+  const uint64_t sent = chrono::duration_cast<chrono::nanoseconds>(now.time_since_epoch()).count();
+  Packet::Data timestamp(8);
+
+  for (int i = 0; i < 8; i++)
+    timestamp[i] = static_cast<uint8_t>(sent >> (56 - 8 * i));
+
+  auto echo = prototype->Clone();
+  echo->SetType(Packet::Type::CONTROL);
+  echo->SetControlType(Packet::Control::ECHO_REQUEST);
+  echo->SetData(timestamp);
+
+  return echo;
+}
+
+
+void
+Sender::Stash(Packet::Data &buffer)
+{
+  if (spare_buffers.size() < MAX_SPARE_BUFFERS)
+    spare_buffers.push_back(move(buffer));
+
+  buffer.clear();
+}
+
+
+void
+Sender::Recycle(Packet::Data &buffer)
+{
+  buffer.clear();
+
+  if (spare_buffers.empty())
+    return;
+
+  buffer.swap(spare_buffers.back());
+  spare_buffers.pop_back();
+}
+
+}
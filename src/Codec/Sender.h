@@ -0,0 +1,167 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../Packets/Packet.h"
+#include "../Packets/Encapsulator.h"
+#include "../Packets/Aggregator.h"
+#include "../Scheduling/Classifier.h"
+#include "../Scheduling/PriorityScheduler.h"
+#include "../Scheduling/FlowScheduler.h"
+#include "../Crypto/Aead.h"
+#include "Latency.h"
+
+#ifndef _SENDER_H_
+#define _SENDER_H_
+
+
+namespace Codec
+{
+
+/*
+ * TUN to socket direction of the tunnel without any I/O: classifies
+ * and queues IP packets, aggregates them, splits into fragments and
+ * interleaves fragment trains of different flows.
+ */
+class Sender
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Transmission taken from the queues, Encapsulate() seals it and
+  // splits it into the train of fragments. Epoch and sequence number of
+  // the frame come from the Aead of the sender pulling it.
+  struct Transmission
+  {
+    std::size_t flow;
+    Packets::Packet::Control end;
+    Clock::time_point origin;
+    std::uint64_t epoch;
+    std::uint64_t sequence;
+    Packets::Packet::Data data;
+    Scheduling::FlowScheduler::Train train;
+  };
+
+  static constexpr std::size_t MAX_TRAINS_IN_FLIGHT = 8;
+
+  // aggregated transmissions mix packets of many flows
+  static constexpr std::size_t AGGREGATE_FLOW = 0;
+
+  Sender(std::unique_ptr<Packets::Packet> &&prototype,
+         const std::size_t &ip_header_offset);
+  virtual ~Sender() = default;
+
+  // max_delay equal to zero disables aggregation
+  virtual void SetAggregation(const std::size_t &max_frame_size,
+                              const std::chrono::microseconds &max_delay);
+
+  virtual void SetQueueManagement(const std::size_t &max_queue_size,
+                                  const std::chrono::microseconds &target,
+                                  const std::chrono::microseconds &interval);
+
+  // Trains of different flows are interleaved by deficit round robin.
+  // Disabled, they are sent one after another in the order they were
+  // queued, e.g. to compare both.
+  virtual void SetFlowScheduling(const bool &enabled);
+
+  // every transmission is sealed before fragmentation, nullptr disables
+  virtual void SetEncryption(std::unique_ptr<Crypto::Aead> &&aead);
+
+  // records the tun_to_socket stage, nullptr disables
+  virtual void SetLatency(const std::shared_ptr<Latency> &latency);
+
+  // Echo requests carry the time they were sent, the peer returns them
+  // to our Receiver, which records the round trip time. They bypass
+  // all queues. Zero disables.
+  virtual void SetEchoInterval(const std::chrono::milliseconds &interval);
+
+  // Takes the packet and leaves an empty, possibly recycled buffer in
+  // its place. Returns false when the packet was dropped.
+  virtual bool Push(Packets::Packet::Data &packet, const Clock::time_point &now);
+
+  // Dump of the next datagram into the buffer, which keeps its capacity,
+  // false when there is nothing to send.
+  virtual bool Pull(Packets::Packet::Data &datagram, const Clock::time_point &now);
+
+  // Next datagram before the dump, nullptr when there is nothing to
+  // send.
+  virtual std::unique_ptr<Packets::Packet> PullPacket(const Clock::time_point &now);
+
+  // PullPacket() in steps, so the caller can encapsulate transmissions
+  // and dump fragments in other threads, each with a Sender of its own.
+  // Only PullTransmission(), QueueTrain() and PullFragment() change the
+  // sender state.
+  //
+  // Next transmission, false when nothing is ready or there are already
+  // MAX_TRAINS_IN_FLIGHT trains, queued or pulled.
+  virtual bool PullTransmission(Transmission &transmission, const Clock::time_point &now);
+  virtual void Encapsulate(Transmission &transmission);
+  // takes the train, the data buffer is left to be reused
+  virtual void QueueTrain(Transmission &transmission);
+  // gives up a pulled transmission which failed to encapsulate
+  virtual void DropTransmission(Transmission &transmission);
+  // next fragment of queued trains or an echo request, nullptr when
+  // there is none
+  virtual std::unique_ptr<Packets::Packet> PullFragment(const Clock::time_point &now);
+
+  virtual bool HasPendingData() const;
+  virtual Scheduling::QueueStats GetQueueStats() const;
+
+  // Stream ids continue in the process taking over, so its trains don't
+  // join streams the peer hasn't finished yet.
+  virtual std::uint16_t GetNextStreamId() const;
+  virtual void SetNextStreamId(const std::uint16_t &stream_id);
+
+protected:
+  static constexpr std::size_t MAX_SPARE_BUFFERS = 64;
+
+  std::unique_ptr<Packets::Packet> prototype;
+  std::size_t ip_header_offset;
+
+  Packets::Encapsulator encapsulator;
+  Packets::Aggregator aggregator;
+  bool aggregate;
+
+  Scheduling::Classifier classifier;
+  Scheduling::PriorityScheduler scheduler;
+  Scheduling::FlowScheduler flows;
+  bool flow_scheduling;
+  // pulled and not queued yet
+  std::size_t pulled_transmissions;
+
+  std::unique_ptr<Crypto::Aead> aead;
+
+  std::shared_ptr<Latency> latency;
+  // last fragment of every train in the flow scheduler and the time
+  // its oldest packet was queued
+  std::vector<std::pair<const Packets::Packet*, Clock::time_point>> train_origins;
+  Clock::time_point aggregate_origin;
+
+  std::chrono::milliseconds echo_interval;
+  Clock::time_point last_echo;
+
+  Packets::Packet::Data packet;
+  Transmission transmission;
+  std::vector<Packets::Packet::Data> spare_buffers;
+
+  void Describe(Transmission &transmission,
+                const std::size_t &flow,
+                const Packets::Packet::Control &end_of_transmission,
+                const Clock::time_point &origin);
+  void RecordTransmission(const Packets::Packet *last, const Clock::time_point &now);
+  std::unique_ptr<Packets::Packet> CreateEchoRequest(const Clock::time_point &now);
+  void Stash(Packets::Packet::Data &buffer);
+  void Recycle(Packets::Packet::Data &buffer);
+};
+
+}
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Aead.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <openssl/kdf.h>
+#include <openssl/rand.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "AuthenticationFailedException.h"
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Crypto
+{
+
+namespace
+{
+
+// bits of the epoch taken by the random value
+constexpr int EPOCH_RANDOM_BITS = 22;
+
+atomic<uint64_t> last_epoch(0);
+
+
+void
+PutNumber(uint8_t *data, const uint64_t &value)
+{
+  for (int i = 0; i < 8; i++)
+    data[i] = static_cast<uint8_t>(value >> (56 - 8 * i));
+}
+
+
+uint64_t
+GetNumber(const uint8_t *data)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++)
+    value = (value << 8) | data[i];
+
+  return value;
+}
+
+
+uint64_t
+GetRandomNumber()
+{
+  uint8_t bytes[8];
+  if (RAND_bytes(bytes, sizeof(bytes)) != 1)
+    throw runtime_error("cannot draw random number");
+
+  return GetNumber(bytes);
+}
+
+
+// four zero bytes and the sequence number
+array<uint8_t, Aead::NONCE_SIZE>
+MakeNonce(const uint64_t &sequence)
+{
+  array<uint8_t, Aead::NONCE_SIZE> nonce {};
+  PutNumber(nonce.data() + Aead::NONCE_SIZE - 8, sequence);
+
+  return nonce;
+}
+
+
+Aead::Key
+Hkdf(const uint8_t *secret, const size_t &secret_size,
+     const uint8_t *salt, const size_t &salt_size,
+     const string &info)
+{
+  Aead::Key key;
+  size_t key_size = key.size();
+
+  EVP_PKEY_CTX *context = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+
+  const bool derived = context
+    && EVP_PKEY_derive_init(context) == 1
+    && EVP_PKEY_CTX_set_hkdf_md(context, EVP_sha256()) == 1
+    && EVP_PKEY_CTX_set1_hkdf_salt(context, salt, salt_size) == 1
+    && EVP_PKEY_CTX_set1_hkdf_key(context, secret, secret_size) == 1
+    && EVP_PKEY_CTX_add1_hkdf_info(context,
+                                   reinterpret_cast<const unsigned char*>(info.data()),
+                                   info.size()) == 1
+    && EVP_PKEY_derive(context, key.data(), &key_size) == 1;
+
+  EVP_PKEY_CTX_free(context);
+
+  if (!derived)
+    throw runtime_error("cannot derive key");
+
+  return key;
+}
+
+}
+
+constexpr size_t Aead::KEY_SIZE;
+constexpr size_t Aead::NONCE_SIZE;
+constexpr size_t Aead::TAG_SIZE;
+constexpr size_t Aead::HEADER_SIZE;
+constexpr size_t Aead::OVERHEAD;
+
+
+Aead::Aead(const Algorithm &algorithm, const Key &key) :
+  algorithm(algorithm),
+  key(key),
+  encrypt_context(EVP_CIPHER_CTX_new()),
+  decrypt_context(EVP_CIPHER_CTX_new()),
+  encrypt_epoch(0),
+  decrypt_epoch(0),
+  encrypt_keyed(false),
+  decrypt_keyed(false),
+  epoch(0),
+  sequence(0)
+{
+  const EVP_CIPHER *cipher = (algorithm == Algorithm::AES_256_GCM) ? EVP_aes_256_gcm()
+                                                                   : EVP_chacha20_poly1305();
+
+  // keys are set with the first epoch
+  try {
+    if (!encrypt_context || !decrypt_context
+        || EVP_EncryptInit_ex(encrypt_context, cipher, nullptr, nullptr, nullptr) != 1
+        || EVP_DecryptInit_ex(decrypt_context, cipher, nullptr, nullptr, nullptr) != 1)
+      throw runtime_error("cannot initialize cipher " + GetName(algorithm));
+
+    epoch = NewEpoch();
+    sequence = GetRandomNumber() >> 2;
+  }
+  catch (...) {
+    EVP_CIPHER_CTX_free(encrypt_context);
+    EVP_CIPHER_CTX_free(decrypt_context);
+    throw;
+  }
+}
+
+
+Aead::~Aead()
+{
+  EVP_CIPHER_CTX_free(encrypt_context);
+  EVP_CIPHER_CTX_free(decrypt_context);
+}
+
+
+void
+Aead::Seal(Packet::Data &frame)
+{
+  Seal(frame, epoch, TakeSequence());
+}
+
+
+void
+Aead::Seal(Packet::Data &frame, const uint64_t &epoch, const uint64_t &sequence)
+{
+  const size_t size = frame.size();
+  const auto nonce = MakeNonce(sequence);
+
+  frame.resize(HEADER_SIZE + size + TAG_SIZE);
+  uint8_t *payload = frame.data() + HEADER_SIZE;
+  memmove(payload, frame.data(), size);
+  PutNumber(frame.data(), epoch);
+  PutNumber(frame.data() + 8, sequence);
+
+  // the context keeps the key of the last epoch
+  Key epoch_key;
+  const bool rekey = !encrypt_keyed || encrypt_epoch != epoch;
+  if (rekey)
+    epoch_key = DeriveKey(key, epoch);
+
+  int length;
+  if (EVP_EncryptInit_ex(encrypt_context, nullptr, nullptr,
+                         rekey ? epoch_key.data() : nullptr, nonce.data()) != 1
+      || EVP_EncryptUpdate(encrypt_context, payload, &length, payload, size) != 1
+      || EVP_EncryptFinal_ex(encrypt_context, payload + length, &length) != 1
+      || EVP_CIPHER_CTX_ctrl(encrypt_context, EVP_CTRL_AEAD_GET_TAG, TAG_SIZE, payload + size) != 1)
+    throw runtime_error("cannot encrypt frame");
+
+  encrypt_epoch = epoch;
+  encrypt_keyed = true;
+}
+
+
+void
+Aead::Open(Packet::Data &frame)
+{
+  uint64_t epoch, sequence;
+  Open(frame, epoch, sequence);
+}
+
+
+void
+Aead::Open(Packet::Data &frame, uint64_t &epoch, uint64_t &sequence)
+{
+  if (frame.size() < OVERHEAD)
+    throw AuthenticationFailedException();
+
+  const size_t size = frame.size() - OVERHEAD;
+  uint8_t *payload = frame.data() + HEADER_SIZE;
+  const uint64_t frame_epoch = GetNumber(frame.data());
+  const uint64_t frame_sequence = GetNumber(frame.data() + 8);
+  const auto nonce = MakeNonce(frame_sequence);
+
+  Key epoch_key;
+  const bool rekey = !decrypt_keyed || decrypt_epoch != frame_epoch;
+  if (rekey)
+    epoch_key = DeriveKey(key, frame_epoch);
+
+  int length;
+  if (EVP_DecryptInit_ex(decrypt_context, nullptr, nullptr,
+                         rekey ? epoch_key.data() : nullptr, nonce.data()) != 1)
+    throw AuthenticationFailedException();
+
+  decrypt_epoch = frame_epoch;
+  decrypt_keyed = true;
+
+  if (EVP_CIPHER_CTX_ctrl(decrypt_context, EVP_CTRL_AEAD_SET_TAG, TAG_SIZE, payload + size) != 1
+      || EVP_DecryptUpdate(decrypt_context, payload, &length, payload, size) != 1
+      || EVP_DecryptFinal_ex(decrypt_context, payload + length, &length) != 1)
+    throw AuthenticationFailedException();
+
+  memmove(frame.data(), payload, size);
+  frame.resize(size);
+  epoch = frame_epoch;
+  sequence = frame_sequence;
+}
+
+
+uint64_t
+Aead::GetEpoch() const
+{
+  return epoch;
+}
+
+
+uint64_t
+Aead::TakeSequence()
+{
+  return sequence++;
+}
+
+
+Aead::Algorithm
+Aead::GetAlgorithm() const
+{
+  return algorithm;
+}
+
+
+Aead::Algorithm
+Aead::GetPreferredAlgorithm()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned eax, ebx, ecx, edx;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) && (ecx & bit_PCLMUL))
+    return Algorithm::AES_256_GCM;
+#elif defined(__aarch64__)
+  const unsigned long hwcap = getauxval(AT_HWCAP);
+  if ((hwcap & HWCAP_AES) && (hwcap & HWCAP_PMULL))
+    return Algorithm::AES_256_GCM;
+#endif
+
+  return Algorithm::CHACHA20_POLY1305;
+}
+
+
+Aead::Key
+Aead::DeriveKey(const string &secret, const string &label)
+{
+  static const string salt = "SimpleDNSTunnel";
+
+  return Hkdf(reinterpret_cast<const uint8_t*>(secret.data()), secret.size(),
+              reinterpret_cast<const uint8_t*>(salt.data()), salt.size(),
+              label);
+}
+
+
+Aead::Key
+Aead::DeriveKey(const Key &key, const uint64_t &epoch)
+{
+  uint8_t salt[8];
+  PutNumber(salt, epoch);
+
+  return Hkdf(key.data(), key.size(), salt, sizeof(salt), "frame");
+}
+
+
+uint64_t
+Aead::NewEpoch()
+{
+  const uint64_t now = chrono::duration_cast<chrono::milliseconds>(
+    chrono::system_clock::now().time_since_epoch()).count();
+  const uint64_t epoch = (now << EPOCH_RANDOM_BITS)
+                         | (GetRandomNumber() & ((uint64_t(1) << EPOCH_RANDOM_BITS) - 1));
+
+  // the clock may stand still between two calls
+  uint64_t previous = last_epoch.load();
+  uint64_t next;
+  do
+    next = max(epoch, previous + 1);
+  while (!last_epoch.compare_exchange_weak(previous, next));
+
+  return next;
+}
+
+
+string
+Aead::GetName(const Algorithm &algorithm)
+{
+  if (algorithm == Algorithm::AES_256_GCM)
+    return "aes-256-gcm";
+
+  return "chacha20-poly1305";
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <openssl/evp.h>
+
+#include "../Packets/Packet.h"
+
+#ifndef _AEAD_H_
+#define _AEAD_H_
+
+
+namespace Crypto
+{
+
+/*
+ * Authenticated encryption of tunnel frames. Sealed frame:
+ *
+ *   epoch (8 bytes) | sequence (8 bytes) | ciphertext | tag (16 bytes)
+ *
+ * Every Aead starts a new epoch, made of the time and a random value.
+ * Frames of an epoch are sealed with a key derived from the shared key
+ * and the epoch, so restarted processes and sessions sharing the secret
+ * don't share frame keys. The sequence numbers frames of the epoch, it's
+ * the nonce and lets the peer reject replayed frames (ReplayWindow).
+ * Cipher contexts are keyed again only when the epoch changes.
+ */
+class Aead : private boost::noncopyable
+{
+public:
+  enum class Algorithm
+  {
+    AES_256_GCM,
+    CHACHA20_POLY1305
+  };
+
+  static constexpr std::size_t KEY_SIZE = 32;
+  static constexpr std::size_t NONCE_SIZE = 12;
+  static constexpr std::size_t TAG_SIZE = 16;
+  static constexpr std::size_t HEADER_SIZE = 16;
+  static constexpr std::size_t OVERHEAD = HEADER_SIZE + TAG_SIZE;
+
+  typedef std::array<std::uint8_t, KEY_SIZE> Key;
+
+  Aead(const Algorithm &algorithm, const Key &key);
+  virtual ~Aead();
+
+  // Encrypts the frame in place, prepends the epoch of this Aead and the
+  // next sequence number and appends the tag.
+  virtual void Seal(Packets::Packet::Data &frame);
+
+  // Same as above with the epoch and sequence given by the caller, so
+  // frames can be sealed in many threads, each with an Aead of its own.
+  // The caller must never seal two frames with the same pair.
+  virtual void Seal(Packets::Packet::Data &frame,
+                    const std::uint64_t &epoch,
+                    const std::uint64_t &sequence);
+
+  // decrypts the frame in place, throws AuthenticationFailedException
+  virtual void Open(Packets::Packet::Data &frame);
+
+  // same as above, epoch and sequence of the frame are set once it's
+  // authenticated
+  virtual void Open(Packets::Packet::Data &frame,
+                    std::uint64_t &epoch,
+                    std::uint64_t &sequence);
+
+  // Epoch and sequence number for the next frame of this Aead. The
+  // first sequence number is random and below 2^62, so it never wraps
+  // and two epochs which happen to be equal hardly ever share a nonce.
+  virtual std::uint64_t GetEpoch() const;
+  virtual std::uint64_t TakeSequence();
+
+  Algorithm GetAlgorithm() const;
+
+  // AES-GCM when the CPU has AES instructions, ChaCha20-Poly1305 otherwise
+  static Algorithm GetPreferredAlgorithm();
+
+  // HKDF-SHA256, label separates keys of both tunnel directions
+  static Key DeriveKey(const std::string &secret, const std::string &label);
+
+  // key of frames of the epoch
+  static Key DeriveKey(const Key &key, const std::uint64_t &epoch);
+
+  // Milliseconds since 1970 in the upper 42 bits and a random value in
+  // the rest, greater than epochs returned before by this process.
+  // Peers take a greater epoch for a newer one.
+  static std::uint64_t NewEpoch();
+
+  static std::string GetName(const Algorithm &algorithm);
+
+private:
+  Algorithm algorithm;
+  Key key;
+  EVP_CIPHER_CTX *encrypt_context;
+  EVP_CIPHER_CTX *decrypt_context;
+  // epochs the contexts are keyed for
+  std::uint64_t encrypt_epoch;
+  std::uint64_t decrypt_epoch;
+  bool encrypt_keyed;
+  bool decrypt_keyed;
+
+  std::uint64_t epoch;
+  std::uint64_t sequence;
+};
+
+}
+
+#endif
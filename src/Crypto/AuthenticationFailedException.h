@@ -0,0 +1,26 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <stdexcept>
+#include <string>
+
+#ifndef _AUTHENTICATIONFAILEDEXCEPTION_H_
+#define _AUTHENTICATIONFAILEDEXCEPTION_H_
+
+namespace Crypto
+{
+
+class AuthenticationFailedException : public std::runtime_error
+{
+public:
+  AuthenticationFailedException() :
+    std::runtime_error("Frame authentication failed.")
+  {
+  }
+};
+
+}
+
+#endif
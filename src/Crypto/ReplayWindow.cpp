@@ -0,0 +1,101 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ReplayWindow.h"
+
+using namespace std;
+
+
+namespace Crypto
+{
+
+constexpr size_t ReplayWindow::SIZE;
+
+
+ReplayWindow::ReplayWindow() :
+  started(false),
+  epoch(0),
+  highest(0)
+{
+}
+
+
+bool
+ReplayWindow::Accept(const uint64_t &epoch, const uint64_t &sequence)
+{
+  if (started && epoch < this->epoch)
+    return false;
+
+  if (!started || epoch > this->epoch)
+  {
+    started = true;
+    this->epoch = epoch;
+    highest = sequence;
+    seen.reset();
+    seen.set(sequence % SIZE);
+    return true;
+  }
+
+  if (sequence > highest)
+  {
+    // forget sequence numbers leaving the window
+    if (sequence - highest >= SIZE)
+      seen.reset();
+    else
+      for (uint64_t s = highest + 1; s < sequence; s++)
+        seen.reset(s % SIZE);
+
+    highest = sequence;
+    seen.set(sequence % SIZE);
+    return true;
+  }
+
+  if (highest - sequence >= SIZE || seen.test(sequence % SIZE))
+    return false;
+
+  seen.set(sequence % SIZE);
+  return true;
+}
+
+
+bool
+ReplayWindow::IsStarted() const
+{
+  return started;
+}
+
+
+uint64_t
+ReplayWindow::GetEpoch() const
+{
+  return epoch;
+}
+
+
+uint64_t
+ReplayWindow::GetHighest() const
+{
+  return highest;
+}
+
+
+const bitset<ReplayWindow::SIZE>&
+ReplayWindow::GetSeen() const
+{
+  return seen;
+}
+
+
+void
+ReplayWindow::Restore(const uint64_t &epoch, const uint64_t &highest,
+                      const bitset<SIZE> &seen)
+{
+  started = true;
+  this->epoch = epoch;
+  this->highest = highest;
+  this->seen = seen;
+}
+
+}
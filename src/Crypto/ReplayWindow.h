@@ -0,0 +1,55 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef _REPLAYWINDOW_H_
+#define _REPLAYWINDOW_H_
+
+
+namespace Crypto
+{
+
+/*
+ * Rejects frames opened before, by epoch and sequence number (see Aead).
+ * A newer epoch replaces the current one, frames of older epochs are
+ * rejected. Within the epoch, frames may come out of order by up to
+ * SIZE sequence numbers, the older ones are rejected.
+ *
+ * Only authenticated frames may be checked, a forged one would move the
+ * window.
+ */
+class ReplayWindow
+{
+public:
+  static constexpr std::size_t SIZE = 1024;
+
+  ReplayWindow();
+
+  // true when the frame wasn't seen before, it's remembered then
+  bool Accept(const std::uint64_t &epoch, const std::uint64_t &sequence);
+
+  // position of the window, to hand it over to another process
+  bool IsStarted() const;
+  std::uint64_t GetEpoch() const;
+  std::uint64_t GetHighest() const;
+  const std::bitset<SIZE>& GetSeen() const;
+  void Restore(const std::uint64_t &epoch, const std::uint64_t &highest,
+               const std::bitset<SIZE> &seen);
+
+private:
+  bool started;
+  std::uint64_t epoch;
+  // the highest sequence number accepted in the epoch
+  std::uint64_t highest;
+  // sequence numbers accepted, highest - SIZE < s <= highest, by s % SIZE
+  std::bitset<SIZE> seen;
+};
+
+}
+
+#endif
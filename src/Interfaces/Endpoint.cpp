@@ -0,0 +1,247 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Endpoint.h"
+#include "InterfaceException.h"
+
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+using namespace std;
+
+
+namespace Interfaces
+{
+
+namespace
+{
+
+// address bytes of IPv4 and IPv6 endpoints, nullptr for other families
+const uint8_t*
+GetAddressBytes(const sockaddr_storage &storage, size_t &size)
+{
+  if (storage.ss_family == AF_INET)
+  {
+    size = sizeof(in_addr);
+    return reinterpret_cast<const uint8_t*>(&reinterpret_cast<const sockaddr_in&>(storage).sin_addr);
+  }
+
+  if (storage.ss_family == AF_INET6)
+  {
+    size = sizeof(in6_addr);
+    return reinterpret_cast<const uint8_t*>(&reinterpret_cast<const sockaddr_in6&>(storage).sin6_addr);
+  }
+
+  size = 0;
+  return nullptr;
+}
+
+}
+
+
+Endpoint::Endpoint() :
+  length(0)
+{
+  memset(&storage, 0, sizeof(storage));
+}
+
+
+Endpoint::Endpoint(const string &address, const int &port) :
+  Endpoint()
+{
+  if (address.find(':') == string::npos)
+  {
+    sockaddr_in &s = reinterpret_cast<sockaddr_in&>(storage);
+    s.sin_family = AF_INET;
+    s.sin_port = htons(port);
+
+    if (inet_aton(address.c_str(), &s.sin_addr) == 0)
+      throw InterfaceException("Invalid IPv4 network address: " + address);
+
+    length = sizeof(sockaddr_in);
+  }
+  else
+  {
+    sockaddr_in6 &s = reinterpret_cast<sockaddr_in6&>(storage);
+    s.sin6_family = AF_INET6;
+    s.sin6_port = htons(port);
+
+    const int err = inet_pton(AF_INET6, address.c_str(), &s.sin6_addr);
+    if (err == 0)
+      throw InterfaceException("Invalid IPv6 network address: " + address);
+    else if (err < 0)
+      throw InterfaceException(strerror(errno));
+
+    length = sizeof(sockaddr_in6);
+  }
+}
+
+
+Endpoint::Endpoint(const sockaddr *address, const socklen_t &length) :
+  Endpoint()
+{
+  if (length > GetCapacity())
+    throw InterfaceException("Address is truncated!");
+
+  memcpy(&storage, address, length);
+  this->length = length;
+}
+
+
+bool
+Endpoint::IsValid() const
+{
+  return length != 0 && storage.ss_family != AF_UNSPEC;
+}
+
+
+int
+Endpoint::GetFamily() const
+{
+  return storage.ss_family;
+}
+
+
+int
+Endpoint::GetPort() const
+{
+  if (storage.ss_family == AF_INET)
+    return ntohs(reinterpret_cast<const sockaddr_in&>(storage).sin_port);
+
+  if (storage.ss_family == AF_INET6)
+    return ntohs(reinterpret_cast<const sockaddr_in6&>(storage).sin6_port);
+
+  return -1;
+}
+
+
+string
+Endpoint::GetAddress() const
+{
+  size_t size;
+  const uint8_t *bytes = GetAddressBytes(storage, size);
+  if (!bytes)
+    return "";
+
+  char text[INET6_ADDRSTRLEN] = {0};
+  if (!inet_ntop(storage.ss_family, bytes, text, sizeof(text)))
+    throw InterfaceException(strerror(errno));
+
+  return text;
+}
+
+
+string
+Endpoint::ToString() const
+{
+  if (storage.ss_family == AF_INET6)
+    return "[" + GetAddress() + "]:" + to_string(GetPort());
+
+  return GetAddress() + ":" + to_string(GetPort());
+}
+
+
+sockaddr*
+Endpoint::GetSockaddr()
+{
+  return reinterpret_cast<sockaddr*>(&storage);
+}
+
+
+const sockaddr*
+Endpoint::GetSockaddr() const
+{
+  return reinterpret_cast<const sockaddr*>(&storage);
+}
+
+
+socklen_t
+Endpoint::GetLength() const
+{
+  return length;
+}
+
+
+void
+Endpoint::SetLength(const socklen_t &length)
+{
+  if (length > GetCapacity())
+    throw InterfaceException("Address is truncated!");
+
+  this->length = length;
+}
+
+
+size_t
+Endpoint::Hash() const
+{
+  // FNV-1a over the same fields Compare() looks at
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](const uint8_t &byte) {
+    hash = (hash ^ byte) * 1099511628211ULL;
+  };
+
+  mix(static_cast<uint8_t>(storage.ss_family));
+
+  const int port = GetPort();
+  mix(static_cast<uint8_t>(port >> 8));
+  mix(static_cast<uint8_t>(port));
+
+  size_t size;
+  const uint8_t *bytes = GetAddressBytes(storage, size);
+  for (size_t i = 0; i < size; i++)
+    mix(bytes[i]);
+
+  return static_cast<size_t>(hash);
+}
+
+
+bool
+Endpoint::operator==(const Endpoint &other) const
+{
+  return Compare(other) == 0;
+}
+
+
+bool
+Endpoint::operator!=(const Endpoint &other) const
+{
+  return Compare(other) != 0;
+}
+
+
+bool
+Endpoint::operator<(const Endpoint &other) const
+{
+  return Compare(other) < 0;
+}
+
+
+int
+Endpoint::Compare(const Endpoint &other) const
+{
+  if (storage.ss_family != other.storage.ss_family)
+    return storage.ss_family < other.storage.ss_family ? -1 : 1;
+
+  if (GetPort() != other.GetPort())
+    return GetPort() < other.GetPort() ? -1 : 1;
+
+  size_t size;
+  const uint8_t *bytes = GetAddressBytes(storage, size);
+  if (!bytes)
+    return 0;
+
+  const int r = memcmp(bytes, GetAddressBytes(other.storage, size), size);
+  if (r != 0 || storage.ss_family != AF_INET6)
+    return r;
+
+  const uint32_t scope = reinterpret_cast<const sockaddr_in6&>(storage).sin6_scope_id;
+  const uint32_t other_scope = reinterpret_cast<const sockaddr_in6&>(other.storage).sin6_scope_id;
+  return scope == other_scope ? 0 : (scope < other_scope ? -1 : 1);
+}
+
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/socket.h>
+
+#ifndef _ENDPOINT_H_
+#define _ENDPOINT_H_
+
+
+namespace Interfaces
+{
+
+/*
+ * IPv4 or IPv6 address with a port, kept in the binary form the socket
+ * calls use, so sending and receiving datagrams doesn't parse, format
+ * or allocate anything. Text form is for configuration and logs only.
+ */
+class Endpoint
+{
+public:
+  // empty endpoint, see IsValid()
+  Endpoint();
+
+  // IPv6 when the address contains a colon, throws InterfaceException
+  // when it can't be parsed
+  Endpoint(const std::string &address, const int &port);
+
+  // copies length bytes of a socket address
+  Endpoint(const sockaddr *address, const socklen_t &length);
+
+  bool IsValid() const;
+  int GetFamily() const;
+  int GetPort() const;
+
+  // numeric address without the port
+  std::string GetAddress() const;
+  // address:port, IPv6 as [address]:port
+  std::string ToString() const;
+
+  // for socket calls: recvfrom() may fill the whole storage
+  sockaddr* GetSockaddr();
+  const sockaddr* GetSockaddr() const;
+  socklen_t GetLength() const;
+  void SetLength(const socklen_t &length);
+
+  static constexpr socklen_t GetCapacity()
+  {
+    return sizeof(sockaddr_storage);
+  }
+
+  std::size_t Hash() const;
+
+  bool operator==(const Endpoint &other) const;
+  bool operator!=(const Endpoint &other) const;
+  // any strict weak order, so endpoints can be map keys
+  bool operator<(const Endpoint &other) const;
+
+private:
+  sockaddr_storage storage;
+  socklen_t length;
+
+  // family, port and address bytes, everything that identifies an endpoint
+  int Compare(const Endpoint &other) const;
+};
+
+}
+
+
+namespace std
+{
+
+template <>
+struct hash<Interfaces::Endpoint>
+{
+  size_t operator()(const Interfaces::Endpoint &endpoint) const
+  {
+    return endpoint.Hash();
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ImpairedInterface.h"
+#include "InterfaceException.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+
+namespace Interfaces
+{
+
+constexpr size_t ImpairedInterface::MAX_PACKET_SIZE;
+
+
+ImpairedInterface::ImpairedInterface(const shared_ptr<Interface> &interface,
+                                     const Impairment::Profile &profile,
+                                     const uint32_t &seed) :
+  interface(interface),
+  now(&Impairment::Clock::now),
+  impairment(profile, seed)
+{
+}
+
+
+void
+ImpairedInterface::SetTimeSource(const TimeSource &time_source)
+{
+  now = time_source;
+}
+
+
+Impairment::Stats
+ImpairedInterface::GetStats() const
+{
+  return impairment.GetStats();
+}
+
+
+size_t
+ImpairedInterface::Read(void *destination, const size_t &bufferLength)
+{
+  Receive();
+
+  if (!impairment.Pull(packet, now()))
+    throw InterfaceException("No packet due in the impaired interface.");
+
+  const size_t n = min(packet.size(), bufferLength);
+  memcpy(destination, packet.data(), n);
+
+  return n;
+}
+
+
+void
+ImpairedInterface::Write(const void *source, const size_t &bufferLength)
+{
+  interface->Write(source, bufferLength);
+}
+
+
+bool
+ImpairedInterface::IsReadyToRead() const
+{
+  Receive();
+  return impairment.HasDue(now());
+}
+
+
+void
+ImpairedInterface::Receive() const
+{
+  while (interface->IsReadyToRead())
+  {
+    packet.resize(MAX_PACKET_SIZE);
+    packet.resize(interface->Read(packet.data(), packet.size()));
+
+    impairment.Push(move(packet), now());
+  }
+}
+
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "Interface.h"
+#include "Impairment.h"
+
+#ifndef _IMPAIREDINTERFACE_H_
+#define _IMPAIREDINTERFACE_H_
+
+
+namespace Interfaces
+{
+
+/*
+ * Puts an Impairment in front of any interface: packets read from it
+ * come out of the impairment, so they can be lost, delayed, duplicated
+ * or reordered on the way. Checking IsReadyToRead() takes everything
+ * waiting in the wrapped interface. Writes pass through untouched, the
+ * other direction is impaired by wrapping the interface at its end.
+ */
+class ImpairedInterface : public Interface, private boost::noncopyable
+{
+public:
+  typedef std::function<Impairment::Clock::time_point()> TimeSource;
+
+  static constexpr std::size_t MAX_PACKET_SIZE = 65536;
+
+  ImpairedInterface(const std::shared_ptr<Interface> &interface,
+                    const Impairment::Profile &profile,
+                    const std::uint32_t &seed);
+  virtual ~ImpairedInterface() = default;
+
+  // tests can run the impairment on their own clock
+  void SetTimeSource(const TimeSource &time_source);
+
+  Impairment::Stats GetStats() const;
+
+  virtual size_t Read(void *destination, const size_t &bufferLength);
+  virtual void Write(const void *source, const size_t &bufferLength);
+
+  virtual bool IsReadyToRead() const;
+
+private:
+  std::shared_ptr<Interface> interface;
+  TimeSource now;
+
+  // IsReadyToRead() receives packets
+  mutable Impairment impairment;
+  mutable Impairment::Data packet;
+
+  void Receive() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Impairment.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+namespace Interfaces
+{
+
+constexpr size_t Impairment::DEFAULT_BURST;
+
+
+Impairment::Profile::Profile() :
+  loss(0),
+  good_to_bad(0),
+  bad_to_good(0),
+  bad_loss(0),
+  duplicate(0),
+  delay(0),
+  jitter(0),
+  reorder(0),
+  rate(0),
+  burst(DEFAULT_BURST)
+{
+}
+
+
+Impairment::Impairment(const Profile &profile, const uint32_t &seed) :
+  profile(profile),
+  random(seed),
+  probability(0.0, 1.0),
+  bad_state(false),
+  tokens(profile.burst),
+  refill_time(),
+  order(0),
+  stats()
+{
+}
+
+
+void
+Impairment::Push(Data &&packet, const Clock::time_point &now)
+{
+  stats.received++;
+
+  if (IsPoliced(packet.size(), now))
+  {
+    stats.rate_dropped++;
+    return;
+  }
+
+  if (IsLost())
+  {
+    stats.lost++;
+    return;
+  }
+
+  const Clock::time_point due = now + GetDelay();
+
+  if (Draw(profile.duplicate))
+  {
+    stats.duplicated++;
+    pending.emplace(Key(due, order++), packet);
+  }
+
+  pending.emplace(Key(due, order++), move(packet));
+}
+
+
+bool
+Impairment::Pull(Data &packet, const Clock::time_point &now)
+{
+  if (!HasDue(now))
+    return false;
+
+  auto first = pending.begin();
+  packet = move(first->second);
+  pending.erase(first);
+
+  stats.delivered++;
+  return true;
+}
+
+
+bool
+Impairment::HasDue(const Clock::time_point &now) const
+{
+  return !pending.empty() && pending.begin()->first.first <= now;
+}
+
+
+bool
+Impairment::GetNextDueTime(Clock::time_point &time) const
+{
+  if (pending.empty())
+    return false;
+
+  time = pending.begin()->first.first;
+  return true;
+}
+
+
+size_t
+Impairment::GetPendingCount() const
+{
+  return pending.size();
+}
+
+
+Impairment::Stats
+Impairment::GetStats() const
+{
+  return stats;
+}
+
+
+bool
+Impairment::Draw(const double &p)
+{
+  // nothing is drawn for disabled features, so enabling one doesn't
+  // change decisions of the others for the packets it doesn't touch
+  if (p <= 0)
+    return false;
+
+  return probability(random) < p;
+}
+
+
+bool
+Impairment::IsPoliced(const size_t &size, const Clock::time_point &now)
+{
+  if (profile.rate == 0)
+    return false;
+
+  if (refill_time != Clock::time_point())
+  {
+    const double elapsed = chrono::duration<double>(now - refill_time).count();
+    tokens = min<double>(profile.burst, tokens + elapsed * profile.rate);
+  }
+  refill_time = now;
+
+  if (size > tokens)
+    return true;
+
+  tokens -= size;
+  return false;
+}
+
+
+bool
+Impairment::IsLost()
+{
+  if (profile.good_to_bad <= 0)
+    return Draw(profile.loss);
+
+  if (bad_state)
+    bad_state = !Draw(profile.bad_to_good);
+  else
+    bad_state = Draw(profile.good_to_bad);
+
+  return Draw(bad_state ? profile.bad_loss : profile.loss);
+}
+
+
+Impairment::Clock::duration
+Impairment::GetDelay()
+{
+  if (Draw(profile.reorder))
+  {
+    stats.reordered++;
+    return Clock::duration::zero();
+  }
+
+  Clock::duration delay = profile.delay;
+
+  if (profile.jitter.count() > 0)
+  {
+    uniform_int_distribution<int64_t> jitter(-profile.jitter.count(), profile.jitter.count());
+    delay += chrono::microseconds(jitter(random));
+  }
+
+  return max(delay, Clock::duration::zero());
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#ifndef _IMPAIRMENT_H_
+#define _IMPAIRMENT_H_
+
+
+namespace Interfaces
+{
+
+/*
+ * Network path emulator in the style of netem: packets pushed in come
+ * out lost, duplicated, delayed, reordered or rate limited, as the
+ * profile says. Every decision is drawn from a generator seeded by the
+ * caller and time is passed in, so the same seed, packets and times
+ * always give the same result.
+ */
+class Impairment
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::vector<std::uint8_t> Data;
+
+  static constexpr std::size_t DEFAULT_BURST = 16 * 1024;
+
+  struct Profile
+  {
+    // probability of losing a packet, in the good state when the
+    // Gilbert-Elliott model is enabled
+    double loss;
+
+    // Gilbert-Elliott bursty loss, enabled when good_to_bad isn't zero:
+    // per packet probabilities of changing the state and of losing
+    // a packet in the bad state
+    double good_to_bad;
+    double bad_to_good;
+    double bad_loss;
+
+    double duplicate;
+
+    // fixed delay plus a uniform one from -jitter to +jitter, so jitter
+    // alone can reorder packets
+    std::chrono::microseconds delay;
+    std::chrono::microseconds jitter;
+    // probability of sending a packet without the delay, so it overtakes
+    // packets still delayed
+    double reorder;
+
+    // token bucket policer, packets above the rate are dropped, zero
+    // disables it; burst has to fit the largest packet
+    std::uint64_t rate; // bytes per second
+    std::size_t burst;
+
+    Profile();
+  };
+
+  struct Stats
+  {
+    std::uint64_t received;
+    std::uint64_t lost;
+    std::uint64_t rate_dropped;
+    std::uint64_t duplicated;
+    std::uint64_t reordered;
+    std::uint64_t delivered;
+  };
+
+  Impairment(const Profile &profile, const std::uint32_t &seed);
+
+  void Push(Data &&packet, const Clock::time_point &now);
+  // the packet whose time came first, false when there is none yet
+  bool Pull(Data &packet, const Clock::time_point &now);
+
+  bool HasDue(const Clock::time_point &now) const;
+  // due time of the first pending packet, false when there is none
+  bool GetNextDueTime(Clock::time_point &time) const;
+  std::size_t GetPendingCount() const;
+
+  Stats GetStats() const;
+
+private:
+  typedef std::pair<Clock::time_point, std::uint64_t> Key;
+
+  Profile profile;
+  std::mt19937 random;
+  std::uniform_real_distribution<double> probability;
+
+  bool bad_state;
+  double tokens;
+  Clock::time_point refill_time;
+
+  // ordered by due time, equal times in the order of arrival
+  std::map<Key, Data> pending;
+  std::uint64_t order;
+
+  Stats stats;
+
+  bool Draw(const double &p);
+  bool IsPoliced(const std::size_t &size, const Clock::time_point &now);
+  bool IsLost();
+  Clock::duration GetDelay();
+};
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "MemoryTun.h"
+#include "InterfaceException.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+
+namespace Interfaces
+{
+
+constexpr size_t MemoryTun::DEFAULT_QUEUE_SIZE;
+
+
+MemoryTun::MemoryTun(const InterfaceType &type, const size_t &queue_size) :
+  TunTap(type),
+  input(queue_size),
+  output(queue_size),
+  dropped(0),
+  refused(0)
+{
+}
+
+
+bool
+MemoryTun::Inject(Packet &&packet)
+{
+  if (input.TryPush(move(packet)))
+    return true;
+
+  refused.fetch_add(1, memory_order_relaxed);
+  return false;
+}
+
+
+bool
+MemoryTun::Extract(Packet &packet)
+{
+  return output.TryPop(packet);
+}
+
+
+uint64_t
+MemoryTun::GetDroppedCount() const
+{
+  return dropped.load(memory_order_relaxed);
+}
+
+
+uint64_t
+MemoryTun::GetKernelDropCount() const
+{
+  return refused.load(memory_order_relaxed);
+}
+
+
+string
+MemoryTun::GetName() const
+{
+  return "memory";
+}
+
+
+size_t
+MemoryTun::Read(void *destination, const size_t &bufferLength)
+{
+  // the tunnel reads only after IsReadyToRead(), a real device would block
+  if (!input.TryPop(packet))
+    throw InterfaceException("No packet waiting in the memory device.");
+
+  const size_t n = min(packet.size(), bufferLength);
+  memcpy(destination, packet.data(), n);
+
+  return n;
+}
+
+
+void
+MemoryTun::Write(const void *source, const size_t &bufferLength)
+{
+  const uint8_t *bytes = static_cast<const uint8_t*>(source);
+
+  if (!output.TryPush(Packet(bytes, bytes + bufferLength)))
+    dropped.fetch_add(1, memory_order_relaxed);
+}
+
+
+bool
+MemoryTun::IsReadyToRead() const
+{
+  return !input.IsEmpty();
+}
+
+
+void
+MemoryTun::Close()
+{
+}
+
+}
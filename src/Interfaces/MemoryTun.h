@@ -0,0 +1,78 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TunTap.h"
+#include "../Pipeline/SpscRing.h"
+
+#ifndef _MEMORYTUN_H_
+#define _MEMORYTUN_H_
+
+
+namespace Interfaces
+{
+
+/*
+ * TUN/TAP device living in memory, so the tunnel can be run by tests and
+ * benchmarks without root and without touching the network configuration.
+ * Packets injected by the caller are read by the tunnel, packets written
+ * by the tunnel wait until the caller extracts them. Like the packets of
+ * a real device, they start with the packet info header.
+ *
+ * Both directions are single producer, single consumer queues: one
+ * thread injects, one (the tunnel) reads, one writes, one extracts.
+ */
+class MemoryTun : public TunTap
+{
+public:
+  typedef std::vector<std::uint8_t> Packet;
+
+  static constexpr std::size_t DEFAULT_QUEUE_SIZE = 1024;
+
+  explicit MemoryTun(const InterfaceType &type = InterfaceType::TUN,
+                     const std::size_t &queue_size = DEFAULT_QUEUE_SIZE);
+  virtual ~MemoryTun() = default;
+
+  // a packet routed into the device, false when the tunnel doesn't keep
+  // up and the queue is full, the packet is then counted as dropped like
+  // a real device does
+  bool Inject(Packet &&packet);
+  // a packet the tunnel delivered, false when there is none
+  bool Extract(Packet &packet);
+
+  // packets written by the tunnel while nobody extracted them and the
+  // queue was full, a real device drops them too
+  std::uint64_t GetDroppedCount() const;
+
+  // packets refused by Inject()
+  virtual std::uint64_t GetKernelDropCount() const;
+
+  virtual std::string GetName() const;
+
+  // packets longer than the buffer are truncated, like read() does
+  virtual size_t Read(void *destination, const size_t &bufferLength);
+  virtual void Write(const void *source, const size_t &bufferLength);
+
+  virtual bool IsReadyToRead() const;
+
+  virtual void Close();
+
+private:
+  Pipeline::SpscRing<Packet> input;
+  Pipeline::SpscRing<Packet> output;
+  std::atomic<std::uint64_t> dropped;
+  std::atomic<std::uint64_t> refused;
+
+  // reused by Read(), taken from the input queue
+  Packet packet;
+};
+
+}
+
+#endif
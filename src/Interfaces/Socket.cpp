@@ -5,16 +5,20 @@
 
 #include "Socket.h"
 #include "InterfaceException.h"
+#include "../Logging/Log.h"
 
-#include <boost/log/trivial.hpp>
 #include <cstring>
 #include <cerrno>
-#include <vector>
 #include <stdexcept>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <sys/select.h>
+#include <sys/ioctl.h>
+#include <linux/sock_diag.h>
+#include <linux/sockios.h>
+
+#include "../Metrics/Counter.h"
 
 using namespace std;
 
@@ -22,10 +26,62 @@ using namespace std;
 namespace Interfaces
 {
 
+namespace
+{
+
+// only sockets with EnableStats() are counted
+Metrics::Counter received_datagrams("sdnst_socket_received_datagrams_total",
+                                    "Datagrams received from the tunnel socket.");
+Metrics::Counter received_bytes("sdnst_socket_received_bytes_total",
+                                "Bytes received from the tunnel socket.");
+Metrics::Counter sent_datagrams("sdnst_socket_sent_datagrams_total",
+                                "Datagrams sent to the tunnel socket.");
+Metrics::Counter sent_bytes("sdnst_socket_sent_bytes_total",
+                            "Bytes sent to the tunnel socket.");
+Metrics::Counter errors("sdnst_socket_errors_total",
+                        "Failed reads and writes of the tunnel socket.");
+
+}
+
+
+void
+Socket::CountReceived(const ssize_t &r) const
+{
+  if (!stats)
+    return;
+
+  if (r < 0)
+  {
+    errors.Add();
+    return;
+  }
+
+  received_datagrams.Add();
+  received_bytes.Add(r);
+}
+
+
+void
+Socket::CountSent(const ssize_t &r) const
+{
+  if (!stats)
+    return;
+
+  if (r < 0)
+  {
+    errors.Add();
+    return;
+  }
+
+  sent_datagrams.Add();
+  sent_bytes.Add(r);
+}
+
+
 Socket::~Socket()
 {
   if (!close_executed && socket_fd != -1)
-    BOOST_LOG_TRIVIAL(warning) << "Socket::Close() not called! Possibly a bug.";
+    LOG(warning) << "Socket::Close() not called! Possibly a bug.";
 }
 
 
@@ -35,27 +91,70 @@ Socket::Create(DomainType domain, SocketType type)
   int d = ToUnixType(domain);
   int t = ToUnixType(type);
 
-  BOOST_LOG_TRIVIAL(info) << "Creating socket...";
+  LOG(info) << "Creating socket...";
   int fd = socket(d, t, 0);
   if (fd < 0)
     throw InterfaceException(strerror(errno));
 
-  BOOST_LOG_TRIVIAL(info) << "New socket descriptor: " << fd;
+  LOG(info) << "New socket descriptor: " << fd;
 
   unique_ptr<Socket> sock(new Socket(domain, type, fd));
   return sock;
 }
 
 
+unique_ptr<Socket>
+Socket::FromDescriptor(const int &fd)
+{
+  int domain, type, reuse_port;
+  socklen_t n = sizeof(int);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &n) < 0
+      || getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &n) < 0
+      || getsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse_port, &n) < 0)
+    throw InterfaceException(strerror(errno));
+
+  unique_ptr<Socket> sock(new Socket(domain == PF_INET6 ? DomainType::INET6 : DomainType::INET,
+                                     type == SOCK_STREAM ? SocketType::STREAM : SocketType::DGRAM,
+                                     fd));
+  sock->reuse_port = reuse_port;
+
+  // connected socket knows its peer
+  Endpoint peer;
+  n = Endpoint::GetCapacity();
+  if (getpeername(fd, peer.GetSockaddr(), &n) == 0)
+  {
+    peer.SetLength(n);
+    sock->remote = peer;
+    sock->has_remote = true;
+    sock->is_connected = true;
+  }
+
+  LOG(info) << "Took over socket descriptor: " << fd;
+
+  return sock;
+}
+
+
+int
+Socket::GetDescriptor() const
+{
+  return socket_fd;
+}
+
+
 void
 Socket::Bind(const int &port, const std::string &address)
 {
-  int err;
-  vector<ByteOfStructSockaddr> v = ToBinaryForm(domain_type, address, port);
+  Bind(Endpoint(address, port));
+}
 
-  BOOST_LOG_TRIVIAL(info) << "Binding socket " << socket_fd
-                          << " to " << address << ":" << port << ".";
-  err = bind(socket_fd, reinterpret_cast<sockaddr*>(v.data()), v.size());
+
+void
+Socket::Bind(const Endpoint &endpoint)
+{
+  LOG(info) << "Binding socket " << socket_fd << " to " << endpoint.ToString() << ".";
+  int err = bind(socket_fd, endpoint.GetSockaddr(), endpoint.GetLength());
   if (err < 0)
     throw InterfaceException(strerror(errno));
 }
@@ -64,16 +163,20 @@ Socket::Bind(const int &port, const std::string &address)
 void
 Socket::Connect(const std::string &address, const int &port)
 {
-  vector<ByteOfStructSockaddr> v = ToBinaryForm(domain_type, address, port);
+  Connect(Endpoint(address, port));
+}
+
 
-  BOOST_LOG_TRIVIAL(info) << "Connecting socket " << socket_fd
-                          << " to: " << address << ":" << port;
-  int err = connect(socket_fd, reinterpret_cast<sockaddr*>(v.data()), v.size());
+void
+Socket::Connect(const Endpoint &endpoint)
+{
+  LOG(info) << "Connecting socket " << socket_fd << " to: " << endpoint.ToString();
+  int err = connect(socket_fd, endpoint.GetSockaddr(), endpoint.GetLength());
   if (err < 0)
     throw InterfaceException(strerror(errno));
 
-  remote_address = address;
-  remote_port = port;
+  remote = endpoint;
+  has_remote = true;
   is_connected = true;
 }
 
@@ -85,11 +188,61 @@ Socket::IsConnected() const
 }
 
 
+void
+Socket::EnableReuseAddress()
+{
+  const int enabled = 1;
+
+  int err = setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
+}
+
+
+void
+Socket::EnableReusePort()
+{
+  const int enabled = 1;
+
+  int err = setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &enabled, sizeof(enabled));
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
+
+  reuse_port = true;
+}
+
+
+bool
+Socket::IsReusePort() const
+{
+  return reuse_port;
+}
+
+
+void
+Socket::SetRemoteEndpoint(const Endpoint &endpoint)
+{
+  if (has_remote)
+    throw InterfaceException("Remote address already set.");
+
+  LOG(info) << "Sending datagrams from socket " << socket_fd << " to: " << endpoint.ToString();
+  remote = endpoint;
+  has_remote = true;
+}
+
+
+bool
+Socket::HasRemoteEndpoint() const
+{
+  return has_remote;
+}
+
+
 void
 Socket::Listen(const int &backlog)
 {
-  BOOST_LOG_TRIVIAL(info) << "Listening socket " << socket_fd
-                          << ", backlog: " << backlog;
+  LOG(info) << "Listening socket " << socket_fd
+            << ", backlog: " << backlog;
   int err = listen(socket_fd, backlog);
   if (err < 0)
     throw InterfaceException(strerror(errno));
@@ -99,41 +252,20 @@ Socket::Listen(const int &backlog)
 unique_ptr<Socket>
 Socket::Accept()
 {
-  vector<ByteOfStructSockaddr> v;
-  int new_socket_fd;
-  in_port_t *port;
-  socklen_t n;
-  void *address;
-
-  BOOST_LOG_TRIVIAL(info) << "Accept new client.";
-  if (domain_type == DomainType::INET)
-  {
-    n = sizeof(sockaddr_in);
-    v.resize(n, 0);
+  Endpoint client;
+  socklen_t n = Endpoint::GetCapacity();
 
-    sockaddr_in *p = reinterpret_cast<sockaddr_in*>(v.data());
-    port = &p->sin_port;
-    address = &p->sin_addr;
-  }
-  else if (domain_type == DomainType::INET6)
-  {
-    n = sizeof(sockaddr_in6);
-    v.resize(n, 0);
-
-    sockaddr_in6 *p = reinterpret_cast<sockaddr_in6*>(v.data());
-    port = &p->sin6_port;
-    address = &p->sin6_addr;
-  }
-
-  new_socket_fd = accept(socket_fd, reinterpret_cast<sockaddr*>(v.data()), &n);
+  LOG(info) << "Accept new client.";
+  int new_socket_fd = accept(socket_fd, client.GetSockaddr(), &n);
   if (new_socket_fd < 0)
     throw InterfaceException(strerror(errno));
 
+  client.SetLength(n);
+
   unique_ptr<Socket> s(new Socket(domain_type,
 				  socket_type,
 				  new_socket_fd,
-				  InAddrBinaryAddressToTextForm(domain_type, address),
-				  ntohs(*port)));
+				  client));
   return s;
 }
 
@@ -155,20 +287,39 @@ Socket::GetSocketType() const
 std::string
 Socket::GetRemoteAddress() const
 {
-  if (remote_address == "")
-    throw InterfaceException("Remote address not set.");
-
-  return remote_address;
+  return GetRemoteEndpoint().GetAddress();
 }
 
 
 int
 Socket::GetRemotePort() const
 {
-  if (remote_port == -1)
-    throw InterfaceException("Remote port not set.");
+  return GetRemoteEndpoint().GetPort();
+}
+
 
-  return remote_port;
+const Endpoint&
+Socket::GetRemoteEndpoint() const
+{
+  if (!has_remote)
+    throw InterfaceException("Remote address not set.");
+
+  return remote;
+}
+
+
+Endpoint
+Socket::GetLocalEndpoint() const
+{
+  Endpoint local;
+  socklen_t n = Endpoint::GetCapacity();
+
+  int err = getsockname(socket_fd, local.GetSockaddr(), &n);
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
+
+  local.SetLength(n);
+  return local;
 }
 
 
@@ -189,7 +340,10 @@ Socket::Write(const void *source, const size_t &bufferLength)
 size_t
 Socket::Recv(void *destination, const size_t &bufferLength, const int &flags)
 {
-  ssize_t r = recv(socket_fd, destination, bufferLength, flags);
+  ssize_t r = drop_reporting
+    ? ReceiveMessage(destination, bufferLength, nullptr, flags)
+    : recv(socket_fd, destination, bufferLength, flags);
+  CountReceived(r);
   if (r < 0)
     throw InterfaceException(strerror(errno));
 
@@ -200,44 +354,51 @@ Socket::Recv(void *destination, const size_t &bufferLength, const int &flags)
 void
 Socket::Send(const void *source, const size_t &bufferLength, const int &flags)
 {
+  if (!is_connected && has_remote)
+  {
+    SendTo(source, bufferLength, remote, flags);
+    return;
+  }
+
   ssize_t r = send(socket_fd, source, bufferLength, flags);
+  CountSent(r);
   if (r < 0)
     throw InterfaceException(strerror(errno));
 }
 
 
 size_t
-Socket::RecvFrom(void *destination, const size_t &bufferLength, string &address, int &port, const int &flags)
+Socket::RecvFrom(void *destination, const size_t &bufferLength, Endpoint &source, const int &flags)
 {
-  vector<ByteOfStructSockaddr> v;
-  if (domain_type == DomainType::INET)
-    v.resize(sizeof(sockaddr_in), 0);  
-  else if (domain_type == DomainType::INET6)
-    v.resize(sizeof(sockaddr_in6), 0);
+  if (drop_reporting)
+  {
+    ssize_t r = ReceiveMessage(destination, bufferLength, &source, flags);
+    CountReceived(r);
+    if (r < 0)
+      throw InterfaceException(strerror(errno));
 
-  sockaddr *s = reinterpret_cast<sockaddr*>(v.data());
-  socklen_t n = v.size();
+    return r;
+  }
+
+  socklen_t n = Endpoint::GetCapacity();
 
-  ssize_t r = recvfrom(socket_fd, destination, bufferLength, flags, s, &n);
+  ssize_t r = recvfrom(socket_fd, destination, bufferLength, flags, source.GetSockaddr(), &n);
+  CountReceived(r);
   if (r < 0)
     throw InterfaceException(strerror(errno));
-  if (v.size() < n)
-    throw InterfaceException("Address is truncated!");
 
-  tuple<string, int> address_port = FromBinaryForm(domain_type, s);
-  address = get<0>(address_port);
-  port = get<1>(address_port);
+  source.SetLength(n);
 
   return r;
 }
 
 
 void
-Socket::SendTo(const void *source, const size_t &bufferLength, const std::string &address, const int &port, const int &flags)
+Socket::SendTo(const void *source, const size_t &bufferLength, const Endpoint &destination, const int &flags)
 {
-  vector<ByteOfStructSockaddr> v = ToBinaryForm(domain_type, address, port);
   ssize_t r = sendto(socket_fd, source, bufferLength, flags,
-		     reinterpret_cast<sockaddr*>(v.data()), v.size());
+		     destination.GetSockaddr(), destination.GetLength());
+  CountSent(r);
   if (r < 0)
     throw InterfaceException(strerror(errno));
 }
@@ -246,12 +407,12 @@ Socket::SendTo(const void *source, const size_t &bufferLength, const std::string
 void
 Socket::Close()
 {
-  BOOST_LOG_TRIVIAL(info) << "Closing socket: " << socket_fd << "...";
+  LOG(info) << "Closing socket: " << socket_fd << "...";
   int err = close(socket_fd);
   if (err < 0)
     throw InterfaceException(strerror(errno));
 
-  BOOST_LOG_TRIVIAL(info) << "Closed socket descriptor: " << socket_fd;
+  LOG(info) << "Closed socket descriptor: " << socket_fd;
 
   socket_fd = -1;
   close_executed = true;
@@ -275,128 +436,226 @@ Socket::IsReadyToRead() const
 }
 
 
-Socket::Socket(Socket::DomainType domain,
-	       Socket::SocketType type,
-	       int socket_fd,
-	       const std::string &remote_address,
-	       const int &remote_port) :
-  socket_fd(socket_fd),
-  domain_type(domain),
-  socket_type(type),
-  remote_address(remote_address),
-  remote_port(remote_port),
-  is_connected(false)
+void
+Socket::AttachFilter(const SocketFilter &filter)
 {
+  const vector<sock_filter> &program = filter.GetProgram();
+  sock_fprog fprog;
+  fprog.len = program.size();
+  fprog.filter = const_cast<sock_filter*>(program.data());
+
+  LOG(info) << "Attaching filter to socket " << socket_fd
+            << ", " << program.size() << " instructions.";
+  int err = setsockopt(socket_fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog));
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
 }
 
 
-int
-Socket::ToUnixType(DomainType domain)
+void
+Socket::AttachSteeringProgram(const SocketFilter &steering)
 {
-  switch (domain)
-  {
-  case DomainType::INET:
-    return PF_INET;
+  const vector<sock_filter> &program = steering.GetProgram();
+  sock_fprog fprog;
+  fprog.len = program.size();
+  fprog.filter = const_cast<sock_filter*>(program.data());
 
-  case DomainType::INET6:
-    return PF_INET6;
-  }
+  LOG(info) << "Attaching steering program to reuseport group of socket " << socket_fd << ".";
+  int err = setsockopt(socket_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &fprog, sizeof(fprog));
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
+}
 
-  throw domain_error("Can't convert DomainType to unix type.");
+
+uint32_t
+Socket::GetDropCount() const
+{
+  uint32_t meminfo[SK_MEMINFO_VARS] = {0};
+  socklen_t n = sizeof(meminfo);
+
+  int err = getsockopt(socket_fd, SOL_SOCKET, SO_MEMINFO, meminfo, &n);
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
+
+  return meminfo[SK_MEMINFO_DROPS];
 }
 
 
-int
-Socket::ToUnixType(SocketType type)
+void
+Socket::EnableDropReporting()
 {
-  switch (type)
-  {
-  case SocketType::DGRAM:
-    return SOCK_DGRAM;
+  const int enabled = 1;
 
-  case SocketType::STREAM:
-    return SOCK_STREAM;
-  }
+  int err = setsockopt(socket_fd, SOL_SOCKET, SO_RXQ_OVFL, &enabled, sizeof(enabled));
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
 
-  throw domain_error("Can't convert SocketType to unix type.");
+  drop_reporting = true;
+}
+
+
+void
+Socket::EnableStats()
+{
+  stats = true;
+}
+
+
+uint32_t
+Socket::GetReportedDropCount() const
+{
+  return reported_drops.load(memory_order_relaxed);
+}
+
+
+void
+Socket::SetReceiveBufferSize(const int &size)
+{
+  SetBufferSize(SO_RCVBUF, SO_RCVBUFFORCE, size, "receive");
+}
+
+
+void
+Socket::SetSendBufferSize(const int &size)
+{
+  SetBufferSize(SO_SNDBUF, SO_SNDBUFFORCE, size, "send");
 }
 
 
-string
-Socket::InAddrBinaryAddressToTextForm(DomainType domain_type, const void *in46_addr)
+Socket::BufferStats
+Socket::GetBufferStats() const
 {
-  char dst[255] = {0};
-  const char *ret;
+  // SIOCINQ of a datagram socket gives the size of the first datagram
+  // only, the memory info has all of them
+  uint32_t meminfo[SK_MEMINFO_VARS] = {0};
+  socklen_t n = sizeof(meminfo);
+
+  int err = getsockopt(socket_fd, SOL_SOCKET, SO_MEMINFO, meminfo, &n);
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
 
-  BOOST_LOG_TRIVIAL(info) << "Converting to text form.";
-  ret = inet_ntop(ToUnixType(domain_type), in46_addr, dst, sizeof(dst));
-  if (ret != dst)
+  int send_queued = 0;
+  err = ioctl(socket_fd, SIOCOUTQ, &send_queued);
+  if (err < 0)
     throw InterfaceException(strerror(errno));
 
-  return string(dst);
+  BufferStats stats;
+  stats.receive_queued = meminfo[SK_MEMINFO_RMEM_ALLOC];
+  stats.receive_buffer = meminfo[SK_MEMINFO_RCVBUF];
+  stats.send_queued = send_queued;
+  stats.send_buffer = meminfo[SK_MEMINFO_SNDBUF];
+
+  return stats;
 }
 
 
-vector<Socket::ByteOfStructSockaddr>
-Socket::ToBinaryForm(DomainType domain_type, const string &address, const int &port)
+Socket::Socket(Socket::DomainType domain,
+	       Socket::SocketType type,
+	       int socket_fd,
+	       const Endpoint &remote) :
+  socket_fd(socket_fd),
+  domain_type(domain),
+  socket_type(type),
+  remote(remote),
+  has_remote(remote.IsValid()),
+  is_connected(false),
+  reuse_port(false),
+  close_executed(false),
+  drop_reporting(false),
+  reported_drops(0),
+  stats(false)
 {
-  vector<ByteOfStructSockaddr> v;
-  int n;
+}
 
-  BOOST_LOG_TRIVIAL(info) << "Converting " + address + " to binary form.";
-  if (domain_type == DomainType::INET)
-  {
-    n = sizeof(sockaddr_in);
-    v.resize(n, 0);
 
-    sockaddr_in *s = reinterpret_cast<sockaddr_in*>(v.data());
-    s->sin_family = AF_INET;
-    s->sin_port = htons(port);
+ssize_t
+Socket::ReceiveMessage(void *destination, const size_t &bufferLength, Endpoint *source, const int &flags)
+{
+  iovec iov = { destination, bufferLength };
+  char control[CMSG_SPACE(sizeof(uint32_t))];
+
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
 
-    const int err = inet_aton(address.c_str(), &s->sin_addr);
-    if (err == 0)
-      throw InterfaceException(strerror(errno));
-  }
-  else if (domain_type == DomainType::INET6)
+  if (source)
   {
-    n = sizeof(sockaddr_in6);
-    v.resize(n, 0);
+    message.msg_name = source->GetSockaddr();
+    message.msg_namelen = Endpoint::GetCapacity();
+  }
 
-    sockaddr_in6 *s = reinterpret_cast<sockaddr_in6*>(v.data());
-    s->sin6_family = AF_INET6;
-    s->sin6_port = htons(port);
+  ssize_t r = recvmsg(socket_fd, &message, flags);
+  if (r < 0)
+    return r;
 
-    const int err = inet_pton(AF_INET6, address.c_str(), s->sin6_addr.s6_addr);
-    if (err == 0)
-      throw InterfaceException("Invalid IPv6 network address: " + address);
-    else if (err < 0)
-      throw InterfaceException(strerror(errno));
-  }
+  if (source)
+    source->SetLength(message.msg_namelen);
+
+  // the kernel attaches the count once something was dropped
+  for (cmsghdr *c = CMSG_FIRSTHDR(&message); c; c = CMSG_NXTHDR(&message, c))
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL)
+    {
+      uint32_t drops;
+      memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+      reported_drops.store(drops, memory_order_relaxed);
+    }
 
-  return v;
+  return r;
 }
 
 
-tuple<string, int>
-Socket::FromBinaryForm(DomainType domain_type, const sockaddr *addr)
+void
+Socket::SetBufferSize(const int &option, const int &forced_option, const int &size, const char *name)
 {
-  string address;
-  int port;
-  
-  if (domain_type == DomainType::INET)
+  // the forced option ignores the system limit, but needs CAP_NET_ADMIN
+  int err = setsockopt(socket_fd, SOL_SOCKET, forced_option, &size, sizeof(size));
+  if (err < 0)
+    err = setsockopt(socket_fd, SOL_SOCKET, option, &size, sizeof(size));
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
+
+  int actual = 0;
+  socklen_t n = sizeof(actual);
+  if (getsockopt(socket_fd, SOL_SOCKET, option, &actual, &n) < 0)
+    throw InterfaceException(strerror(errno));
+
+  LOG(info) << "Socket " << socket_fd << " " << name << " buffer: " << actual
+            << " bytes (requested " << size << ").";
+}
+
+
+int
+Socket::ToUnixType(DomainType domain)
+{
+  switch (domain)
   {
-    auto p = reinterpret_cast<const sockaddr_in*>(addr);
-    address = InAddrBinaryAddressToTextForm(domain_type, reinterpret_cast<const void*>(&p->sin_addr));
-    port = ntohs(p->sin_port);
+  case DomainType::INET:
+    return PF_INET;
+
+  case DomainType::INET6:
+    return PF_INET6;
   }
-  else if (domain_type == DomainType::INET6)
+
+  throw domain_error("Can't convert DomainType to unix type.");
+}
+
+
+int
+Socket::ToUnixType(SocketType type)
+{
+  switch (type)
   {
-    auto p = reinterpret_cast<const sockaddr_in6*>(addr);
-    address = InAddrBinaryAddressToTextForm(domain_type, reinterpret_cast<const void*>(&p->sin6_addr));
-    port = ntohs(p->sin6_port);
+  case SocketType::DGRAM:
+    return SOCK_DGRAM;
+
+  case SocketType::STREAM:
+    return SOCK_STREAM;
   }
-  
-  return make_tuple(address, port);
+
+  throw domain_error("Can't convert SocketType to unix type.");
 }
 
 }
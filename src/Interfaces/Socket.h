@@ -4,17 +4,18 @@
  */
 
 #include <boost/noncopyable.hpp>
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <vector>
-#include <tuple>
+#include <string>
 
 #include "Interface.h"
+#include "Endpoint.h"
+#include "SocketFilter.h"
 
 #ifndef _SOCKET_H_
 #define _SOCKET_H_
 
-struct sockaddr;
-
 
 namespace Interfaces
 {
@@ -22,8 +23,6 @@ namespace Interfaces
 class Socket : public Interface, private boost::noncopyable
 {
 public:
-  typedef char ByteOfStructSockaddr;
-
   enum class DomainType
   {
     INET,
@@ -40,11 +39,34 @@ public:
   virtual ~Socket();
 
   static std::unique_ptr<Socket> Create(DomainType domain, SocketType type);
+  // takes over a descriptor of a bound or connected socket, e.g. received
+  // from the process being replaced
+  static std::unique_ptr<Socket> FromDescriptor(const int &fd);
+
+  int GetDescriptor() const;
   void Bind(const int &port, const std::string &address);
+  void Bind(const Endpoint &endpoint);
 
   void Connect(const std::string &address, const int &port);
+  void Connect(const Endpoint &endpoint);
   bool IsConnected() const;
 
+  // lets a listening socket bind a port with connections in TIME_WAIT,
+  // has to be called before Bind()
+  void EnableReuseAddress();
+
+  // lets several sockets (and processes) bind the same address and port,
+  // has to be called before Bind()
+  void EnableReusePort();
+  bool IsReusePort() const;
+
+  // Send() and Write() go to the endpoint with sendto(), the socket stays
+  // unconnected, e.g. so the steering program of its reuseport group
+  // still decides which datagrams it gets
+  void SetRemoteEndpoint(const Endpoint &endpoint);
+  // set by Connect(), SetRemoteEndpoint() or Accept()
+  bool HasRemoteEndpoint() const;
+
   void Listen(const int &backlog);
   std::unique_ptr<Socket> Accept();
 
@@ -53,6 +75,9 @@ public:
 
   std::string GetRemoteAddress() const;
   int GetRemotePort() const;
+  const Endpoint& GetRemoteEndpoint() const;
+  // address the socket is bound to, e.g. the port chosen by the kernel
+  Endpoint GetLocalEndpoint() const;
 
   size_t Read(void *destination, const size_t &bufferLength);
   void Write(const void *source, const size_t &bufferLength);
@@ -60,39 +85,83 @@ public:
   size_t Recv(void *destination, const size_t &bufferLength, const int &flags = 0);
   void Send(const void *source, const size_t &bufferLength, const int &flags = 0);
 
-  size_t RecvFrom(void *destination, const size_t &bufferLength, std::string &address, int &port, const int &flags = 0);
-  void SendTo(const void *source, const size_t &bufferLength, const std::string &address, const int &port, const int &flags = 0);
+  size_t RecvFrom(void *destination, const size_t &bufferLength, Endpoint &source, const int &flags = 0);
+  void SendTo(const void *source, const size_t &bufferLength, const Endpoint &destination, const int &flags = 0);
 
   bool IsReadyToRead() const;
 
+  // datagrams not matching the filter are dropped by the kernel
+  void AttachFilter(const SocketFilter &filter);
+
+  // chooses the socket of the reuseport group which gets a datagram,
+  // one program serves the whole group
+  void AttachSteeringProgram(const SocketFilter &steering);
+
+  // datagrams dropped by the kernel since the socket was created:
+  // rejected by the filter or not fitting into the receive buffer,
+  // wraps around at 2^32
+  std::uint32_t GetDropCount() const;
+
+  // Recv() and RecvFrom() take the drop count the kernel attaches to
+  // datagrams (SO_RXQ_OVFL), so it's known without a system call
+  void EnableDropReporting();
+  // the drop count of the last datagram received, zero before the first
+  // datagram reporting it, wraps around at 2^32
+  std::uint32_t GetReportedDropCount() const;
+
+  // counts datagrams and bytes of the socket in the sdnst_socket_*
+  // metrics, meant for the tunnel socket only
+  void EnableStats();
+
+  // Root may go above net.core.rmem_max and net.core.wmem_max, others get
+  // at most them. The kernel doubles the size for its bookkeeping.
+  void SetReceiveBufferSize(const int &size);
+  void SetSendBufferSize(const int &size);
+
+  struct BufferStats
+  {
+    // bytes waiting in the buffers, of all datagrams, not only the first
+    std::uint32_t receive_queued;
+    std::uint32_t receive_buffer;
+    std::uint32_t send_queued;
+    std::uint32_t send_buffer;
+  };
+
+  BufferStats GetBufferStats() const;
+
   void Close();
 
 private:
   Socket(DomainType domain,
 	 SocketType type,
 	 int socket_fd,
-	 const std::string &remote_address = "",
-	 const int &remote_port = -1);
+	 const Endpoint &remote = Endpoint());
 
   int socket_fd;
 
   DomainType domain_type;
   SocketType socket_type;
 
-  std::string remote_address;
-  int remote_port;
+  Endpoint remote;
+  // set after remote, so threads sending datagrams see complete address
+  std::atomic<bool> has_remote;
 
-  bool is_connected;
+  // read by threads sending datagrams
+  std::atomic<bool> is_connected;
+  bool reuse_port;
   bool close_executed;
 
+  bool drop_reporting;
+  std::atomic<std::uint32_t> reported_drops;
+  bool stats;
+
+  ssize_t ReceiveMessage(void *destination, const size_t &bufferLength, Endpoint *source, const int &flags);
+  void CountReceived(const ssize_t &r) const;
+  void CountSent(const ssize_t &r) const;
+  void SetBufferSize(const int &option, const int &forced_option, const int &size, const char *name);
+
   static int ToUnixType(DomainType domain);
   static int ToUnixType(SocketType type);
-  static std::string InAddrBinaryAddressToTextForm(DomainType domain_type, const void *in46_addr);
-  static std::vector<ByteOfStructSockaddr> ToBinaryForm(DomainType domain,
-							const std::string &address,
-							const int &port);
-  static std::tuple<std::string, int> FromBinaryForm(DomainType domain_type,
-						     const sockaddr *addr);
 };
 
 }
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "SocketFilter.h"
+#include "InterfaceException.h"
+
+using namespace std;
+
+
+namespace Interfaces
+{
+
+constexpr uint32_t SocketFilter::UDP_HEADER_SIZE;
+constexpr size_t SocketFilter::MAX_PROGRAM_SIZE;
+
+
+SocketFilter::SocketFilter(const Packets::Packet::Signature &signature,
+                           const uint32_t &header_size)
+{
+  // every check jumps to the final "drop" instruction when it fails,
+  // jump targets are filled in when the size of the program is known
+  vector<size_t> checks;
+
+  program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0));
+  checks.push_back(program.size());
+  program.push_back(BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K,
+                             static_cast<uint32_t>(header_size + signature.minimum_size), 0, 0));
+
+  for (auto &byte : signature.bytes)
+  {
+    program.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS,
+                               static_cast<uint32_t>(header_size + byte.offset)));
+    if (byte.mask != 0xFF)
+      program.push_back(BPF_STMT(BPF_ALU | BPF_AND | BPF_K, byte.mask));
+
+    checks.push_back(program.size());
+    program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                               static_cast<uint32_t>(byte.value & byte.mask), 0, 0));
+  }
+
+  // whole datagram is accepted
+  program.push_back(BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF));
+  program.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+
+  if (program.size() > MAX_PROGRAM_SIZE)
+    throw InterfaceException("Signature is too long for a socket filter.");
+
+  const size_t drop = program.size() - 1;
+  for (auto &c : checks)
+    program[c].jf = drop - c - 1;
+}
+
+
+SocketFilter
+SocketFilter::CreateSteering(const size_t &session_id_offset,
+                             const unsigned &sockets)
+{
+  if (sockets == 0)
+    throw InterfaceException("Steering needs at least one socket.");
+
+  // datagrams too short to have a session id stop the program, which
+  // returns zero - the first socket
+  SocketFilter steering;
+  steering.program = {
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, static_cast<uint32_t>(session_id_offset)),
+    BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, sockets),
+    BPF_STMT(BPF_RET | BPF_A, 0)
+  };
+
+  return steering;
+}
+
+
+const vector<sock_filter>&
+SocketFilter::GetProgram() const
+{
+  return program;
+}
+
+}
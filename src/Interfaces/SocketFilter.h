@@ -0,0 +1,59 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <linux/filter.h>
+
+#include "../Packets/Packet.h"
+
+#ifndef _SOCKETFILTER_H_
+#define _SOCKETFILTER_H_
+
+
+namespace Interfaces
+{
+
+/*
+ * Classic BPF programs run by the kernel for every received datagram.
+ *
+ * Filter built from the signature of a packet format accepts only
+ * matching datagrams, attached with Socket::AttachFilter(). Foreign
+ * datagrams are dropped before they are copied to the process and are
+ * counted in Socket::GetDropCount().
+ *
+ * Steering program chooses the socket of a SO_REUSEPORT group which
+ * gets the datagram, attached with Socket::AttachSteeringProgram().
+ */
+class SocketFilter
+{
+public:
+  // filters of UDP sockets see the datagram with its UDP header
+  static constexpr std::uint32_t UDP_HEADER_SIZE = 8;
+
+  explicit SocketFilter(const Packets::Packet::Signature &signature,
+                        const std::uint32_t &header_size = UDP_HEADER_SIZE);
+
+  // returns session id modulo number of sockets, the index of the
+  // socket in the group (sockets are numbered in order of binding);
+  // steering programs see the datagram without the UDP header
+  static SocketFilter CreateSteering(const std::size_t &session_id_offset,
+                                     const unsigned &sockets);
+
+  const std::vector<sock_filter>& GetProgram() const;
+
+private:
+  // jump offsets have eight bits
+  static constexpr std::size_t MAX_PROGRAM_SIZE = 256;
+
+  std::vector<sock_filter> program;
+
+  SocketFilter() = default;
+};
+
+}
+
+#endif
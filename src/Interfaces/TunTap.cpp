@@ -5,7 +5,6 @@
 
 #include <cerrno>
 #include <cstring>
-#include <boost/log/trivial.hpp>
 #include <sys/socket.h>
 #include <linux/if.h>
 #include <linux/if_tun.h>
@@ -15,9 +14,12 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/select.h>
+#include <fstream>
 
 #include "TunTap.h"
 #include "InterfaceException.h"
+#include "../Logging/Log.h"
+#include "../Metrics/Counter.h"
 
 using namespace std;
 
@@ -25,11 +27,25 @@ using namespace std;
 namespace Interfaces
 {
 
+namespace
+{
+
+Metrics::Counter received_packets("sdnst_tun_received_packets_total",
+                                  "Packets read from the TUN/TAP device.");
+Metrics::Counter received_bytes("sdnst_tun_received_bytes_total",
+                                "Bytes read from the TUN/TAP device.");
+Metrics::Counter sent_packets("sdnst_tun_sent_packets_total",
+                              "Packets written to the TUN/TAP device.");
+Metrics::Counter sent_bytes("sdnst_tun_sent_bytes_total",
+                            "Bytes written to the TUN/TAP device.");
+
+}
+
 
 TunTap::~TunTap()
 {
   if (!close_executed && fd != -1)
-    BOOST_LOG_TRIVIAL(warning) << "TunTap::Close() not called! Possibly a bug.";
+    LOG(warning) << "TunTap::Close() not called! Possibly a bug.";
 }
 
 
@@ -39,7 +55,7 @@ TunTap::Create(TunTap::InterfaceType type)
   const char * const tun_tap_device = "/dev/net/tun"; 
   unique_ptr<TunTap> tt(new TunTap(type));
 
-  BOOST_LOG_TRIVIAL(info) << "Opening device file: " << tun_tap_device;
+  LOG(info) << "Opening device file: " << tun_tap_device;
   tt->fd = open(tun_tap_device, O_RDWR);
   if (tt->fd < 0)
     throw InterfaceException(strerror(errno));
@@ -51,19 +67,47 @@ TunTap::Create(TunTap::InterfaceType type)
   else if (type == InterfaceType::TAP)
     ifr.ifr_flags = IFF_TAP;
 
-  BOOST_LOG_TRIVIAL(info) << "Creating TUN/TAP device...";
+  LOG(info) << "Creating TUN/TAP device...";
   int err = ioctl(tt->fd, TUNSETIFF, (void *)&ifr);
   if (err < 0)
     throw InterfaceException(strerror(errno));
 
   tt->name = ifr.ifr_name;
 
-  BOOST_LOG_TRIVIAL(info) << "Created device: " << tt->name;
+  LOG(info) << "Created device: " << tt->name;
+
+  return tt;
+}
+
+
+unique_ptr<TunTap>
+TunTap::FromDescriptor(const int &fd)
+{
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(struct ifreq));
+
+  int err = ioctl(fd, TUNGETIFF, (void *)&ifr);
+  if (err < 0)
+    throw InterfaceException(strerror(errno));
+
+  unique_ptr<TunTap> tt(new TunTap((ifr.ifr_flags & IFF_TAP) ? InterfaceType::TAP
+                                                             : InterfaceType::TUN));
+  tt->fd = fd;
+  tt->name = ifr.ifr_name;
+
+  LOG(info) << "Took over device: " << tt->name << ", descriptor: " << fd;
 
   return tt;
 }
 
 
+int
+TunTap::GetDescriptor() const
+{
+  return fd;
+}
+
+
 TunTap::InterfaceType
 TunTap::GetType() const
 {
@@ -86,6 +130,9 @@ TunTap::Read(void *destination, const size_t &bufferLength)
   if (n < 0)
     throw InterfaceException(strerror(errno));
 
+  received_packets.Add();
+  received_bytes.Add(n);
+
   return n;
 }
 
@@ -97,6 +144,9 @@ TunTap::Write(const void *source, const size_t &bufferLength)
 
   if (n < 0)
     throw InterfaceException(strerror(errno));
+
+  sent_packets.Add();
+  sent_bytes.Add(n);
 }
 
 
@@ -116,15 +166,30 @@ TunTap::IsReadyToRead() const
 }
 
 
+uint64_t
+TunTap::GetKernelDropCount() const
+{
+  if (fd == -1)
+    return 0;
+
+  // without sysfs, e.g. in some containers, nothing is known
+  ifstream statistics("/sys/class/net/" + name + "/statistics/tx_dropped");
+  uint64_t dropped = 0;
+  statistics >> dropped;
+
+  return dropped;
+}
+
+
 void
 TunTap::Close()
 {
-  BOOST_LOG_TRIVIAL(info) << "Closing TunTap descriptor: " << fd;
+  LOG(info) << "Closing TunTap descriptor: " << fd;
   int err = close(fd);
   if (err < 0)
     throw InterfaceException(strerror(errno));
 
-  BOOST_LOG_TRIVIAL(info) << "TunTap descriptor " << fd << " closed.";
+  LOG(info) << "TunTap descriptor " << fd << " closed.";
   close_executed = true;
 }
 
@@ -4,8 +4,9 @@
  */
 
 #include <boost/noncopyable.hpp>
+#include <cstdint>
 #include <memory>
-//#include <string>
+#include <string>
 
 #include "Interface.h"
 
@@ -25,23 +26,41 @@ public:
     TAP
   };
 
+  // every packet read from the device starts with struct tun_pi
+  static constexpr std::size_t PACKET_INFO_SIZE = 4;
+  static constexpr std::size_t ETHERNET_HEADER_SIZE = 14;
+
   virtual ~TunTap();
 
   static std::unique_ptr<TunTap> Create(InterfaceType type);
+  // takes over a descriptor of an attached device, e.g. received from
+  // the process being replaced
+  static std::unique_ptr<TunTap> FromDescriptor(const int &fd);
 
-  InterfaceType GetType() const;
-  std::string GetName() const;
+  virtual int GetDescriptor() const;
 
-  size_t Read(void *destination, const size_t &bufferLength);
-  void Write(const void *source, const size_t &bufferLength);
+  virtual InterfaceType GetType() const;
+  virtual std::string GetName() const;
 
-  bool IsReadyToRead() const;
-  
-  void Close();
+  virtual size_t Read(void *destination, const size_t &bufferLength);
+  virtual void Write(const void *source, const size_t &bufferLength);
 
-private:
+  virtual bool IsReadyToRead() const;
+
+  // Packets routed into the device which were dropped because the tunnel
+  // didn't read them in time (tx_dropped of the interface), zero without
+  // sysfs. The descriptor itself reports no queue length, SIOCINQ and
+  // SIOCOUTQ fail on it.
+  virtual std::uint64_t GetKernelDropCount() const;
+
+  virtual void Close();
+
+protected:
+  // descriptor is set by the factories, devices not backed by the
+  // kernel keep it at -1
   TunTap(InterfaceType type);
 
+private:
   InterfaceType type;
   std::string name;
   int fd;
@@ -0,0 +1,297 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Generator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../Interfaces/TunTap.h"
+#include "../Packets/PseudoDNS.h"
+#include "../Logging/Log.h"
+
+using namespace std;
+using namespace Interfaces;
+using namespace Packets;
+
+
+namespace LoadGen
+{
+
+namespace
+{
+
+constexpr size_t IP_HEADER_SIZE = 20;
+constexpr size_t UDP_HEADER_SIZE = 8;
+constexpr size_t PROBE_OFFSET = TunTap::PACKET_INFO_SIZE + IP_HEADER_SIZE + UDP_HEADER_SIZE;
+constexpr size_t PROBE_SIZE = 16;
+// packets sent in one round when the generator falls behind its rate
+constexpr unsigned MAX_BURST = 64;
+constexpr unsigned MAX_RECEIVE_ROUNDS = 16;
+
+}
+
+constexpr size_t Generator::MIN_PACKET_SIZE;
+constexpr size_t Generator::MAX_PACKET_SIZE;
+constexpr size_t Generator::MAX_SOCKETS;
+constexpr size_t Generator::MAX_DATAGRAM_SIZE;
+constexpr chrono::seconds Generator::DRAIN_TIMEOUT;
+
+static_assert(Generator::MIN_PACKET_SIZE == IP_HEADER_SIZE + UDP_HEADER_SIZE + PROBE_SIZE,
+              "the smallest packet has to hold the probe");
+
+
+Generator::Config::Config() :
+  clients(1000),
+  rate(10000),
+  // simple IMIX
+  sizes({ {64, 7}, {576, 4}, {1500, 1} }),
+  duration(10000),
+  seed(1)
+{
+}
+
+
+Generator::Generator(const Endpoint &server, const SessionFactory &factory,
+                     const Config &config) :
+  config(config),
+  random(config.seed),
+  running(false),
+  report(),
+  round_trip("sdnst_loadgen_round_trip_time_seconds",
+             "Round trip time of generated packets through the reflector.")
+{
+  vector<double> weights;
+  for (auto &s : config.sizes)
+    weights.push_back(s.second);
+  size_distribution = discrete_distribution<size_t>(weights.begin(), weights.end());
+
+  const size_t n = min<size_t>(config.clients, MAX_SOCKETS);
+  for (size_t i = 0; i < n; i++)
+  {
+    sockets.push_back(Socket::Create(server.GetFamily() == AF_INET6 ? Socket::DomainType::INET6
+                                                                    : Socket::DomainType::INET,
+                                     Socket::SocketType::DGRAM));
+    sockets.back()->Connect(server);
+    descriptors.push_back(pollfd { sockets.back()->GetDescriptor(), POLLIN, 0 });
+  }
+
+  for (unsigned i = 0; i < config.clients; i++)
+    sessions.push_back(factory.Create(i + 1));
+
+  report.clients = config.clients;
+}
+
+
+Generator::Report
+Generator::Run()
+{
+  LOG(info) << "Generating " << config.rate << " packets per second of "
+            << config.clients << " clients...";
+
+  const chrono::nanoseconds interval(1000000000 / config.rate);
+  const Clock::time_point start = Clock::now();
+  Clock::time_point next = start;
+  uint64_t sequence = 0;
+
+  running = true;
+  while (running && Clock::now() - start < config.duration)
+  {
+    const Clock::time_point now = Clock::now();
+    bool idle = true;
+
+    for (unsigned i = 0; i < MAX_BURST && next <= now; i++, next += interval)
+    {
+      Send(sequence % config.clients, sequence, now);
+      sequence++;
+      idle = false;
+    }
+
+    FlushPending(now);
+
+    if (Receive())
+      idle = false;
+
+    if (idle)
+      usleep(10);
+  }
+
+  const Clock::time_point end = Clock::now();
+  report.seconds = chrono::duration<double>(end - start).count();
+
+  while (running && report.received + report.malformed < report.sent
+         && Clock::now() - end < DRAIN_TIMEOUT)
+  {
+    FlushPending(Clock::now());
+
+    if (!Receive())
+      usleep(10);
+  }
+
+  running = false;
+  report.round_trip = round_trip.GetSnapshot().Summarize();
+
+  for (auto &s : sockets)
+    s->Close();
+
+  return report;
+}
+
+
+void
+Generator::Stop()
+{
+  running = false;
+}
+
+
+void
+Generator::Send(const size_t &client, const uint64_t &sequence,
+                const Clock::time_point &now)
+{
+  const size_t size = config.sizes[size_distribution(random)].first;
+  MakePacket(size, sequence, now);
+
+  if (!sessions[client]->sender->Push(packet, now))
+  {
+    report.dropped++;
+    return;
+  }
+
+  report.sent++;
+  report.sent_bytes += size;
+  Flush(client, now);
+}
+
+
+void
+Generator::Flush(const size_t &client, const Clock::time_point &now)
+{
+  Session &session = *sessions[client];
+  Socket &socket = *sockets[client % sockets.size()];
+
+  while (session.sender->Pull(datagram, now))
+    socket.Write(datagram.data(), datagram.size());
+
+  if (!session.pending && session.sender->HasPendingData())
+  {
+    session.pending = true;
+    pending.push_back(client);
+  }
+}
+
+
+void
+Generator::FlushPending(const Clock::time_point &now)
+{
+  vector<size_t> flushed;
+  flushed.swap(pending);
+
+  for (auto &client : flushed)
+  {
+    sessions[client]->pending = false;
+    Flush(client, now);
+  }
+}
+
+
+bool
+Generator::Receive()
+{
+  bool received = false;
+
+  // reflected traffic is a few times the generated one, so sockets are
+  // read until empty or for a few rounds
+  for (unsigned round = 0; round < MAX_RECEIVE_ROUNDS; round++)
+  {
+    if (poll(descriptors.data(), descriptors.size(), 0) <= 0)
+      break;
+
+    for (size_t i = 0; i < sockets.size(); i++)
+      if (descriptors[i].revents & POLLIN)
+        ReceiveFrom(*sockets[i]);
+
+    received = true;
+  }
+
+  return received;
+}
+
+
+void
+Generator::ReceiveFrom(Socket &socket)
+{
+  datagram.resize(MAX_DATAGRAM_SIZE);
+  datagram.resize(socket.Read(datagram.data(), datagram.size()));
+
+  if (datagram.size() < PseudoDNS::SESSION_ID_OFFSET + 2)
+    return;
+
+  // the reflector answers with the session id of the client
+  const size_t session_id = (datagram[PseudoDNS::SESSION_ID_OFFSET] << 8)
+                          | datagram[PseudoDNS::SESSION_ID_OFFSET + 1];
+  if (session_id == 0 || session_id > sessions.size())
+    return;
+
+  const Clock::time_point now = Clock::now();
+  sessions[session_id - 1]->receiver->Push(datagram, reflected, now);
+
+  for (auto &p : reflected)
+    Count(p, now);
+  reflected.clear();
+}
+
+
+void
+Generator::Count(const Packet::Data &p, const Clock::time_point &now)
+{
+  // reassembly can join fragments of different packets after losses
+  const uint8_t *ip = p.data() + TunTap::PACKET_INFO_SIZE;
+  if (p.size() < PROBE_OFFSET + PROBE_SIZE
+      || p.size() - TunTap::PACKET_INFO_SIZE != (size_t(ip[2]) << 8 | ip[3]))
+  {
+    report.malformed++;
+    return;
+  }
+
+  int64_t sent;
+  memcpy(&sent, p.data() + PROBE_OFFSET + sizeof(uint64_t), sizeof(sent));
+  round_trip.Record(now.time_since_epoch() - chrono::nanoseconds(sent));
+
+  report.received++;
+  report.received_bytes += p.size() - TunTap::PACKET_INFO_SIZE;
+}
+
+
+void
+Generator::MakePacket(const size_t &ip_size, const uint64_t &sequence,
+                      const Clock::time_point &now)
+{
+  packet.assign(TunTap::PACKET_INFO_SIZE + ip_size, 0x5A);
+  uint8_t *ip = packet.data() + TunTap::PACKET_INFO_SIZE;
+
+  // packet info: no flags, IPv4
+  packet[0] = 0; packet[1] = 0; packet[2] = 0x08; packet[3] = 0x00;
+
+  // UDP flows differ by source port, so the flow scheduler of every
+  // session interleaves them
+  const uint16_t port = 1024 + sequence % 64;
+  const uint8_t header[IP_HEADER_SIZE + UDP_HEADER_SIZE] = {
+    0x45, 0x00, uint8_t(ip_size >> 8), uint8_t(ip_size), 0x00, 0x00, 0x40, 0x00,
+    0x40, 0x11, 0x00, 0x00, 10, 0, 0, 1, 10, 0, 0, 2,
+    uint8_t(port >> 8), uint8_t(port), 0x13, 0x89,
+    uint8_t((ip_size - IP_HEADER_SIZE) >> 8), uint8_t(ip_size - IP_HEADER_SIZE), 0x00, 0x00
+  };
+  memcpy(ip, header, sizeof(header));
+
+  const int64_t time = chrono::duration_cast<chrono::nanoseconds>(now.time_since_epoch()).count();
+  memcpy(packet.data() + PROBE_OFFSET, &sequence, sizeof(sequence));
+  memcpy(packet.data() + PROBE_OFFSET + sizeof(sequence), &time, sizeof(time));
+}
+
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <poll.h>
+
+#include "SessionFactory.h"
+#include "../Interfaces/Endpoint.h"
+#include "../Interfaces/Socket.h"
+#include "../Metrics/Histogram.h"
+#include "../Packets/Packet.h"
+
+#ifndef _GENERATOR_H_
+#define _GENERATOR_H_
+
+
+namespace LoadGen
+{
+
+/*
+ * Emulates many tunnel clients talking to a Reflector. Every client is
+ * a session id with its own codec, clients share a few sockets. IP
+ * packets are made up at the given rate, spread over the clients in
+ * turn, and carry the time they were sent, so the reflected ones give
+ * the round trip time.
+ */
+class Generator : private boost::noncopyable
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+  // IP packet sizes with their weights
+  typedef std::vector<std::pair<std::size_t, unsigned>> Sizes;
+
+  // sequence number and send time after the IP and UDP headers
+  static constexpr std::size_t MIN_PACKET_SIZE = 44;
+  static constexpr std::size_t MAX_PACKET_SIZE = 1500;
+  static constexpr std::size_t MAX_SOCKETS = 64;
+  static constexpr std::size_t MAX_DATAGRAM_SIZE = 65536;
+  // how long reflected packets are waited for after sending stops
+  static constexpr std::chrono::seconds DRAIN_TIMEOUT{1};
+
+  struct Config
+  {
+    // 1-65535, session ids from 1
+    unsigned clients;
+    // packets per second of all clients
+    unsigned rate;
+    Sizes sizes;
+    std::chrono::milliseconds duration;
+    std::uint32_t seed;
+
+    Config();
+  };
+
+  struct Report
+  {
+    unsigned clients;
+    std::uint64_t sent;
+    std::uint64_t sent_bytes;
+    // by queues of the generator itself, not counted as sent
+    std::uint64_t dropped;
+    std::uint64_t received;
+    std::uint64_t received_bytes;
+    // reassembled from fragments of different packets
+    std::uint64_t malformed;
+    // time of sending
+    double seconds;
+    Metrics::Histogram::Summary round_trip;
+  };
+
+  Generator(const Interfaces::Endpoint &server, const SessionFactory &factory,
+            const Config &config);
+
+  // returns when config.duration passed and the reflected packets came,
+  // or after Stop()
+  Report Run();
+  void Stop();
+
+private:
+  Config config;
+
+  std::vector<std::unique_ptr<Interfaces::Socket>> sockets;
+  std::vector<pollfd> descriptors;
+  std::vector<std::unique_ptr<Session>> sessions;
+  // clients which sender holds aggregated data
+  std::vector<std::size_t> pending;
+
+  std::mt19937 random;
+  std::discrete_distribution<std::size_t> size_distribution;
+
+  std::atomic<bool> running;
+  Report report;
+  Metrics::Histogram round_trip;
+
+  Packets::Packet::Data packet;
+  Packets::Packet::Data datagram;
+  std::vector<Packets::Packet::Data> reflected;
+
+  void Send(const std::size_t &client, const std::uint64_t &sequence,
+            const Clock::time_point &now);
+  void Flush(const std::size_t &client, const Clock::time_point &now);
+  void FlushPending(const Clock::time_point &now);
+  // false when no socket had anything to read
+  bool Receive();
+  void ReceiveFrom(Interfaces::Socket &socket);
+  void Count(const Packets::Packet::Data &p, const Clock::time_point &now);
+
+  void MakePacket(const std::size_t &ip_size, const std::uint64_t &sequence,
+                  const Clock::time_point &now);
+};
+
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Reflector.h"
+
+#include <unistd.h>
+
+#include "../Packets/PseudoDNS.h"
+#include "../Interfaces/TunTap.h"
+#include "../Logging/Log.h"
+
+using namespace std;
+using namespace Interfaces;
+using namespace Packets;
+
+
+namespace LoadGen
+{
+
+constexpr size_t Reflector::MAX_DATAGRAM_SIZE;
+constexpr chrono::seconds Reflector::STATS_INTERVAL;
+
+
+Reflector::Reflector(const shared_ptr<Socket> &socket, const SessionFactory &factory) :
+  socket(socket),
+  factory(factory),
+  running(false),
+  stats(),
+  published()
+{
+}
+
+
+void
+Reflector::Run()
+{
+  LOG(info) << "Reflecting packets of clients...";
+
+  Clock::time_point stats_time = Clock::now();
+
+  running = true;
+  while (running)
+  {
+    const bool received = Poll();
+    const Clock::time_point now = Clock::now();
+
+    FlushPending(now);
+
+    if (now - stats_time >= STATS_INTERVAL)
+    {
+      Publish(chrono::duration<double>(now - stats_time).count());
+      stats_time = now;
+    }
+
+    if (!received)
+      usleep(10);
+  }
+
+  Publish(chrono::duration<double>(Clock::now() - stats_time).count());
+}
+
+
+void
+Reflector::Stop()
+{
+  running = false;
+}
+
+
+Reflector::Stats
+Reflector::GetStats() const
+{
+  lock_guard<mutex> lock(stats_mutex);
+  return published;
+}
+
+
+bool
+Reflector::Poll()
+{
+  if (!socket->IsReadyToRead())
+    return false;
+
+  Endpoint source;
+  datagram.resize(MAX_DATAGRAM_SIZE);
+  datagram.resize(socket->RecvFrom(datagram.data(), datagram.size(), source));
+  stats.datagrams++;
+
+  if (datagram.size() < PseudoDNS::SESSION_ID_OFFSET + 2)
+    return true;
+
+  // many sessions may come from one address and port, as they do from
+  // behind a resolver
+  const uint16_t session_id = (datagram[PseudoDNS::SESSION_ID_OFFSET] << 8)
+                            | datagram[PseudoDNS::SESSION_ID_OFFSET + 1];
+  const ClientKey key(source, session_id);
+
+  auto c = clients.find(key);
+  if (c == clients.end())
+  {
+    c = clients.emplace(key, Client { source, factory.Create(session_id) }).first;
+    stats.clients++;
+  }
+
+  Client &client = c->second;
+  client.session->receiver->Push(datagram, packets, Codec::Receiver::Clock::now());
+
+  Packet::Data reply;
+  while (client.session->receiver->PullReply(reply))
+    socket->SendTo(reply.data(), reply.size(), client.endpoint);
+
+  const Clock::time_point now = Clock::now();
+  for (auto &p : packets)
+  {
+    stats.packets++;
+    stats.bytes += p.size() - TunTap::PACKET_INFO_SIZE;
+    client.session->sender->Push(p, now);
+  }
+  packets.clear();
+
+  Flush(client, now);
+  return true;
+}
+
+
+void
+Reflector::Flush(Client &client, const Clock::time_point &now)
+{
+  Session &session = *client.session;
+
+  while (session.sender->Pull(datagram, now))
+    socket->SendTo(datagram.data(), datagram.size(), client.endpoint);
+
+  if (!session.pending && session.sender->HasPendingData())
+  {
+    session.pending = true;
+    pending.push_back(&client);
+  }
+}
+
+
+void
+Reflector::FlushPending(const Clock::time_point &now)
+{
+  if (pending.empty())
+    return;
+
+  vector<Client*> flushed;
+  flushed.swap(pending);
+
+  for (auto &client : flushed)
+  {
+    client->session->pending = false;
+    Flush(*client, now);
+  }
+}
+
+
+void
+Reflector::Publish(const double &seconds)
+{
+  Stats previous;
+  {
+    lock_guard<mutex> lock(stats_mutex);
+    previous = published;
+    published = stats;
+  }
+
+  const uint64_t packets = stats.packets - previous.packets;
+  if (packets == 0 || seconds <= 0)
+    return;
+
+  LOG(info) << "Reflected packets per second: " << static_cast<uint64_t>(packets / seconds)
+            << ", goodput: " << (stats.bytes - previous.bytes) * 8 / seconds / 1e6 << " Mbit/s"
+            << ", clients: " << stats.clients;
+}
+
+}
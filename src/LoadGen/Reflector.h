@@ -0,0 +1,95 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "SessionFactory.h"
+#include "../Interfaces/Endpoint.h"
+#include "../Interfaces/Socket.h"
+#include "../Packets/Packet.h"
+
+#ifndef _REFLECTOR_H_
+#define _REFLECTOR_H_
+
+
+namespace LoadGen
+{
+
+/*
+ * Server side of the load generator: decodes datagrams of any number of
+ * clients, each with the codec of its own session, and sends every
+ * reassembled IP packet back to its client through the same codec.
+ * Stands for the server with its TUN device replaced by a mirror.
+ */
+class Reflector : private boost::noncopyable
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr std::size_t MAX_DATAGRAM_SIZE = 65536;
+  static constexpr std::chrono::seconds STATS_INTERVAL{1};
+
+  struct Stats
+  {
+    std::uint64_t datagrams;
+    // reflected IP packets and their bytes
+    std::uint64_t packets;
+    std::uint64_t bytes;
+    std::size_t clients;
+  };
+
+  Reflector(const std::shared_ptr<Interfaces::Socket> &socket,
+            const SessionFactory &factory);
+
+  void Run();
+  void Stop();
+
+  // as of the last STATS_INTERVAL or the end of Run()
+  Stats GetStats() const;
+
+private:
+  typedef std::pair<Interfaces::Endpoint, std::uint16_t> ClientKey;
+
+  struct Client
+  {
+    Interfaces::Endpoint endpoint;
+    std::unique_ptr<Session> session;
+  };
+
+  std::shared_ptr<Interfaces::Socket> socket;
+  SessionFactory factory;
+
+  std::map<ClientKey, Client> clients;
+  // clients which sender holds aggregated data
+  std::vector<Client*> pending;
+
+  std::atomic<bool> running;
+  // updated by Run(), copied to published every STATS_INTERVAL
+  Stats stats;
+  Stats published;
+  mutable std::mutex stats_mutex;
+
+  Packets::Packet::Data datagram;
+  std::vector<Packets::Packet::Data> packets;
+
+  // one received datagram, false when nothing came
+  bool Poll();
+  void Flush(Client &client, const Clock::time_point &now);
+  void FlushPending(const Clock::time_point &now);
+  void Publish(const double &seconds);
+};
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "SessionFactory.h"
+
+#include "../Packets/PseudoDNS.h"
+#include "../Interfaces/TunTap.h"
+#include "../Scheduling/CoDelQueue.h"
+
+using namespace std;
+using namespace Codec;
+using namespace Packets;
+using namespace Scheduling;
+
+
+namespace LoadGen
+{
+
+SessionFactory::SessionFactory(const bool &checksum) :
+  checksum(checksum),
+  aggregate_size(0),
+  aggregate_delay(0),
+  max_queue_size(CoDelQueue::DEFAULT_MAX_SIZE),
+  codel_target(CoDelQueue::DEFAULT_TARGET),
+  codel_interval(CoDelQueue::DEFAULT_INTERVAL),
+  encryption(false),
+  cipher(Crypto::Aead::Algorithm::CHACHA20_POLY1305),
+  send_key(),
+  receive_key()
+{
+}
+
+
+void
+SessionFactory::SetAggregation(const size_t &max_frame_size,
+                               const chrono::microseconds &max_delay)
+{
+  aggregate_size = max_frame_size;
+  aggregate_delay = max_delay;
+}
+
+
+void
+SessionFactory::SetQueueManagement(const size_t &max_queue_size,
+                                   const chrono::microseconds &target,
+                                   const chrono::microseconds &interval)
+{
+  this->max_queue_size = max_queue_size;
+  codel_target = target;
+  codel_interval = interval;
+}
+
+
+void
+SessionFactory::SetEncryption(const Crypto::Aead::Algorithm &algorithm,
+                              const Crypto::Aead::Key &send_key,
+                              const Crypto::Aead::Key &receive_key)
+{
+  encryption = true;
+  cipher = algorithm;
+  this->send_key = send_key;
+  this->receive_key = receive_key;
+}
+
+
+unique_ptr<Session>
+SessionFactory::Create(const uint16_t &session_id) const
+{
+  unique_ptr<PseudoDNS> sender_prototype(new PseudoDNS());
+  sender_prototype->SetChecksum(checksum);
+  sender_prototype->SetSessionId(session_id);
+  unique_ptr<Packet> receiver_prototype = sender_prototype->Clone();
+
+  // packets are generated as if read from a TUN device
+  unique_ptr<Session> session(new Session {
+    unique_ptr<Sender>(new Sender(move(sender_prototype), Interfaces::TunTap::PACKET_INFO_SIZE)),
+    unique_ptr<Receiver>(new Receiver(move(receiver_prototype))),
+    false
+  });
+
+  session->sender->SetAggregation(aggregate_size, aggregate_delay);
+  session->sender->SetQueueManagement(max_queue_size, codel_target, codel_interval);
+
+  if (encryption)
+  {
+    session->sender->SetEncryption(unique_ptr<Crypto::Aead>(new Crypto::Aead(cipher, send_key)));
+    session->receiver->SetEncryption(unique_ptr<Crypto::Aead>(new Crypto::Aead(cipher, receive_key)));
+  }
+
+  return session;
+}
+
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "../Codec/Sender.h"
+#include "../Codec/Receiver.h"
+#include "../Crypto/Aead.h"
+
+#ifndef _SESSION_FACTORY_H_
+#define _SESSION_FACTORY_H_
+
+
+namespace LoadGen
+{
+
+// codec of one emulated client, or of the server side of its tunnel
+struct Session
+{
+  std::unique_ptr<Codec::Sender> sender;
+  std::unique_ptr<Codec::Receiver> receiver;
+  // sender holds data until its aggregation delay passes
+  bool pending;
+};
+
+
+/*
+ * Creates sessions set up like PrimitiveReaderAndWriter sets up its
+ * codec, so generated traffic costs the server what real clients do.
+ */
+class SessionFactory
+{
+public:
+  SessionFactory(const bool &checksum);
+
+  // max_delay equal to zero disables aggregation
+  void SetAggregation(const std::size_t &max_frame_size,
+                      const std::chrono::microseconds &max_delay);
+
+  void SetQueueManagement(const std::size_t &max_queue_size,
+                          const std::chrono::microseconds &target,
+                          const std::chrono::microseconds &interval);
+
+  void SetEncryption(const Crypto::Aead::Algorithm &algorithm,
+                     const Crypto::Aead::Key &send_key,
+                     const Crypto::Aead::Key &receive_key);
+
+  std::unique_ptr<Session> Create(const std::uint16_t &session_id) const;
+
+private:
+  bool checksum;
+
+  std::size_t aggregate_size;
+  std::chrono::microseconds aggregate_delay;
+
+  std::size_t max_queue_size;
+  std::chrono::microseconds codel_target;
+  std::chrono::microseconds codel_interval;
+
+  bool encryption;
+  Crypto::Aead::Algorithm cipher;
+  Crypto::Aead::Key send_key;
+  Crypto::Aead::Key receive_key;
+};
+
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Log.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+
+namespace Logging
+{
+
+constexpr size_t Entry::MAX_TEXT_SIZE;
+
+
+Stream::Stream(const Level &level)
+{
+  entry.level = level;
+  entry.length = 0;
+}
+
+
+Stream::~Stream()
+{
+  Logger::GetInstance().Push(entry);
+}
+
+
+Stream&
+Stream::operator<<(const char *text)
+{
+  Append(text, strlen(text));
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const string &text)
+{
+  Append(text.data(), text.size());
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const char &c)
+{
+  Append(&c, 1);
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const bool &value)
+{
+  return *this << (value ? "true" : "false");
+}
+
+
+Stream&
+Stream::operator<<(const int &value)
+{
+  Format("%d", value);
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const unsigned &value)
+{
+  Format("%u", value);
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const long &value)
+{
+  Format("%ld", value);
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const unsigned long &value)
+{
+  Format("%lu", value);
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const long long &value)
+{
+  Format("%lld", value);
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const unsigned long long &value)
+{
+  Format("%llu", value);
+  return *this;
+}
+
+
+Stream&
+Stream::operator<<(const double &value)
+{
+  Format("%g", value);
+  return *this;
+}
+
+
+void
+Stream::Append(const char *text, const size_t &size)
+{
+  const size_t copied = min(size, Entry::MAX_TEXT_SIZE - entry.length);
+
+  memcpy(entry.text + entry.length, text, copied);
+  entry.length += copied;
+}
+
+
+void
+Stream::Format(const char *format, ...)
+{
+  // long enough for any number
+  char buffer[32];
+  va_list arguments;
+
+  va_start(arguments, format);
+  const int r = vsnprintf(buffer, sizeof(buffer), format, arguments);
+  va_end(arguments);
+
+  if (r > 0)
+    Append(buffer, min(static_cast<size_t>(r), sizeof(buffer) - 1));
+}
+
+}
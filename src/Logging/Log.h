@@ -0,0 +1,110 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+
+namespace Logging
+{
+
+enum class Level : std::uint8_t
+{
+  TRACE,
+  DEBUG,
+  INFO,
+  WARNING,
+  ERROR,
+  FATAL
+};
+
+// names used by the LOG() macro, the same as in Boost.Log trivial logger
+constexpr Level trace = Level::TRACE;
+constexpr Level debug = Level::DEBUG;
+constexpr Level info = Level::INFO;
+constexpr Level warning = Level::WARNING;
+constexpr Level error = Level::ERROR;
+constexpr Level fatal = Level::FATAL;
+
+// records below this level are compiled out, per-packet records use
+// debug, so they exist only in builds configured with --enable-debug
+#if defined(LOG_MIN_LEVEL)
+constexpr Level MIN_LEVEL = LOG_MIN_LEVEL;
+#elif defined(HAVE_ENABLE_DEBUG)
+constexpr Level MIN_LEVEL = Level::TRACE;
+#else
+constexpr Level MIN_LEVEL = Level::INFO;
+#endif
+
+
+/*
+ * One log record. Fixed size, so it can be passed through a ring
+ * without allocating, longer messages are truncated.
+ */
+struct Entry
+{
+  static constexpr std::size_t MAX_TEXT_SIZE = 240;
+
+  Level level;
+  std::uint8_t length;
+  char text[MAX_TEXT_SIZE];
+};
+
+
+/*
+ * Formats a record in place and hands it to the Logger when destroyed,
+ * i.e. at the end of the LOG() statement.
+ */
+class Stream
+{
+public:
+  Stream(const Level &level);
+  ~Stream();
+
+  Stream& operator<<(const char *text);
+  Stream& operator<<(const std::string &text);
+  Stream& operator<<(const char &c);
+  Stream& operator<<(const bool &value);
+  Stream& operator<<(const int &value);
+  Stream& operator<<(const unsigned &value);
+  Stream& operator<<(const long &value);
+  Stream& operator<<(const unsigned long &value);
+  Stream& operator<<(const long long &value);
+  Stream& operator<<(const unsigned long long &value);
+  Stream& operator<<(const double &value);
+
+private:
+  Entry entry;
+
+  void Append(const char *text, const std::size_t &size);
+  void Format(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+
+// turns the whole LOG() expression into void, '&' binds weaker than '<<'
+struct Voidify
+{
+  void operator&(const Stream &) {}
+};
+
+}
+
+
+// LOG(info) << "text" << value; the whole statement, arguments included,
+// is removed by the compiler when the level is below MIN_LEVEL
+#define LOG(level)                                                      \
+  (::Logging::level < ::Logging::MIN_LEVEL)                             \
+    ? (void) 0                                                          \
+    : ::Logging::Voidify() & ::Logging::Stream(::Logging::level)
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Logger.h"
+
+#include <string>
+#include <boost/log/core.hpp>
+#include <boost/log/trivial.hpp>
+#include <unistd.h>
+
+using namespace std;
+
+
+namespace Logging
+{
+
+constexpr size_t Logger::QUEUE_SIZE;
+constexpr unsigned Logger::IDLE_SLEEP;
+
+
+Logger&
+Logger::GetInstance()
+{
+  static Logger logger;
+  return logger;
+}
+
+
+Logger::Logger() :
+  queue(QUEUE_SIZE),
+  running(false),
+  dropped(0),
+  reported_dropped(0),
+  sink(&Logger::WriteToBoostLog)
+{
+}
+
+
+Logger::~Logger()
+{
+  Stop();
+}
+
+
+void
+Logger::SetSink(const Sink &sink)
+{
+  lock_guard<mutex> lock(sink_mutex);
+
+  if (sink)
+    this->sink = sink;
+  else
+    this->sink = &Logger::WriteToBoostLog;
+}
+
+
+void
+Logger::Start()
+{
+  if (running.exchange(true))
+    return;
+
+  thread = std::thread(&Logger::Drain, this);
+}
+
+
+void
+Logger::Stop()
+{
+  if (!running.exchange(false))
+    return;
+
+  thread.join();
+  WriteQueued();
+}
+
+
+void
+Logger::Push(const Entry &entry)
+{
+  if (!running.load(memory_order_relaxed))
+  {
+    Write(entry);
+    return;
+  }
+
+  Entry copy = entry;
+  if (!queue.TryPush(move(copy)))
+    dropped.fetch_add(1, memory_order_relaxed);
+}
+
+
+uint64_t
+Logger::GetDroppedCount() const
+{
+  return dropped.load(memory_order_relaxed);
+}
+
+
+void
+Logger::Drain()
+{
+  while (running.load(memory_order_relaxed))
+    if (!WriteQueued())
+      usleep(IDLE_SLEEP);
+}
+
+
+bool
+Logger::WriteQueued()
+{
+  Entry entry;
+  bool written = false;
+
+  while (queue.TryPop(entry))
+  {
+    Write(entry);
+    written = true;
+  }
+
+  const uint64_t d = dropped.load(memory_order_relaxed);
+  if (d != reported_dropped)
+  {
+    Stream(Level::WARNING) << "Dropped " << (d - reported_dropped) << " log records, queue was full.";
+    reported_dropped = d;
+  }
+
+  // the file sink isn't flushed on every record
+  if (written)
+    boost::log::core::get()->flush();
+
+  return written;
+}
+
+
+void
+Logger::Write(const Entry &entry)
+{
+  lock_guard<mutex> lock(sink_mutex);
+  sink(entry);
+}
+
+
+void
+Logger::WriteToBoostLog(const Entry &entry)
+{
+  const auto severity = static_cast<boost::log::trivial::severity_level>(entry.level);
+
+  BOOST_LOG_SEV(boost::log::trivial::logger::get(), severity)
+    << string(entry.text, entry.length);
+}
+
+}
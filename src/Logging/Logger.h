@@ -0,0 +1,77 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <boost/noncopyable.hpp>
+
+#include "Log.h"
+#include "../Pipeline/MpscRing.h"
+
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+
+namespace Logging
+{
+
+/*
+ * Passes log records from any thread to the sink. While started,
+ * records go through a lock-free ring drained by a background thread,
+ * so logging threads never wait for a lock or for the disk; when the
+ * ring is full records are dropped and counted. When not started (at
+ * startup, in tests) records are written synchronously.
+ */
+class Logger : private boost::noncopyable
+{
+public:
+  typedef std::function<void(const Entry &entry)> Sink;
+
+  static constexpr std::size_t QUEUE_SIZE = 1024;
+
+  static Logger& GetInstance();
+
+  // default sink writes to the Boost.Log trivial logger, an empty
+  // function restores it
+  void SetSink(const Sink &sink);
+
+  void Start();
+  // writes everything still queued
+  void Stop();
+
+  void Push(const Entry &entry);
+
+  std::uint64_t GetDroppedCount() const;
+
+private:
+  // the background thread sleeps this long when the ring is empty
+  static constexpr unsigned IDLE_SLEEP = 1000;
+
+  Pipeline::MpscRing<Entry> queue;
+  std::atomic<bool> running;
+  std::atomic<std::uint64_t> dropped;
+  std::uint64_t reported_dropped;
+  std::thread thread;
+
+  std::mutex sink_mutex;
+  Sink sink;
+
+  Logger();
+  ~Logger();
+
+  void Drain();
+  bool WriteQueued();
+  void Write(const Entry &entry);
+
+  static void WriteToBoostLog(const Entry &entry);
+};
+
+}
+
+#endif
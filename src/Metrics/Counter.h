@@ -0,0 +1,50 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Registry.h"
+
+#ifndef _COUNTER_H_
+#define _COUNTER_H_
+
+
+namespace Metrics
+{
+
+/*
+ * Monotonic counter. Cheap enough for per-packet use: an update touches
+ * only a cache line owned by the calling thread.
+ */
+class Counter
+{
+public:
+  // labels in Prometheus syntax, e.g. reason="corrupted"
+  Counter(const std::string &name, const std::string &help,
+          const std::string &labels = "") :
+    slot(Registry::GetInstance().Register(name, help, Type::COUNTER, labels))
+  {
+  }
+
+  void Add(const std::int64_t &value = 1)
+  {
+    auto &v = Registry::GetInstance().GetThreadValues()[slot];
+    v.store(v.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  std::int64_t GetValue() const
+  {
+    return Registry::GetInstance().GetValue(slot);
+  }
+
+private:
+  std::size_t slot;
+};
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Registry.h"
+
+#ifndef _GAUGE_H_
+#define _GAUGE_H_
+
+
+namespace Metrics
+{
+
+/*
+ * Value which goes up and down, e.g. a queue length. Every thread keeps
+ * its own part and the exported value is the sum of all parts, so a
+ * gauge set from many threads reports the total.
+ */
+class Gauge
+{
+public:
+  // labels in Prometheus syntax, e.g. class="bulk"
+  Gauge(const std::string &name, const std::string &help,
+        const std::string &labels = "") :
+    slot(Registry::GetInstance().Register(name, help, Type::GAUGE, labels))
+  {
+  }
+
+  void Set(const std::int64_t &value)
+  {
+    Registry::GetInstance().GetThreadValues()[slot].store(value, std::memory_order_relaxed);
+  }
+
+  void Add(const std::int64_t &value)
+  {
+    auto &v = Registry::GetInstance().GetThreadValues()[slot];
+    v.store(v.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  std::int64_t GetValue() const
+  {
+    return Registry::GetInstance().GetValue(slot);
+  }
+
+private:
+  std::size_t slot;
+};
+
+}
+
+#endif
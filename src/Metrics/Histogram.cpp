@@ -0,0 +1,264 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Histogram.h"
+#include "Registry.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+namespace Metrics
+{
+
+constexpr unsigned Histogram::SUB_BUCKET_BITS;
+constexpr size_t Histogram::SUB_BUCKETS;
+constexpr size_t Histogram::BUCKET_COUNT;
+constexpr size_t Histogram::MAX_THREADS;
+constexpr size_t Histogram::CACHE_LINE_SIZE;
+
+
+namespace
+{
+
+// small index of the calling thread, the same for every histogram
+size_t
+GetThreadIndex()
+{
+  static atomic<size_t> next_index(0);
+  static thread_local size_t index =
+    min(next_index.fetch_add(1, memory_order_relaxed), Histogram::MAX_THREADS - 1);
+
+  return index;
+}
+
+
+void
+Increment(atomic<uint64_t> &value, const uint64_t &delta)
+{
+  value.store(value.load(memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+}
+
+
+Histogram::Snapshot::Snapshot() :
+  counts(BUCKET_COUNT, 0),
+  count(0),
+  sum(0),
+  max(0)
+{
+}
+
+
+void
+Histogram::Snapshot::Merge(const Snapshot &other)
+{
+  for (size_t i = 0; i < BUCKET_COUNT; i++)
+    counts[i] += other.counts[i];
+
+  count += other.count;
+  sum += other.sum;
+  max = std::max(max, other.max);
+}
+
+
+uint64_t
+Histogram::Snapshot::GetValueAtQuantile(const double &quantile) const
+{
+  if (count == 0)
+    return 0;
+
+  const double q = std::min(std::max(quantile, 0.0), 1.0);
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(q * count)));
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    seen += counts[i];
+    if (seen >= rank)
+      return std::min(GetBucketUpperBound(i), max);
+  }
+
+  return max;
+}
+
+
+uint64_t
+Histogram::Snapshot::GetCount() const
+{
+  return count;
+}
+
+
+uint64_t
+Histogram::Snapshot::GetSum() const
+{
+  return sum;
+}
+
+
+uint64_t
+Histogram::Snapshot::GetMax() const
+{
+  return max;
+}
+
+
+Histogram::Summary
+Histogram::Snapshot::Summarize() const
+{
+  typedef chrono::nanoseconds ns;
+
+  return {
+    count,
+    ns(GetValueAtQuantile(0.5)),
+    ns(GetValueAtQuantile(0.9)),
+    ns(GetValueAtQuantile(0.99)),
+    ns(GetValueAtQuantile(0.999)),
+    ns(max)
+  };
+}
+
+
+Histogram::Block::Block()
+{
+  for (auto &c : counts)
+    c.store(0, memory_order_relaxed);
+
+  count.store(0, memory_order_relaxed);
+  sum.store(0, memory_order_relaxed);
+  max.store(0, memory_order_relaxed);
+}
+
+
+Histogram::Histogram(const string &name, const string &help, const string &labels) :
+  name(name),
+  help(help),
+  labels(labels)
+{
+  for (auto &b : blocks)
+    b.store(nullptr, memory_order_relaxed);
+
+  Registry::GetInstance().Register(this);
+}
+
+
+Histogram::~Histogram()
+{
+  Registry::GetInstance().Unregister(this);
+}
+
+
+void
+Histogram::Record(const uint64_t &value)
+{
+  Block &block = GetThreadBlock();
+
+  Increment(block.counts[GetBucketIndex(value)], 1);
+  Increment(block.count, 1);
+  Increment(block.sum, value);
+
+  if (value > block.max.load(memory_order_relaxed))
+    block.max.store(value, memory_order_relaxed);
+}
+
+
+Histogram::Snapshot
+Histogram::GetSnapshot() const
+{
+  Snapshot snapshot;
+  lock_guard<std::mutex> lock(mutex);
+
+  for (auto &block : owned_blocks)
+  {
+    for (size_t i = 0; i < BUCKET_COUNT; i++)
+      snapshot.counts[i] += block->counts[i].load(memory_order_relaxed);
+
+    snapshot.count += block->count.load(memory_order_relaxed);
+    snapshot.sum += block->sum.load(memory_order_relaxed);
+    snapshot.max = std::max(snapshot.max, block->max.load(memory_order_relaxed));
+  }
+
+  return snapshot;
+}
+
+
+const string&
+Histogram::GetName() const
+{
+  return name;
+}
+
+
+const string&
+Histogram::GetHelp() const
+{
+  return help;
+}
+
+
+const string&
+Histogram::GetLabels() const
+{
+  return labels;
+}
+
+
+size_t
+Histogram::GetBucketIndex(const uint64_t &value)
+{
+  if (value < SUB_BUCKETS)
+    return value;
+
+  // position of the highest set bit decides the range, the next
+  // SUB_BUCKET_BITS bits the bucket within it
+  const unsigned magnitude = 63 - __builtin_clzll(value);
+  const unsigned shift = magnitude - SUB_BUCKET_BITS;
+
+  return (shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+}
+
+
+uint64_t
+Histogram::GetBucketUpperBound(const size_t &index)
+{
+  if (index < SUB_BUCKETS)
+    return index;
+
+  const unsigned shift = index / SUB_BUCKETS - 1;
+  const uint64_t sub_bucket = index % SUB_BUCKETS + SUB_BUCKETS;
+
+  // wraps to the maximum value for the last bucket
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+
+Histogram::Block&
+Histogram::GetThreadBlock()
+{
+  auto &slot = blocks[GetThreadIndex()];
+  Block *block = slot.load(memory_order_acquire);
+
+  if (block)
+    return *block;
+
+  lock_guard<std::mutex> lock(mutex);
+
+  // threads sharing the last slot may race to create it
+  block = slot.load(memory_order_acquire);
+  if (!block)
+  {
+    owned_blocks.emplace_back(new Block());
+    block = owned_blocks.back().get();
+    slot.store(block, memory_order_release);
+  }
+
+  return *block;
+}
+
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+
+namespace Metrics
+{
+
+/*
+ * Latency recorder in the style of HdrHistogram: every power of two
+ * range is split into SUB_BUCKETS linear buckets, so a recorded value
+ * is off by at most 1/SUB_BUCKETS (6.25%) whatever its magnitude, and
+ * the whole 64-bit range fits in BUCKET_COUNT counters.
+ *
+ * Like metrics in the Registry, every thread records into its own
+ * block (relaxed load and store), readers merge the blocks. Threads
+ * above MAX_THREADS share the last block and may lose some samples.
+ */
+class Histogram : private boost::noncopyable
+{
+public:
+  static constexpr unsigned SUB_BUCKET_BITS = 4;
+  static constexpr std::size_t SUB_BUCKETS = std::size_t(1) << SUB_BUCKET_BITS;
+  static constexpr std::size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+  static constexpr std::size_t MAX_THREADS = 64;
+
+  // p50, p90, p99 and p99.9 of recorded nanoseconds
+  struct Summary
+  {
+    std::uint64_t count;
+    std::chrono::nanoseconds p50;
+    std::chrono::nanoseconds p90;
+    std::chrono::nanoseconds p99;
+    std::chrono::nanoseconds p999;
+    std::chrono::nanoseconds max;
+  };
+
+  // merged state of one or more histograms
+  class Snapshot
+  {
+  public:
+    Snapshot();
+
+    void Merge(const Snapshot &other);
+
+    // highest value equivalent to the value at the given quantile,
+    // zero when nothing was recorded
+    std::uint64_t GetValueAtQuantile(const double &quantile) const;
+
+    std::uint64_t GetCount() const;
+    std::uint64_t GetSum() const;
+    std::uint64_t GetMax() const;
+
+    Summary Summarize() const;
+
+  private:
+    friend class Histogram;
+
+    std::vector<std::uint64_t> counts;
+    std::uint64_t count;
+    std::uint64_t sum;
+    std::uint64_t max;
+  };
+
+  // histograms with the same name and labels are exported merged
+  Histogram(const std::string &name, const std::string &help,
+            const std::string &labels = "");
+  ~Histogram();
+
+  void Record(const std::uint64_t &value);
+
+  void Record(const std::chrono::nanoseconds &duration)
+  {
+    Record(static_cast<std::uint64_t>(duration.count() > 0 ? duration.count() : 0));
+  }
+
+  Snapshot GetSnapshot() const;
+
+  const std::string& GetName() const;
+  const std::string& GetHelp() const;
+  const std::string& GetLabels() const;
+
+  static std::size_t GetBucketIndex(const std::uint64_t &value);
+  static std::uint64_t GetBucketUpperBound(const std::size_t &index);
+
+private:
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  struct Block
+  {
+    char front_padding[CACHE_LINE_SIZE];
+    std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> counts;
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> sum;
+    std::atomic<std::uint64_t> max;
+    char back_padding[CACHE_LINE_SIZE];
+
+    Block();
+  };
+
+  std::string name;
+  std::string help;
+  std::string labels;
+
+  mutable std::mutex mutex;
+  std::array<std::atomic<Block*>, MAX_THREADS> blocks;
+  std::vector<std::unique_ptr<Block>> owned_blocks;
+
+  Block& GetThreadBlock();
+};
+
+}
+
+#endif
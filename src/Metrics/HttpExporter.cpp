@@ -0,0 +1,141 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "HttpExporter.h"
+#include "Registry.h"
+#include "../Logging/Log.h"
+
+#include <chrono>
+#include <unistd.h>
+
+using namespace std;
+using namespace Interfaces;
+
+
+namespace Metrics
+{
+
+constexpr size_t HttpExporter::MAX_REQUEST_SIZE;
+
+
+HttpExporter::HttpExporter(const string &address, const int &port) :
+  socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::STREAM)),
+  running(false)
+{
+  // process taking over after a hot restart binds the port again,
+  // while connections of the previous one may be in TIME_WAIT
+  socket->EnableReuseAddress();
+  socket->Bind(port, address);
+  socket->Listen(8);
+}
+
+
+HttpExporter::~HttpExporter()
+{
+  Stop();
+  socket->Close();
+}
+
+
+void
+HttpExporter::Start()
+{
+  LOG(info) << "Starting metrics exporter...";
+  running = true;
+  thread = std::thread(&HttpExporter::Serve, this);
+}
+
+
+void
+HttpExporter::Stop()
+{
+  running = false;
+
+  if (thread.joinable())
+    thread.join();
+}
+
+
+string
+HttpExporter::Respond(const string &request)
+{
+  if (request.compare(0, 13, "GET /metrics ") != 0 && request.compare(0, 6, "GET / ") != 0)
+    return "HTTP/1.0 404 Not Found\r\n"
+           "Content-Type: text/plain\r\n"
+           "Connection: close\r\n"
+           "\r\n"
+           "Not found\n";
+
+  const string body = Registry::GetInstance().Render();
+
+  return "HTTP/1.0 200 OK\r\n"
+         "Content-Type: text/plain; version=0.0.4\r\n"
+         "Content-Length: " + to_string(body.size()) + "\r\n"
+         "Connection: close\r\n"
+         "\r\n" + body;
+}
+
+
+void
+HttpExporter::Serve()
+{
+  while (running)
+  {
+    try {
+      if (!socket->IsReadyToRead())
+      {
+        usleep(100000);
+        continue;
+      }
+
+      unique_ptr<Socket> client = socket->Accept();
+
+      try {
+        ServeClient(*client);
+      }
+      catch (exception &ex) {
+        LOG(warning) << "Metrics exporter: " << ex.what();
+      }
+
+      client->Close();
+    }
+    catch (exception &ex) {
+      LOG(warning) << "Metrics exporter: " << ex.what();
+    }
+  }
+}
+
+
+void
+HttpExporter::ServeClient(Socket &client)
+{
+  const auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+  string request;
+  char buffer[512];
+
+  // the request line is all we need
+  while (request.find("\r\n") == string::npos && request.size() < MAX_REQUEST_SIZE)
+  {
+    if (chrono::steady_clock::now() > deadline || !running)
+      return;
+
+    if (!client.IsReadyToRead())
+    {
+      usleep(1000);
+      continue;
+    }
+
+    const size_t r = client.Read(buffer, sizeof(buffer));
+    if (r == 0)
+      return;
+
+    request.append(buffer, r);
+  }
+
+  const string response = Respond(request);
+  client.Write(response.data(), response.size());
+}
+
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <boost/noncopyable.hpp>
+
+#include "../Interfaces/Socket.h"
+
+#ifndef _HTTPEXPORTER_H_
+#define _HTTPEXPORTER_H_
+
+
+namespace Metrics
+{
+
+/*
+ * Minimal HTTP/1.0 server answering every GET /metrics with the
+ * registry rendered in Prometheus text format. Requests are served one
+ * by one in a single background thread.
+ */
+class HttpExporter : private boost::noncopyable
+{
+public:
+  HttpExporter(const std::string &address, const int &port);
+  virtual ~HttpExporter();
+
+  void Start();
+  void Stop();
+
+  static std::string Respond(const std::string &request);
+
+private:
+  static constexpr std::size_t MAX_REQUEST_SIZE = 4096;
+
+  std::unique_ptr<Interfaces::Socket> socket;
+  std::thread thread;
+  std::atomic<bool> running;
+
+  void Serve();
+  void ServeClient(Interfaces::Socket &client);
+};
+
+}
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Registry.h"
+#include "Histogram.h"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+
+namespace Metrics
+{
+
+constexpr size_t Registry::MAX_METRICS;
+constexpr size_t Registry::CACHE_LINE_SIZE;
+
+
+Registry::ThreadBlock::ThreadBlock()
+{
+  for (auto &v : values)
+    v.store(0, memory_order_relaxed);
+}
+
+
+Registry&
+Registry::GetInstance()
+{
+  static Registry registry;
+  return registry;
+}
+
+
+size_t
+Registry::Register(const string &name, const string &help,
+                   const Type &type, const string &labels)
+{
+  lock_guard<std::mutex> lock(mutex);
+
+  for (size_t i = 0; i < descriptions.size(); i++)
+    if (descriptions[i].name == name && descriptions[i].labels == labels)
+      return i;
+
+  if (descriptions.size() == MAX_METRICS)
+    throw runtime_error("too many metrics, cannot register " + name);
+
+  descriptions.push_back({ name, help, type, labels });
+  return descriptions.size() - 1;
+}
+
+
+void
+Registry::Register(const Histogram *histogram)
+{
+  lock_guard<std::mutex> lock(mutex);
+  histograms.push_back(histogram);
+}
+
+
+void
+Registry::Unregister(const Histogram *histogram)
+{
+  lock_guard<std::mutex> lock(mutex);
+  histograms.erase(remove(histograms.begin(), histograms.end(), histogram),
+                   histograms.end());
+}
+
+
+Registry::Values&
+Registry::GetThreadValues()
+{
+  static thread_local Values *values = nullptr;
+
+  if (!values)
+  {
+    unique_ptr<ThreadBlock> block(new ThreadBlock());
+    values = &block->values;
+
+    lock_guard<std::mutex> lock(mutex);
+    blocks.push_back(move(block));
+  }
+
+  return *values;
+}
+
+
+int64_t
+Registry::GetValue(const size_t &slot) const
+{
+  lock_guard<std::mutex> lock(mutex);
+  int64_t sum = 0;
+
+  for (auto &block : blocks)
+    sum += block->values[slot].load(memory_order_relaxed);
+
+  return sum;
+}
+
+
+string
+Registry::Render() const
+{
+  lock_guard<std::mutex> lock(mutex);
+  set<string> described;
+  ostringstream out;
+
+  for (size_t i = 0; i < descriptions.size(); i++)
+  {
+    const Description &d = descriptions[i];
+
+    // all series of one metric are written together after its header
+    if (!described.insert(d.name).second)
+      continue;
+
+    out << "# HELP " << d.name << " " << d.help << "\n"
+        << "# TYPE " << d.name << " " << (d.type == Type::COUNTER ? "counter" : "gauge") << "\n";
+
+    for (size_t j = i; j < descriptions.size(); j++)
+    {
+      if (descriptions[j].name != d.name)
+        continue;
+
+      int64_t sum = 0;
+      for (auto &block : blocks)
+        sum += block->values[j].load(memory_order_relaxed);
+
+      out << d.name;
+      if (!descriptions[j].labels.empty())
+        out << "{" << descriptions[j].labels << "}";
+      out << " " << sum << "\n";
+    }
+  }
+
+  RenderHistograms(out);
+  return out.str();
+}
+
+
+void
+Registry::RenderHistograms(ostream &out) const
+{
+  static const double QUANTILES[] { 0.5, 0.9, 0.99, 0.999 };
+  set<string> described;
+  set<pair<string, string>> rendered;
+
+  for (size_t i = 0; i < histograms.size(); i++)
+  {
+    const string &name = histograms[i]->GetName();
+
+    // all series of one metric are written together after its header
+    if (!described.insert(name).second)
+      continue;
+
+    out << "# HELP " << name << " " << histograms[i]->GetHelp() << "\n"
+        << "# TYPE " << name << " summary\n";
+
+    for (size_t j = i; j < histograms.size(); j++)
+    {
+      const string &labels = histograms[j]->GetLabels();
+
+      // histograms with the same name and labels are merged
+      if (histograms[j]->GetName() != name || !rendered.insert(make_pair(name, labels)).second)
+        continue;
+
+      Histogram::Snapshot snapshot = histograms[j]->GetSnapshot();
+      for (size_t k = j + 1; k < histograms.size(); k++)
+        if (histograms[k]->GetName() == name && histograms[k]->GetLabels() == labels)
+          snapshot.Merge(histograms[k]->GetSnapshot());
+
+      // recorded in nanoseconds, exported in seconds
+      for (auto q : QUANTILES)
+        out << name << "{" << labels << (labels.empty() ? "" : ",") << "quantile=\"" << q << "\"} "
+            << snapshot.GetValueAtQuantile(q) / 1e9 << "\n";
+
+      const string series = labels.empty() ? "" : "{" + labels + "}";
+      out << name << "_sum" << series << " " << snapshot.GetSum() / 1e9 << "\n"
+          << name << "_count" << series << " " << snapshot.GetCount() << "\n";
+    }
+  }
+}
+
+}
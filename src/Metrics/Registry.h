@@ -0,0 +1,97 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#ifndef _REGISTRY_H_
+#define _REGISTRY_H_
+
+
+namespace Metrics
+{
+
+class Histogram;
+
+
+enum class Type
+{
+  COUNTER,
+  GAUGE
+};
+
+
+/*
+ * Keeps descriptions of all metrics and a block of values for every
+ * thread which updated any of them. Threads write only to their own
+ * block (relaxed load and store, no read-modify-write), readers sum the
+ * blocks of all threads.
+ */
+class Registry : private boost::noncopyable
+{
+public:
+  static constexpr std::size_t MAX_METRICS = 256;
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  typedef std::array<std::atomic<std::int64_t>, MAX_METRICS> Values;
+
+  static Registry& GetInstance();
+
+  // registering the same name and labels twice returns the same slot
+  std::size_t Register(const std::string &name, const std::string &help,
+                       const Type &type, const std::string &labels = "");
+
+  // histograms are exported as summaries until they are unregistered
+  void Register(const Histogram *histogram);
+  void Unregister(const Histogram *histogram);
+
+  // values of the calling thread
+  Values& GetThreadValues();
+
+  std::int64_t GetValue(const std::size_t &slot) const;
+
+  // Prometheus text exposition format, version 0.0.4
+  std::string Render() const;
+
+private:
+  struct Description
+  {
+    std::string name;
+    std::string help;
+    Type type;
+    std::string labels;
+  };
+
+  // padded, so blocks of different threads never share a cache line
+  struct ThreadBlock
+  {
+    char front_padding[CACHE_LINE_SIZE];
+    Values values;
+    char back_padding[CACHE_LINE_SIZE];
+
+    ThreadBlock();
+  };
+
+  mutable std::mutex mutex;
+  std::vector<Description> descriptions;
+  std::vector<std::unique_ptr<ThreadBlock>> blocks;
+  std::vector<const Histogram*> histograms;
+
+  Registry() = default;
+
+  void RenderHistograms(std::ostream &out) const;
+};
+
+}
+
+#endif
@@ -7,10 +7,10 @@
 #include <boost/regex.hpp>
 #include <sstream>
 #include <string>
-#include <boost/log/trivial.hpp>
 
 #include "ProgramOptions.h"
 #include "BadOptionValueException.h"
+#include "../Logging/Log.h"
 
 
 namespace Options
@@ -23,27 +23,134 @@ using namespace boost;
 
 ProgramOptions::ProgramOptions() :
   general_options("General options"),
+  config_options("Config file only options"),
   help_options("Help options"),
   cmd_params(0, nullptr),
   mode(ProgramOptions::Mode::SERVER),
   address("127.0.0.1"),
   port(53),
+  aggregate_delay(0),
+  aggregate_size(512),
+  queue_size(256),
+  codel_target(5000),
+  codel_interval(100000),
+  pipeline(false),
+  codec_workers(0),
+  cipher(Cipher::NONE),
+  checksum(false),
+  socket_filter(false),
+  processes(1),
+  session_id(0),
+  takeover(false),
+  metrics_port(0),
+  echo_interval(0),
+  socket_receive_buffer(0),
+  socket_send_buffer(0),
+  loadgen_clients(1000),
+  loadgen_rate(10000),
+  loadgen_sizes({ {64, 7}, {576, 4}, {1500, 1} }),
+  loadgen_duration(10),
   show_help(false)
 {
   general_options.add_options()
-    ("mode", value<string>(), "server|client\n\
+    ("mode", value<string>(), "server|client|loadgen|reflector\n\
+loadgen: emulate clients of a reflector,\n\
+reflector: server returning every packet,\n\
+both without TUN device\n\
 default: server\n")
     ("address", value<string>(), "server: adderss to bind\n\
 client: address to connect\n\
 default: 127.0.0.1\n")
     ("port", value<unsigned>(), "server: port to listen\n\
 client: port to connect\n\
-default: 53");
+default: 53\n")
+    ("aggregate-delay", value<unsigned>(), "pack small packets into one transmission,\n\
+flush after this many microseconds\n\
+default: 0 (disabled)\n")
+    ("aggregate-size", value<unsigned>(), "flush aggregated transmission when it\n\
+reaches this many bytes\n\
+default: 512\n")
+    ("queue-size", value<unsigned>(), "maximum number of packets waiting\n\
+in every traffic class queue\n\
+default: 256\n")
+    ("codel-target", value<unsigned>(), "acceptable queue delay in microseconds\n\
+default: 5000\n")
+    ("codel-interval", value<unsigned>(), "CoDel interval in microseconds,\n\
+should be close to the tunnel round trip time\n\
+default: 100000\n")
+    ("pipeline", "run reader, codec and writer of every\n\
+direction in separate threads\n")
+    ("cpu-affinity", value<string>(), "comma separated CPUs for pipeline stages:\n\
+TUN reader, encoder, socket writer,\n\
+socket reader, decoder, TUN writer\n\
+default: not pinned\n")
+    ("codec-workers", value<unsigned>(), "threads dumping and parsing datagrams\n\
+in every direction of the pipeline (0-64)\n\
+default: 0, done by codec stages\n")
+    ("key-file", value<string>(), "file with the shared secret in its first\n\
+line, enables encryption, has to be the\n\
+same on both sides\n")
+    ("cipher", value<string>(), "aes-256-gcm|chacha20-poly1305|auto\n\
+has to be the same on both sides, auto\n\
+picks AES-GCM when the CPU supports it\n\
+default: chacha20-poly1305\n")
+    ("checksum", "add CRC32C to every sent datagram, damaged\n\
+datagrams are dropped before reassembly\n")
+    ("socket-filter", "drop datagrams which aren't tunnel packets\n\
+in the kernel, with a BPF socket filter\n")
+    ("processes", value<unsigned>(), "server: processes sharing the port (1-64),\n\
+clients are steered to them by session id,\n\
+every process creates its own TUN device\n\
+and serves one client, the first one\n\
+default: 1\n")
+    ("session-id", value<unsigned>(), "client: session id (1-65535) choosing\n\
+the server process (id modulo processes),\n\
+clients need distinct ones\n\
+default: random\n")
+    ("handoff-socket", value<string>(), "Unix socket path for hot restart, the\n\
+running process hands the tunnel over to\n\
+the new process started with --takeover\n\
+default: not set - disabled\n")
+    ("takeover", "take the tunnel over from the process\n\
+listening on the handoff socket\n")
+    ("metrics-port", value<int>(), "serve metrics in Prometheus format on\n\
+http://127.0.0.1:<port>/metrics\n\
+default: 0 - disabled\n")
+    ("echo-interval", value<unsigned>(), "send echo request every this many\n\
+milliseconds to measure round trip time,\n\
+the peer has to support echo requests\n\
+default: 0 - disabled\n")
+    ("socket-receive-buffer", value<unsigned>(), "socket receive buffer in bytes, may be\n\
+above net.core.rmem_max when run as root\n\
+(0-1073741824), default: 0 - kernel default\n")
+    ("socket-send-buffer", value<unsigned>(), "socket send buffer in bytes, may be\n\
+above net.core.wmem_max when run as root\n\
+(0-1073741824), default: 0 - kernel default\n")
+    ("loadgen-clients", value<unsigned>(), "loadgen: emulated clients (1-65535)\n\
+default: 1000\n")
+    ("loadgen-rate", value<unsigned>(), "loadgen: packets per second of all clients\n\
+default: 10000\n")
+    ("loadgen-sizes", value<string>(), "loadgen: comma separated IP packet sizes\n\
+(44-1500) with optional weights\n\
+default: 64:7,576:4,1500:1\n")
+    ("loadgen-duration", value<unsigned>(), "loadgen: seconds of sending\n\
+default: 10");
+
+  // not on the command line, where other users see it
+  config_options.add_options()
+    ("key", value<string>(), "shared secret, same as key-file\n");
 
   help_options.add_options()
     ("help,h", "print help message and exit");
 
+  command_line_options.add(general_options);
+  command_line_options.add(help_options);
+
+  config_file_options.add(general_options);
+  config_file_options.add(config_options);
+
   all_options.add(general_options);
+  all_options.add(config_options);
   all_options.add(help_options);
 }
 
@@ -65,13 +172,13 @@ ProgramOptions::SetConfigFilePath(const string &path)
 void
 ProgramOptions::Parse()
 {
-  store(parse_command_line(cmd_params.first, cmd_params.second, all_options),
+  store(parse_command_line(cmd_params.first, cmd_params.second, command_line_options),
 	variables);
 
   if (!config_file_path.empty()) {
-    BOOST_LOG_TRIVIAL(info) << "Reading config file: " << config_file_path;
+    LOG(info) << "Reading config file: " << config_file_path;
     OpenConfigFile();
-    store(parse_config_file(config_file, general_options),
+    store(parse_config_file(config_file, config_file_options),
 	  variables);
   }
 
@@ -87,6 +194,90 @@ ProgramOptions::Parse()
 
   if (variables.count("port"))
     SetPort(variables["port"].as<unsigned>());
+
+  if (variables.count("aggregate-delay"))
+    aggregate_delay = variables["aggregate-delay"].as<unsigned>();
+
+  if (variables.count("aggregate-size"))
+    SetAggregateSize(variables["aggregate-size"].as<unsigned>());
+
+  if (variables.count("queue-size"))
+    SetQueueSize(variables["queue-size"].as<unsigned>());
+
+  if (variables.count("codel-target"))
+    codel_target = variables["codel-target"].as<unsigned>();
+
+  if (variables.count("codel-interval"))
+    SetCoDelInterval(variables["codel-interval"].as<unsigned>());
+
+  pipeline = variables.count("pipeline");
+
+  if (variables.count("cpu-affinity"))
+    SetCpuAffinity(variables["cpu-affinity"].as<string>());
+
+  if (variables.count("codec-workers"))
+    SetCodecWorkers(variables["codec-workers"].as<unsigned>());
+
+  // the file given on the command line wins over the config file
+  if (variables.count("key-file"))
+    ReadKeyFile(variables["key-file"].as<string>());
+  else if (variables.count("key"))
+    key = variables["key"].as<string>();
+
+  if (variables.count("key") || variables.count("key-file"))
+  {
+    if (key.empty())
+      throw BadOptionValueException("key", "empty");
+
+    // both sides have to use the same cipher, the frame doesn't say
+    cipher = Cipher::CHACHA20_POLY1305;
+  }
+
+  if (variables.count("cipher"))
+    SetCipher(variables["cipher"].as<string>());
+
+  checksum = variables.count("checksum");
+
+  socket_filter = variables.count("socket-filter");
+
+  if (variables.count("processes"))
+    SetProcesses(variables["processes"].as<unsigned>());
+
+  if (variables.count("session-id"))
+    SetSessionId(variables["session-id"].as<unsigned>());
+
+  if (variables.count("handoff-socket"))
+    handoff_socket = variables["handoff-socket"].as<string>();
+
+  takeover = variables.count("takeover");
+  if (takeover && handoff_socket.empty())
+    throw BadOptionValueException("takeover", "handoff-socket not set");
+
+  if (variables.count("metrics-port"))
+    SetMetricsPort(variables["metrics-port"].as<int>());
+
+  if (variables.count("echo-interval"))
+    echo_interval = variables["echo-interval"].as<unsigned>();
+
+  if (variables.count("socket-receive-buffer"))
+    SetSocketBuffer("socket-receive-buffer", variables["socket-receive-buffer"].as<unsigned>(),
+                    socket_receive_buffer);
+
+  if (variables.count("socket-send-buffer"))
+    SetSocketBuffer("socket-send-buffer", variables["socket-send-buffer"].as<unsigned>(),
+                    socket_send_buffer);
+
+  if (variables.count("loadgen-clients"))
+    SetLoadGenClients(variables["loadgen-clients"].as<unsigned>());
+
+  if (variables.count("loadgen-rate"))
+    SetLoadGenRate(variables["loadgen-rate"].as<unsigned>());
+
+  if (variables.count("loadgen-sizes"))
+    SetLoadGenSizes(variables["loadgen-sizes"].as<string>());
+
+  if (variables.count("loadgen-duration"))
+    SetLoadGenDuration(variables["loadgen-duration"].as<unsigned>());
 }
 
 
@@ -121,6 +312,174 @@ ProgramOptions::GetPort() const
 }
 
 
+unsigned
+ProgramOptions::GetAggregateDelay() const
+{
+  return aggregate_delay;
+}
+
+
+unsigned
+ProgramOptions::GetAggregateSize() const
+{
+  return aggregate_size;
+}
+
+
+unsigned
+ProgramOptions::GetQueueSize() const
+{
+  return queue_size;
+}
+
+
+unsigned
+ProgramOptions::GetCoDelTarget() const
+{
+  return codel_target;
+}
+
+
+unsigned
+ProgramOptions::GetCoDelInterval() const
+{
+  return codel_interval;
+}
+
+
+bool
+ProgramOptions::GetPipeline() const
+{
+  return pipeline;
+}
+
+
+vector<int>
+ProgramOptions::GetCpuAffinity() const
+{
+  return cpu_affinity;
+}
+
+
+unsigned
+ProgramOptions::GetCodecWorkers() const
+{
+  return codec_workers;
+}
+
+
+string
+ProgramOptions::GetKey() const
+{
+  return key;
+}
+
+
+ProgramOptions::Cipher
+ProgramOptions::GetCipher() const
+{
+  return cipher;
+}
+
+
+bool
+ProgramOptions::GetChecksum() const
+{
+  return checksum;
+}
+
+
+bool
+ProgramOptions::GetSocketFilter() const
+{
+  return socket_filter;
+}
+
+
+unsigned
+ProgramOptions::GetProcesses() const
+{
+  return processes;
+}
+
+
+unsigned
+ProgramOptions::GetSessionId() const
+{
+  return session_id;
+}
+
+
+string
+ProgramOptions::GetHandoffSocket() const
+{
+  return handoff_socket;
+}
+
+
+bool
+ProgramOptions::GetTakeover() const
+{
+  return takeover;
+}
+
+
+int
+ProgramOptions::GetMetricsPort() const
+{
+  return metrics_port;
+}
+
+
+unsigned
+ProgramOptions::GetEchoInterval() const
+{
+  return echo_interval;
+}
+
+
+unsigned
+ProgramOptions::GetSocketReceiveBuffer() const
+{
+  return socket_receive_buffer;
+}
+
+
+unsigned
+ProgramOptions::GetSocketSendBuffer() const
+{
+  return socket_send_buffer;
+}
+
+
+unsigned
+ProgramOptions::GetLoadGenClients() const
+{
+  return loadgen_clients;
+}
+
+
+unsigned
+ProgramOptions::GetLoadGenRate() const
+{
+  return loadgen_rate;
+}
+
+
+vector<pair<unsigned, unsigned>>
+ProgramOptions::GetLoadGenSizes() const
+{
+  return loadgen_sizes;
+}
+
+
+unsigned
+ProgramOptions::GetLoadGenDuration() const
+{
+  return loadgen_duration;
+}
+
+
 bool
 ProgramOptions::GetShowHelp() const
 {
@@ -137,6 +496,19 @@ ProgramOptions::OpenConfigFile()
 }
 
 
+void
+ProgramOptions::ReadKeyFile(const string &path)
+{
+  ifstream file(path.c_str());
+  if (!file)
+    throw BadOptionValueException("key-file", "cannot open " + path);
+
+  getline(file, key);
+  if (!key.empty() && key.back() == '\r')
+    key.pop_back();
+}
+
+
 void
 ProgramOptions::SetMode(const std::string &mode)
 {
@@ -144,6 +516,10 @@ ProgramOptions::SetMode(const std::string &mode)
     this->mode = Mode::CLIENT;
   else if (mode == "server")
     this->mode = Mode::SERVER;
+  else if (mode == "loadgen")
+    this->mode = Mode::LOADGEN;
+  else if (mode == "reflector")
+    this->mode = Mode::REFLECTOR;
   else
     throw BadOptionValueException("mode", mode);
 }
@@ -170,4 +546,183 @@ ProgramOptions::SetPort(const unsigned &port)
   this->port = port;
 }
 
+
+void
+ProgramOptions::SetAggregateSize(const unsigned &size)
+{
+  if (size == 0 || size > 65535)
+    throw BadOptionValueException("aggregate-size", to_string(size));
+
+  this->aggregate_size = size;
+}
+
+
+
+void
+ProgramOptions::SetQueueSize(const unsigned &size)
+{
+  if (size == 0)
+    throw BadOptionValueException("queue-size", to_string(size));
+
+  this->queue_size = size;
+}
+
+
+void
+ProgramOptions::SetCoDelInterval(const unsigned &interval)
+{
+  if (interval == 0)
+    throw BadOptionValueException("codel-interval", to_string(interval));
+
+  this->codel_interval = interval;
+}
+
+
+void
+ProgramOptions::SetCpuAffinity(const std::string &cpus)
+{
+  regex list("[0-9]{1,4}(,[0-9]{1,4})*");
+
+  if (!regex_match(cpus, list))
+    throw BadOptionValueException("cpu-affinity", cpus);
+
+  cpu_affinity.clear();
+
+  stringstream stream(cpus);
+  string cpu;
+  while (getline(stream, cpu, ','))
+    cpu_affinity.push_back(stoi(cpu));
+}
+
+
+void
+ProgramOptions::SetCodecWorkers(const unsigned &workers)
+{
+  if (workers > 64)
+    throw BadOptionValueException("codec-workers", to_string(workers));
+
+  this->codec_workers = workers;
+}
+
+
+void
+ProgramOptions::SetCipher(const std::string &cipher)
+{
+  Cipher selected;
+
+  if (cipher == "auto")
+    selected = Cipher::AUTO;
+  else if (cipher == "aes-256-gcm")
+    selected = Cipher::AES_256_GCM;
+  else if (cipher == "chacha20-poly1305")
+    selected = Cipher::CHACHA20_POLY1305;
+  else
+    throw BadOptionValueException("cipher", cipher);
+
+  // without a key there is nothing to encrypt with
+  if (!key.empty())
+    this->cipher = selected;
+}
+
+
+void
+ProgramOptions::SetProcesses(const unsigned &processes)
+{
+  if (processes < 1 || processes > 64)
+    throw BadOptionValueException("processes", to_string(processes));
+
+  this->processes = processes;
+}
+
+
+void
+ProgramOptions::SetSessionId(const unsigned &session_id)
+{
+  if (session_id < 1 || session_id > 65535)
+    throw BadOptionValueException("session-id", to_string(session_id));
+
+  this->session_id = session_id;
+}
+
+
+void
+ProgramOptions::SetMetricsPort(const int &port)
+{
+  if (port < 0 || port > 65535)
+    throw BadOptionValueException("metrics-port", to_string(port));
+
+  this->metrics_port = port;
+}
+
+
+void
+ProgramOptions::SetSocketBuffer(const string &option, const unsigned &size, unsigned &buffer)
+{
+  // the kernel doubles it and keeps it in an int
+  if (size > 1073741824)
+    throw BadOptionValueException(option, to_string(size));
+
+  buffer = size;
+}
+
+
+
+void
+ProgramOptions::SetLoadGenClients(const unsigned &clients)
+{
+  if (clients < 1 || clients > 65535)
+    throw BadOptionValueException("loadgen-clients", to_string(clients));
+
+  this->loadgen_clients = clients;
+}
+
+
+void
+ProgramOptions::SetLoadGenRate(const unsigned &rate)
+{
+  if (rate == 0)
+    throw BadOptionValueException("loadgen-rate", to_string(rate));
+
+  this->loadgen_rate = rate;
+}
+
+
+void
+ProgramOptions::SetLoadGenSizes(const std::string &sizes)
+{
+  regex list("[0-9]{1,4}(:[0-9]{1,4})?(,[0-9]{1,4}(:[0-9]{1,4})?)*");
+
+  if (!regex_match(sizes, list))
+    throw BadOptionValueException("loadgen-sizes", sizes);
+
+  vector<pair<unsigned, unsigned>> parsed;
+
+  stringstream stream(sizes);
+  string size;
+  while (getline(stream, size, ','))
+  {
+    const size_t colon = size.find(':');
+    const unsigned bytes = stoi(size.substr(0, colon));
+    const unsigned weight = (colon == string::npos) ? 1 : stoi(size.substr(colon + 1));
+
+    // the smallest packet holds IP and UDP headers and the probe
+    if (bytes < 44 || bytes > 1500 || weight == 0)
+      throw BadOptionValueException("loadgen-sizes", sizes);
+
+    parsed.emplace_back(bytes, weight);
+  }
+
+  this->loadgen_sizes = parsed;
+}
+
+
+void
+ProgramOptions::SetLoadGenDuration(const unsigned &duration)
+{
+  if (duration == 0)
+    throw BadOptionValueException("loadgen-duration", to_string(duration));
+
+  this->loadgen_duration = duration;
+}
+
 }
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 
 namespace Options
@@ -21,7 +22,18 @@ public:
   enum class Mode
   {
     SERVER,
-    CLIENT
+    CLIENT,
+    // synthetic clients and the server mirroring their packets
+    LOADGEN,
+    REFLECTOR
+  };
+
+  enum class Cipher
+  {
+    NONE,
+    AUTO,
+    AES_256_GCM,
+    CHACHA20_POLY1305
   };
 
   ProgramOptions();
@@ -37,6 +49,34 @@ public:
   Mode GetMode() const;
   std::string GetAddress() const;
   int GetPort() const;
+  unsigned GetAggregateDelay() const;
+  unsigned GetAggregateSize() const;
+  unsigned GetQueueSize() const;
+  unsigned GetCoDelTarget() const;
+  unsigned GetCoDelInterval() const;
+  bool GetPipeline() const;
+  std::vector<int> GetCpuAffinity() const;
+  unsigned GetCodecWorkers() const;
+  std::string GetKey() const;
+  Cipher GetCipher() const;
+  bool GetChecksum() const;
+  bool GetSocketFilter() const;
+  unsigned GetProcesses() const;
+  // zero when not set
+  unsigned GetSessionId() const;
+  // empty when hot restart is disabled
+  std::string GetHandoffSocket() const;
+  bool GetTakeover() const;
+  int GetMetricsPort() const;
+  unsigned GetEchoInterval() const;
+  // bytes, zero when the kernel default is used
+  unsigned GetSocketReceiveBuffer() const;
+  unsigned GetSocketSendBuffer() const;
+  unsigned GetLoadGenClients() const;
+  unsigned GetLoadGenRate() const;
+  // IP packet sizes with their weights
+  std::vector<std::pair<unsigned, unsigned>> GetLoadGenSizes() const;
+  unsigned GetLoadGenDuration() const;
   bool GetShowHelp() const;
 
 private:
@@ -44,7 +84,10 @@ private:
   typedef boost::program_options::variables_map variables_map;
 
   options_description general_options,
+                      config_options,
                       help_options,
+                      command_line_options,
+                      config_file_options,
                       all_options;
 
   variables_map variables;
@@ -56,12 +99,51 @@ private:
   Mode mode;
   std::string address;
   unsigned port;
+  unsigned aggregate_delay;
+  unsigned aggregate_size;
+  unsigned queue_size;
+  unsigned codel_target;
+  unsigned codel_interval;
+  bool pipeline;
+  std::vector<int> cpu_affinity;
+  unsigned codec_workers;
+  std::string key;
+  Cipher cipher;
+  bool checksum;
+  bool socket_filter;
+  unsigned processes;
+  unsigned session_id;
+  std::string handoff_socket;
+  bool takeover;
+  int metrics_port;
+  unsigned echo_interval;
+  unsigned socket_receive_buffer;
+  unsigned socket_send_buffer;
+  unsigned loadgen_clients;
+  unsigned loadgen_rate;
+  std::vector<std::pair<unsigned, unsigned>> loadgen_sizes;
+  unsigned loadgen_duration;
   bool show_help;
 
   void OpenConfigFile();
+  void ReadKeyFile(const std::string &path);
   void SetMode(const std::string &mode);
   void SetIp(const std::string &address);
   void SetPort(const unsigned &port);
+  void SetAggregateSize(const unsigned &size);
+  void SetQueueSize(const unsigned &size);
+  void SetCoDelInterval(const unsigned &interval);
+  void SetCpuAffinity(const std::string &cpus);
+  void SetCodecWorkers(const unsigned &workers);
+  void SetCipher(const std::string &cipher);
+  void SetProcesses(const unsigned &processes);
+  void SetSessionId(const unsigned &session_id);
+  void SetMetricsPort(const int &port);
+  void SetSocketBuffer(const std::string &option, const unsigned &size, unsigned &buffer);
+  void SetLoadGenClients(const unsigned &clients);
+  void SetLoadGenRate(const unsigned &rate);
+  void SetLoadGenSizes(const std::string &sizes);
+  void SetLoadGenDuration(const unsigned &duration);
 };
 
 }
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Aggregator.h"
+#include "TooMuchDataException.h"
+#include "CorruptedPacketException.h"
+
+#include <limits>
+
+using namespace std;
+
+
+namespace Packets
+{
+
+Aggregator::Aggregator(const size_t &max_frame_size,
+                       const chrono::microseconds &max_delay) :
+  max_frame_size(max_frame_size),
+  max_delay(max_delay),
+  packet_count(0)
+{
+  frame.reserve(max_frame_size);
+}
+
+
+bool
+Aggregator::Add(const Packet::Data &packet, const Clock::time_point &now)
+{
+  if (packet.size() > numeric_limits<uint16_t>::max())
+    throw TooMuchDataException();
+
+  const size_t needed = LENGTH_PREFIX_SIZE + packet.size();
+  if (!IsEmpty() && frame.size() + needed > max_frame_size)
+    return false;
+
+  if (IsEmpty())
+    first_packet_time = now;
+
+  frame.push_back(static_cast<uint8_t>(packet.size() >> 8));
+  frame.push_back(static_cast<uint8_t>(packet.size() & 0xFF));
+  frame.insert(frame.end(), packet.begin(), packet.end());
+  packet_count++;
+
+  return true;
+}
+
+
+bool
+Aggregator::IsEmpty() const
+{
+  return packet_count == 0;
+}
+
+
+bool
+Aggregator::IsReadyToFlush(const Clock::time_point &now) const
+{
+  if (IsEmpty())
+    return false;
+
+  return frame.size() + LENGTH_PREFIX_SIZE >= max_frame_size
+    || now - first_packet_time >= max_delay;
+}
+
+
+size_t
+Aggregator::GetPacketCount() const
+{
+  return packet_count;
+}
+
+
+Packet::Data
+Aggregator::Flush()
+{
+  Packet::Data flushed;
+  flushed.reserve(max_frame_size);
+  flushed.swap(frame);
+  packet_count = 0;
+
+  return flushed;
+}
+
+
+vector<Packet::Data>
+Aggregator::Split(const Packet::Data &frame)
+{
+  vector<Packet::Data> packets;
+
+  for (size_t i = 0; i < frame.size(); )
+  {
+    if (i + LENGTH_PREFIX_SIZE > frame.size())
+      throw CorruptedPacketException();
+
+    const size_t size = (frame[i] << 8) | frame[i + 1];
+    i += LENGTH_PREFIX_SIZE;
+
+    if (i + size > frame.size())
+      throw CorruptedPacketException();
+
+    packets.emplace_back(frame.begin() + i, frame.begin() + i + size);
+    i += size;
+  }
+
+  return packets;
+}
+
+}
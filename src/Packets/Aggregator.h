@@ -0,0 +1,61 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "Packet.h"
+
+#ifndef _AGGREGATOR_H_
+#define _AGGREGATOR_H_
+
+
+namespace Packets
+{
+
+/*
+ * Packs several IP packets into one frame. Every packet in the frame
+ * is prefixed with its length (two bytes, big endian), so the receiving
+ * side can split the frame with Aggregator::Split().
+ *
+ * The frame should be flushed when it's full or when the oldest packet
+ * waits longer than the configured delay.
+ */
+class Aggregator
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr std::size_t LENGTH_PREFIX_SIZE = 2;
+
+  Aggregator(const std::size_t &max_frame_size,
+             const std::chrono::microseconds &max_delay);
+  virtual ~Aggregator() = default;
+
+  // returns false when the packet doesn't fit into the current frame,
+  // empty frame accepts every packet
+  virtual bool Add(const Packet::Data &packet, const Clock::time_point &now);
+
+  virtual bool IsEmpty() const;
+  virtual bool IsReadyToFlush(const Clock::time_point &now) const;
+  virtual std::size_t GetPacketCount() const;
+
+  virtual Packet::Data Flush();
+
+  static std::vector<Packet::Data> Split(const Packet::Data &frame);
+
+protected:
+  std::size_t max_frame_size;
+  std::chrono::microseconds max_delay;
+
+  Packet::Data frame;
+  std::size_t packet_count;
+  Clock::time_point first_packet_time;
+};
+
+}
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "CorruptedPacketException.h"
+
+#ifndef _CHECKSUMMISMATCHEXCEPTION_H_
+#define _CHECKSUMMISMATCHEXCEPTION_H_
+
+namespace Packets
+{
+
+class ChecksumMismatchException : public CorruptedPacketException
+{
+public:
+  ChecksumMismatchException() :
+    CorruptedPacketException("Packet checksum mismatch.")
+  {
+  }
+};
+
+}
+
+#endif
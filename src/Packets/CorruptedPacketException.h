@@ -19,6 +19,12 @@ public:
     std::runtime_error("Packet is corrupted.")
   {
   }
+
+protected:
+  CorruptedPacketException(const std::string &message) :
+    std::runtime_error(message)
+  {
+  }
 };
 
 }
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Crc32c.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_acle.h>
+#endif
+
+using namespace std;
+
+
+namespace Packets
+{
+
+namespace
+{
+
+constexpr uint32_t POLYNOMIAL = 0x82F63B78; // reflected 0x1EDC6F41
+
+
+struct Tables
+{
+  uint32_t slice[8][256];
+
+  Tables()
+  {
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++)
+        crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+      slice[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; i++)
+      for (int s = 1; s < 8; s++)
+        slice[s][i] = (slice[s - 1][i] >> 8) ^ slice[0][slice[s - 1][i] & 0xFF];
+  }
+};
+
+
+const Tables&
+GetTables()
+{
+  static const Tables tables;
+  return tables;
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse4.2")))
+uint32_t
+UpdateHardware(uint32_t crc, const uint8_t *data, size_t size)
+{
+#if defined(__x86_64__)
+  for (; size >= 8; size -= 8, data += 8)
+  {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+  }
+#endif
+
+  for (; size > 0; size--, data++)
+    crc = _mm_crc32_u8(crc, *data);
+
+  return crc;
+}
+
+
+bool
+DetectHardware()
+{
+  unsigned eax, ebx, ecx, edx;
+  return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2);
+}
+
+#elif defined(__aarch64__)
+
+__attribute__((target("+crc")))
+uint32_t
+UpdateHardware(uint32_t crc, const uint8_t *data, size_t size)
+{
+  for (; size >= 8; size -= 8, data += 8)
+  {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = __crc32cd(crc, word);
+  }
+
+  for (; size > 0; size--, data++)
+    crc = __crc32cb(crc, *data);
+
+  return crc;
+}
+
+
+bool
+DetectHardware()
+{
+  return getauxval(AT_HWCAP) & HWCAP_CRC32;
+}
+
+#else
+
+uint32_t
+UpdateHardware(uint32_t, const uint8_t*, size_t)
+{
+  throw runtime_error("CRC32C instructions are not supported");
+}
+
+
+bool
+DetectHardware()
+{
+  return false;
+}
+
+#endif
+
+
+uint32_t
+UpdateSoftware(uint32_t crc, const uint8_t *data, size_t size)
+{
+  const auto &t = GetTables().slice;
+
+  // little endian only, otherwise bytes are processed one by one
+  if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    for (; size >= 8; size -= 8, data += 8)
+    {
+      uint32_t low, high;
+      memcpy(&low, data, sizeof(low));
+      memcpy(&high, data + 4, sizeof(high));
+      low ^= crc;
+
+      crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF]
+        ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24]
+        ^ t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF]
+        ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+    }
+
+  for (; size > 0; size--, data++)
+    crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+
+  return crc;
+}
+
+}
+
+
+uint32_t
+Crc32c::Compute(const uint8_t *data, const size_t &size, const uint32_t &crc)
+{
+  static const bool hardware = IsHardwareSupported();
+
+  if (hardware)
+    return ~UpdateHardware(~crc, data, size);
+
+  return ~UpdateSoftware(~crc, data, size);
+}
+
+
+bool
+Crc32c::IsHardwareSupported()
+{
+  return DetectHardware();
+}
+
+
+uint32_t
+Crc32c::ComputeSoftware(const uint8_t *data, const size_t &size, const uint32_t &crc)
+{
+  return ~UpdateSoftware(~crc, data, size);
+}
+
+
+uint32_t
+Crc32c::ComputeHardware(const uint8_t *data, const size_t &size, const uint32_t &crc)
+{
+  if (!IsHardwareSupported())
+    throw runtime_error("CRC32C instructions are not supported");
+
+  return ~UpdateHardware(~crc, data, size);
+}
+
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef _CRC32C_H_
+#define _CRC32C_H_
+
+
+namespace Packets
+{
+
+/*
+ * CRC32C (Castagnoli). Uses SSE4.2 or ARMv8 CRC instructions when the
+ * CPU has them, slicing-by-8 tables otherwise.
+ */
+class Crc32c
+{
+public:
+  // crc is the result of the previous call, so data may come in parts
+  static std::uint32_t Compute(const std::uint8_t *data, const std::size_t &size,
+                               const std::uint32_t &crc = 0);
+
+  static bool IsHardwareSupported();
+
+  // implementations, exposed for tests
+  static std::uint32_t ComputeSoftware(const std::uint8_t *data, const std::size_t &size,
+                                       const std::uint32_t &crc = 0);
+  static std::uint32_t ComputeHardware(const std::uint8_t *data, const std::size_t &size,
+                                       const std::uint32_t &crc = 0);
+};
+
+}
+
+#endif
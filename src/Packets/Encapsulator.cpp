@@ -8,12 +8,28 @@
 
 #include <algorithm>
 
+#include "../Metrics/Counter.h"
+
 using namespace std;
 
 
 namespace Packets
 {
 
+namespace
+{
+
+Metrics::Counter encapsulated("sdnst_encapsulated_transmissions_total",
+                              "Transmissions split into fragments.");
+Metrics::Counter fragments_created("sdnst_fragments_created_total",
+                                   "Fragments created from transmissions.");
+Metrics::Counter decapsulated("sdnst_decapsulated_transmissions_total",
+                              "Transmissions reassembled from fragments.");
+Metrics::Counter fragments_reassembled("sdnst_fragments_reassembled_total",
+                                       "Fragments joined into transmissions.");
+
+}
+
 Encapsulator::Encapsulator(unique_ptr<Packet> &&prototype) :
   prototype(std::move(prototype)),
   part_size(0)
@@ -37,6 +53,7 @@ Encapsulator::Encapsulate(const Packet::Data &data) const
 {
   const size_t size = (part_size == 0) ? prototype->GetMaximumDataSize() : part_size;
   vector<unique_ptr<Packet>> packets;
+  packets.reserve((data.size() + size - 1) / size);
 
   for (size_t i = 0; i < data.size(); i += size)
   {
@@ -50,6 +67,9 @@ Encapsulator::Encapsulate(const Packet::Data &data) const
     packets.push_back(move(p));
   }
 
+  encapsulated.Add();
+  fragments_created.Add(packets.size());
+
   return packets;
 }
 
@@ -58,6 +78,8 @@ Packet::Data
 Encapsulator::Decapsulate(const vector<unique_ptr<Packet>> &packets) const
 {
   Packet::Data data;
+  // enough for full fragments, so the data isn't moved while it grows
+  data.reserve(packets.size() * prototype->GetMaximumDataSize());
 
   for (auto it = packets.cbegin(); it != packets.cend(); it++)
   {
@@ -66,6 +88,9 @@ Encapsulator::Decapsulate(const vector<unique_ptr<Packet>> &packets) const
     data.insert(data.end(), pd.begin(), pd.end());
   }
 
+  decapsulated.Add();
+  fragments_reassembled.Add(packets.size());
+
   return data;
 }
 
@@ -3,6 +3,7 @@
  * All rights reserved. Distributed under the terms of the MIT License.
  */
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <memory>
@@ -29,7 +30,25 @@ public:
   {
     NONE,
     RECEIVED,
-    END_OF_TRANSMISSION
+    END_OF_TRANSMISSION,
+    END_OF_AGGREGATE,
+    ECHO_REQUEST,
+    ECHO_REPLY
+  };
+
+  // bytes every dump starts with: (dump[offset] & mask) == value,
+  // lets foreign datagrams be dropped before they are parsed
+  struct Signature
+  {
+    struct Byte
+    {
+      std::size_t offset;
+      std::uint8_t mask;
+      std::uint8_t value;
+    };
+
+    std::size_t minimum_size;
+    std::vector<Byte> bytes;
   };
 
   virtual ~Packet() = default;
@@ -40,14 +59,24 @@ public:
   virtual void SetControlType(const Control &control) = 0;
   virtual Control GetControlType() const = 0;
 
+  // identifies train of fragments, trains with different
+  // stream ids may be interleaved
+  virtual void SetStreamId(const std::uint16_t &stream_id) = 0;
+  virtual std::uint16_t GetStreamId() const = 0;
+
   virtual void SetData(const Data &data) = 0;
   virtual Data GetData() const = 0;
 
   virtual void FillFromDump(const Data &dump) = 0;
   virtual Data Dump() const = 0;
+  // same as above into the buffer, keeping its capacity, so a recycled
+  // buffer isn't allocated again
+  virtual void Dump(Data &dump) const = 0;
 
   virtual int GetMaximumDataSize() const = 0;
 
+  virtual Signature GetSignature() const = 0;
+
   virtual std::unique_ptr<Packet> Clone() const = 0;
 };
 
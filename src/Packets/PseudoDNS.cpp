@@ -8,6 +8,8 @@
 #include "CantSetControlTypeException.h"
 #include "CorruptedPacketException.h"
 #include "WrongMagicNumberException.h"
+#include "ChecksumMismatchException.h"
+#include "Crc32c.h"
 
 #include <utility>
 
@@ -17,9 +19,17 @@ using namespace std;
 namespace Packets
 {
 
+constexpr size_t PseudoDNS::MAX_DUMP_SIZE;
+constexpr size_t PseudoDNS::SESSION_ID_OFFSET;
+constexpr size_t PseudoDNS::CHECKSUM_SIZE;
+
+
 PseudoDNS::PseudoDNS(const Packet::Type &type) :
   type(type),
-  control_type(Packet::Control::NONE)
+  control_type(Packet::Control::NONE),
+  stream_id(0),
+  session_id(0),
+  checksum(false)
 {
 }
 
@@ -55,6 +65,48 @@ PseudoDNS::GetControlType() const
 }
 
 
+void
+PseudoDNS::SetStreamId(const uint16_t &stream_id)
+{
+  this->stream_id = stream_id;
+}
+
+
+uint16_t
+PseudoDNS::GetStreamId() const
+{
+  return stream_id;
+}
+
+
+void
+PseudoDNS::SetSessionId(const uint16_t &session_id)
+{
+  this->session_id = session_id;
+}
+
+
+uint16_t
+PseudoDNS::GetSessionId() const
+{
+  return session_id;
+}
+
+
+void
+PseudoDNS::SetChecksum(const bool &enabled)
+{
+  checksum = enabled;
+}
+
+
+bool
+PseudoDNS::HasChecksum() const
+{
+  return checksum;
+}
+
+
 void
 PseudoDNS::SetData(const Packet::Data &data)
 {
@@ -83,19 +135,26 @@ PseudoDNS::FillFromDump(const Packet::Data &dump)
     throw WrongMagicNumberException();
 
   // Check constans
-  if (((dump.at(2) & 0xFE) != 0x00)
+  if (((dump.at(2) & ~(DC_FLAG | CHECKSUM_FLAG)) != 0x00)
       || ((dump.at(3) & 0xF0) != 0x00))
     throw CorruptedPacketException();
 
-  vector<pair<int, unsigned char>> position_value {
+  const bool has_checksum = dump.at(2) & CHECKSUM_FLAG;
+  if (has_checksum && dump.size() < 17 + 1 + CHECKSUM_SIZE)
+    throw CorruptedPacketException();
+
+  // position of the last label terminator
+  const size_t name_end = dump.size() - 5;
+
+  // data labels end where the checksum label starts
+  const size_t labels_end = has_checksum ? name_end - 1 - CHECKSUM_SIZE : name_end;
+
+  const pair<size_t, unsigned char> position_value[] {
     {4, 0x00},
     {5, 0x01},
-    {6, 0x00},
-    {7, 0x00},
     {8, 0x00},
     {9, 0x00},
-    {10, 0x00},
-    {11, 0x00},
+    {labels_end, has_checksum ? CHECKSUM_SIZE : 0x00},
     {dump.size() - 5, 0x00},
     {dump.size() - 4, 0x00},
     {dump.size() - 3, 0x01},
@@ -110,23 +169,35 @@ PseudoDNS::FillFromDump(const Packet::Data &dump)
   // Check data size
   constexpr int data_position = 13;
   constexpr int data_size_position = data_position - 1;
-  const uint8_t data_size = dump.at(data_size_position);
+  const uint8_t data_size = (labels_end == data_size_position) ? 0 : dump.at(data_size_position);
 
   // Check size of packet
-  const int calculated_end_position = data_size_position + data_size + 4  + (data_size != 0);
-  const int end_position = dump.size() - 1;
-  if (calculated_end_position != end_position)
+  const size_t calculated_labels_end = data_size_position + data_size + (data_size != 0);
+  if (calculated_labels_end != labels_end)
     throw CorruptedPacketException();
 
+  // Check checksum of the header and data, before anything is copied
+  if (has_checksum)
+  {
+    uint32_t crc = Crc32c::Compute(dump.data(), data_size_position);
+    crc = Crc32c::Compute(dump.data() + data_position, data_size, crc);
+
+    const uint8_t *sent = dump.data() + labels_end + 1;
+    if (crc != ((uint32_t(sent[0]) << 24) | (sent[1] << 16) | (sent[2] << 8) | sent[3]))
+      throw ChecksumMismatchException();
+  }
+
   // Copy values
-  type = static_cast<Packet::Type>(dump.at(2) & 0x01);
+  type = static_cast<Packet::Type>(dump.at(2) & DC_FLAG);
   control_type = static_cast<Packet::Control>(dump.at(3) & 0x0F);
+  stream_id = (dump.at(6) << 8) | dump.at(7);
+  session_id = (dump.at(SESSION_ID_OFFSET) << 8) | dump.at(SESSION_ID_OFFSET + 1);
+  checksum = has_checksum;
 
   if (type == Packet::Type::DATA && control_type != Packet::Control::NONE)
     throw CorruptedPacketException();
 
-  data.insert(data.begin(),
-	      dump.begin() + data_position,
+  data.assign(dump.begin() + data_position,
 	      dump.begin() + data_position + data_size);
 }
 
@@ -134,19 +205,40 @@ PseudoDNS::FillFromDump(const Packet::Data &dump)
 Packet::Data
 PseudoDNS::Dump() const
 {
-  Data dump(12, 0x00);
+  Data dump;
+  Dump(dump);
+  return dump;
+}
+
+
+void
+PseudoDNS::Dump(Data &dump) const
+{
+  // any dump fits, so a recycled buffer is never grown
+  dump.clear();
+  dump.reserve(MAX_DUMP_SIZE);
+  dump.resize(12, 0x00);
+
   // Magic number
   dump.at(0) = 0x14;
   dump.at(1) = 0x1D;
 
-  // DC - Data or control packet
-  dump.at(2) = static_cast<uint8_t>(type);
+  // DC - Data or control packet, CF - checksum label present
+  dump.at(2) = static_cast<uint8_t>(type) | (checksum ? CHECKSUM_FLAG : 0x00);
 
   // Control type
   dump.at(3) = static_cast<uint8_t>(control_type);
 
   dump.at(5) = 0x01;
 
+  // Stream id
+  dump.at(6) = static_cast<uint8_t>(stream_id >> 8);
+  dump.at(7) = static_cast<uint8_t>(stream_id & 0xFF);
+
+  // Session id
+  dump.at(SESSION_ID_OFFSET) = static_cast<uint8_t>(session_id >> 8);
+  dump.at(SESSION_ID_OFFSET + 1) = static_cast<uint8_t>(session_id & 0xFF);
+
   if (data.size() > 0)
   {
     // Data size
@@ -156,6 +248,18 @@ PseudoDNS::Dump() const
     dump.insert(dump.end(), data.begin(), data.end());
   }
 
+  if (checksum)
+  {
+    uint32_t crc = Crc32c::Compute(dump.data(), 12);
+    crc = Crc32c::Compute(data.data(), data.size(), crc);
+
+    dump.push_back(CHECKSUM_SIZE);
+    dump.push_back(static_cast<uint8_t>(crc >> 24));
+    dump.push_back(static_cast<uint8_t>(crc >> 16));
+    dump.push_back(static_cast<uint8_t>(crc >> 8));
+    dump.push_back(static_cast<uint8_t>(crc));
+  }
+
   // last 5 bytes
   const char bytes[] {
     0x00,
@@ -164,8 +268,6 @@ PseudoDNS::Dump() const
   };
 
   dump.insert(dump.end(), bytes, bytes + sizeof(bytes));
-
-  return dump;
 }
 
 
@@ -176,13 +278,34 @@ PseudoDNS::GetMaximumDataSize() const
 }
 
 
+Packet::Signature
+PseudoDNS::GetSignature() const
+{
+  // constant part of the header, the same checks FillFromDump() starts with
+  return Signature {
+    17,
+    {
+      {0, 0xFF, 0x14},
+      {1, 0xFF, 0x1D},
+      {2, static_cast<uint8_t>(~(DC_FLAG | CHECKSUM_FLAG)), 0x00},
+      {3, 0xF0, 0x00},
+      {4, 0xFF, 0x00},
+      {5, 0xFF, 0x01}
+    }
+  };
+}
+
+
 unique_ptr<Packet>
 PseudoDNS::Clone() const
 {
-  unique_ptr<Packet> p(new PseudoDNS());
+  unique_ptr<PseudoDNS> p(new PseudoDNS());
 
   p->SetType(type);
   p->SetControlType(control_type);
+  p->SetStreamId(stream_id);
+  p->SetSessionId(session_id);
+  p->SetChecksum(checksum);
   p->SetData(data);
 
   return p;
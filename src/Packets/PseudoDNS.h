@@ -3,6 +3,7 @@
  * All rights reserved. Distributed under the terms of the MIT License.
  */
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -19,6 +20,10 @@ class PseudoDNS : public Packet
 {
 public:
   static constexpr int MAX_DATA_SIZE = 63;
+  // header, data label, checksum label and the last 5 bytes
+  static constexpr std::size_t MAX_DUMP_SIZE = 12 + 1 + MAX_DATA_SIZE + 1 + 4 + 5;
+  // position of the big endian session id in every dump
+  static constexpr std::size_t SESSION_ID_OFFSET = 10;
 
   PseudoDNS(const Type &type = Type::DATA);
   virtual ~PseudoDNS() = default;
@@ -29,19 +34,41 @@ public:
   virtual void SetControlType(const Control &control);
   virtual Control GetControlType() const;
 
+  virtual void SetStreamId(const std::uint16_t &stream_id);
+  virtual std::uint16_t GetStreamId() const;
+
+  // identifies the client, so datagrams of one client can be steered to
+  // the same server process, zero when not used
+  virtual void SetSessionId(const std::uint16_t &session_id);
+  virtual std::uint16_t GetSessionId() const;
+
+  // CRC32C of the header and data, sent as an additional label
+  virtual void SetChecksum(const bool &enabled);
+  virtual bool HasChecksum() const;
+
   virtual void SetData(const Data &data);
   virtual Data GetData() const;
 
   virtual void FillFromDump(const Data &dump);
   virtual Data Dump() const;
+  virtual void Dump(Data &dump) const;
 
   virtual int GetMaximumDataSize() const;
 
+  virtual Signature GetSignature() const;
+
   virtual std::unique_ptr<Packet> Clone() const;
 
 private:
+  static constexpr std::uint8_t DC_FLAG = 0x01;
+  static constexpr std::uint8_t CHECKSUM_FLAG = 0x04;
+  static constexpr std::size_t CHECKSUM_SIZE = 4;
+
   Type type;
   Control control_type;
+  std::uint16_t stream_id;
+  std::uint16_t session_id;
+  bool checksum;
   Data data;
 };
 
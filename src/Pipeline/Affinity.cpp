@@ -0,0 +1,34 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Affinity.h"
+#include "../Logging/Log.h"
+
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+
+
+namespace Pipeline
+{
+
+bool
+Affinity::Set(std::thread &thread, const int &cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  const int err = pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+  if (err != 0)
+  {
+    LOG(warning) << "Can't pin thread to CPU " << cpu << ": " << strerror(err);
+    return false;
+  }
+
+  return true;
+}
+
+}
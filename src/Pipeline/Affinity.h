@@ -0,0 +1,24 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <thread>
+
+#ifndef _AFFINITY_H_
+#define _AFFINITY_H_
+
+
+namespace Pipeline
+{
+
+class Affinity
+{
+public:
+  // pins the thread to one CPU, returns false on failure
+  static bool Set(std::thread &thread, const int &cpu);
+};
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Backoff.h"
+
+#include <thread>
+#include <unistd.h>
+
+
+namespace Pipeline
+{
+
+Backoff::Backoff() :
+  spins(0)
+{
+}
+
+
+void
+Backoff::Wait()
+{
+  if (spins < SPIN_LIMIT)
+  {
+    spins++;
+    std::this_thread::yield();
+  }
+  else
+    usleep(SLEEP_TIME);
+}
+
+
+void
+Backoff::Reset()
+{
+  spins = 0;
+}
+
+}
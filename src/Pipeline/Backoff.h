@@ -0,0 +1,34 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#ifndef _BACKOFF_H_
+#define _BACKOFF_H_
+
+
+namespace Pipeline
+{
+
+/*
+ * Waiting strategy of idle pipeline stage: yields the CPU a few times
+ * to catch a quick follow-up and falls back to sleeping.
+ */
+class Backoff
+{
+public:
+  static constexpr unsigned SPIN_LIMIT = 64;
+  static constexpr unsigned SLEEP_TIME = 50; // microseconds
+
+  Backoff();
+
+  void Wait();
+  void Reset();
+
+private:
+  unsigned spins;
+};
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Channel.h"
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Pipeline
+{
+
+Channel::Channel(const size_t &capacity, const size_t &buffer_size) :
+  buffer_size(buffer_size),
+  forward(capacity),
+  backward(2 * capacity)
+{
+  for (size_t i = 0; i < forward.GetCapacity(); i++)
+  {
+    Packet::Data buffer;
+    buffer.reserve(buffer_size);
+    backward.TryPush(move(buffer));
+  }
+}
+
+
+Packet::Data
+Channel::Acquire()
+{
+  Packet::Data buffer;
+
+  if (!backward.TryPop(buffer))
+    buffer.reserve(buffer_size);
+
+  return buffer;
+}
+
+
+bool
+Channel::TryPush(Packet::Data &&buffer)
+{
+  return forward.TryPush(move(buffer));
+}
+
+
+bool
+Channel::TryPop(Packet::Data &buffer)
+{
+  return forward.TryPop(buffer);
+}
+
+
+void
+Channel::Release(Packet::Data &&buffer)
+{
+  buffer.clear();
+
+  // when the pool is full the buffer is simply freed
+  backward.TryPush(move(buffer));
+}
+
+
+bool
+Channel::IsEmpty() const
+{
+  return forward.IsEmpty();
+}
+
+}
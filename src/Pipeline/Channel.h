@@ -0,0 +1,47 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <boost/noncopyable.hpp>
+
+#include "SpscRing.h"
+#include "../Packets/Packet.h"
+
+#ifndef _CHANNEL_H_
+#define _CHANNEL_H_
+
+
+namespace Pipeline
+{
+
+/*
+ * Connects two pipeline stages. Buffers go forward from the producer to
+ * the consumer and come back through the second ring, so in the steady
+ * state buffers are reused instead of allocated.
+ */
+class Channel : private boost::noncopyable
+{
+public:
+  Channel(const std::size_t &capacity, const std::size_t &buffer_size);
+
+  // producer side
+  Packets::Packet::Data Acquire();
+  bool TryPush(Packets::Packet::Data &&buffer);
+
+  // consumer side
+  bool TryPop(Packets::Packet::Data &buffer);
+  void Release(Packets::Packet::Data &&buffer);
+
+  bool IsEmpty() const;
+
+private:
+  std::size_t buffer_size;
+  SpscRing<Packets::Packet::Data> forward;
+  SpscRing<Packets::Packet::Data> backward;
+};
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <boost/noncopyable.hpp>
+
+#ifndef _MPSCRING_H_
+#define _MPSCRING_H_
+
+
+namespace Pipeline
+{
+
+/*
+ * Lock-free, bounded ring for many producer threads and one consumer
+ * thread (D. Vyukov's bounded queue). Every slot has a sequence number
+ * telling whose turn it is, so producers only compete for the tail
+ * index and never wait for each other: a full ring makes TryPush fail
+ * instead of blocking.
+ */
+template <typename T>
+class MpscRing : private boost::noncopyable
+{
+public:
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  // capacity is rounded up to the power of two
+  MpscRing(const std::size_t &capacity) :
+    head(0),
+    tail(0)
+  {
+    std::size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+
+    for (std::size_t i = 0; i < size; i++)
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  // any thread, returns false when the ring is full
+  bool TryPush(T &&item)
+  {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    Slot *slot;
+
+    while (true)
+    {
+      slot = &slots[t & mask];
+      const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(t);
+
+      if (difference == 0)
+      {
+        if (tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (difference < 0)
+        return false;
+      else
+        t = tail.load(std::memory_order_relaxed);
+    }
+
+    slot->item = std::move(item);
+    slot->sequence.store(t + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // consumer side, returns false when the ring is empty
+  bool TryPop(T &item)
+  {
+    const std::size_t h = head.load(std::memory_order_relaxed);
+    Slot &slot = slots[h & mask];
+
+    if (slot.sequence.load(std::memory_order_acquire) != h + 1)
+      return false;
+
+    item = std::move(slot.item);
+    slot.sequence.store(h + mask + 1, std::memory_order_release);
+    head.store(h + 1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  std::size_t GetCapacity() const
+  {
+    return mask + 1;
+  }
+
+private:
+  typedef std::atomic<std::size_t> Index;
+
+  struct Slot
+  {
+    std::atomic<std::size_t> sequence;
+    T item;
+  };
+
+  // consumer
+  alignas(CACHE_LINE_SIZE) Index head;
+
+  // producers
+  alignas(CACHE_LINE_SIZE) Index tail;
+
+  // not changed after construction
+  alignas(CACHE_LINE_SIZE) std::unique_ptr<Slot[]> slots;
+  std::size_t mask;
+};
+
+template <typename T>
+constexpr std::size_t MpscRing<T>::CACHE_LINE_SIZE;
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#ifndef _REORDERBUFFER_H_
+#define _REORDERBUFFER_H_
+
+
+namespace Pipeline
+{
+
+/*
+ * Restores the submission order of items completed out of order.
+ * Every item carries its sequence number, items are released strictly
+ * in sequence, skipped sequences (dropped items) don't block the rest.
+ */
+template <typename T>
+class ReorderBuffer : private boost::noncopyable
+{
+public:
+  // window is rounded up to the power of two
+  ReorderBuffer(const std::size_t &window) :
+    next(0)
+  {
+    std::size_t size = 1;
+    while (size < window)
+      size <<= 1;
+
+    slots.resize(size);
+    states.resize(size, State::EMPTY);
+    mask = size - 1;
+  }
+
+  // returns false when the sequence doesn't fit in the window
+  bool Insert(const std::uint64_t &sequence, T &&item)
+  {
+    if (!IsInWindow(sequence))
+      return false;
+
+    slots[sequence & mask] = std::move(item);
+    states[sequence & mask] = State::READY;
+
+    return true;
+  }
+
+  // marks the sequence as completed without an item
+  bool Skip(const std::uint64_t &sequence)
+  {
+    if (!IsInWindow(sequence))
+      return false;
+
+    states[sequence & mask] = State::SKIPPED;
+
+    return true;
+  }
+
+  // returns false when the next item in sequence isn't completed yet
+  bool TryPop(T &item)
+  {
+    while (states[next & mask] == State::SKIPPED)
+      states[next++ & mask] = State::EMPTY;
+
+    if (states[next & mask] != State::READY)
+      return false;
+
+    item = std::move(slots[next & mask]);
+    states[next++ & mask] = State::EMPTY;
+
+    return true;
+  }
+
+  // all sequences below this one were released or skipped
+  std::uint64_t GetNextSequence() const
+  {
+    return next;
+  }
+
+  std::size_t GetWindow() const
+  {
+    return slots.size();
+  }
+
+private:
+  enum class State : std::uint8_t
+  {
+    EMPTY,
+    READY,
+    SKIPPED
+  };
+
+  std::vector<T> slots;
+  std::vector<State> states;
+  std::size_t mask;
+  std::uint64_t next;
+
+  bool IsInWindow(const std::uint64_t &sequence) const
+  {
+    return sequence >= next && sequence - next < slots.size();
+  }
+};
+
+}
+
+#endif
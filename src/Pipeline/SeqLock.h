@@ -0,0 +1,84 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <boost/noncopyable.hpp>
+
+#ifndef _SEQLOCK_H_
+#define _SEQLOCK_H_
+
+
+namespace Pipeline
+{
+
+/*
+ * Value published by one writer thread and read by any thread without
+ * locks. The writer never waits, a reader retries while the value
+ * changes under it, so it always gets a value which was stored. The
+ * value is kept in atomic words, reading it while it's written isn't
+ * a data race.
+ */
+template <typename T>
+class SeqLock : private boost::noncopyable
+{
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+  SeqLock(const T &value = T()) :
+    version(0)
+  {
+    Store(value);
+  }
+
+  // writer side, one thread at a time
+  void Store(const T &value)
+  {
+    const unsigned v = version.load(std::memory_order_relaxed);
+    version.store(v + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::uint64_t words[WORDS] = {};
+    std::memcpy(words, &value, sizeof(T));
+    for (std::size_t i = 0; i < WORDS; i++)
+      data[i].store(words[i], std::memory_order_relaxed);
+
+    version.store(v + 2, std::memory_order_release);
+  }
+
+  T Load() const
+  {
+    std::uint64_t words[WORDS];
+    unsigned before, after;
+
+    // odd version is a store in progress
+    do
+    {
+      before = version.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < WORDS; i++)
+        words[i] = data[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = version.load(std::memory_order_relaxed);
+    }
+    while ((before & 1) || before != after);
+
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+private:
+  static constexpr std::size_t WORDS = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  std::atomic<unsigned> version;
+  std::atomic<std::uint64_t> data[WORDS];
+};
+
+}
+
+#endif
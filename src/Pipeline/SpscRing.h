@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#ifndef _SPSCRING_H_
+#define _SPSCRING_H_
+
+
+namespace Pipeline
+{
+
+/*
+ * Lock-free, bounded ring for exactly one producer and one consumer
+ * thread. Producer and consumer indexes live on separate cache lines,
+ * every side keeps a cached copy of the other side index, so the shared
+ * line is touched only when the ring looks full or empty. The slots,
+ * read by both sides, have a line of their own too.
+ */
+template <typename T>
+class SpscRing : private boost::noncopyable
+{
+public:
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  // capacity is rounded up to the power of two
+  SpscRing(const std::size_t &capacity)
+  {
+    consumer.head = 0;
+    consumer.cached_tail = 0;
+    producer.tail = 0;
+    producer.cached_head = 0;
+
+    std::size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+
+    slots.resize(size);
+    mask = size - 1;
+  }
+
+  // producer side, returns false when the ring is full
+  bool TryPush(T &&item)
+  {
+    const std::size_t t = producer.tail.load(std::memory_order_relaxed);
+
+    if (t - producer.cached_head == slots.size())
+    {
+      producer.cached_head = consumer.head.load(std::memory_order_acquire);
+      if (t - producer.cached_head == slots.size())
+        return false;
+    }
+
+    slots[t & mask] = std::move(item);
+    producer.tail.store(t + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // consumer side, returns false when the ring is empty
+  bool TryPop(T &item)
+  {
+    const std::size_t h = consumer.head.load(std::memory_order_relaxed);
+
+    if (h == consumer.cached_tail)
+    {
+      consumer.cached_tail = producer.tail.load(std::memory_order_acquire);
+      if (h == consumer.cached_tail)
+        return false;
+    }
+
+    item = std::move(slots[h & mask]);
+    consumer.head.store(h + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool IsEmpty() const
+  {
+    return consumer.head.load(std::memory_order_acquire) == producer.tail.load(std::memory_order_acquire);
+  }
+
+  std::size_t GetCapacity() const
+  {
+    return slots.size();
+  }
+
+private:
+  typedef std::atomic<std::size_t> Index;
+
+  struct alignas(CACHE_LINE_SIZE) Consumer
+  {
+    Index head;
+    std::size_t cached_tail;
+  };
+
+  struct alignas(CACHE_LINE_SIZE) Producer
+  {
+    Index tail;
+    std::size_t cached_head;
+  };
+
+  Consumer consumer;
+  Producer producer;
+
+  // not changed after construction
+  alignas(CACHE_LINE_SIZE) std::vector<T> slots;
+  std::size_t mask;
+};
+
+template <typename T>
+constexpr std::size_t SpscRing<T>::CACHE_LINE_SIZE;
+
+}
+
+#endif
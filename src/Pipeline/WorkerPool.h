@@ -0,0 +1,195 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "SpscRing.h"
+#include "ReorderBuffer.h"
+#include "Backoff.h"
+#include "../Logging/Log.h"
+
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+
+namespace Pipeline
+{
+
+/*
+ * Runs a job on independent items in several threads and returns the
+ * results in the submission order. Every worker has its own input and
+ * output ring, so one thread submits, one thread collects and no locks
+ * are shared between them. Items for which the job returns false or
+ * throws are dropped, so a job whose caller has to account for every
+ * item returns its failures as results.
+ */
+template <typename In, typename Out>
+class WorkerPool : private boost::noncopyable
+{
+public:
+  typedef std::function<bool(In &in, Out &out)> Job;
+
+  // called once per worker, so jobs don't have to be thread-safe
+  typedef std::function<Job()> JobFactory;
+
+  WorkerPool(const std::size_t &workers, const std::size_t &capacity,
+             const JobFactory &factory) :
+    running(true),
+    submitted(0),
+    collected(0),
+    next_worker(0),
+    reorder(workers * capacity)
+  {
+    for (std::size_t i = 0; i < workers; i++)
+    {
+      inputs.emplace_back(new SpscRing<Task>(capacity));
+      outputs.emplace_back(new SpscRing<Result>(capacity));
+    }
+
+    for (std::size_t i = 0; i < workers; i++)
+      threads.emplace_back(&WorkerPool::Work, this, i, factory());
+  }
+
+  virtual ~WorkerPool()
+  {
+    running = false;
+
+    for (auto &t : threads)
+      t.join();
+  }
+
+  // submitter side, returns false and leaves the item untouched when
+  // all workers are busy
+  bool TrySubmit(In &&in)
+  {
+    // the reorder buffer has to hold every item in flight
+    if (GetInFlightCount() >= reorder.GetWindow())
+      return false;
+
+    Task task;
+    task.sequence = submitted;
+    task.in = std::move(in);
+
+    for (std::size_t i = 0; i < inputs.size(); i++)
+    {
+      const std::size_t worker = (next_worker + i) % inputs.size();
+
+      if (inputs[worker]->TryPush(std::move(task)))
+      {
+        next_worker = (worker + 1) % inputs.size();
+        submitted++;
+        return true;
+      }
+    }
+
+    in = std::move(task.in);
+    return false;
+  }
+
+  // collector side, returns false when the next result isn't ready
+  bool TryCollect(Out &out)
+  {
+    Result result;
+
+    for (auto &output : outputs)
+      while (output->TryPop(result))
+        if (result.valid)
+          reorder.Insert(result.sequence, std::move(result.out));
+        else
+          reorder.Skip(result.sequence);
+
+    const bool ready = reorder.TryPop(out);
+    collected.store(reorder.GetNextSequence(), std::memory_order_release);
+
+    return ready;
+  }
+
+  // submitter side, items submitted and not collected yet
+  std::size_t GetInFlightCount() const
+  {
+    return submitted - collected.load(std::memory_order_acquire);
+  }
+
+  std::size_t GetWorkerCount() const
+  {
+    return threads.size();
+  }
+
+private:
+  struct Task
+  {
+    std::uint64_t sequence;
+    In in;
+  };
+
+  struct Result
+  {
+    std::uint64_t sequence;
+    bool valid;
+    Out out;
+  };
+
+  std::atomic<bool> running;
+
+  std::vector<std::unique_ptr<SpscRing<Task>>> inputs;
+  std::vector<std::unique_ptr<SpscRing<Result>>> outputs;
+  std::vector<std::thread> threads;
+
+  // submitter
+  std::uint64_t submitted;
+  std::atomic<std::uint64_t> collected;
+  std::size_t next_worker;
+
+  // collector
+  ReorderBuffer<Out> reorder;
+
+  void Work(const std::size_t &index, Job job)
+  {
+    Backoff backoff;
+    Task task;
+    Result result;
+
+    while (running)
+    {
+      if (!inputs[index]->TryPop(task))
+      {
+        backoff.Wait();
+        continue;
+      }
+
+      backoff.Reset();
+      result.sequence = task.sequence;
+
+      try {
+        result.valid = job(task.in, result.out);
+      }
+      catch (std::exception &ex) {
+        LOG(warning) << "Worker dropped item: " << ex.what();
+        result.valid = false;
+      }
+
+      while (!outputs[index]->TryPush(std::move(result)))
+      {
+        if (!running)
+          return;
+
+        backoff.Wait();
+      }
+    }
+  }
+};
+
+}
+
+#endif
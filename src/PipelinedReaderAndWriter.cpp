@@ -0,0 +1,486 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "PipelinedReaderAndWriter.h"
+
+#include <thread>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "Pipeline/Backoff.h"
+#include "Pipeline/Affinity.h"
+#include "Packets/PseudoDNS.h"
+#include "Logging/Log.h"
+
+using namespace std;
+using namespace Interfaces;
+using namespace Packets;
+using namespace Codec;
+using namespace Pipeline;
+
+
+PipelinedReaderAndWriter::PipelinedReaderAndWriter(shared_ptr<TunTap> &tuntap,
+                                                   shared_ptr<Socket> &socket,
+                                                   shared_ptr<Packet> &prototype)
+ :
+  PrimitiveReaderAndWriter(tuntap, socket, prototype),
+  tun_to_encoder(RING_SIZE, TUN_BUFFER_SIZE),
+  encoder_to_socket(SOCKET_RING_SIZE, DATAGRAM_BUFFER_SIZE),
+  socket_to_decoder(RING_SIZE, DATAGRAM_BUFFER_SIZE),
+  decoder_to_tun(RING_SIZE, TUN_BUFFER_SIZE),
+  tun_reader_done(false),
+  encoder_done(false),
+  socket_reader_done(false),
+  decoder_done(false),
+  codec_workers(0)
+{
+}
+
+
+void
+PipelinedReaderAndWriter::Run()
+{
+  LOG(info) << "Starting pipeline threads...";
+  running = true;
+  draining = false;
+  tun_reader_done = false;
+  encoder_done = false;
+  socket_reader_done = false;
+  decoder_done = false;
+
+  if (codec_workers > 0)
+    LOG(info) << "Starting " << codec_workers << " codec workers per direction...";
+
+  vector<thread> threads;
+  threads.emplace_back(&PipelinedReaderAndWriter::ReadFromTun, this);
+  threads.emplace_back(codec_workers > 0 ? &PipelinedReaderAndWriter::EncodeInPool
+                                         : &PipelinedReaderAndWriter::Encode, this);
+  threads.emplace_back(&PipelinedReaderAndWriter::WriteToSocket, this);
+  threads.emplace_back(&PipelinedReaderAndWriter::ReadFromSocket, this);
+  threads.emplace_back(codec_workers > 0 ? &PipelinedReaderAndWriter::DecodeInPool
+                                         : &PipelinedReaderAndWriter::Decode, this);
+  threads.emplace_back(&PipelinedReaderAndWriter::WriteToTun, this);
+
+  if (!cpus.empty())
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+      const int cpu = cpus[i % cpus.size()];
+      LOG(info) << "Pinning pipeline stage " << i << " to CPU " << cpu;
+      Affinity::Set(threads[i], cpu);
+    }
+
+  for (auto &t : threads)
+    t.join();
+
+  LogQueueStats();
+  LogLatencyStats();
+  LogSocketStats();
+}
+
+
+void
+PipelinedReaderAndWriter::SetCpuAffinity(const vector<int> &cpus)
+{
+  this->cpus = cpus;
+}
+
+
+void
+PipelinedReaderAndWriter::SetCodecWorkers(const size_t &workers)
+{
+  codec_workers = workers;
+}
+
+
+void
+PipelinedReaderAndWriter::ReadFromTun() try
+{
+  Packet::Data buffer = tun_to_encoder.Acquire();
+
+  while (running && !draining)
+  {
+    if (!socket->HasRemoteEndpoint())
+    {
+      usleep(500);
+      continue;
+    }
+
+    if (!tuntap->IsReadyToRead())
+    {
+      usleep(50);
+      continue;
+    }
+
+    buffer.resize(TUN_BUFFER_SIZE);
+    const int r = tuntap->Read(buffer.data(), buffer.size());
+    buffer.resize(r);
+
+    Push(tun_to_encoder, move(buffer));
+    buffer = tun_to_encoder.Acquire();
+  }
+
+  tun_reader_done = true;
+}
+catch (exception &ex) {
+  LOG(fatal) << ex.what();
+  running = false;
+}
+
+
+void
+PipelinedReaderAndWriter::Encode() try
+{
+  auto sender = CreateSender();
+  Backoff backoff;
+  Packet::Data packet;
+  Packet::Data datagram = encoder_to_socket.Acquire();
+  bool pending = false;
+
+  RestoreHandoffState(*sender);
+
+  while (running)
+  {
+    const bool tun_reader_stopped = tun_reader_done;
+    bool busy = false;
+
+    for (int i = 0; i < MAX_TUN_READS_PER_ROUND && tun_to_encoder.TryPop(packet); i++)
+    {
+      sender->Push(packet, Sender::Clock::now());
+      tun_to_encoder.Release(move(packet));
+      busy = true;
+    }
+
+    busy |= PassDatagrams(*sender, datagram, pending);
+
+    UpdateQueueStats(*sender);
+
+    if (tun_reader_stopped && !busy)
+    {
+      const bool sent = !sender->HasPendingData() && !pending;
+      if (sent || IsDrainTimedOut())
+        break;
+    }
+
+    if (busy)
+      backoff.Reset();
+    else
+      backoff.Wait();
+  }
+
+  if (running)
+    SaveHandoffState(*sender);
+
+  encoder_done = true;
+}
+catch (exception &ex) {
+  LOG(fatal) << ex.what();
+  running = false;
+}
+
+
+void
+PipelinedReaderAndWriter::EncodeInPool() try
+{
+  ParallelSender encoder([this]() { return CreateSender(); }, codec_workers, latency);
+  Sender &sender = encoder.GetSender();
+  Backoff backoff;
+  Packet::Data packet;
+  vector<Packet::Data> datagrams;
+
+  RestoreHandoffState(sender);
+
+  while (running)
+  {
+    const bool tun_reader_stopped = tun_reader_done;
+    bool busy = false;
+
+    for (int i = 0; i < MAX_TUN_READS_PER_ROUND && tun_to_encoder.TryPop(packet); i++)
+    {
+      sender.Push(packet, Sender::Clock::now());
+      tun_to_encoder.Release(move(packet));
+      busy = true;
+    }
+
+    busy |= encoder.Poll(datagrams, Sender::Clock::now());
+
+    for (auto &d : datagrams)
+    {
+      Push(encoder_to_socket, move(d));
+      encoder.Recycle(encoder_to_socket.Acquire());
+    }
+    datagrams.clear();
+
+    UpdateQueueStats(sender);
+
+    if (tun_reader_stopped && !busy && (!encoder.HasPendingData() || IsDrainTimedOut()))
+      break;
+
+    if (busy)
+      backoff.Reset();
+    else
+      backoff.Wait();
+  }
+
+  if (running)
+    SaveHandoffState(sender);
+
+  encoder_done = true;
+}
+catch (exception &ex) {
+  LOG(fatal) << ex.what();
+  running = false;
+}
+
+
+void
+PipelinedReaderAndWriter::WriteToSocket() try
+{
+  Backoff backoff;
+  Packet::Data datagram;
+
+  while (running)
+  {
+    const bool encoder_stopped = encoder_done;
+
+    if (!encoder_to_socket.TryPop(datagram))
+    {
+      if (encoder_stopped)
+        break;
+
+      backoff.Wait();
+      continue;
+    }
+
+    backoff.Reset();
+    socket->Write(datagram.data(), datagram.size());
+    encoder_to_socket.Release(move(datagram));
+  }
+}
+catch (exception &ex) {
+  LOG(fatal) << ex.what();
+  running = false;
+}
+
+
+void
+PipelinedReaderAndWriter::ReadFromSocket() try
+{
+  Packet::Data buffer = socket_to_decoder.Acquire();
+  Endpoint source;
+
+  while (running && !draining)
+  {
+    UpdateSocketStats();
+
+    if (!socket->IsReadyToRead())
+    {
+      usleep(50);
+      continue;
+    }
+
+    // longer datagrams aren't tunnel packets, truncated they fail to parse
+    buffer.resize(PseudoDNS::MAX_DUMP_SIZE);
+    const int r = socket->RecvFrom(buffer.data(), buffer.size(), source);
+    buffer.resize(r);
+
+    if (!AcceptPeer(source))
+      continue;
+
+    Push(socket_to_decoder, move(buffer));
+    buffer = socket_to_decoder.Acquire();
+  }
+
+  socket_reader_done = true;
+}
+catch (exception &ex) {
+  LOG(fatal) << ex.what();
+  running = false;
+}
+
+
+void
+PipelinedReaderAndWriter::Decode() try
+{
+  auto receiver = CreateReceiver();
+  Backoff backoff;
+  vector<Packet::Data> packets;
+  Packet::Data datagram;
+
+  RestoreHandoffState(*receiver);
+
+  while (running)
+  {
+    const bool socket_reader_stopped = socket_reader_done;
+
+    if (!socket_to_decoder.TryPop(datagram))
+    {
+      if (socket_reader_stopped)
+        break;
+
+      backoff.Wait();
+      continue;
+    }
+
+    const auto start = Receiver::Clock::now();
+    receiver->Push(datagram, packets, start);
+    latency->decode.Record(Receiver::Clock::now() - start);
+
+    socket_to_decoder.Release(move(datagram));
+
+    backoff.Reset();
+    SendReplies(*receiver);
+    PassPackets(packets);
+  }
+
+  if (running)
+    SaveHandoffState(*receiver);
+
+  decoder_done = true;
+}
+catch (exception &ex) {
+  LOG(fatal) << ex.what();
+  running = false;
+}
+
+
+void
+PipelinedReaderAndWriter::DecodeInPool() try
+{
+  ParallelReceiver decoder([this]() { return CreateReceiver(); }, codec_workers, latency);
+  Receiver &receiver = decoder.GetReceiver();
+  Backoff backoff;
+  vector<Packet::Data> packets;
+  Packet::Data datagram;
+  bool pending = false;
+
+  RestoreHandoffState(receiver);
+
+  while (running)
+  {
+    const bool socket_reader_stopped = socket_reader_done;
+    bool busy = false;
+
+    // datagrams wait in the channel while the workers are busy
+    while (pending || socket_to_decoder.TryPop(datagram))
+    {
+      pending = !decoder.Push(move(datagram));
+      if (pending)
+        break;
+
+      busy = true;
+    }
+
+    busy |= decoder.Poll(packets, Receiver::Clock::now());
+
+    SendReplies(receiver);
+    PassPackets(packets);
+
+    if (socket_reader_stopped && !busy && !pending && !decoder.HasPendingData())
+      break;
+
+    if (busy)
+      backoff.Reset();
+    else
+      backoff.Wait();
+  }
+
+  if (running)
+    SaveHandoffState(receiver);
+
+  decoder_done = true;
+}
+catch (exception &ex) {
+  LOG(fatal) << ex.what();
+  running = false;
+}
+
+
+void
+PipelinedReaderAndWriter::WriteToTun() try
+{
+  Backoff backoff;
+  Packet::Data packet;
+
+  while (running)
+  {
+    const bool decoder_stopped = decoder_done;
+
+    if (!decoder_to_tun.TryPop(packet))
+    {
+      if (decoder_stopped)
+        break;
+
+      backoff.Wait();
+      continue;
+    }
+
+    backoff.Reset();
+    tuntap->Write(packet.data(), packet.size());
+    decoder_to_tun.Release(move(packet));
+  }
+}
+catch (exception &ex) {
+  LOG(fatal) << ex.what();
+  running = false;
+}
+
+
+bool
+PipelinedReaderAndWriter::PassDatagrams(Sender &sender, Packet::Data &datagram, bool &pending)
+{
+  bool passed = false;
+
+  // send as much as the socket stage accepts, the rest stays queued
+  while (true)
+  {
+    if (!pending)
+    {
+      const auto start = Sender::Clock::now();
+      if (!sender.Pull(datagram, start))
+        break;
+
+      latency->encode.Record(Sender::Clock::now() - start);
+    }
+
+    pending = true;
+    if (!encoder_to_socket.TryPush(move(datagram)))
+      break;
+
+    pending = false;
+    datagram = encoder_to_socket.Acquire();
+    passed = true;
+  }
+
+  return passed;
+}
+
+
+void
+PipelinedReaderAndWriter::PassPackets(vector<Packet::Data> &packets)
+{
+  for (auto &p : packets)
+  {
+    Packet::Data buffer = decoder_to_tun.Acquire();
+    buffer.assign(p.begin(), p.end());
+    Push(decoder_to_tun, move(buffer));
+  }
+
+  packets.clear();
+}
+
+
+void
+PipelinedReaderAndWriter::Push(Channel &channel, Packet::Data &&buffer)
+{
+  Backoff backoff;
+
+  while (!channel.TryPush(move(buffer)))
+  {
+    if (!running)
+      return;
+
+    backoff.Wait();
+  }
+}
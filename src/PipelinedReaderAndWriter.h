@@ -0,0 +1,87 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#ifndef _PIPELINEDREADERANDWRITER_H_
+#define _PIPELINEDREADERANDWRITER_H_
+
+#include <memory>
+#include <vector>
+
+#include "PrimitiveReaderAndWriter.h"
+#include "Codec/ParallelSender.h"
+#include "Codec/ParallelReceiver.h"
+#include "Pipeline/Channel.h"
+
+
+/*
+ * Every direction is split into three stages (I/O reader, codec, I/O
+ * writer), each running in its own thread. Stages are connected by
+ * lock-free single producer/single consumer channels, so encoding and
+ * decoding overlaps with system calls.
+ */
+class PipelinedReaderAndWriter : public PrimitiveReaderAndWriter
+{
+public:
+  static constexpr unsigned STAGE_COUNT = 6;
+
+  PipelinedReaderAndWriter(std::shared_ptr<Interfaces::TunTap> &tuntap,
+                           std::shared_ptr<Interfaces::Socket> &socket,
+                           std::shared_ptr<Packets::Packet> &prototype);
+  virtual ~PipelinedReaderAndWriter() = default;
+
+  virtual void Run();
+
+  // CPUs for stages in order: TUN reader, encoder, socket writer,
+  // socket reader, decoder, TUN writer; list is repeated when it is
+  // shorter than the number of stages, empty list disables pinning
+  virtual void SetCpuAffinity(const std::vector<int> &cpus);
+
+  // Seals, splits and dumps in a pool of worker threads, and parses,
+  // opens and splits in another one. The encoder and decoder stages only
+  // queue and reassemble then. Zero disables the pools.
+  virtual void SetCodecWorkers(const std::size_t &workers);
+
+protected:
+  static constexpr std::size_t RING_SIZE = 256;
+
+  // small, so packets wait in CoDel managed queues instead
+  static constexpr std::size_t SOCKET_RING_SIZE = 16;
+
+  static constexpr std::size_t DATAGRAM_BUFFER_SIZE = 512;
+
+  Pipeline::Channel tun_to_encoder;
+  Pipeline::Channel encoder_to_socket;
+  Pipeline::Channel socket_to_decoder;
+  Pipeline::Channel decoder_to_tun;
+
+  std::vector<int> cpus;
+
+  // on handoff every stage stops when the stage before it is done and
+  // there is nothing left between them
+  std::atomic<bool> tun_reader_done;
+  std::atomic<bool> encoder_done;
+  std::atomic<bool> socket_reader_done;
+  std::atomic<bool> decoder_done;
+
+  std::size_t codec_workers;
+
+  void ReadFromTun();
+  void Encode();
+  void EncodeInPool();
+  void WriteToSocket();
+
+  void ReadFromSocket();
+  void Decode();
+  void DecodeInPool();
+  void WriteToTun();
+
+  bool PassDatagrams(Codec::Sender &sender, Packets::Packet::Data &datagram, bool &pending);
+  void PassPackets(std::vector<Packets::Packet::Data> &packets);
+
+  void Push(Pipeline::Channel &channel, Packets::Packet::Data &&buffer);
+};
+
+
+#endif // _PIPELINEDREADERANDWRITER_H_
@@ -6,16 +6,65 @@
 #include "PrimitiveReaderAndWriter.h"
 
 #include <thread>
+#include <limits>
 #include <stdexcept>
-#include <boost/log/trivial.hpp>
 #include <unistd.h>
 
 #include "Packets/Packet.h"
-#include "Packets/Encapsulator.h"
+#include "Packets/PseudoDNS.h"
+#include "Metrics/Counter.h"
+#include "Metrics/Gauge.h"
+#include "Logging/Log.h"
 
 using namespace std;
 using namespace Interfaces;
 using namespace Packets;
+using namespace Scheduling;
+using namespace Codec;
+
+
+namespace
+{
+
+Metrics::Counter enqueued("sdnst_queue_enqueued_packets_total",
+                          "Packets accepted by transmit queues.");
+Metrics::Counter dequeued("sdnst_queue_dequeued_packets_total",
+                          "Packets taken from transmit queues.");
+Metrics::Counter tail_dropped("sdnst_queue_dropped_packets_total",
+                              "Packets dropped by transmit queues.",
+                              "reason=\"tail\"");
+Metrics::Counter codel_dropped("sdnst_queue_dropped_packets_total",
+                               "Packets dropped by transmit queues.",
+                               "reason=\"codel\"");
+Metrics::Counter ecn_marked("sdnst_queue_ecn_marked_packets_total",
+                            "Packets marked with ECN CE instead of dropping.");
+Metrics::Gauge queue_length("sdnst_queue_length_packets",
+                            "Packets waiting in transmit queues.");
+Metrics::Gauge sojourn_time("sdnst_queue_sojourn_time_microseconds",
+                            "Queueing delay of the last sent packet.");
+Metrics::Counter foreign_dropped("sdnst_socket_dropped_datagrams_total",
+                                 "Datagrams dropped after receiving them from the socket.",
+                                 "reason=\"foreign_source\"");
+Metrics::Counter kernel_dropped("sdnst_socket_kernel_dropped_datagrams_total",
+                                "Datagrams dropped by the kernel: rejected by the socket filter or receive buffer full.");
+Metrics::Counter tun_kernel_dropped("sdnst_tun_kernel_dropped_packets_total",
+                                    "Packets routed into the TUN device and dropped by the kernel, not read in time.");
+Metrics::Gauge receive_queued("sdnst_socket_receive_queue_bytes",
+                              "Bytes of datagrams waiting in the socket receive buffer.");
+Metrics::Gauge receive_buffer("sdnst_socket_receive_buffer_bytes",
+                              "Size of the socket receive buffer.");
+Metrics::Gauge send_queued("sdnst_socket_send_queue_bytes",
+                           "Bytes waiting in the socket send buffer.");
+Metrics::Gauge send_buffer("sdnst_socket_send_buffer_bytes",
+                           "Size of the socket send buffer.");
+
+}
+
+
+constexpr size_t PrimitiveReaderAndWriter::TUN_BUFFER_SIZE;
+constexpr chrono::seconds PrimitiveReaderAndWriter::HANDOFF_DRAIN_TIMEOUT;
+constexpr chrono::seconds PrimitiveReaderAndWriter::SOCKET_STATS_INTERVAL;
+constexpr chrono::milliseconds PrimitiveReaderAndWriter::SOCKET_BUFFERS_INTERVAL;
 
 
 PrimitiveReaderAndWriter::PrimitiveReaderAndWriter(shared_ptr<TunTap> &tuntap,
@@ -25,7 +74,26 @@ PrimitiveReaderAndWriter::PrimitiveReaderAndWriter(shared_ptr<TunTap> &tuntap,
   tuntap(tuntap),
   socket(socket),
   prototype(prototype),
-  running(false)
+  running(false),
+  draining(false),
+  drain_deadline(),
+  aggregate_size(0),
+  aggregate_delay(0),
+  max_queue_size(CoDelQueue::DEFAULT_MAX_SIZE),
+  codel_target(CoDelQueue::DEFAULT_TARGET),
+  codel_interval(CoDelQueue::DEFAULT_INTERVAL),
+  encryption(false),
+  cipher(Crypto::Aead::Algorithm::CHACHA20_POLY1305),
+  send_key(),
+  receive_key(),
+  echo_interval(0),
+  queue_stats(),
+  published_queue_stats(),
+  latency(new Latency()),
+  socket_dropped(0),
+  tun_dropped(0),
+  socket_stats_time(),
+  socket_buffers_time()
 {
 }
 
@@ -33,65 +101,162 @@ PrimitiveReaderAndWriter::PrimitiveReaderAndWriter(shared_ptr<TunTap> &tuntap,
 void
 PrimitiveReaderAndWriter::Run()
 {
-  BOOST_LOG_TRIVIAL(info) << "Starting sending/receiving threads...";
+  LOG(info) << "Starting sending/receiving threads...";
   running = true;
+  draining = false;
 
   thread t1(&PrimitiveReaderAndWriter::ReadFromTunAndWriteToSocket, this);
   thread t2(&PrimitiveReaderAndWriter::ReadFromSocketAndWriteToTun, this);
 
   t1.join();
   t2.join();
+
+  LogQueueStats();
+  LogLatencyStats();
+  LogSocketStats();
 }
 
 
 void
 PrimitiveReaderAndWriter::Stop()
 {
-  BOOST_LOG_TRIVIAL(info) << "Stopping threads...";
+  LOG(info) << "Stopping threads...";
   running = false;
 }
 
 
+void
+PrimitiveReaderAndWriter::StopForHandoff()
+{
+  LOG(info) << "Stopping threads for handoff...";
+  drain_deadline = Sender::Clock::now() + HANDOFF_DRAIN_TIMEOUT;
+  draining = true;
+}
+
+
+Restart::State
+PrimitiveReaderAndWriter::GetHandoffState() const
+{
+  lock_guard<mutex> lock(handoff_mutex);
+  Restart::State state = handoff_state;
+
+  if (socket->HasRemoteEndpoint() && !socket->IsConnected())
+    state.peer = socket->GetRemoteEndpoint();
+
+  return state;
+}
+
+
+void
+PrimitiveReaderAndWriter::SetHandoffState(const Restart::State &state)
+{
+  lock_guard<mutex> lock(handoff_mutex);
+  handoff_state = state;
+}
+
+
+void
+PrimitiveReaderAndWriter::SetAggregation(const size_t &max_frame_size,
+                                         const chrono::microseconds &max_delay)
+{
+  aggregate_size = max_frame_size;
+  aggregate_delay = max_delay;
+}
+
+
+void
+PrimitiveReaderAndWriter::SetQueueManagement(const size_t &max_queue_size,
+                                             const chrono::microseconds &target,
+                                             const chrono::microseconds &interval)
+{
+  this->max_queue_size = max_queue_size;
+  codel_target = target;
+  codel_interval = interval;
+}
+
+
+void
+PrimitiveReaderAndWriter::SetEncryption(const Crypto::Aead::Algorithm &algorithm,
+                                        const Crypto::Aead::Key &send_key,
+                                        const Crypto::Aead::Key &receive_key)
+{
+  encryption = true;
+  cipher = algorithm;
+  this->send_key = send_key;
+  this->receive_key = receive_key;
+}
+
+
+void
+PrimitiveReaderAndWriter::SetEchoInterval(const chrono::milliseconds &interval)
+{
+  echo_interval = interval;
+}
+
+
+QueueStats
+PrimitiveReaderAndWriter::GetQueueStats() const
+{
+  return published_queue_stats.Load();
+}
+
+
+Latency::Stats
+PrimitiveReaderAndWriter::GetLatencyStats() const
+{
+  return latency->GetStats();
+}
+
+
 void
 PrimitiveReaderAndWriter::ReadFromTunAndWriteToSocket() try
 {
-  Encapsulator encapsulator(ClonePrototype());
+  auto sender = CreateSender();
   Packet::Data data;
+  Packet::Data dump;
 
-  while (running)
+  RestoreHandoffState(*sender);
+
+  while (running && !draining)
   {
-    if (!socket->IsConnected())
+    if (!socket->HasRemoteEndpoint())
     {
       usleep(500);
       continue;
     }
 
-    if (!socket->IsReadyToRead())
+    // queue everything waiting in TUN, so packets can overtake each other
+    for (int i = 0; i < MAX_TUN_READS_PER_ROUND && tuntap->IsReadyToRead(); i++)
     {
-      usleep(50);
-      continue;
-    }
-    
-    data.resize(150);
-    const int r = tuntap->Read(data.data(), data.size());
-    data.resize(r);
+      data.resize(TUN_BUFFER_SIZE);
+      const int r = tuntap->Read(data.data(), data.size());
+      data.resize(r);
 
-    auto packets = encapsulator.Encapsulate(data);
+      sender->Push(data, Sender::Clock::now());
+    }
 
-    auto last = ClonePrototype();
-    last->SetType(Packet::Type::CONTROL);
-    last->SetControlType(Packet::Control::END_OF_TRANSMISSION);
-    packets.push_back(move(last));
+    const auto start = Sender::Clock::now();
+    const bool ready = sender->Pull(dump, start);
+    UpdateQueueStats(*sender);
 
-    for (auto &packet : packets)
+    if (!ready)
     {
-      auto dump = packet->Dump();
-      socket->Write(dump.data(), dump.size());
+      usleep(50);
+      continue;
     }
+
+    latency->encode.Record(Sender::Clock::now() - start);
+    socket->Write(dump.data(), dump.size());
+  }
+
+  if (running)
+  {
+    DrainSender(*sender);
+    SaveHandoffState(*sender);
   }
 }
 catch (exception &ex) {
-  BOOST_LOG_TRIVIAL(fatal) << ex.what();
+  LOG(fatal) << ex.what();
   running = false;
 }
 
@@ -99,46 +264,330 @@ catch (exception &ex) {
 void
 PrimitiveReaderAndWriter::ReadFromSocketAndWriteToTun() try
 {
-  Encapsulator encapsulator(ClonePrototype());
-  vector<unique_ptr<Packet>> received_packets;
+  auto receiver = CreateReceiver();
+  vector<Packet::Data> packets;
   Packet::Data dump;
-  string address;
-  int port;
+  Endpoint source;
 
-  while (running)
+  RestoreHandoffState(*receiver);
+
+  while (running && !draining)
   {
+    UpdateSocketStats();
+
     if (!socket->IsReadyToRead())
     {
       usleep(50);
       continue;
     }
 
-    dump.resize(150);
-    const int r = socket->RecvFrom(dump.data(), dump.size(), address, port);
+    // longer datagrams aren't tunnel packets, truncated they fail to parse
+    dump.resize(PseudoDNS::MAX_DUMP_SIZE);
+    const int r = socket->RecvFrom(dump.data(), dump.size(), source);
     dump.resize(r);
 
-    if (!socket->IsConnected())
-      socket->Connect(address, port);
+    if (!AcceptPeer(source))
+      continue;
+
+    const auto start = Receiver::Clock::now();
+    receiver->Push(dump, packets, start);
+    latency->decode.Record(Receiver::Clock::now() - start);
 
-    auto packet = ClonePrototype();
-    packet->FillFromDump(dump);
+    SendReplies(*receiver);
 
-    if (packet->GetType() == Packet::Type::CONTROL)
-    {
-      Packet::Data data = encapsulator.Decapsulate(received_packets);
-      tuntap->Write(data.data(), data.size());
-      received_packets.clear();
-    }
-    else
-      received_packets.push_back(move(packet));
+    for (auto &p : packets)
+      tuntap->Write(p.data(), p.size());
+    packets.clear();
   }
+
+  if (running)
+    SaveHandoffState(*receiver);
 }
 catch (exception &ex) {
-  BOOST_LOG_TRIVIAL(fatal) << ex.what();
+  LOG(fatal) << ex.what();
   running = false;
 }
 
 
+void
+PrimitiveReaderAndWriter::LogQueueStats() const
+{
+  const QueueStats stats = GetQueueStats();
+  LOG(info) << "Queued packets: " << stats.enqueued
+            << ", sent: " << stats.dequeued
+            << ", tail dropped: " << stats.tail_dropped
+            << ", CoDel dropped: " << stats.codel_dropped
+            << ", ECN marked: " << stats.ecn_marked;
+}
+
+
+void
+PrimitiveReaderAndWriter::LogLatencyStats() const
+{
+  const Latency::Stats stats = GetLatencyStats();
+  const pair<const char*, const Metrics::Histogram::Summary*> stages[] {
+    { "TUN to socket", &stats.tun_to_socket },
+    { "encode", &stats.encode },
+    { "decode", &stats.decode },
+    { "reassembly", &stats.reassembly },
+    { "round trip", &stats.round_trip }
+  };
+
+  for (auto &stage : stages)
+  {
+    const Metrics::Histogram::Summary &s = *stage.second;
+    if (s.count == 0)
+      continue;
+
+    typedef chrono::microseconds us;
+    LOG(info) << "Latency of " << stage.first
+              << " [us] p50: " << chrono::duration_cast<us>(s.p50).count()
+              << ", p90: " << chrono::duration_cast<us>(s.p90).count()
+              << ", p99: " << chrono::duration_cast<us>(s.p99).count()
+              << ", p99.9: " << chrono::duration_cast<us>(s.p999).count()
+              << ", max: " << chrono::duration_cast<us>(s.max).count()
+              << " (" << s.count << " samples)";
+  }
+}
+
+
+bool
+PrimitiveReaderAndWriter::AcceptPeer(const Endpoint &source)
+{
+  if (!socket->HasRemoteEndpoint())
+  {
+    // connected socket would get datagrams of its peer regardless of the
+    // steering program of the reuseport group
+    if (socket->IsReusePort())
+      socket->SetRemoteEndpoint(source);
+    else
+      socket->Connect(source);
+    return true;
+  }
+
+  // kernel delivers only datagrams of the peer to a connected socket
+  if (socket->IsConnected() || source == socket->GetRemoteEndpoint())
+    return true;
+
+  // another client, or one which collides with the peer in steering
+  if (foreign_dropped.GetValue() == 0)
+    LOG(warning) << "Dropping datagrams from " << source.ToString()
+                 << ", the process serves " << socket->GetRemoteEndpoint().ToString()
+                 << " only.";
+  foreign_dropped.Add();
+  return false;
+}
+
+
+void
+PrimitiveReaderAndWriter::UpdateSocketStats()
+{
+  // attached to received datagrams, costs no system call
+  AddSocketDrops(socket->GetReportedDropCount());
+
+  const auto now = Receiver::Clock::now();
+  if (now - socket_buffers_time < SOCKET_BUFFERS_INTERVAL)
+    return;
+
+  socket_buffers_time = now;
+
+  const Socket::BufferStats buffers = socket->GetBufferStats();
+  receive_queued.Set(buffers.receive_queued);
+  receive_buffer.Set(buffers.receive_buffer);
+  send_queued.Set(buffers.send_queued);
+  send_buffer.Set(buffers.send_buffer);
+
+  if (now - socket_stats_time < SOCKET_STATS_INTERVAL)
+    return;
+
+  // the device outlives the process on handoff, only its new drops count
+  const uint64_t dropped = tuntap->GetKernelDropCount();
+  if (socket_stats_time != Receiver::Clock::time_point())
+    tun_kernel_dropped.Add(dropped - tun_dropped);
+  tun_dropped = dropped;
+
+  socket_stats_time = now;
+
+  // reported by datagrams only when something was dropped, and not at
+  // all without drop reporting
+  AddSocketDrops(socket->GetDropCount());
+}
+
+
+void
+PrimitiveReaderAndWriter::AddSocketDrops(const uint32_t &dropped)
+{
+  // Both sources read the same kernel counter, the one read last may be
+  // behind the other. It wraps around, so does the difference.
+  const uint32_t difference = dropped - socket_dropped;
+  if (difference == 0 || difference > numeric_limits<uint32_t>::max() / 2)
+    return;
+
+  kernel_dropped.Add(difference);
+  socket_dropped = dropped;
+}
+
+
+void
+PrimitiveReaderAndWriter::LogSocketStats() const
+{
+  LOG(info) << "Datagrams dropped by the kernel: " << socket->GetDropCount()
+            << ", packets dropped by the TUN device: " << tuntap->GetKernelDropCount();
+}
+
+
+void
+PrimitiveReaderAndWriter::SendReplies(Receiver &receiver)
+{
+  Packet::Data reply;
+
+  // sent from the receiving thread, so queues don't delay them
+  while (receiver.PullReply(reply))
+    socket->Write(reply.data(), reply.size());
+}
+
+
+void
+PrimitiveReaderAndWriter::DrainSender(Sender &sender)
+{
+  Packet::Data dump;
+
+  while (running && sender.HasPendingData() && !IsDrainTimedOut())
+  {
+    if (!sender.Pull(dump, Sender::Clock::now()))
+    {
+      usleep(50);
+      continue;
+    }
+
+    socket->Write(dump.data(), dump.size());
+  }
+
+  UpdateQueueStats(sender);
+}
+
+
+void
+PrimitiveReaderAndWriter::SaveHandoffState(const Sender &sender)
+{
+  lock_guard<mutex> lock(handoff_mutex);
+  handoff_state.next_stream_id = sender.GetNextStreamId();
+}
+
+
+void
+PrimitiveReaderAndWriter::RestoreHandoffState(Sender &sender)
+{
+  lock_guard<mutex> lock(handoff_mutex);
+
+  if (handoff_state.next_stream_id != 0)
+    sender.SetNextStreamId(handoff_state.next_stream_id);
+}
+
+
+void
+PrimitiveReaderAndWriter::SaveHandoffState(const Receiver &receiver)
+{
+  lock_guard<mutex> lock(handoff_mutex);
+  handoff_state.fragments = receiver.GetPendingFragments();
+
+  const Crypto::ReplayWindow &window = receiver.GetReplayWindow();
+  handoff_state.replay_epoch = window.IsStarted() ? window.GetEpoch() : 0;
+  handoff_state.replay_highest = window.GetHighest();
+  handoff_state.replay_seen = window.GetSeen();
+
+  LOG(info) << "Fragments of unfinished transmissions: " << handoff_state.fragments.size();
+}
+
+
+void
+PrimitiveReaderAndWriter::RestoreHandoffState(Receiver &receiver)
+{
+  lock_guard<mutex> lock(handoff_mutex);
+  vector<Packet::Data> packets;
+  const auto now = Receiver::Clock::now();
+
+  if (handoff_state.replay_epoch != 0)
+  {
+    Crypto::ReplayWindow window;
+    window.Restore(handoff_state.replay_epoch, handoff_state.replay_highest,
+                   handoff_state.replay_seen);
+    receiver.SetReplayWindow(window);
+  }
+
+  for (auto &fragment : handoff_state.fragments)
+    receiver.Push(fragment, packets, now);
+
+  handoff_state.fragments.clear();
+}
+
+
+bool
+PrimitiveReaderAndWriter::IsDrainTimedOut() const
+{
+  return Sender::Clock::now() > drain_deadline;
+}
+
+
+unique_ptr<Sender>
+PrimitiveReaderAndWriter::CreateSender()
+{
+  unique_ptr<Sender> sender(new Sender(ClonePrototype(), GetIpHeaderOffset()));
+
+  sender->SetAggregation(aggregate_size, aggregate_delay);
+  sender->SetQueueManagement(max_queue_size, codel_target, codel_interval);
+  sender->SetLatency(latency);
+  sender->SetEchoInterval(echo_interval);
+
+  if (encryption)
+    sender->SetEncryption(unique_ptr<Crypto::Aead>(new Crypto::Aead(cipher, send_key)));
+
+  return sender;
+}
+
+
+unique_ptr<Receiver>
+PrimitiveReaderAndWriter::CreateReceiver()
+{
+  unique_ptr<Receiver> receiver(new Receiver(ClonePrototype()));
+  receiver->SetLatency(latency);
+
+  if (encryption)
+    receiver->SetEncryption(unique_ptr<Crypto::Aead>(new Crypto::Aead(cipher, receive_key)));
+
+  return receiver;
+}
+
+
+void
+PrimitiveReaderAndWriter::UpdateQueueStats(const Sender &sender)
+{
+  const QueueStats stats = sender.GetQueueStats();
+
+  // counters get only what changed since the last update
+  enqueued.Add(stats.enqueued - queue_stats.enqueued);
+  dequeued.Add(stats.dequeued - queue_stats.dequeued);
+  tail_dropped.Add(stats.tail_dropped - queue_stats.tail_dropped);
+  codel_dropped.Add(stats.codel_dropped - queue_stats.codel_dropped);
+  ecn_marked.Add(stats.ecn_marked - queue_stats.ecn_marked);
+  queue_length.Set(stats.length);
+  sojourn_time.Set(stats.sojourn_time.count());
+
+  queue_stats = stats;
+  published_queue_stats.Store(stats);
+}
+
+
+size_t
+PrimitiveReaderAndWriter::GetIpHeaderOffset() const
+{
+  if (tuntap->GetType() == TunTap::InterfaceType::TAP)
+    return TunTap::PACKET_INFO_SIZE + TunTap::ETHERNET_HEADER_SIZE;
+
+  return TunTap::PACKET_INFO_SIZE;
+}
+
+
 unique_ptr<Packet>
 PrimitiveReaderAndWriter::ClonePrototype()
 {
@@ -6,11 +6,20 @@
 #ifndef _PRIMITIVEREADERANDWRITER_H_
 #define _PRIMITIVEREADERANDWRITER_H_
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
 
 #include "Interfaces/TunTap.h"
 #include "Interfaces/Socket.h"
 #include "Packets/Packet.h"
+#include "Scheduling/CoDelQueue.h"
+#include "Codec/Sender.h"
+#include "Codec/Receiver.h"
+#include "Codec/Latency.h"
+#include "Crypto/Aead.h"
+#include "Restart/State.h"
+#include "Pipeline/SeqLock.h"
 
 
 class PrimitiveReaderAndWriter
@@ -24,18 +33,115 @@ public:
   virtual void Run();
   virtual void Stop();
 
+  // Stops reading from TUN and socket, sends what is already queued and
+  // returns from Run(). The process taking over gets the descriptors and
+  // GetHandoffState(), unread packets stay in kernel buffers.
+  virtual void StopForHandoff();
+  virtual Restart::State GetHandoffState() const;
+  // state of the replaced process, has to be set before Run()
+  virtual void SetHandoffState(const Restart::State &state);
+
+  // max_delay equal to zero disables aggregation
+  virtual void SetAggregation(const std::size_t &max_frame_size,
+                              const std::chrono::microseconds &max_delay);
+
+  virtual void SetQueueManagement(const std::size_t &max_queue_size,
+                                  const std::chrono::microseconds &target,
+                                  const std::chrono::microseconds &interval);
+
+  // keys are derived separately for each tunnel direction
+  virtual void SetEncryption(const Crypto::Aead::Algorithm &algorithm,
+                             const Crypto::Aead::Key &send_key,
+                             const Crypto::Aead::Key &receive_key);
+
+  // zero disables echo requests, so the round trip time isn't measured
+  virtual void SetEchoInterval(const std::chrono::milliseconds &interval);
+
+  // queues between TUN reader and socket writer
+  virtual Scheduling::QueueStats GetQueueStats() const;
+
+  // p50, p90, p99 and p99.9 of every stage since the start
+  virtual Codec::Latency::Stats GetLatencyStats() const;
+
 protected:
   std::shared_ptr<Interfaces::TunTap> tuntap;
   std::shared_ptr<Interfaces::Socket> socket;
   std::shared_ptr<Packets::Packet> prototype;
   std::mutex prototype_mutex;
 
-  bool running;
+  // packet info + default MTU
+  static constexpr std::size_t TUN_BUFFER_SIZE = Interfaces::TunTap::PACKET_INFO_SIZE + 1500;
+  static constexpr int MAX_TUN_READS_PER_ROUND = 64;
+  // queued packets not sent in this time are lost on handoff
+  static constexpr std::chrono::seconds HANDOFF_DRAIN_TIMEOUT{1};
+  // how often kernel drop counts are read from the socket and the TUN
+  // device, and how often the socket buffers are sampled
+  static constexpr std::chrono::seconds SOCKET_STATS_INTERVAL{1};
+  static constexpr std::chrono::milliseconds SOCKET_BUFFERS_INTERVAL{100};
+
+  std::atomic<bool> running;
+  std::atomic<bool> draining;
+  // set before draining
+  Codec::Sender::Clock::time_point drain_deadline;
+
+  Restart::State handoff_state;
+  mutable std::mutex handoff_mutex;
+
+  std::size_t aggregate_size;
+  std::chrono::microseconds aggregate_delay;
+
+  std::size_t max_queue_size;
+  std::chrono::microseconds codel_target;
+  std::chrono::microseconds codel_interval;
+
+  bool encryption;
+  Crypto::Aead::Algorithm cipher;
+  Crypto::Aead::Key send_key;
+  Crypto::Aead::Key receive_key;
+
+  std::chrono::milliseconds echo_interval;
+
+  // the last stats of the thread which sends, and their copy for others
+  Scheduling::QueueStats queue_stats;
+  Pipeline::SeqLock<Scheduling::QueueStats> published_queue_stats;
+
+  std::shared_ptr<Codec::Latency> latency;
+
+  // updated by the socket reading thread only
+  std::uint32_t socket_dropped;
+  std::uint64_t tun_dropped;
+  Codec::Receiver::Clock::time_point socket_stats_time;
+  Codec::Receiver::Clock::time_point socket_buffers_time;
 
   // these functions don't work in all cases
   void ReadFromTunAndWriteToSocket();
   void ReadFromSocketAndWriteToTun();
 
+  std::unique_ptr<Codec::Sender> CreateSender();
+  std::unique_ptr<Codec::Receiver> CreateReceiver();
+  void UpdateQueueStats(const Codec::Sender &sender);
+  void LogQueueStats() const;
+  void LogLatencyStats() const;
+  // the first source of datagrams becomes the peer of the tunnel, false
+  // for datagrams of other sources: a process serves one client
+  bool AcceptPeer(const Interfaces::Endpoint &source);
+  void UpdateSocketStats();
+  void AddSocketDrops(const std::uint32_t &dropped);
+  void LogSocketStats() const;
+
+  void SendReplies(Codec::Receiver &receiver);
+
+  // handoff: sender of the stopped process sends what it has queued,
+  // receiver of the new process gets unfinished transmissions
+  void DrainSender(Codec::Sender &sender);
+  void SaveHandoffState(const Codec::Sender &sender);
+  void RestoreHandoffState(Codec::Sender &sender);
+  void SaveHandoffState(const Codec::Receiver &receiver);
+  void RestoreHandoffState(Codec::Receiver &receiver);
+  bool IsDrainTimedOut() const;
+
+  std::size_t GetIpHeaderOffset() const;
+
   std::unique_ptr<Packets::Packet> ClonePrototype();
 };
 
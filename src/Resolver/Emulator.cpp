@@ -0,0 +1,219 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Emulator.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace Interfaces;
+
+
+namespace Resolver
+{
+
+constexpr size_t Emulator::HEADER_SIZE;
+constexpr uint8_t Emulator::TRUNCATED_FLAG;
+
+
+Emulator::Config::Config() :
+  cache_ttl(0),
+  retry_timeout(800),
+  retries(2),
+  qps(0),
+  edns_size(1232),
+  rewrite_ids(false),
+  drop_unsolicited(false)
+{
+}
+
+
+Emulator::Emulator(const Config &config, const uint32_t &seed) :
+  config(config),
+  random(seed),
+  stats()
+{
+}
+
+
+void
+Emulator::OnQuery(const Endpoint &client_endpoint, const Data &query,
+                  const Clock::time_point &now, vector<Datagram> &output)
+{
+  stats.queries++;
+  Client &client = clients[client_endpoint];
+
+  if (IsRateLimited(client, now))
+  {
+    stats.rate_limited++;
+    return;
+  }
+
+  if (config.cache_ttl.count() > 0)
+  {
+    ExpireCache(now);
+
+    auto cached = cache.find(query);
+    if (cached != cache.end())
+    {
+      stats.cache_hits++;
+
+      // a query still being resolved gets nothing yet
+      if (cached->second.answered)
+        output.push_back(Datagram { false, client_endpoint, cached->second.response });
+      return;
+    }
+
+    cache[query] = CacheEntry { false, Data() };
+    cache_expiry.emplace_back(now + config.cache_ttl, query);
+  }
+
+  client.outstanding.push_back(Query { query, now + config.retry_timeout, 0 });
+  Forward(client_endpoint, client.outstanding.back(), output);
+  stats.forwarded++;
+}
+
+
+void
+Emulator::OnResponse(const Endpoint &client_endpoint, const Data &response,
+                     const Clock::time_point &now, vector<Datagram> &output)
+{
+  auto client = clients.find(client_endpoint);
+
+  if (client == clients.end() || client->second.outstanding.empty())
+  {
+    stats.unsolicited++;
+    if (!config.drop_unsolicited)
+      output.push_back(Datagram { false, client_endpoint, response });
+    return;
+  }
+
+  stats.responses++;
+  Query query = move(client->second.outstanding.front());
+  client->second.outstanding.pop_front();
+
+  Data answer = (response.size() > config.edns_size) ? Truncate(response) : response;
+  if (answer.size() != response.size())
+    stats.truncated++;
+
+  // the client sees its own ID, whatever was sent upstream
+  if (config.rewrite_ids && answer.size() >= 2 && query.data.size() >= 2)
+    copy(query.data.begin(), query.data.begin() + 2, answer.begin());
+
+  if (config.cache_ttl.count() > 0)
+  {
+    ExpireCache(now);
+
+    auto cached = cache.find(query.data);
+    if (cached != cache.end())
+      cached->second = CacheEntry { true, answer };
+  }
+
+  output.push_back(Datagram { false, client_endpoint, move(answer) });
+}
+
+
+void
+Emulator::OnTimer(const Clock::time_point &now, vector<Datagram> &output)
+{
+  for (auto &client : clients)
+  {
+    // retried queries go to the back, so the queue stays in the order
+    // of retry times
+    auto &outstanding = client.second.outstanding;
+
+    while (!outstanding.empty() && outstanding.front().retry_time <= now)
+    {
+      Query query = move(outstanding.front());
+      outstanding.pop_front();
+
+      if (query.retries >= config.retries)
+      {
+        stats.timed_out++;
+        continue;
+      }
+
+      query.retries++;
+      query.retry_time = now + config.retry_timeout;
+      Forward(client.first, query, output);
+      stats.retried++;
+      outstanding.push_back(move(query));
+    }
+  }
+}
+
+
+Emulator::Stats
+Emulator::GetStats() const
+{
+  return stats;
+}
+
+
+bool
+Emulator::IsRateLimited(Client &client, const Clock::time_point &now)
+{
+  if (config.qps == 0)
+    return false;
+
+  // a second worth of queries can come at once
+  if (client.refill_time == Clock::time_point())
+    client.tokens = config.qps;
+  else
+  {
+    const double elapsed = chrono::duration<double>(now - client.refill_time).count();
+    client.tokens = min<double>(config.qps, client.tokens + elapsed * config.qps);
+  }
+  client.refill_time = now;
+
+  if (client.tokens < 1)
+    return true;
+
+  client.tokens -= 1;
+  return false;
+}
+
+
+void
+Emulator::ExpireCache(const Clock::time_point &now)
+{
+  while (!cache_expiry.empty() && cache_expiry.front().first <= now)
+  {
+    cache.erase(cache_expiry.front().second);
+    cache_expiry.pop_front();
+  }
+}
+
+
+void
+Emulator::Forward(const Endpoint &client, const Query &query, vector<Datagram> &output)
+{
+  Data data = query.data;
+
+  // every transmission gets a new ID, like from a resolver choosing them
+  // at random
+  if (config.rewrite_ids && data.size() >= 2)
+  {
+    const uint16_t id = random();
+    data[0] = id >> 8;
+    data[1] = id;
+  }
+
+  output.push_back(Datagram { true, client, move(data) });
+}
+
+
+Emulator::Data
+Emulator::Truncate(const Data &response) const
+{
+  Data truncated(response.begin(), response.begin() + min(HEADER_SIZE, response.size()));
+
+  if (truncated.size() > 2)
+    truncated[2] |= TRUNCATED_FLAG;
+
+  return truncated;
+}
+
+}
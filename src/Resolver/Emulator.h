@@ -0,0 +1,136 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../Interfaces/Endpoint.h"
+
+#ifndef _EMULATOR_H_
+#define _EMULATOR_H_
+
+
+namespace Resolver
+{
+
+/*
+ * What a caching recursive resolver does to the datagrams of a DNS
+ * tunnel, without the sockets, so it can be tested on its own clock:
+ *
+ * - identical queries within the cache TTL aren't forwarded, the client
+ *   gets the response remembered for the first one (if any) again,
+ * - queries above the per-client rate are dropped,
+ * - forwarded queries not answered within the retry timeout are sent
+ *   again, up to the retry limit,
+ * - responses above the EDNS size reach the client truncated: the
+ *   header with the TC flag and nothing else,
+ * - the ID of forwarded queries can be replaced, responses get the
+ *   client's ID back.
+ *
+ * The tunnel isn't strictly query and response, so every datagram from
+ * the server is taken as the response to the oldest outstanding query of
+ * its client; unsolicited ones are passed or dropped as configured.
+ */
+class Emulator
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::vector<std::uint8_t> Data;
+
+  static constexpr std::size_t HEADER_SIZE = 12;
+  static constexpr std::uint8_t TRUNCATED_FLAG = 0x02;
+
+  struct Config
+  {
+    // zero disables the cache
+    std::chrono::milliseconds cache_ttl;
+    std::chrono::milliseconds retry_timeout;
+    unsigned retries;
+    // queries per second of one client, zero is unlimited
+    unsigned qps;
+    std::size_t edns_size;
+    bool rewrite_ids;
+    bool drop_unsolicited;
+
+    Config();
+  };
+
+  struct Stats
+  {
+    std::uint64_t queries;
+    std::uint64_t forwarded;
+    std::uint64_t cache_hits;
+    std::uint64_t rate_limited;
+    std::uint64_t retried;
+    std::uint64_t timed_out;
+    std::uint64_t responses;
+    std::uint64_t unsolicited;
+    std::uint64_t truncated;
+  };
+
+  struct Datagram
+  {
+    bool to_server;
+    Interfaces::Endpoint client;
+    Data data;
+  };
+
+  Emulator(const Config &config, const std::uint32_t &seed);
+
+  // each call appends datagrams to send to output
+  void OnQuery(const Interfaces::Endpoint &client, const Data &query,
+               const Clock::time_point &now, std::vector<Datagram> &output);
+  void OnResponse(const Interfaces::Endpoint &client, const Data &response,
+                  const Clock::time_point &now, std::vector<Datagram> &output);
+  // retries due queries
+  void OnTimer(const Clock::time_point &now, std::vector<Datagram> &output);
+
+  Stats GetStats() const;
+
+private:
+  struct Query
+  {
+    // as received from the client, the cache key
+    Data data;
+    Clock::time_point retry_time;
+    unsigned retries;
+  };
+
+  struct Client
+  {
+    double tokens;
+    Clock::time_point refill_time;
+    std::deque<Query> outstanding;
+  };
+
+  struct CacheEntry
+  {
+    bool answered;
+    Data response;
+  };
+
+  Config config;
+  std::mt19937 random;
+  std::map<Interfaces::Endpoint, Client> clients;
+  std::map<Data, CacheEntry> cache;
+  // keys in the order they expire, all entries live the same time
+  std::deque<std::pair<Clock::time_point, Data>> cache_expiry;
+  Stats stats;
+
+  bool IsRateLimited(Client &client, const Clock::time_point &now);
+  void ExpireCache(const Clock::time_point &now);
+  void Forward(const Interfaces::Endpoint &client, const Query &query, std::vector<Datagram> &output);
+  Data Truncate(const Data &response) const;
+};
+
+}
+
+#endif
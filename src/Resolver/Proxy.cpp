@@ -0,0 +1,143 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Proxy.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../Interfaces/InterfaceException.h"
+#include "../Logging/Log.h"
+
+using namespace std;
+using namespace Interfaces;
+
+
+namespace Resolver
+{
+
+constexpr size_t Proxy::MAX_DATAGRAM_SIZE;
+
+
+Proxy::Proxy(const Endpoint &listen, const Endpoint &server,
+             const Emulator::Config &config, const uint32_t &seed) :
+  server(server),
+  emulator(config, seed),
+  running(false)
+{
+  socket = CreateSocket();
+  socket->Bind(listen);
+}
+
+
+Proxy::~Proxy()
+{
+  socket->Close();
+
+  for (auto &u : upstream)
+    u.second->Close();
+}
+
+
+Endpoint
+Proxy::GetLocalEndpoint() const
+{
+  return socket->GetLocalEndpoint();
+}
+
+
+void
+Proxy::Run()
+{
+  vector<uint8_t> buffer(MAX_DATAGRAM_SIZE);
+
+  running = true;
+  while (running)
+    if (!Poll(buffer))
+      usleep(20);
+}
+
+
+void
+Proxy::Stop()
+{
+  running = false;
+}
+
+
+Emulator::Stats
+Proxy::GetStats() const
+{
+  lock_guard<mutex> lock(emulator_mutex);
+  return emulator.GetStats();
+}
+
+
+bool
+Proxy::Poll(vector<uint8_t> &buffer)
+{
+  lock_guard<mutex> lock(emulator_mutex);
+  vector<Emulator::Datagram> output;
+  bool received = false;
+  Endpoint source;
+
+  if (socket->IsReadyToRead())
+  {
+    const size_t n = socket->RecvFrom(buffer.data(), buffer.size(), source);
+    emulator.OnQuery(source, Emulator::Data(buffer.begin(), buffer.begin() + n),
+                     Emulator::Clock::now(), output);
+    received = true;
+  }
+
+  for (auto &u : upstream)
+    if (u.second->IsReadyToRead())
+    {
+      const size_t n = u.second->RecvFrom(buffer.data(), buffer.size(), source);
+      emulator.OnResponse(u.first, Emulator::Data(buffer.begin(), buffer.begin() + n),
+                          Emulator::Clock::now(), output);
+      received = true;
+    }
+
+  emulator.OnTimer(Emulator::Clock::now(), output);
+  Send(output);
+
+  return received;
+}
+
+
+unique_ptr<Socket>
+Proxy::CreateSocket() const
+{
+  return Socket::Create(server.GetFamily() == AF_INET6 ? Socket::DomainType::INET6
+                                                       : Socket::DomainType::INET,
+                        Socket::SocketType::DGRAM);
+}
+
+
+void
+Proxy::Send(vector<Emulator::Datagram> &datagrams)
+{
+  for (auto &d : datagrams)
+  {
+    if (!d.to_server)
+    {
+      socket->SendTo(d.data.data(), d.data.size(), d.client);
+      continue;
+    }
+
+    auto u = upstream.find(d.client);
+    if (u == upstream.end())
+    {
+      LOG(info) << "New client of the resolver: " << d.client.ToString();
+      u = upstream.emplace(d.client, CreateSocket()).first;
+    }
+
+    // unconnected, so a server not listening yet doesn't make the next
+    // receive fail
+    u->second->SendTo(d.data.data(), d.data.size(), server);
+  }
+}
+
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "Emulator.h"
+#include "../Interfaces/Endpoint.h"
+#include "../Interfaces/Socket.h"
+
+#ifndef _PROXY_H_
+#define _PROXY_H_
+
+
+namespace Resolver
+{
+
+/*
+ * The Emulator on UDP sockets, to put between a tunnel client and its
+ * server. Queries of any number of clients come to one socket, every
+ * client is forwarded from its own socket, so the server tells them
+ * apart as it does behind a real resolver.
+ */
+class Proxy : private boost::noncopyable
+{
+public:
+  static constexpr std::size_t MAX_DATAGRAM_SIZE = 65536;
+
+  Proxy(const Interfaces::Endpoint &listen, const Interfaces::Endpoint &server,
+        const Emulator::Config &config, const std::uint32_t &seed);
+  ~Proxy();
+
+  // e.g. the port chosen by the kernel
+  Interfaces::Endpoint GetLocalEndpoint() const;
+
+  void Run();
+  void Stop();
+
+  Emulator::Stats GetStats() const;
+
+private:
+  std::unique_ptr<Interfaces::Socket> socket;
+  Interfaces::Endpoint server;
+  std::map<Interfaces::Endpoint, std::unique_ptr<Interfaces::Socket>> upstream;
+
+  Emulator emulator;
+  mutable std::mutex emulator_mutex;
+  std::atomic<bool> running;
+
+  // one round of receiving and sending, false when nothing came
+  bool Poll(std::vector<std::uint8_t> &buffer);
+  std::unique_ptr<Interfaces::Socket> CreateSocket() const;
+  void Send(std::vector<Emulator::Datagram> &datagrams);
+};
+
+}
+
+#endif
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "HotRestart.h"
+#include "HandoffException.h"
+#include "../Logging/Log.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Restart
+{
+
+constexpr size_t HotRestart::MAX_DESCRIPTORS;
+
+
+namespace
+{
+
+sockaddr_un
+ToAddress(const string &path)
+{
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (path.empty() || path.size() >= sizeof(address.sun_path))
+    throw HandoffException("Invalid handoff socket path: " + path);
+
+  memcpy(address.sun_path, path.data(), path.size());
+  return address;
+}
+
+}
+
+
+HotRestart::HotRestart(const string &path) :
+  path(path),
+  listen_fd(-1),
+  connection_fd(-1)
+{
+}
+
+
+HotRestart::~HotRestart()
+{
+  Close();
+}
+
+
+void
+HotRestart::Listen()
+{
+  const sockaddr_un address = ToAddress(path);
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0)
+    throw HandoffException(strerror(errno));
+
+  unlink(path.c_str());
+  if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+      || listen(listen_fd, 1) < 0)
+    throw HandoffException(strerror(errno));
+
+  LOG(info) << "Waiting for hot restart requests on " << path;
+}
+
+
+bool
+HotRestart::WaitForRequest(const chrono::milliseconds &timeout)
+{
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(listen_fd, &fds);
+
+  timeval tv;
+  tv.tv_sec = timeout.count() / 1000;
+  tv.tv_usec = (timeout.count() % 1000) * 1000;
+
+  const int r = select(listen_fd + 1, &fds, nullptr, nullptr, &tv);
+  if (r < 0 && errno != EINTR)
+    throw HandoffException(strerror(errno));
+
+  if (r <= 0)
+    return false;
+
+  connection_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+  if (connection_fd < 0)
+    throw HandoffException(strerror(errno));
+
+  LOG(info) << "Hot restart requested.";
+  return true;
+}
+
+
+void
+HotRestart::Handoff(const vector<int> &descriptors, const Packet::Data &state)
+{
+  if (descriptors.size() > MAX_DESCRIPTORS)
+    throw HandoffException("Too many descriptors to hand off.");
+
+  // descriptors go with the state length, the state follows
+  const uint32_t size = state.size();
+  const uint8_t header[] = {
+    static_cast<uint8_t>(size >> 24), static_cast<uint8_t>(size >> 16),
+    static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size)
+  };
+
+  iovec iov;
+  iov.iov_base = const_cast<uint8_t*>(header);
+  iov.iov_len = sizeof(header);
+
+  char control[CMSG_SPACE(MAX_DESCRIPTORS * sizeof(int))];
+  memset(control, 0, sizeof(control));
+
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = CMSG_SPACE(descriptors.size() * sizeof(int));
+
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(descriptors.size() * sizeof(int));
+  memcpy(CMSG_DATA(cmsg), descriptors.data(), descriptors.size() * sizeof(int));
+
+  if (sendmsg(connection_fd, &message, MSG_NOSIGNAL) != sizeof(header))
+    throw HandoffException(strerror(errno));
+
+  WriteAll(state.data(), state.size());
+
+  LOG(info) << "Handed off " << descriptors.size() << " descriptors and "
+            << state.size() << " bytes of state.";
+}
+
+
+void
+HotRestart::TakeOver(vector<int> &descriptors, Packet::Data &state)
+{
+  Connect();
+
+  uint8_t header[4];
+  iovec iov;
+  iov.iov_base = header;
+  iov.iov_len = sizeof(header);
+
+  char control[CMSG_SPACE(MAX_DESCRIPTORS * sizeof(int))];
+
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  const ssize_t r = recvmsg(connection_fd, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+  if (r < 0)
+    throw HandoffException(strerror(errno));
+  if (r != sizeof(header))
+    throw HandoffException("Running process closed the handoff connection.");
+
+  descriptors.clear();
+  for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg))
+  {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const int *fds = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+    descriptors.insert(descriptors.end(), fds, fds + count);
+  }
+
+  if (message.msg_flags & MSG_CTRUNC)
+  {
+    for (auto &fd : descriptors)
+      close(fd);
+
+    throw HandoffException("Handed off descriptors were truncated.");
+  }
+
+  state.resize((uint32_t(header[0]) << 24) | (header[1] << 16) | (header[2] << 8) | header[3]);
+  ReadAll(state.data(), state.size());
+
+  LOG(info) << "Took over " << descriptors.size() << " descriptors and "
+            << state.size() << " bytes of state.";
+}
+
+
+void
+HotRestart::Close()
+{
+  if (connection_fd != -1)
+    close(connection_fd);
+
+  if (listen_fd != -1)
+    close(listen_fd);
+
+  connection_fd = -1;
+  listen_fd = -1;
+}
+
+
+void
+HotRestart::Connect()
+{
+  const sockaddr_un address = ToAddress(path);
+
+  connection_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (connection_fd < 0)
+    throw HandoffException(strerror(errno));
+
+  LOG(info) << "Requesting hot restart from the process listening on " << path;
+  if (connect(connection_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0)
+    throw HandoffException(path + ": " + strerror(errno));
+}
+
+
+void
+HotRestart::WriteAll(const void *source, const size_t &size)
+{
+  const uint8_t *p = static_cast<const uint8_t*>(source);
+  size_t written = 0;
+
+  while (written < size)
+  {
+    const ssize_t r = send(connection_fd, p + written, size - written, MSG_NOSIGNAL);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r < 0)
+      throw HandoffException(strerror(errno));
+
+    written += r;
+  }
+}
+
+
+void
+HotRestart::ReadAll(void *destination, const size_t &size)
+{
+  uint8_t *p = static_cast<uint8_t*>(destination);
+  size_t received = 0;
+
+  while (received < size)
+  {
+    const ssize_t r = recv(connection_fd, p + received, size - received, 0);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r < 0)
+      throw HandoffException(strerror(errno));
+    if (r == 0)
+      throw HandoffException("Running process closed the handoff connection.");
+
+    received += r;
+  }
+}
+
+}
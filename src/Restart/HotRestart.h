@@ -0,0 +1,61 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "../Packets/Packet.h"
+
+#ifndef _HOTRESTART_H_
+#define _HOTRESTART_H_
+
+
+namespace Restart
+{
+
+/*
+ * Upgrade without closing the tunnel. The running process listens on a
+ * Unix socket, the new process connects to it with TakeOver(). The
+ * running process stops reading, sends what it has queued, then passes
+ * its descriptors (SCM_RIGHTS) and serialized state with Handoff() and
+ * exits. Packets and datagrams arriving meanwhile wait in the kernel
+ * buffers of the same TUN device and socket.
+ */
+class HotRestart : private boost::noncopyable
+{
+public:
+  static constexpr std::size_t MAX_DESCRIPTORS = 8;
+
+  explicit HotRestart(const std::string &path);
+  ~HotRestart();
+
+  // running process side, replaces socket file left by the previous process
+  void Listen();
+  // true when the new process connected, waits at most timeout
+  bool WaitForRequest(const std::chrono::milliseconds &timeout);
+  void Handoff(const std::vector<int> &descriptors, const Packets::Packet::Data &state);
+
+  // new process side, blocks until the running process hands off,
+  // received descriptors belong to the caller
+  void TakeOver(std::vector<int> &descriptors, Packets::Packet::Data &state);
+
+  void Close();
+
+private:
+  std::string path;
+  int listen_fd;
+  int connection_fd;
+
+  void Connect();
+  void WriteAll(const void *source, const std::size_t &size);
+  void ReadAll(void *destination, const std::size_t &size);
+};
+
+}
+
+#endif
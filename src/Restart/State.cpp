@@ -0,0 +1,153 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "State.h"
+#include "HandoffException.h"
+
+#include <cstring>
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Restart
+{
+
+namespace
+{
+
+// "SDST" and version of the format
+constexpr uint8_t HEADER[] = { 0x53, 0x44, 0x53, 0x54, 0x02 };
+
+
+void
+PutNumber(Packet::Data &data, const uint64_t &value, const size_t &size)
+{
+  for (size_t i = size; i > 0; i--)
+    data.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+}
+
+
+class Reader
+{
+public:
+  Reader(const Packet::Data &data) :
+    data(data),
+    position(0)
+  {
+  }
+
+  uint64_t GetNumber(const size_t &size)
+  {
+    uint64_t value = 0;
+    for (auto &b : GetBytes(size))
+      value = (value << 8) | b;
+
+    return value;
+  }
+
+  Packet::Data GetBytes(const size_t &size)
+  {
+    if (data.size() - position < size)
+      throw HandoffException("Handed over state is truncated.");
+
+    Packet::Data bytes(data.begin() + position, data.begin() + position + size);
+    position += size;
+    return bytes;
+  }
+
+  bool IsAtEnd() const
+  {
+    return position == data.size();
+  }
+
+private:
+  const Packet::Data &data;
+  size_t position;
+};
+
+}
+
+
+State::State() :
+  session_id(0),
+  next_stream_id(0),
+  replay_epoch(0),
+  replay_highest(0)
+{
+}
+
+
+Packet::Data
+State::Serialize() const
+{
+  Packet::Data data(begin(HEADER), end(HEADER));
+
+  PutNumber(data, session_id, 2);
+
+  PutNumber(data, peer.GetLength(), 1);
+  const uint8_t *address = reinterpret_cast<const uint8_t*>(peer.GetSockaddr());
+  data.insert(data.end(), address, address + peer.GetLength());
+
+  PutNumber(data, fragments.size(), 4);
+  for (auto &f : fragments)
+  {
+    PutNumber(data, f.size(), 2);
+    data.insert(data.end(), f.begin(), f.end());
+  }
+
+  PutNumber(data, next_stream_id, 2);
+  PutNumber(data, replay_epoch, 8);
+  PutNumber(data, replay_highest, 8);
+  for (size_t i = 0; i < replay_seen.size(); i += 8)
+  {
+    uint8_t bits = 0;
+    for (size_t b = 0; b < 8; b++)
+      bits |= replay_seen[i + b] << b;
+    data.push_back(bits);
+  }
+
+  return data;
+}
+
+
+State
+State::Deserialize(const Packet::Data &data)
+{
+  Reader reader(data);
+  State state;
+
+  const Packet::Data header = reader.GetBytes(sizeof(HEADER));
+  if (memcmp(header.data(), HEADER, sizeof(HEADER)) != 0)
+    throw HandoffException("Handed over state has unknown format.");
+
+  state.session_id = reader.GetNumber(2);
+
+  const Packet::Data address = reader.GetBytes(reader.GetNumber(1));
+  if (address.size() > Interfaces::Endpoint::GetCapacity())
+    throw HandoffException("Handed over peer address is too long.");
+
+  if (!address.empty())
+    state.peer = Interfaces::Endpoint(reinterpret_cast<const sockaddr*>(address.data()),
+                                      address.size());
+
+  const uint32_t count = reader.GetNumber(4);
+  for (uint32_t i = 0; i < count; i++)
+    state.fragments.push_back(reader.GetBytes(reader.GetNumber(2)));
+
+  state.next_stream_id = reader.GetNumber(2);
+  state.replay_epoch = reader.GetNumber(8);
+  state.replay_highest = reader.GetNumber(8);
+  const Packet::Data seen = reader.GetBytes(state.replay_seen.size() / 8);
+  for (size_t i = 0; i < state.replay_seen.size(); i++)
+    state.replay_seen[i] = (seen[i / 8] >> (i % 8)) & 1;
+
+  if (!reader.IsAtEnd())
+    throw HandoffException("Handed over state has trailing data.");
+
+  return state;
+}
+
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+#include "../Interfaces/Endpoint.h"
+#include "../Packets/Packet.h"
+#include "../Crypto/ReplayWindow.h"
+
+#ifndef _STATE_H_
+#define _STATE_H_
+
+
+namespace Restart
+{
+
+/*
+ * Tunnel state which isn't kept by the kernel with the TUN and socket
+ * descriptors, handed over to the process replacing this one.
+ */
+struct State
+{
+  // peer of an unconnected socket, connected socket keeps it itself
+  Interfaces::Endpoint peer;
+  std::uint16_t session_id;
+  // fragments of unfinished transmissions, in the order they came,
+  // the new Receiver gets them again
+  std::vector<Packets::Packet::Data> fragments;
+  // stream id of the next flow of the Sender, 0 when not known
+  std::uint16_t next_stream_id;
+  // replay window of the Receiver, so the new one rejects frames opened
+  // before; epoch 0 when it didn't start
+  std::uint64_t replay_epoch;
+  std::uint64_t replay_highest;
+  std::bitset<Crypto::ReplayWindow::SIZE> replay_seen;
+
+  State();
+
+  Packets::Packet::Data Serialize() const;
+  // throws HandoffException when data is damaged or of other version
+  static State Deserialize(const Packets::Packet::Data &data);
+};
+
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Classifier.h"
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Scheduling
+{
+
+namespace
+{
+
+constexpr uint8_t PROTOCOL_TCP = 6;
+constexpr uint8_t PROTOCOL_UDP = 17;
+constexpr size_t IPV4_MIN_HEADER_SIZE = 20;
+constexpr size_t IPV6_HEADER_SIZE = 40;
+constexpr size_t TCP_MIN_HEADER_SIZE = 20;
+constexpr size_t PORTS_SIZE = 4;
+
+
+// FNV-1a
+size_t
+Hash(size_t hash, const uint8_t *bytes, const size_t &size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+}
+
+
+Classifier::Classifier(const size_t &ip_header_offset) :
+  ip_header_offset(ip_header_offset)
+{
+}
+
+
+TrafficClass
+Classifier::Classify(const Packet::Data &packet) const
+{
+  if (packet.size() < ip_header_offset + IPV4_MIN_HEADER_SIZE)
+    return TrafficClass::DEFAULT;
+
+  const uint8_t *ip = packet.data() + ip_header_offset;
+  const size_t available = packet.size() - ip_header_offset;
+  const uint8_t version = ip[0] >> 4;
+
+  uint8_t dscp;
+  size_t ip_size;
+  size_t header_size;
+  bool is_tcp;
+
+  if (version == 4)
+  {
+    header_size = (ip[0] & 0x0F) * 4;
+    dscp = ip[1] >> 2;
+    ip_size = (ip[2] << 8) | ip[3];
+
+    const bool is_fragment = ((ip[6] & 0x1F) | ip[7]) != 0;
+    is_tcp = ip[9] == PROTOCOL_TCP && !is_fragment;
+  }
+  else if (version == 6 && available >= IPV6_HEADER_SIZE)
+  {
+    header_size = IPV6_HEADER_SIZE;
+    dscp = ((ip[0] & 0x0F) << 2) | (ip[1] >> 6);
+    ip_size = IPV6_HEADER_SIZE + ((ip[4] << 8) | ip[5]);
+    is_tcp = ip[6] == PROTOCOL_TCP;
+  }
+  else
+    return TrafficClass::DEFAULT;
+
+  if (header_size < IPV4_MIN_HEADER_SIZE || ip_size > available || ip_size < header_size)
+    return TrafficClass::DEFAULT;
+
+  const TrafficClass marked = ClassifyDSCP(dscp);
+  if (marked != TrafficClass::DEFAULT)
+    return marked;
+
+  if (is_tcp && IsTcpWithoutPayload(ip + header_size, ip_size - header_size))
+    return TrafficClass::ACK;
+
+  if (ip_size <= SMALL_PACKET_SIZE)
+    return TrafficClass::INTERACTIVE;
+
+  if (ip_size >= BULK_PACKET_SIZE)
+    return TrafficClass::BULK;
+
+  return TrafficClass::DEFAULT;
+}
+
+
+size_t
+Classifier::GetFlow(const Packet::Data &packet) const
+{
+  if (packet.size() < ip_header_offset + IPV4_MIN_HEADER_SIZE)
+    return 0;
+
+  const uint8_t *ip = packet.data() + ip_header_offset;
+  const size_t available = packet.size() - ip_header_offset;
+  const uint8_t version = ip[0] >> 4;
+
+  size_t hash = 14695981039346656037ULL;
+  size_t header_size;
+  uint8_t protocol;
+
+  if (version == 4)
+  {
+    header_size = (ip[0] & 0x0F) * 4;
+    protocol = ip[9];
+    hash = Hash(hash, ip + 12, 8);
+
+    // only first fragment carries ports
+    if (((ip[6] & 0x1F) | ip[7]) != 0)
+      protocol = 0;
+  }
+  else if (version == 6 && available >= IPV6_HEADER_SIZE)
+  {
+    header_size = IPV6_HEADER_SIZE;
+    protocol = ip[6];
+    hash = Hash(hash, ip + 8, 32);
+  }
+  else
+    return 0;
+
+  hash = Hash(hash, &protocol, 1);
+
+  if ((protocol == PROTOCOL_TCP || protocol == PROTOCOL_UDP)
+      && header_size + PORTS_SIZE <= available)
+    hash = Hash(hash, ip + header_size, PORTS_SIZE);
+
+  return hash == 0 ? 1 : hash;
+}
+
+
+TrafficClass
+Classifier::ClassifyDSCP(const uint8_t &dscp)
+{
+  switch (dscp)
+  {
+  case 46: // EF
+  case 40: // CS5
+  case 48: // CS6
+  case 56: // CS7
+  case 34: // AF41
+  case 36: // AF42
+  case 38: // AF43
+    return TrafficClass::INTERACTIVE;
+
+  case 1:  // LE
+  case 8:  // CS1
+    return TrafficClass::BULK;
+  }
+
+  return TrafficClass::DEFAULT;
+}
+
+
+bool
+Classifier::IsTcpWithoutPayload(const uint8_t *tcp_header, const size_t &segment_size)
+{
+  if (segment_size < TCP_MIN_HEADER_SIZE)
+    return false;
+
+  const size_t tcp_header_size = (tcp_header[12] >> 4) * 4;
+  return tcp_header_size >= TCP_MIN_HEADER_SIZE && tcp_header_size == segment_size;
+}
+
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+
+#include "TrafficClass.h"
+#include "../Packets/Packet.h"
+
+#ifndef _CLASSIFIER_H_
+#define _CLASSIFIER_H_
+
+
+namespace Scheduling
+{
+
+/*
+ * Looks into inner IPv4/IPv6 and TCP headers and picks traffic class:
+ *  - INTERACTIVE - DSCP EF, CS5-CS7, AF4x or small packets,
+ *  - ACK - TCP segments without payload,
+ *  - BULK - DSCP CS1, LE or big packets,
+ *  - DEFAULT - everything else, including packets which can't be parsed.
+ */
+class Classifier
+{
+public:
+  static constexpr std::size_t SMALL_PACKET_SIZE = 128;
+  static constexpr std::size_t BULK_PACKET_SIZE = 1000;
+
+  // ip_header_offset - number of bytes before IP header (e.g. TUN packet info)
+  Classifier(const std::size_t &ip_header_offset = 0);
+  virtual ~Classifier() = default;
+
+  virtual TrafficClass Classify(const Packets::Packet::Data &packet) const;
+
+  // hash of addresses, protocol and ports, zero when packet can't be parsed
+  virtual std::size_t GetFlow(const Packets::Packet::Data &packet) const;
+
+protected:
+  std::size_t ip_header_offset;
+
+  static TrafficClass ClassifyDSCP(const std::uint8_t &dscp);
+  static bool IsTcpWithoutPayload(const std::uint8_t *tcp_header,
+                                  const std::size_t &segment_size);
+};
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "CoDelQueue.h"
+#include "Ecn.h"
+
+#include <cmath>
+#include <utility>
+
+using namespace std;
+using namespace std::chrono;
+using namespace Packets;
+
+
+namespace Scheduling
+{
+
+constexpr size_t CoDelQueue::DEFAULT_MAX_SIZE;
+constexpr microseconds CoDelQueue::DEFAULT_TARGET;
+constexpr microseconds CoDelQueue::DEFAULT_INTERVAL;
+
+
+CoDelQueue::CoDelQueue(const size_t &ip_header_offset,
+                       const size_t &max_size,
+                       const microseconds &target,
+                       const microseconds &interval) :
+  ip_header_offset(ip_header_offset),
+  max_size(max_size),
+  target(target),
+  interval(interval),
+  stats(),
+  dropping(false),
+  count(0),
+  last_count(0)
+{
+}
+
+
+bool
+CoDelQueue::Enqueue(Packet::Data &&packet, const Clock::time_point &now)
+{
+  if (entries.size() >= max_size)
+  {
+    stats.tail_dropped++;
+    return false;
+  }
+
+  entries.push_back(Entry { move(packet), now });
+  stats.enqueued++;
+
+  return true;
+}
+
+
+bool
+CoDelQueue::Dequeue(Packet::Data &packet, const Clock::time_point &now)
+{
+  Entry entry;
+  bool ok_to_drop;
+
+  if (!DoDequeue(entry, now, ok_to_drop))
+  {
+    dropping = false;
+    return false;
+  }
+
+  if (dropping)
+  {
+    if (!ok_to_drop)
+      dropping = false;
+
+    while (dropping && now >= drop_next)
+    {
+      count++;
+      drop_next = ControlLaw(drop_next);
+
+      if (!Drop(entry))
+        break;
+
+      if (!DoDequeue(entry, now, ok_to_drop))
+      {
+        dropping = false;
+        return false;
+      }
+
+      if (!ok_to_drop)
+        dropping = false;
+    }
+  }
+  else if (ok_to_drop)
+  {
+    bool have_entry = true;
+    if (Drop(entry))
+      have_entry = DoDequeue(entry, now, ok_to_drop);
+
+    dropping = true;
+    const unsigned delta = count - last_count;
+    count = (delta > 1 && now - drop_next < 16 * interval) ? delta : 1;
+    last_count = count;
+    drop_next = ControlLaw(now);
+
+    if (!have_entry)
+      return false;
+  }
+
+  stats.dequeued++;
+  stats.sojourn_time = duration_cast<microseconds>(now - entry.enqueue_time);
+  packet = move(entry.packet);
+
+  return true;
+}
+
+
+bool
+CoDelQueue::IsEmpty() const
+{
+  return entries.empty();
+}
+
+
+size_t
+CoDelQueue::GetSize() const
+{
+  return entries.size();
+}
+
+
+QueueStats
+CoDelQueue::GetStats() const
+{
+  QueueStats s = stats;
+  s.length = entries.size();
+
+  return s;
+}
+
+
+bool
+CoDelQueue::DoDequeue(Entry &entry, const Clock::time_point &now, bool &ok_to_drop)
+{
+  ok_to_drop = false;
+
+  if (entries.empty())
+  {
+    first_above_time = Clock::time_point();
+    return false;
+  }
+
+  entry = move(entries.front());
+  entries.pop_front();
+
+  const auto sojourn_time = now - entry.enqueue_time;
+  if (sojourn_time < target || entries.empty())
+    first_above_time = Clock::time_point();
+  else if (first_above_time == Clock::time_point())
+    first_above_time = now + interval;
+  else if (now >= first_above_time)
+    ok_to_drop = true;
+
+  return true;
+}
+
+
+bool
+CoDelQueue::Drop(Entry &entry)
+{
+  if (Ecn::MarkCongestionExperienced(entry.packet, ip_header_offset))
+  {
+    stats.ecn_marked++;
+    return false;
+  }
+
+  stats.codel_dropped++;
+  return true;
+}
+
+
+CoDelQueue::Clock::time_point
+CoDelQueue::ControlLaw(const Clock::time_point &t) const
+{
+  return t + duration_cast<Clock::duration>(interval / sqrt(static_cast<double>(count)));
+}
+
+}
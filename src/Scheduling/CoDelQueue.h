@@ -0,0 +1,90 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "../Packets/Packet.h"
+
+#ifndef _CODELQUEUE_H_
+#define _CODELQUEUE_H_
+
+
+namespace Scheduling
+{
+
+struct QueueStats
+{
+  std::uint64_t enqueued;
+  std::uint64_t dequeued;
+  std::uint64_t tail_dropped;
+  std::uint64_t codel_dropped;
+  std::uint64_t ecn_marked;
+  std::size_t length;
+  std::chrono::microseconds sojourn_time; // of the last dequeued packet
+};
+
+
+/*
+ * Bounded FIFO with CoDel active queue management (RFC 8289). When
+ * packets stay in the queue longer than 'target' for at least
+ * 'interval', packets are dropped from the head or, when inner packet is
+ * ECN capable, marked with Congestion Experienced.
+ */
+class CoDelQueue
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr std::size_t DEFAULT_MAX_SIZE = 256;
+  static constexpr std::chrono::microseconds DEFAULT_TARGET {5000};
+  static constexpr std::chrono::microseconds DEFAULT_INTERVAL {100000};
+
+  CoDelQueue(const std::size_t &ip_header_offset = 0,
+             const std::size_t &max_size = DEFAULT_MAX_SIZE,
+             const std::chrono::microseconds &target = DEFAULT_TARGET,
+             const std::chrono::microseconds &interval = DEFAULT_INTERVAL);
+  virtual ~CoDelQueue() = default;
+
+  // returns false when the queue is full and the packet was dropped
+  virtual bool Enqueue(Packets::Packet::Data &&packet, const Clock::time_point &now);
+  virtual bool Dequeue(Packets::Packet::Data &packet, const Clock::time_point &now);
+
+  virtual bool IsEmpty() const;
+  virtual std::size_t GetSize() const;
+  virtual QueueStats GetStats() const;
+
+protected:
+  struct Entry
+  {
+    Packets::Packet::Data packet;
+    Clock::time_point enqueue_time;
+  };
+
+  std::size_t ip_header_offset;
+  std::size_t max_size;
+  std::chrono::microseconds target;
+  std::chrono::microseconds interval;
+
+  std::deque<Entry> entries;
+  QueueStats stats;
+
+  // CoDel state
+  bool dropping;
+  unsigned count;
+  unsigned last_count;
+  Clock::time_point first_above_time;
+  Clock::time_point drop_next;
+
+  bool DoDequeue(Entry &entry, const Clock::time_point &now, bool &ok_to_drop);
+  bool Drop(Entry &entry);
+  Clock::time_point ControlLaw(const Clock::time_point &t) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Ecn.h"
+
+#include <cstdint>
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Scheduling
+{
+
+namespace
+{
+
+constexpr uint8_t NOT_ECT = 0x00;
+constexpr uint8_t CE = 0x03;
+
+}
+
+
+bool
+Ecn::MarkCongestionExperienced(Packet::Data &packet, const size_t &ip_header_offset)
+{
+  if (packet.size() < ip_header_offset + 2)
+    return false;
+
+  uint8_t *ip = packet.data() + ip_header_offset;
+  const uint8_t version = ip[0] >> 4;
+
+  if (version == 4)
+  {
+    constexpr size_t checksum_position = 10;
+    if (packet.size() < ip_header_offset + checksum_position + 2)
+      return false;
+
+    const uint8_t ecn = ip[1] & 0x03;
+    if (ecn == NOT_ECT)
+      return false;
+    if (ecn == CE)
+      return true;
+
+    // incremental checksum update, RFC 1624
+    const uint16_t old_word = (ip[0] << 8) | ip[1];
+    ip[1] |= CE;
+    const uint16_t new_word = (ip[0] << 8) | ip[1];
+
+    uint32_t sum = static_cast<uint16_t>(~((ip[checksum_position] << 8) | ip[checksum_position + 1]));
+    sum += static_cast<uint16_t>(~old_word);
+    sum += new_word;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+
+    const uint16_t checksum = ~sum;
+    ip[checksum_position] = checksum >> 8;
+    ip[checksum_position + 1] = checksum & 0xFF;
+
+    return true;
+  }
+  else if (version == 6)
+  {
+    const uint8_t ecn = (ip[1] >> 4) & 0x03;
+    if (ecn == NOT_ECT)
+      return false;
+
+    ip[1] |= CE << 4;
+    return true;
+  }
+
+  return false;
+}
+
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+
+#include "../Packets/Packet.h"
+
+#ifndef _ECN_H_
+#define _ECN_H_
+
+
+namespace Scheduling
+{
+
+class Ecn
+{
+public:
+  // Sets Congestion Experienced codepoint in ECN capable IPv4/IPv6 packet,
+  // IPv4 header checksum is updated. Returns false when packet is not ECN
+  // capable and has to be dropped instead.
+  static bool MarkCongestionExperienced(Packets::Packet::Data &packet,
+                                        const std::size_t &ip_header_offset);
+};
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "FlowScheduler.h"
+#include "NoFreeStreamIdException.h"
+
+#include <limits>
+#include <utility>
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Scheduling
+{
+
+FlowScheduler::FlowScheduler(const size_t &quantum) :
+  quantum(quantum == 0 ? 1 : quantum),
+  train_count(0),
+  next_stream_id(1)
+{
+}
+
+
+void
+FlowScheduler::Enqueue(const size_t &flow, Train &&train)
+{
+  if (train.empty())
+    return;
+
+  auto it = flows.find(flow);
+  if (it == flows.end())
+  {
+    Flow f;
+    f.stream_id = AllocateStreamId();
+    f.deficit = quantum;
+
+    it = flows.emplace(flow, move(f)).first;
+    active_flows.push_back(flow);
+  }
+
+  Flow &f = it->second;
+  f.train_lengths.push_back(train.size());
+  for (auto &packet : train)
+  {
+    packet->SetStreamId(f.stream_id);
+    f.fragments.push_back(move(packet));
+  }
+
+  train_count++;
+}
+
+
+unique_ptr<Packet>
+FlowScheduler::Dequeue()
+{
+  if (active_flows.empty())
+    return nullptr;
+
+  const size_t flow = active_flows.front();
+  Flow &f = flows.at(flow);
+
+  unique_ptr<Packet> packet = move(f.fragments.front());
+  f.fragments.pop_front();
+  f.deficit--;
+
+  if (--f.train_lengths.front() == 0)
+  {
+    f.train_lengths.pop_front();
+    train_count--;
+  }
+
+  active_flows.pop_front();
+  if (f.fragments.empty())
+  {
+    used_stream_ids.erase(f.stream_id);
+    flows.erase(flow);
+  }
+  else if (f.deficit == 0)
+  {
+    f.deficit = quantum;
+    active_flows.push_back(flow);
+  }
+  else
+    active_flows.push_front(flow);
+
+  return packet;
+}
+
+
+bool
+FlowScheduler::IsEmpty() const
+{
+  return active_flows.empty();
+}
+
+
+size_t
+FlowScheduler::GetTrainCount() const
+{
+  return train_count;
+}
+
+
+size_t
+FlowScheduler::GetFlowCount() const
+{
+  return flows.size();
+}
+
+
+uint16_t
+FlowScheduler::GetNextStreamId() const
+{
+  return next_stream_id;
+}
+
+
+void
+FlowScheduler::SetNextStreamId(const uint16_t &stream_id)
+{
+  next_stream_id = (stream_id == 0) ? 1 : stream_id;
+}
+
+
+uint16_t
+FlowScheduler::AllocateStreamId()
+{
+  // stream id 0 is used by trains sent without scheduler
+  constexpr size_t ids = numeric_limits<uint16_t>::max();
+
+  for (size_t i = 0; i < ids; i++)
+  {
+    const uint16_t id = next_stream_id;
+    next_stream_id = (next_stream_id == ids) ? 1 : next_stream_id + 1;
+
+    if (used_stream_ids.insert(id).second)
+      return id;
+  }
+
+  throw NoFreeStreamIdException();
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../Packets/Packet.h"
+
+#ifndef _FLOWSCHEDULER_H_
+#define _FLOWSCHEDULER_H_
+
+
+namespace Scheduling
+{
+
+/*
+ * Deficit round robin over fragment trains of different flows. Every
+ * active flow gets its own stream id, so the receiver can reassemble
+ * interleaved trains. Cost of every fragment is one, all but the last
+ * fragment of a train have the maximum size anyway.
+ */
+class FlowScheduler
+{
+public:
+  typedef std::vector<std::unique_ptr<Packets::Packet>> Train;
+
+  FlowScheduler(const std::size_t &quantum = 1);
+  virtual ~FlowScheduler() = default;
+
+  // sets stream id of every packet in the train
+  virtual void Enqueue(const std::size_t &flow, Train &&train);
+
+  // returns nullptr when there is nothing to send
+  virtual std::unique_ptr<Packets::Packet> Dequeue();
+
+  virtual bool IsEmpty() const;
+  virtual std::size_t GetTrainCount() const;
+  virtual std::size_t GetFlowCount() const;
+
+  // stream id the next flow gets unless it's in use, a process taking
+  // over continues with it
+  virtual std::uint16_t GetNextStreamId() const;
+  virtual void SetNextStreamId(const std::uint16_t &stream_id);
+
+protected:
+  struct Flow
+  {
+    std::uint16_t stream_id;
+    std::size_t deficit;
+    std::deque<std::size_t> train_lengths;
+    std::deque<std::unique_ptr<Packets::Packet>> fragments;
+  };
+
+  std::size_t quantum;
+  std::size_t train_count;
+  std::uint16_t next_stream_id;
+
+  std::unordered_map<std::size_t, Flow> flows;
+  std::unordered_set<std::uint16_t> used_stream_ids;
+  std::deque<std::size_t> active_flows;
+
+  std::uint16_t AllocateStreamId();
+};
+
+}
+
+#endif
@@ -0,0 +1,27 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <stdexcept>
+#include <string>
+
+#ifndef _NOFREESTREAMIDEXCEPTION_H_
+#define _NOFREESTREAMIDEXCEPTION_H_
+
+
+namespace Scheduling
+{
+
+class NoFreeStreamIdException : public std::runtime_error
+{
+public:
+ NoFreeStreamIdException() :
+    std::runtime_error("No free stream id.")
+  {
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "PriorityScheduler.h"
+
+#include <utility>
+
+using namespace std;
+using namespace Packets;
+
+
+namespace Scheduling
+{
+
+const PriorityScheduler::Weights PriorityScheduler::DEFAULT_WEIGHTS {{ 8, 8, 4, 1 }};
+
+
+PriorityScheduler::PriorityScheduler(const Weights &weights,
+                                     const size_t &ip_header_offset,
+                                     const size_t &max_queue_size,
+                                     const chrono::microseconds &target,
+                                     const chrono::microseconds &interval) :
+  weights(weights),
+  credits(weights),
+  last_sojourn_time(0)
+{
+  for (auto &queue : queues)
+    queue = CoDelQueue(ip_header_offset, max_queue_size, target, interval);
+}
+
+
+bool
+PriorityScheduler::Enqueue(const TrafficClass &traffic_class,
+                           Packet::Data &&packet,
+                           const Clock::time_point &now)
+{
+  return queues.at(static_cast<size_t>(traffic_class)).Enqueue(move(packet), now);
+}
+
+
+bool
+PriorityScheduler::Dequeue(Packet::Data &packet, const Clock::time_point &now)
+{
+  if (IsEmpty())
+    return false;
+
+  for (int round = 0; round < 2; round++)
+  {
+    for (size_t i = 0; i < queues.size(); i++)
+    {
+      if (queues[i].IsEmpty() || credits[i] == 0)
+        continue;
+
+      // CoDel may drop every waiting packet
+      if (!queues[i].Dequeue(packet, now))
+        continue;
+
+      credits[i]--;
+      last_sojourn_time = queues[i].GetStats().sojourn_time;
+      return true;
+    }
+
+    // every waiting class used its share, start a new round
+    credits = weights;
+  }
+
+  return false;
+}
+
+
+bool
+PriorityScheduler::IsEmpty() const
+{
+  for (auto &queue : queues)
+    if (!queue.IsEmpty())
+      return false;
+
+  return true;
+}
+
+
+size_t
+PriorityScheduler::GetSize(const TrafficClass &traffic_class) const
+{
+  return queues.at(static_cast<size_t>(traffic_class)).GetSize();
+}
+
+
+QueueStats
+PriorityScheduler::GetStats(const TrafficClass &traffic_class) const
+{
+  return queues.at(static_cast<size_t>(traffic_class)).GetStats();
+}
+
+
+QueueStats
+PriorityScheduler::GetStats() const
+{
+  QueueStats total {};
+
+  for (auto &queue : queues)
+  {
+    const QueueStats s = queue.GetStats();
+    total.enqueued += s.enqueued;
+    total.dequeued += s.dequeued;
+    total.tail_dropped += s.tail_dropped;
+    total.codel_dropped += s.codel_dropped;
+    total.ecn_marked += s.ecn_marked;
+    total.length += s.length;
+  }
+
+  total.sojourn_time = last_sojourn_time;
+  return total;
+}
+
+
+chrono::microseconds
+PriorityScheduler::GetLastSojournTime() const
+{
+  return last_sojourn_time;
+}
+
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <array>
+#include <cstddef>
+
+#include "TrafficClass.h"
+#include "CoDelQueue.h"
+#include "../Packets/Packet.h"
+
+#ifndef _PRIORITYSCHEDULER_H_
+#define _PRIORITYSCHEDULER_H_
+
+
+namespace Scheduling
+{
+
+/*
+ * Keeps one queue per traffic class. Queues are served in priority
+ * order, but every class may send at most 'weight' packets before lower
+ * classes get their turn, so bulk traffic is never starved.
+ *
+ * Every queue is bounded and managed by CoDel.
+ */
+class PriorityScheduler
+{
+public:
+  typedef std::array<unsigned, TRAFFIC_CLASS_COUNT> Weights;
+  typedef CoDelQueue::Clock Clock;
+
+  static const Weights DEFAULT_WEIGHTS;
+
+  PriorityScheduler(const Weights &weights = DEFAULT_WEIGHTS,
+                    const std::size_t &ip_header_offset = 0,
+                    const std::size_t &max_queue_size = CoDelQueue::DEFAULT_MAX_SIZE,
+                    const std::chrono::microseconds &target = CoDelQueue::DEFAULT_TARGET,
+                    const std::chrono::microseconds &interval = CoDelQueue::DEFAULT_INTERVAL);
+  virtual ~PriorityScheduler() = default;
+
+  // returns false when the packet was dropped
+  virtual bool Enqueue(const TrafficClass &traffic_class,
+                       Packets::Packet::Data &&packet,
+                       const Clock::time_point &now = Clock::now());
+  virtual bool Dequeue(Packets::Packet::Data &packet,
+                       const Clock::time_point &now = Clock::now());
+
+  virtual bool IsEmpty() const;
+  virtual std::size_t GetSize(const TrafficClass &traffic_class) const;
+
+  virtual QueueStats GetStats(const TrafficClass &traffic_class) const;
+  // sum of all queues, sojourn time of the last dequeued packet
+  virtual QueueStats GetStats() const;
+
+  virtual std::chrono::microseconds GetLastSojournTime() const;
+
+protected:
+  Weights weights;
+  Weights credits;
+  std::array<CoDelQueue, TRAFFIC_CLASS_COUNT> queues;
+  std::chrono::microseconds last_sojourn_time;
+};
+
+}
+
+#endif
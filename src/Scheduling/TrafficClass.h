@@ -0,0 +1,28 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstdint>
+
+#ifndef _TRAFFICCLASS_H_
+#define _TRAFFICCLASS_H_
+
+
+namespace Scheduling
+{
+
+// ordered from the highest to the lowest priority
+enum class TrafficClass : std::uint8_t
+{
+  INTERACTIVE,
+  ACK,
+  DEFAULT,
+  BULK
+};
+
+constexpr unsigned TRAFFIC_CLASS_COUNT = 4;
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "EventQueue.h"
+
+using namespace std;
+
+
+namespace Simulation
+{
+
+constexpr chrono::hours EventQueue::START_TIME;
+
+
+EventQueue::EventQueue() :
+  now(START_TIME),
+  order(0)
+{
+}
+
+
+EventQueue::Clock::time_point
+EventQueue::GetTime() const
+{
+  return now;
+}
+
+
+void
+EventQueue::Schedule(const Clock::time_point &time, const Event &event)
+{
+  events.emplace(Key(max(time, now), order++), event);
+}
+
+
+void
+EventQueue::ScheduleAfter(const Clock::duration &delay, const Event &event)
+{
+  Schedule(now + delay, event);
+}
+
+
+uint64_t
+EventQueue::RunUntil(const Clock::time_point &end)
+{
+  uint64_t count = 0;
+
+  while (!events.empty() && events.begin()->first.first <= end)
+  {
+    auto first = events.begin();
+    now = first->first.first;
+
+    // the event may schedule others, so it's taken out first
+    const Event event = move(first->second);
+    events.erase(first);
+
+    event();
+    count++;
+  }
+
+  now = max(now, end);
+  return count;
+}
+
+
+size_t
+EventQueue::GetPendingCount() const
+{
+  return events.size();
+}
+
+}
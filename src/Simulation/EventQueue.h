@@ -0,0 +1,63 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <utility>
+#include <boost/noncopyable.hpp>
+
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+
+namespace Simulation
+{
+
+/*
+ * Virtual clock of a discrete event simulation. Events run in the order
+ * of their time, events of the same time in the order they were
+ * scheduled, and the clock jumps from one event to the next, so a run
+ * takes as long as its events need to compute and always gives the same
+ * result. Times are steady_clock time points, so the clock can be passed
+ * to everything taking the time as an argument.
+ */
+class EventQueue : private boost::noncopyable
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::function<void()> Event;
+
+  // far enough from the epoch, so zero initialized time points are long
+  // in the past, as they are on a real clock
+  static constexpr std::chrono::hours START_TIME{1};
+
+  EventQueue();
+
+  Clock::time_point GetTime() const;
+
+  // events in the past run at the current time
+  void Schedule(const Clock::time_point &time, const Event &event);
+  void ScheduleAfter(const Clock::duration &delay, const Event &event);
+
+  // Runs events up to and including the end time, then sets the clock
+  // to it. Returns the number of events run.
+  std::uint64_t RunUntil(const Clock::time_point &end);
+
+  std::size_t GetPendingCount() const;
+
+private:
+  typedef std::pair<Clock::time_point, std::uint64_t> Key;
+
+  Clock::time_point now;
+  std::map<Key, Event> events;
+  std::uint64_t order;
+};
+
+}
+
+#endif
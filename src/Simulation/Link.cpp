@@ -0,0 +1,121 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Link.h"
+
+#include <utility>
+
+using namespace std;
+using namespace Interfaces;
+
+
+namespace Simulation
+{
+
+Link::Config::Config() :
+  rate(0),
+  buffer(64 * 1024),
+  path()
+{
+}
+
+
+Link::Link(EventQueue &events, const Config &config, const uint32_t &seed,
+           const Receiver &receiver) :
+  events(events),
+  config(config),
+  impairment(config.path, seed),
+  receiver(receiver),
+  buffered_bytes(0),
+  busy_until(),
+  delivery_scheduled(false),
+  delivery_time(),
+  stats()
+{
+}
+
+
+void
+Link::Send(Data &&datagram)
+{
+  stats.sent++;
+
+  if (config.rate == 0)
+  {
+    impairment.Push(move(datagram), events.GetTime());
+    ScheduleDelivery();
+    return;
+  }
+
+  if (buffered_bytes + datagram.size() > config.buffer)
+  {
+    stats.buffer_dropped++;
+    return;
+  }
+
+  // the bottleneck sends one datagram after another
+  const chrono::nanoseconds transmission(datagram.size() * 1000000000 / config.rate);
+  busy_until = max(busy_until, events.GetTime()) + transmission;
+  events.Schedule(busy_until, [this]() { OnSent(); });
+
+  buffered_bytes += datagram.size();
+  buffer.push_back(move(datagram));
+}
+
+
+Link::Stats
+Link::GetStats() const
+{
+  Stats s = stats;
+  s.path = impairment.GetStats();
+
+  return s;
+}
+
+
+void
+Link::OnSent()
+{
+  buffered_bytes -= buffer.front().size();
+  impairment.Push(move(buffer.front()), events.GetTime());
+  buffer.pop_front();
+
+  ScheduleDelivery();
+}
+
+
+void
+Link::Deliver()
+{
+  delivery_scheduled = false;
+
+  while (impairment.Pull(datagram, events.GetTime()))
+  {
+    stats.delivered++;
+    stats.delivered_bytes += datagram.size();
+    receiver(move(datagram));
+  }
+
+  ScheduleDelivery();
+}
+
+
+void
+Link::ScheduleDelivery()
+{
+  EventQueue::Clock::time_point due;
+  if (!impairment.GetNextDueTime(due))
+    return;
+
+  // a delivery already scheduled for earlier takes this one too
+  if (delivery_scheduled && delivery_time <= due)
+    return;
+
+  delivery_scheduled = true;
+  delivery_time = due;
+  events.Schedule(due, [this]() { Deliver(); });
+}
+
+}
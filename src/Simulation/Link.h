@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "EventQueue.h"
+#include "../Interfaces/Impairment.h"
+
+#ifndef _LINK_H_
+#define _LINK_H_
+
+
+namespace Simulation
+{
+
+/*
+ * One direction of a simulated path: a bottleneck sending at the given
+ * rate from a drop tail buffer, then an Impairment adding the delay,
+ * jitter, loss and everything else of its profile. Datagrams come out
+ * to the receiver function at the time they arrive.
+ */
+class Link : private boost::noncopyable
+{
+public:
+  typedef std::vector<std::uint8_t> Data;
+  typedef std::function<void(Data &&datagram)> Receiver;
+
+  struct Config
+  {
+    // bytes per second, zero is unlimited
+    std::uint64_t rate;
+    // bytes waiting for the bottleneck, more are dropped
+    std::size_t buffer;
+    Interfaces::Impairment::Profile path;
+
+    Config();
+  };
+
+  struct Stats
+  {
+    std::uint64_t sent;
+    std::uint64_t buffer_dropped;
+    std::uint64_t delivered;
+    std::uint64_t delivered_bytes;
+    Interfaces::Impairment::Stats path;
+  };
+
+  Link(EventQueue &events, const Config &config, const std::uint32_t &seed,
+       const Receiver &receiver);
+
+  void Send(Data &&datagram);
+
+  Stats GetStats() const;
+
+private:
+  EventQueue &events;
+  Config config;
+  Interfaces::Impairment impairment;
+  Receiver receiver;
+
+  // datagrams in the buffer, the first one is being sent
+  std::deque<Data> buffer;
+  std::size_t buffered_bytes;
+  EventQueue::Clock::time_point busy_until;
+
+  bool delivery_scheduled;
+  EventQueue::Clock::time_point delivery_time;
+  Data datagram;
+
+  Stats stats;
+
+  void OnSent();
+  void Deliver();
+  void ScheduleDelivery();
+};
+
+}
+
+#endif
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "TunnelSimulation.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "../Interfaces/TunTap.h"
+#include "../Packets/PseudoDNS.h"
+#include "../Crypto/Aead.h"
+
+using namespace std;
+using namespace Packets;
+using namespace Codec;
+
+
+namespace Simulation
+{
+
+namespace
+{
+
+// the sequence number follows the IP and UDP headers
+constexpr size_t SEQUENCE_OFFSET = Interfaces::TunTap::PACKET_INFO_SIZE + 28;
+
+}
+
+constexpr size_t TunnelSimulation::MIN_PACKET_SIZE;
+constexpr size_t TunnelSimulation::MAX_PACKET_SIZE;
+constexpr chrono::milliseconds TunnelSimulation::RESOLVER_TIMER_INTERVAL;
+
+
+TunnelSimulation::Traffic::Traffic() :
+  rate(0),
+  size(500),
+  poisson(false),
+  flows(4),
+  port(1024)
+{
+}
+
+
+TunnelSimulation::Config::Config() :
+  duration(10000),
+  drain(1000),
+  seed(1),
+  upstream(),
+  downstream(),
+  interactive(),
+  poll_interval(50),
+  datagrams_per_poll(0),
+  aggregate_size(0),
+  aggregate_delay(0),
+  max_queue_size(Scheduling::CoDelQueue::DEFAULT_MAX_SIZE),
+  codel_target(Scheduling::CoDelQueue::DEFAULT_TARGET),
+  codel_interval(Scheduling::CoDelQueue::DEFAULT_INTERVAL),
+  checksum(false),
+  encryption(false),
+  flow_scheduling(true),
+  uplink(),
+  downlink(),
+  resolver(false),
+  resolver_config(),
+  sample_interval(100)
+{
+  interactive.size = 100;
+  interactive.flows = 1;
+  interactive.port = 22;
+}
+
+
+TunnelSimulation::TunnelSimulation(const Config &config) :
+  config(config),
+  events(),
+  random(config.seed),
+  end_of_traffic(events.GetTime() + config.duration),
+  client(),
+  server(),
+  // every part draws from its own generator
+  uplink(events, config.uplink, config.seed + 1,
+         [this](Packet::Data &&datagram) { OnUplink(move(datagram)); }),
+  downlink(events, config.downlink, config.seed + 2,
+           [this](Packet::Data &&datagram) { Receive(client, server, datagram); }),
+  resolver(config.resolver ? new Resolver::Emulator(config.resolver_config, config.seed + 3) : nullptr),
+  client_endpoint("10.0.0.1", 53000)
+{
+  // the clock doesn't move while an end polls at no interval
+  this->config.poll_interval = max(config.poll_interval, chrono::microseconds(1));
+
+  InitializeEnd(client, 1, 2);
+  InitializeEnd(server, 2, 1);
+
+  AddSource(client, config.upstream, "upstream");
+  AddSource(server, config.downstream, "downstream");
+  if (config.interactive.rate > 0)
+    AddSource(client, config.interactive, "interactive");
+}
+
+
+TunnelSimulation::Result
+TunnelSimulation::Run()
+{
+  const Clock::time_point start = events.GetTime();
+
+  for (End *end : { &client, &server })
+  {
+    for (size_t i = 0; i < end->sources.size(); i++)
+      if (end->sources[i].traffic.rate > 0)
+        events.Schedule(start, [this, end, i]() { Generate(*end, i); });
+
+    events.Schedule(start, [this, end]() { Poll(*end); });
+  }
+
+  if (resolver)
+    events.ScheduleAfter(RESOLVER_TIMER_INTERVAL, [this]() { OnResolverTimer(); });
+
+  if (config.sample_interval.count() > 0)
+    events.ScheduleAfter(config.sample_interval, [this]() { TakeSample(); });
+
+  Result result;
+  result.events = events.RunUntil(end_of_traffic + config.drain);
+
+  Summarize(client, 0, result.upstream);
+  Summarize(server, 0, result.downstream);
+  result.interactive = Direction();
+  if (client.sources.size() > 1)
+    Summarize(client, 1, result.interactive);
+  result.uplink = uplink.GetStats();
+  result.downlink = downlink.GetStats();
+  result.resolver = resolver ? resolver->GetStats() : Resolver::Emulator::Stats();
+
+  return result;
+}
+
+
+void
+TunnelSimulation::InitializeEnd(End &end, const uint8_t &address, const uint8_t &peer_address)
+{
+  end.address = address;
+  end.peer_address = peer_address;
+  end.datagrams = 0;
+
+  unique_ptr<PseudoDNS> prototype(new PseudoDNS());
+  prototype->SetChecksum(config.checksum);
+
+  end.sender.reset(new Sender(prototype->Clone(), Interfaces::TunTap::PACKET_INFO_SIZE));
+  end.sender->SetAggregation(config.aggregate_size, config.aggregate_delay);
+  end.sender->SetQueueManagement(config.max_queue_size, config.codel_target, config.codel_interval);
+  end.sender->SetFlowScheduling(config.flow_scheduling);
+  end.receiver.reset(new Receiver(move(prototype)));
+
+  if (config.encryption)
+  {
+    // both directions share the key, it only has to cost the same
+    const Crypto::Aead::Key key = Crypto::Aead::DeriveKey("simulation", "tunnel");
+    end.sender->SetEncryption(unique_ptr<Crypto::Aead>(
+      new Crypto::Aead(Crypto::Aead::Algorithm::CHACHA20_POLY1305, key)));
+    end.receiver->SetEncryption(unique_ptr<Crypto::Aead>(
+      new Crypto::Aead(Crypto::Aead::Algorithm::CHACHA20_POLY1305, key)));
+  }
+}
+
+
+void
+TunnelSimulation::AddSource(End &end, const Traffic &traffic, const char *direction)
+{
+  Source source;
+  source.traffic = traffic;
+  source.traffic.size = min(max(traffic.size, MIN_PACKET_SIZE), MAX_PACKET_SIZE);
+  source.traffic.flows = max(traffic.flows, 1u);
+  source.stats = Direction();
+  source.latency.reset(new Metrics::Histogram("sdnst_simulation_latency_seconds",
+                                              "One way latency of simulated IP packets.",
+                                              string("direction=\"") + direction + "\""));
+  source.sample = Sample();
+  source.sample_latency = chrono::nanoseconds(0);
+
+  end.sources.push_back(move(source));
+}
+
+
+void
+TunnelSimulation::Generate(End &end, const size_t &index)
+{
+  const Clock::time_point now = events.GetTime();
+  if (now >= end_of_traffic)
+    return;
+
+  Source &source = end.sources[index];
+  const uint64_t sequence = end.send_times.size();
+  const size_t size = source.traffic.size;
+  const uint16_t port = source.traffic.port + source.stats.offered % source.traffic.flows;
+
+  // packet info, IPv4 and UDP headers, sequence number
+  packet.assign(Interfaces::TunTap::PACKET_INFO_SIZE + size, 0);
+  const uint8_t headers[] = {
+    0x00, 0x00, 0x08, 0x00,
+    0x45, 0x00, uint8_t(size >> 8), uint8_t(size), 0x00, 0x00, 0x40, 0x00,
+    0x40, 0x11, 0x00, 0x00, 10, 0, 0, end.address, 10, 0, 0, end.peer_address,
+    uint8_t(port >> 8), uint8_t(port), 0x00, 0x35, uint8_t((size - 20) >> 8), uint8_t(size - 20), 0x00, 0x00
+  };
+  copy(headers, headers + sizeof(headers), packet.begin());
+
+  for (int i = 0; i < 8; i++)
+    packet[SEQUENCE_OFFSET + i] = sequence >> (56 - 8 * i);
+
+  end.send_times.push_back(now);
+  end.delivered.push_back(false);
+  end.source_indexes.push_back(index);
+  source.stats.offered++;
+  source.stats.offered_bytes += size;
+  end.sender->Push(packet, now);
+
+  Clock::duration gap;
+  if (source.traffic.poisson)
+  {
+    exponential_distribution<double> seconds(source.traffic.rate);
+    gap = chrono::duration_cast<Clock::duration>(chrono::duration<double>(seconds(random)));
+  }
+  else
+    gap = chrono::duration_cast<Clock::duration>(chrono::seconds(1)) / source.traffic.rate;
+
+  events.ScheduleAfter(gap, [this, &end, index]() { Generate(end, index); });
+}
+
+
+void
+TunnelSimulation::Poll(End &end)
+{
+  const Clock::time_point now = events.GetTime();
+
+  for (unsigned i = 0; config.datagrams_per_poll == 0 || i < config.datagrams_per_poll; i++)
+  {
+    if (!end.sender->Pull(dump, now))
+      break;
+
+    end.datagrams++;
+
+    if (&end == &client)
+      SendFromClient(move(dump));
+    else
+      SendFromServer(move(dump));
+  }
+
+  events.ScheduleAfter(config.poll_interval, [this, &end]() { Poll(end); });
+}
+
+
+void
+TunnelSimulation::Receive(End &end, End &peer, const Packet::Data &datagram)
+{
+  end.receiver->Push(datagram, packets, events.GetTime());
+
+  for (auto &p : packets)
+    Record(peer, p);
+  packets.clear();
+}
+
+
+void
+TunnelSimulation::Record(End &peer, const Packet::Data &ip_packet)
+{
+  if (ip_packet.size() < SEQUENCE_OFFSET + 8)
+    return;
+
+  uint64_t sequence = 0;
+  for (int i = 0; i < 8; i++)
+    sequence = (sequence << 8) | ip_packet[SEQUENCE_OFFSET + i];
+
+  if (sequence >= peer.send_times.size())
+    return;
+
+  Source &source = peer.sources[peer.source_indexes[sequence]];
+  const size_t size = ip_packet.size() - Interfaces::TunTap::PACKET_INFO_SIZE;
+  if (size != source.traffic.size)
+  {
+    source.stats.damaged++;
+    return;
+  }
+
+  if (peer.delivered[sequence])
+  {
+    source.stats.duplicated++;
+    return;
+  }
+
+  const chrono::nanoseconds latency = events.GetTime() - peer.send_times[sequence];
+
+  peer.delivered[sequence] = true;
+  source.stats.delivered++;
+  source.stats.delivered_bytes += size;
+  source.latency->Record(latency);
+
+  source.sample.delivered++;
+  source.sample.delivered_bytes += size;
+  source.sample.max_latency = max(source.sample.max_latency, latency);
+  source.sample_latency += latency;
+}
+
+
+void
+TunnelSimulation::SendFromClient(Packet::Data &&datagram)
+{
+  uplink.Send(move(datagram));
+}
+
+
+void
+TunnelSimulation::SendFromServer(Packet::Data &&datagram)
+{
+  if (!resolver)
+  {
+    downlink.Send(move(datagram));
+    return;
+  }
+
+  resolver->OnResponse(client_endpoint, datagram, events.GetTime(), resolver_output);
+  Dispatch();
+}
+
+
+void
+TunnelSimulation::OnUplink(Packet::Data &&datagram)
+{
+  if (!resolver)
+  {
+    Receive(server, client, datagram);
+    return;
+  }
+
+  resolver->OnQuery(client_endpoint, datagram, events.GetTime(), resolver_output);
+  Dispatch();
+}
+
+
+void
+TunnelSimulation::OnResolverTimer()
+{
+  resolver->OnTimer(events.GetTime(), resolver_output);
+  Dispatch();
+
+  events.ScheduleAfter(RESOLVER_TIMER_INTERVAL, [this]() { OnResolverTimer(); });
+}
+
+
+void
+TunnelSimulation::Dispatch()
+{
+  // the resolver is next to the server
+  for (auto &d : resolver_output)
+    if (d.to_server)
+      Receive(server, client, d.data);
+    else
+      downlink.Send(move(d.data));
+
+  resolver_output.clear();
+}
+
+
+void
+TunnelSimulation::TakeSample()
+{
+  for (End *end : { &client, &server })
+    for (Source &source : end->sources)
+    {
+      Sample &s = source.sample;
+      if (s.delivered > 0)
+        s.mean_latency = source.sample_latency / s.delivered;
+
+      source.stats.timeline.push_back(s);
+      s = Sample();
+      source.sample_latency = chrono::nanoseconds(0);
+    }
+
+  events.ScheduleAfter(config.sample_interval, [this]() { TakeSample(); });
+}
+
+
+void
+TunnelSimulation::Summarize(End &end, const size_t &index, Direction &direction)
+{
+  const Source &source = end.sources[index];
+
+  direction = source.stats;
+  direction.datagrams = end.datagrams;
+  direction.throughput = (config.duration.count() > 0)
+    ? source.stats.delivered_bytes / chrono::duration<double>(config.duration).count()
+    : 0;
+  direction.latency = source.latency->GetSnapshot().Summarize();
+  direction.queue = end.sender->GetQueueStats();
+}
+
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "EventQueue.h"
+#include "Link.h"
+#include "../Codec/Sender.h"
+#include "../Codec/Receiver.h"
+#include "../Interfaces/Endpoint.h"
+#include "../Metrics/Histogram.h"
+#include "../Resolver/Emulator.h"
+#include "../Scheduling/CoDelQueue.h"
+
+#ifndef _TUNNELSIMULATION_H_
+#define _TUNNELSIMULATION_H_
+
+
+namespace Simulation
+{
+
+/*
+ * A tunnel client and server, each a Sender and a Receiver like in
+ * PrimitiveReaderAndWriter, connected by two simulated links and,
+ * optionally, the resolver emulator in front of the server. Sources at
+ * both ends make up IP packets, which carry their sequence number, so
+ * the other end measures how long they took. Everything runs on the
+ * virtual clock of an EventQueue: seconds of traffic take a fraction of
+ * a second and the same configuration always gives the same result.
+ * The client may run a second, interactive source next to the upstream
+ * one, its packets are reported apart.
+ */
+class TunnelSimulation : private boost::noncopyable
+{
+public:
+  typedef EventQueue::Clock Clock;
+
+  // IP and UDP headers and the sequence number
+  static constexpr std::size_t MIN_PACKET_SIZE = 36;
+  static constexpr std::size_t MAX_PACKET_SIZE = 1500;
+
+  struct Traffic
+  {
+    // IP packets per second, zero sends nothing
+    unsigned rate;
+    std::size_t size;
+    // exponential gaps between packets instead of equal ones
+    bool poisson;
+    // packets are spread over this many UDP flows, starting at the port
+    unsigned flows;
+    std::uint16_t port;
+
+    Traffic();
+  };
+
+  struct Config
+  {
+    // sources send for the duration, packets still on their way are
+    // delivered during the drain time after it
+    std::chrono::milliseconds duration;
+    std::chrono::milliseconds drain;
+    std::uint32_t seed;
+
+    Traffic upstream;
+    Traffic downstream;
+    // client to server too, one flow of small packets by default
+    Traffic interactive;
+
+    // Each end takes datagrams from its Sender this often, at most the
+    // given number at once (zero is all of them), which paces what it
+    // sends. The reader and writer threads poll every 50 us.
+    std::chrono::microseconds poll_interval;
+    unsigned datagrams_per_poll;
+
+    // as PrimitiveReaderAndWriter::SetAggregation() and
+    // SetQueueManagement()
+    std::size_t aggregate_size;
+    std::chrono::microseconds aggregate_delay;
+    std::size_t max_queue_size;
+    std::chrono::microseconds codel_target;
+    std::chrono::microseconds codel_interval;
+
+    bool checksum;
+    bool encryption;
+    // as Codec::Sender::SetFlowScheduling()
+    bool flow_scheduling;
+
+    // client to server and back
+    Link::Config uplink;
+    Link::Config downlink;
+
+    bool resolver;
+    Resolver::Emulator::Config resolver_config;
+
+    // length of the intervals of the timeline, zero disables it
+    std::chrono::milliseconds sample_interval;
+
+    Config();
+  };
+
+  // packets of one direction delivered in an interval
+  struct Sample
+  {
+    std::uint64_t delivered;
+    std::uint64_t delivered_bytes;
+    std::chrono::nanoseconds mean_latency;
+    std::chrono::nanoseconds max_latency;
+  };
+
+  // datagrams and queue are of the end, the same for the upstream and
+  // interactive sources
+  struct Direction
+  {
+    std::uint64_t offered;
+    std::uint64_t offered_bytes;
+    std::uint64_t datagrams;
+    std::uint64_t delivered;
+    std::uint64_t delivered_bytes;
+    std::uint64_t duplicated;
+    // IP packets of a wrong length, joined from fragments of others
+    std::uint64_t damaged;
+    // IP bytes delivered per second of the duration
+    double throughput;
+    Metrics::Histogram::Summary latency;
+    Scheduling::QueueStats queue;
+    std::vector<Sample> timeline;
+  };
+
+  struct Result
+  {
+    Direction upstream;
+    Direction downstream;
+    Direction interactive;
+    Link::Stats uplink;
+    Link::Stats downlink;
+    Resolver::Emulator::Stats resolver;
+    // events run by the virtual clock
+    std::uint64_t events;
+  };
+
+  TunnelSimulation(const Config &config);
+
+  // may be called once
+  Result Run();
+
+private:
+  // how often the resolver emulator retries queries
+  static constexpr std::chrono::milliseconds RESOLVER_TIMER_INTERVAL{10};
+
+  struct Source
+  {
+    Traffic traffic;
+    Direction stats;
+    std::unique_ptr<Metrics::Histogram> latency;
+    Sample sample;
+    std::chrono::nanoseconds sample_latency;
+  };
+
+  struct End
+  {
+    std::vector<Source> sources;
+    std::unique_ptr<Codec::Sender> sender;
+    std::unique_ptr<Codec::Receiver> receiver;
+    std::uint8_t address;
+    std::uint8_t peer_address;
+    std::uint64_t datagrams;
+
+    // of the packets this end sent, by sequence number
+    std::vector<Clock::time_point> send_times;
+    std::vector<bool> delivered;
+    std::vector<std::uint8_t> source_indexes;
+  };
+
+  Config config;
+  EventQueue events;
+  std::mt19937 random;
+  Clock::time_point end_of_traffic;
+
+  End client;
+  End server;
+  Link uplink;
+  Link downlink;
+  std::unique_ptr<Resolver::Emulator> resolver;
+  Interfaces::Endpoint client_endpoint;
+
+  Packets::Packet::Data packet;
+  Packets::Packet::Data dump;
+  std::vector<Packets::Packet::Data> packets;
+  std::vector<Resolver::Emulator::Datagram> resolver_output;
+
+  void InitializeEnd(End &end, const std::uint8_t &address, const std::uint8_t &peer_address);
+  void AddSource(End &end, const Traffic &traffic, const char *direction);
+
+  void Generate(End &end, const std::size_t &source);
+  void Poll(End &end);
+  void Receive(End &end, End &peer, const Packets::Packet::Data &datagram);
+  void Record(End &peer, const Packets::Packet::Data &ip_packet);
+
+  void SendFromClient(Packets::Packet::Data &&datagram);
+  void SendFromServer(Packets::Packet::Data &&datagram);
+  void OnUplink(Packets::Packet::Data &&datagram);
+  void OnResolverTimer();
+  void Dispatch();
+
+  void TakeSample();
+  void Summarize(End &end, const std::size_t &source, Direction &direction);
+};
+
+}
+
+#endif
@@ -3,22 +3,40 @@
  * All rights reserved. Distributed under the terms of the MIT License.
  */
 
+#include <atomic>
 #include <iostream>
 #include <boost/log/common.hpp>
 #include <boost/log/expressions.hpp>
 #include <boost/log/utility/setup/file.hpp>
 #include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "Options/ProgramOptions.h"
 #include "Interfaces/TunTap.h"
 #include "Interfaces/Socket.h"
+#include "Interfaces/SocketFilter.h"
 #include "Packets/PseudoDNS.h"
+#include "Crypto/Aead.h"
 #include "PrimitiveReaderAndWriter.h"
-
-#ifdef HAVE_CONFIG_H
-#include "config.h"
-#endif
+#include "PipelinedReaderAndWriter.h"
+#include "Metrics/HttpExporter.h"
+#include "Restart/HotRestart.h"
+#include "Restart/State.h"
+#include "LoadGen/Generator.h"
+#include "LoadGen/Reflector.h"
+#include "Logging/Log.h"
+#include "Logging/Logger.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -32,12 +50,359 @@ namespace expr = boost::log::expressions;
 namespace keywords = boost::log::keywords;
 
 PrimitiveReaderAndWriter *rw_ptr;
+LoadGen::Generator *generator_ptr;
+LoadGen::Reflector *reflector_ptr;
 
 
 void sig_handler(int signum)
 {
-  BOOST_LOG_TRIVIAL(info) << "Received signal: " << signum;
-  rw_ptr->Stop();
+  LOG(info) << "Received signal: " << signum;
+  if (rw_ptr)
+    rw_ptr->Stop();
+  if (generator_ptr)
+    generator_ptr->Stop();
+  if (reflector_ptr)
+    reflector_ptr->Stop();
+}
+
+
+// set by SIGINT in the supervisor of server processes
+volatile sig_atomic_t supervisor_stopping;
+
+
+void
+StopSupervisor(int)
+{
+  supervisor_stopping = 1;
+}
+
+
+// forks the server process with the given number, returns its pid in
+// the parent and 0 in the child
+pid_t
+ForkServerProcess(const unsigned &process, const unsigned &processes)
+{
+  // the logger thread doesn't survive fork()
+  Logging::Logger::GetInstance().Stop();
+
+  const pid_t pid = fork();
+  if (pid < 0) {
+    const string error = strerror(errno);
+    Logging::Logger::GetInstance().Start();
+    throw runtime_error(error);
+  }
+
+  if (pid == 0)
+    signal(SIGINT, SIG_DFL);
+
+  Logging::Logger::GetInstance().Start();
+
+  if (pid == 0)
+    LOG(info) << "Server process " << process << " of " << processes
+              << ", pid: " << getpid();
+
+  return pid;
+}
+
+
+/*
+ * Forks a process for every socket and waits for them. A process which
+ * exits is forked again with the same number after RESPAWN_DELAY, until
+ * the supervisor gets SIGINT and passes it to the processes. Returns in
+ * forked processes with their number set, or when all processes have
+ * stopped with process equal to processes.
+ */
+void
+SuperviseServerProcesses(const unsigned &processes, unsigned &process)
+{
+  const chrono::seconds RESPAWN_DELAY(1);
+  // by pid
+  map<pid_t, unsigned> running;
+
+  struct sigaction action = {};
+  action.sa_handler = StopSupervisor;
+  // no SA_RESTART, waitpid() has to return on SIGINT
+  sigaction(SIGINT, &action, nullptr);
+
+  for (unsigned i = 0; i < processes; i++) {
+    const pid_t pid = ForkServerProcess(i, processes);
+    if (pid == 0) {
+      process = i;
+      return;
+    }
+
+    running[pid] = i;
+  }
+
+  bool stopped = false;
+  while (!running.empty()) {
+    if (supervisor_stopping && !stopped) {
+      LOG(info) << "Stopping server processes.";
+      for (auto &r : running)
+        kill(r.first, SIGINT);
+      stopped = true;
+    }
+
+    int status;
+    const pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR)
+        continue;
+      throw runtime_error(strerror(errno));
+    }
+
+    auto found = running.find(pid);
+    if (found == running.end())
+      continue;
+
+    const unsigned number = found->second;
+    running.erase(found);
+    if (supervisor_stopping)
+      continue;
+
+    LOG(warning) << "Server process " << number << " (pid " << pid << ") exited with status "
+                 << (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status))
+                 << ", starting it again.";
+
+    // a process failing at start isn't forked in a loop, SIGINT cuts
+    // the delay short
+    this_thread::sleep_for(RESPAWN_DELAY);
+    if (supervisor_stopping)
+      continue;
+
+    const pid_t respawned = ForkServerProcess(number, processes);
+    if (respawned == 0) {
+      process = number;
+      return;
+    }
+
+    running[respawned] = number;
+  }
+
+  process = processes;
+}
+
+
+/*
+ * Binds one socket of a SO_REUSEPORT group for every server process and
+ * forks the processes. Sockets are numbered in order of binding, so the
+ * steering program sends session id modulo number of processes to the
+ * socket of the process with that number. Every process serves one
+ * client, the first one it hears from (see AcceptPeer), so clients need
+ * session ids distinct modulo number of processes; datagrams of a client
+ * colliding with a served one are dropped. Returns socket of the calling
+ * process, nullptr in the supervisor once all processes have stopped.
+ *
+ * The kernel removes a socket from the group when its last descriptor
+ * is closed and moves the last socket of the group to its place, which
+ * would steer sessions to other processes. So the parent doesn't tunnel
+ * itself, it keeps all sockets open and forks an exiting process again
+ * with the socket of its number; datagrams wait in the socket buffer
+ * meanwhile. A single process is restarted by sending SIGINT to its pid
+ * (logged at start), SIGINT sent to the parent stops all of them.
+ */
+shared_ptr<Socket>
+BindServerProcesses(const Options::ProgramOptions &options, unsigned &process)
+{
+  const unsigned processes = options.GetProcesses();
+  vector<shared_ptr<Socket>> sockets;
+
+  for (unsigned i = 0; i < processes; i++) {
+    shared_ptr<Socket> socket(Socket::Create(Socket::DomainType::INET,
+                                             Socket::SocketType::DGRAM));
+    if (processes > 1)
+      socket->EnableReusePort();
+
+    socket->Bind(options.GetPort(), options.GetAddress());
+    sockets.push_back(socket);
+  }
+
+  process = 0;
+  if (processes == 1)
+    return sockets.front();
+
+  sockets.front()->AttachSteeringProgram(
+    SocketFilter::CreateSteering(PseudoDNS::SESSION_ID_OFFSET, processes));
+
+  LOG(info) << "Supervisor of " << processes << " server processes, pid: " << getpid();
+  SuperviseServerProcesses(processes, process);
+
+  for (unsigned i = 0; i < processes; i++)
+    if (i != process)
+      sockets[i]->Close();
+
+  return (process == processes) ? nullptr : sockets[process];
+}
+
+
+// stops the tunnel for handoff when the new process asks for it
+void
+WatchForHandoff(Restart::HotRestart &hot_restart,
+                PrimitiveReaderAndWriter &rw,
+                const atomic<bool> &tunneling,
+                bool &handoff)
+{
+  try {
+    while (tunneling)
+      if (hot_restart.WaitForRequest(chrono::milliseconds(100))) {
+        handoff = true;
+        rw.StopForHandoff();
+        return;
+      }
+  } catch (exception &ex) {
+    LOG(error) << "Hot restart: " << ex.what();
+  }
+}
+
+
+uint16_t
+GetSessionId(const Options::ProgramOptions &options)
+{
+  uint16_t session_id = options.GetSessionId();
+
+  while (session_id == 0)
+    session_id = random_device()();
+
+  LOG(info) << "Session id: " << session_id;
+  return session_id;
+}
+
+
+Crypto::Aead::Algorithm
+GetAlgorithm(const Options::ProgramOptions &options)
+{
+  if (options.GetCipher() == Options::ProgramOptions::Cipher::AES_256_GCM)
+    return Crypto::Aead::Algorithm::AES_256_GCM;
+  if (options.GetCipher() == Options::ProgramOptions::Cipher::CHACHA20_POLY1305)
+    return Crypto::Aead::Algorithm::CHACHA20_POLY1305;
+
+  LOG(warning) << "Cipher chosen by CPU features, the peer has to choose the same one.";
+  return Crypto::Aead::GetPreferredAlgorithm();
+}
+
+
+// cipher and keys of both directions, as seen from this side
+struct Encryption
+{
+  Crypto::Aead::Algorithm algorithm;
+  Crypto::Aead::Key send_key;
+  Crypto::Aead::Key receive_key;
+};
+
+
+Encryption
+GetEncryption(const Options::ProgramOptions &options, const bool &client)
+{
+  const auto client_key = Crypto::Aead::DeriveKey(options.GetKey(), "client to server");
+  const auto server_key = Crypto::Aead::DeriveKey(options.GetKey(), "server to client");
+  const Crypto::Aead::Algorithm algorithm = GetAlgorithm(options);
+
+  LOG(info) << "Encryption: " << Crypto::Aead::GetName(algorithm);
+  if (client)
+    return Encryption {algorithm, client_key, server_key};
+
+  return Encryption {algorithm, server_key, client_key};
+}
+
+
+// codec of loadgen clients or of the reflector, set up like the tunnel
+LoadGen::SessionFactory
+CreateSessionFactory(const Options::ProgramOptions &options, const bool &client)
+{
+  LoadGen::SessionFactory factory(options.GetChecksum());
+
+  factory.SetAggregation(options.GetAggregateSize(),
+                         chrono::microseconds(options.GetAggregateDelay()));
+  factory.SetQueueManagement(options.GetQueueSize(),
+                             chrono::microseconds(options.GetCoDelTarget()),
+                             chrono::microseconds(options.GetCoDelInterval()));
+
+  if (options.GetCipher() != Options::ProgramOptions::Cipher::NONE) {
+    const Encryption encryption = GetEncryption(options, client);
+    factory.SetEncryption(encryption.algorithm, encryption.send_key, encryption.receive_key);
+  }
+
+  return factory;
+}
+
+
+void
+PrintLoadGenReport(const LoadGen::Generator::Report &report)
+{
+  typedef chrono::microseconds us;
+  const double seconds = report.seconds > 0 ? report.seconds : 1;
+  const double loss = report.sent ? 100.0 * (report.sent - report.received) / report.sent : 0;
+
+  stringstream stream;
+  stream << "Clients: " << report.clients
+         << ", sent: " << static_cast<uint64_t>(report.sent / seconds) << " pps"
+         << ", reflected: " << static_cast<uint64_t>(report.received / seconds) << " pps"
+         << ", goodput: " << report.received_bytes * 8 / seconds / 1e6 << " Mbit/s"
+         << ", loss: " << loss << "%"
+         << " (generator dropped: " << report.dropped
+         << ", malformed: " << report.malformed << ")\n"
+         << "Round trip time [us] p50: " << chrono::duration_cast<us>(report.round_trip.p50).count()
+         << ", p90: " << chrono::duration_cast<us>(report.round_trip.p90).count()
+         << ", p99: " << chrono::duration_cast<us>(report.round_trip.p99).count()
+         << ", p99.9: " << chrono::duration_cast<us>(report.round_trip.p999).count()
+         << ", max: " << chrono::duration_cast<us>(report.round_trip.max).count();
+
+  LOG(info) << stream.str();
+  cout << stream.str() << endl;
+}
+
+
+int
+RunLoadGen(const Options::ProgramOptions &options)
+{
+  const auto sizes = options.GetLoadGenSizes();
+
+  LoadGen::Generator::Config config;
+  config.clients = options.GetLoadGenClients();
+  config.rate = options.GetLoadGenRate();
+  config.sizes.assign(sizes.begin(), sizes.end());
+  config.duration = chrono::seconds(options.GetLoadGenDuration());
+  config.seed = random_device()();
+
+  LoadGen::Generator generator(Endpoint(options.GetAddress(), options.GetPort()),
+                               CreateSessionFactory(options, true), config);
+
+  generator_ptr = &generator;
+  signal(SIGINT, sig_handler);
+
+  PrintLoadGenReport(generator.Run());
+
+  generator_ptr = nullptr;
+  return 0;
+}
+
+
+int
+RunReflector(const Options::ProgramOptions &options)
+{
+  unsigned process = 0;
+  shared_ptr<Socket> socket = BindServerProcesses(options, process);
+  // the supervisor of server processes
+  if (!socket)
+    return 0;
+
+  LoadGen::Reflector reflector(socket, CreateSessionFactory(options, false));
+
+  unique_ptr<Metrics::HttpExporter> exporter;
+  if (options.GetMetricsPort() != 0) {
+    exporter.reset(new Metrics::HttpExporter("127.0.0.1", options.GetMetricsPort() + process));
+    exporter->Start();
+  }
+
+  reflector_ptr = &reflector;
+  signal(SIGINT, sig_handler);
+
+  reflector.Run();
+
+  reflector_ptr = nullptr;
+  socket->Close();
+
+  return 0;
 }
 
 
@@ -52,14 +417,19 @@ main(int argc, char *argv[])
                                         << ">\t"
                                         << expr::smessage
 			   ),
-      keywords::auto_flush = true
+      // flushed by the logger thread after every batch of records
+      keywords::auto_flush = false,
+      // the process taking over after a hot restart writes to the same file
+      keywords::open_mode = ios_base::out | ios_base::app
     );
-    BOOST_LOG_TRIVIAL(info) << "SimpleDNSTunnel";
+    Logging::Logger::GetInstance().Start();
+
+    LOG(info) << "SimpleDNSTunnel";
 #ifdef HAVE_CONFIG_H
-    BOOST_LOG_TRIVIAL(info) << "Version: " << VERSION;
+    LOG(info) << "Version: " << VERSION;
 #endif
-    BOOST_LOG_TRIVIAL(info) << "Copyright 2014-2015 Adam Chyła, adam@chyla.org";
-    BOOST_LOG_TRIVIAL(info) << "All rights reserved. Distributed under the terms of the MIT License.";
+    LOG(info) << "Copyright 2014-2015 Adam Chyła, adam@chyla.org";
+    LOG(info) << "All rights reserved. Distributed under the terms of the MIT License.";
 
     Options::ProgramOptions options;
     options.SetCommandLineOptions(argc, const_cast<const char**>(argv));
@@ -69,37 +439,156 @@ main(int argc, char *argv[])
     if (options.GetShowHelp()) {
       cout << " Simple DNS Tunnel\n===================\n";
       cout << options.GetHelpMessage() << "\n";
+      Logging::Logger::GetInstance().Stop();
       return 0;
     }
 
-    // create interfaces
-    shared_ptr<TunTap> tuntap(TunTap::Create(TunTap::InterfaceType::TUN));
-    shared_ptr<Socket> socket(Socket::Create(Socket::DomainType::INET,
-					     Socket::SocketType::DGRAM));
+    // no TUN device, the tunnel codec only
+    if (options.GetMode() == Options::ProgramOptions::Mode::LOADGEN
+        || options.GetMode() == Options::ProgramOptions::Mode::REFLECTOR) {
+      const int result = (options.GetMode() == Options::ProgramOptions::Mode::LOADGEN)
+                         ? RunLoadGen(options) : RunReflector(options);
+      Logging::Logger::GetInstance().Stop();
+      return result;
+    }
+
+    const bool client = options.GetMode() == Options::ProgramOptions::Mode::CLIENT;
+
+    unique_ptr<Restart::HotRestart> hot_restart;
+    if (!options.GetHandoffSocket().empty()) {
+      if (!client && options.GetProcesses() > 1)
+        throw runtime_error("Hot restart needs a single server process.");
+
+      hot_restart.reset(new Restart::HotRestart(options.GetHandoffSocket()));
+    }
+
+    // create interfaces, every server process creates its own TUN device
+    shared_ptr<TunTap> tuntap;
+    shared_ptr<Socket> socket;
+    unsigned process = 0;
+    Restart::State handoff_state;
+
+    if (options.GetTakeover()) {
+      vector<int> descriptors;
+      Packet::Data state;
+      hot_restart->TakeOver(descriptors, state);
+      if (descriptors.size() != 2)
+        throw runtime_error("Expected TUN and socket descriptors.");
+
+      tuntap = TunTap::FromDescriptor(descriptors[0]);
+      socket = Socket::FromDescriptor(descriptors[1]);
+      handoff_state = Restart::State::Deserialize(state);
 
-    if (options.GetMode() == Options::ProgramOptions::Mode::CLIENT)
-      socket->Connect(options.GetAddress(), options.GetPort());
-    else
-      socket->Bind(options.GetPort(), options.GetAddress());
+      if (handoff_state.peer.IsValid())
+        socket->SetRemoteEndpoint(handoff_state.peer);
+    }
+    else {
+      if (client) {
+        socket = Socket::Create(Socket::DomainType::INET,
+                                Socket::SocketType::DGRAM);
+        socket->Connect(options.GetAddress(), options.GetPort());
+      }
+      else {
+        socket = BindServerProcesses(options, process);
+        // the supervisor of server processes
+        if (!socket) {
+          Logging::Logger::GetInstance().Stop();
+          return 0;
+        }
+      }
+
+      tuntap = TunTap::Create(TunTap::InterfaceType::TUN);
+    }
 
     // start tunneling
-    shared_ptr<Packet> prototype(new PseudoDNS());
-    PrimitiveReaderAndWriter rw(tuntap, socket, prototype);
+    PseudoDNS *pseudo_dns = new PseudoDNS();
+    pseudo_dns->SetChecksum(options.GetChecksum());
+    if (client)
+      pseudo_dns->SetSessionId(handoff_state.session_id != 0 ? handoff_state.session_id
+                                                             : GetSessionId(options));
+    shared_ptr<Packet> prototype(pseudo_dns);
+
+    if (options.GetSocketFilter())
+      socket->AttachFilter(SocketFilter(prototype->GetSignature()));
+
+    if (options.GetSocketReceiveBuffer() > 0)
+      socket->SetReceiveBufferSize(options.GetSocketReceiveBuffer());
+    if (options.GetSocketSendBuffer() > 0)
+      socket->SetSendBufferSize(options.GetSocketSendBuffer());
+    socket->EnableDropReporting();
+    socket->EnableStats();
+
+    unique_ptr<PrimitiveReaderAndWriter> rw;
+    if (options.GetPipeline()) {
+      PipelinedReaderAndWriter *pipelined = new PipelinedReaderAndWriter(tuntap, socket, prototype);
+      pipelined->SetCpuAffinity(options.GetCpuAffinity());
+      pipelined->SetCodecWorkers(options.GetCodecWorkers());
+      rw.reset(pipelined);
+    }
+    else {
+      rw.reset(new PrimitiveReaderAndWriter(tuntap, socket, prototype));
+    }
+
+    rw->SetAggregation(options.GetAggregateSize(),
+                       chrono::microseconds(options.GetAggregateDelay()));
+    rw->SetQueueManagement(options.GetQueueSize(),
+                           chrono::microseconds(options.GetCoDelTarget()),
+                           chrono::microseconds(options.GetCoDelInterval()));
+    rw->SetEchoInterval(chrono::milliseconds(options.GetEchoInterval()));
+    rw->SetHandoffState(handoff_state);
+
+    if (options.GetCipher() != Options::ProgramOptions::Cipher::NONE) {
+      const bool client = options.GetMode() == Options::ProgramOptions::Mode::CLIENT;
+      const Encryption encryption = GetEncryption(options, client);
+      rw->SetEncryption(encryption.algorithm, encryption.send_key, encryption.receive_key);
+    }
 
     // register signal handler
-    rw_ptr = &rw;
+    rw_ptr = rw.get();
     signal(SIGINT, sig_handler);
 
-    rw.Run();
+    unique_ptr<Metrics::HttpExporter> exporter;
+    if (options.GetMetricsPort() != 0) {
+      // every server process on its own port
+      exporter.reset(new Metrics::HttpExporter("127.0.0.1", options.GetMetricsPort() + process));
+      exporter->Start();
+    }
+
+    atomic<bool> tunneling(true);
+    bool handoff = false;
+    thread watcher;
+    if (hot_restart) {
+      hot_restart->Listen();
+      watcher = thread(WatchForHandoff, ref(*hot_restart), ref(*rw), ref(tunneling), ref(handoff));
+    }
+
+    rw->Run();
+
+    tunneling = false;
+    if (watcher.joinable())
+      watcher.join();
+
+    // the new process binds the metrics port again
+    exporter.reset();
+
+    if (handoff) {
+      Restart::State state = rw->GetHandoffState();
+      state.session_id = pseudo_dns->GetSessionId();
+      hot_restart->Handoff({ tuntap->GetDescriptor(), socket->GetDescriptor() },
+                           state.Serialize());
+    }
 
+    hot_restart.reset();
     tuntap->Close();
     socket->Close();
 
   } catch (exception &ex) {
     std::cerr << ex.what() << '\n';
-    BOOST_LOG_TRIVIAL(fatal) << ex.what();
+    LOG(fatal) << ex.what();
+    Logging::Logger::GetInstance().Stop();
     return 1;
   }
 
+  Logging::Logger::GetInstance().Stop();
   return 0;
 }
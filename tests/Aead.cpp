@@ -0,0 +1,197 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+
+#include "../src/Crypto/Aead.h"
+#include "../src/Crypto/AuthenticationFailedException.h"
+
+using namespace Crypto;
+using namespace Packets;
+
+
+namespace
+{
+
+const Aead::Algorithm algorithms[] = {
+  Aead::Algorithm::AES_256_GCM,
+  Aead::Algorithm::CHACHA20_POLY1305
+};
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( Aead_Tests )
+
+BOOST_AUTO_TEST_CASE( SealAndOpen_RoundTrip )
+{
+  const Aead::Key key = Aead::DeriveKey("secret", "test");
+  const Packet::Data expected { 0x45, 0x00, 0x00, 0x14, 0x01, 0x02, 0x03 };
+
+  for (auto algorithm : algorithms)
+  {
+    Aead sender(algorithm, key), receiver(algorithm, key);
+    Packet::Data frame = expected;
+
+    sender.Seal(frame);
+    BOOST_CHECK_EQUAL(frame.size(), expected.size() + Aead::OVERHEAD);
+
+    receiver.Open(frame);
+    BOOST_CHECK_EQUAL_COLLECTIONS(frame.begin(), frame.end(),
+				  expected.begin(), expected.end());
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( Seal_EmptyFrame )
+{
+  const Aead::Key key = Aead::DeriveKey("secret", "test");
+  Aead sender(Aead::Algorithm::CHACHA20_POLY1305, key);
+  Aead receiver(Aead::Algorithm::CHACHA20_POLY1305, key);
+  Packet::Data frame;
+
+  sender.Seal(frame);
+  receiver.Open(frame);
+
+  BOOST_CHECK(frame.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE( Seal_NonceChanges )
+{
+  Aead aead(Aead::Algorithm::AES_256_GCM, Aead::DeriveKey("secret", "test"));
+  Packet::Data first { 0x01, 0x02 }, second { 0x01, 0x02 };
+
+  aead.Seal(first);
+  aead.Seal(second);
+
+  BOOST_CHECK(first != second);
+}
+
+
+BOOST_AUTO_TEST_CASE( Open_ReturnsEpochAndSequence )
+{
+  const Aead::Key key = Aead::DeriveKey("secret", "test");
+  Aead sender(Aead::Algorithm::AES_256_GCM, key), receiver(Aead::Algorithm::AES_256_GCM, key);
+  const std::uint64_t first = sender.TakeSequence();
+  Packet::Data frame { 0x01, 0x02 };
+  std::uint64_t epoch, sequence;
+
+  sender.Seal(frame);
+  receiver.Open(frame, epoch, sequence);
+
+  BOOST_CHECK_EQUAL(epoch, sender.GetEpoch());
+  BOOST_CHECK_EQUAL(sequence, first + 1);
+  BOOST_CHECK_LT(sequence, std::uint64_t(1) << 62);
+}
+
+
+BOOST_AUTO_TEST_CASE( Seal_GivenEpochAndSequence )
+{
+  const Aead::Key key = Aead::DeriveKey("secret", "test");
+  Aead numbering(Aead::Algorithm::CHACHA20_POLY1305, key);
+  Aead sealing(Aead::Algorithm::CHACHA20_POLY1305, key);
+  Aead receiver(Aead::Algorithm::CHACHA20_POLY1305, key);
+  std::uint64_t epoch, sequence;
+
+  // frames of one epoch sealed by many Aeads, as codec workers do
+  for (std::uint64_t i = 0; i < 3; i++)
+  {
+    Packet::Data frame { 0x01, 0x02 };
+    const std::uint64_t taken = numbering.TakeSequence();
+    (i % 2 ? sealing : numbering).Seal(frame, numbering.GetEpoch(), taken);
+
+    receiver.Open(frame, epoch, sequence);
+    BOOST_CHECK_EQUAL(epoch, numbering.GetEpoch());
+    BOOST_CHECK_EQUAL(sequence, taken);
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( NewEpoch_Increases )
+{
+  const Aead::Key key = Aead::DeriveKey("secret", "test");
+  Aead first(Aead::Algorithm::AES_256_GCM, key), second(Aead::Algorithm::AES_256_GCM, key);
+
+  BOOST_CHECK_LT(first.GetEpoch(), second.GetEpoch());
+  BOOST_CHECK_LT(second.GetEpoch(), Aead::NewEpoch());
+}
+
+
+BOOST_AUTO_TEST_CASE( DeriveKey_EpochsSeparateKeys )
+{
+  const Aead::Key key = Aead::DeriveKey("secret", "test");
+
+  BOOST_CHECK(Aead::DeriveKey(key, 1) == Aead::DeriveKey(key, 1));
+  BOOST_CHECK(Aead::DeriveKey(key, 1) != Aead::DeriveKey(key, 2));
+  BOOST_CHECK(Aead::DeriveKey(key, 1) != key);
+}
+
+
+BOOST_AUTO_TEST_CASE( Open_TamperedHeader )
+{
+  const Aead::Key key = Aead::DeriveKey("secret", "test");
+
+  // epoch and sequence are bound by the key and the nonce
+  for (std::size_t i : { 0, 15 })
+  {
+    Aead sender(Aead::Algorithm::AES_256_GCM, key), receiver(Aead::Algorithm::AES_256_GCM, key);
+    Packet::Data frame { 0x01, 0x02, 0x03 };
+
+    sender.Seal(frame);
+    frame[i] ^= 0x01;
+
+    BOOST_CHECK_THROW(receiver.Open(frame), AuthenticationFailedException);
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( Open_TamperedFrame )
+{
+  const Aead::Key key = Aead::DeriveKey("secret", "test");
+
+  for (auto algorithm : algorithms)
+  {
+    Aead sender(algorithm, key), receiver(algorithm, key);
+    Packet::Data frame { 0x01, 0x02, 0x03 };
+
+    sender.Seal(frame);
+    frame[Aead::HEADER_SIZE] ^= 0x01;
+
+    BOOST_CHECK_THROW(receiver.Open(frame), AuthenticationFailedException);
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( Open_WrongKey )
+{
+  Aead sender(Aead::Algorithm::AES_256_GCM, Aead::DeriveKey("secret", "test"));
+  Aead receiver(Aead::Algorithm::AES_256_GCM, Aead::DeriveKey("other", "test"));
+  Packet::Data frame { 0x01, 0x02, 0x03 };
+
+  sender.Seal(frame);
+
+  BOOST_CHECK_THROW(receiver.Open(frame), AuthenticationFailedException);
+}
+
+
+BOOST_AUTO_TEST_CASE( Open_TooShortFrame )
+{
+  Aead aead(Aead::Algorithm::AES_256_GCM, Aead::DeriveKey("secret", "test"));
+  Packet::Data frame(Aead::OVERHEAD - 1, 0x00);
+
+  BOOST_CHECK_THROW(aead.Open(frame), AuthenticationFailedException);
+}
+
+
+BOOST_AUTO_TEST_CASE( DeriveKey_LabelsSeparateKeys )
+{
+  BOOST_CHECK(Aead::DeriveKey("secret", "a") == Aead::DeriveKey("secret", "a"));
+  BOOST_CHECK(Aead::DeriveKey("secret", "a") != Aead::DeriveKey("secret", "b"));
+  BOOST_CHECK(Aead::DeriveKey("secret", "a") != Aead::DeriveKey("secret2", "a"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <vector>
+
+#include "../src/Packets/Aggregator.h"
+#include "../src/Packets/CorruptedPacketException.h"
+
+using namespace Packets;
+
+
+BOOST_AUTO_TEST_SUITE( Aggregator_Tests )
+
+BOOST_AUTO_TEST_CASE( EmptyAggregator_NotReadyToFlush )
+{
+  Aggregator aggregator(100, std::chrono::microseconds(0));
+
+  BOOST_CHECK(aggregator.IsEmpty());
+  BOOST_CHECK(!aggregator.IsReadyToFlush(Aggregator::Clock::now()));
+}
+
+
+BOOST_AUTO_TEST_CASE( Add_PacketsAreLengthPrefixed )
+{
+  Aggregator aggregator(100, std::chrono::microseconds(1000));
+  const auto now = Aggregator::Clock::now();
+
+  BOOST_CHECK(aggregator.Add({ 0x01, 0x02, 0x03 }, now));
+  BOOST_CHECK(aggregator.Add({ 0x04 }, now));
+  BOOST_CHECK_EQUAL(aggregator.GetPacketCount(), 2);
+
+  Packet::Data frame = aggregator.Flush();
+  Packet::Data expected {
+    0x00, 0x03, 0x01, 0x02, 0x03,
+    0x00, 0x01, 0x04
+  };
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(frame.begin(), frame.end(),
+				expected.begin(), expected.end());
+  BOOST_CHECK(aggregator.IsEmpty());
+}
+
+
+BOOST_AUTO_TEST_CASE( Add_RefuseWhenFrameIsFull )
+{
+  Aggregator aggregator(8, std::chrono::microseconds(1000));
+  const auto now = Aggregator::Clock::now();
+
+  BOOST_CHECK(aggregator.Add({ 0x01, 0x02, 0x03 }, now));
+  BOOST_CHECK(!aggregator.Add({ 0x04, 0x05 }, now));
+  BOOST_CHECK_EQUAL(aggregator.GetPacketCount(), 1);
+}
+
+
+BOOST_AUTO_TEST_CASE( Add_EmptyFrameAcceptsBigPacket )
+{
+  Aggregator aggregator(4, std::chrono::microseconds(1000));
+
+  BOOST_CHECK(aggregator.Add(Packet::Data(10, 0xFA), Aggregator::Clock::now()));
+  BOOST_CHECK(aggregator.IsReadyToFlush(Aggregator::Clock::now()));
+}
+
+
+BOOST_AUTO_TEST_CASE( IsReadyToFlush_AfterDeadline )
+{
+  Aggregator aggregator(100, std::chrono::microseconds(500));
+  const auto now = Aggregator::Clock::now();
+
+  aggregator.Add({ 0x01 }, now);
+
+  BOOST_CHECK(!aggregator.IsReadyToFlush(now + std::chrono::microseconds(499)));
+  BOOST_CHECK(aggregator.IsReadyToFlush(now + std::chrono::microseconds(500)));
+}
+
+
+BOOST_AUTO_TEST_CASE( Split_ReturnsOriginalPackets )
+{
+  Aggregator aggregator(100, std::chrono::microseconds(1000));
+  const auto now = Aggregator::Clock::now();
+  std::vector<Packet::Data> packets {
+    { 0x01, 0x02, 0x03 },
+    { },
+    { 0x04, 0x05 }
+  };
+
+  for (auto &p : packets)
+    aggregator.Add(p, now);
+
+  std::vector<Packet::Data> split = Aggregator::Split(aggregator.Flush());
+
+  BOOST_REQUIRE_EQUAL(split.size(), packets.size());
+  for (unsigned i = 0; i < packets.size(); i++)
+    BOOST_CHECK_EQUAL_COLLECTIONS(split[i].begin(), split[i].end(),
+				  packets[i].begin(), packets[i].end());
+}
+
+
+BOOST_AUTO_TEST_CASE( Split_ThrowOnTruncatedFrame )
+{
+  Packet::Data frame { 0x00, 0x03, 0x01, 0x02 };
+
+  BOOST_CHECK_THROW(Aggregator::Split(frame), CorruptedPacketException);
+}
+
+
+BOOST_AUTO_TEST_CASE( Split_ThrowOnTruncatedLength )
+{
+  Packet::Data frame { 0x00, 0x01, 0x01, 0x00 };
+
+  BOOST_CHECK_THROW(Aggregator::Split(frame), CorruptedPacketException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "IpPacket.h"
+#include "../src/PrimitiveReaderAndWriter.h"
+#include "../src/Interfaces/MemoryTun.h"
+#include "../src/Interfaces/Socket.h"
+#include "../src/Packets/PseudoDNS.h"
+#include "../src/Packets/Encapsulator.h"
+#include "../src/Codec/Sender.h"
+#include "../src/Codec/Receiver.h"
+
+using namespace std;
+using namespace Interfaces;
+using namespace Packets;
+using namespace Codec;
+
+
+namespace
+{
+
+constexpr int WARM_UP_PACKETS = 200;
+constexpr int PACKETS = 4000;
+
+// Heap allocations allowed per packet once buffers are warmed up. The
+// goal for all of them is zero, FillFromDump() and Dump() into a buffer
+// are there already. The rest are what the code allocates today: a test
+// fails when a change allocates more, and a budget is lowered when
+// allocations are removed.
+
+// the packet list, then for each of 3 fragments its data, the packet
+// and a copy of the data
+constexpr double ENCAPSULATE_BUDGET = 10;
+// the returned data and a copy of the data of each fragment
+constexpr double DECAPSULATE_BUDGET = 4;
+// 200 bytes long packet, 4 fragments
+constexpr double CODEC_BUDGET = 44;
+// the codec and the packet written to MemoryTun
+constexpr double READER_AND_WRITER_BUDGET = 45;
+
+void
+CheckNoAllocations(const string &name, const uint64_t &allocations, const int &packets)
+{
+  BOOST_CHECK_MESSAGE(allocations == 0,
+                      name << ": " << allocations << " allocations for " << packets
+                      << " packets, " << static_cast<double>(allocations) / packets
+                      << " per packet");
+}
+
+
+void
+CheckBudget(const string &name, const uint64_t &allocations, const int &packets, const double &budget)
+{
+  BOOST_CHECK_MESSAGE(allocations <= budget * packets,
+                      name << ": " << allocations << " allocations for " << packets
+                      << " packets, " << static_cast<double>(allocations) / packets
+                      << " per packet, budget " << budget);
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( AllocationBudget_Tests )
+
+BOOST_AUTO_TEST_CASE( Counter_CountsAllocationsOfItsScope )
+{
+  AllocationCounter thread_counter;
+  AllocationCounter process_counter(AllocationCounter::Scope::PROCESS);
+
+  // read before checking, checks allocate too
+  unique_ptr<int> p(new int(1));
+  const uint64_t allocated = thread_counter.GetAllocations();
+  p.reset();
+  const uint64_t deallocated = thread_counter.GetDeallocations();
+
+  BOOST_CHECK_EQUAL(allocated, 1);
+  BOOST_CHECK_EQUAL(deallocated, 1);
+
+  // allocations of other threads are counted by the process only
+  thread_counter.Reset();
+  process_counter.Reset();
+  unique_ptr<int> q;
+  thread t([&q]() { q.reset(new int(2)); });
+  t.join();
+  const uint64_t thread_allocated = thread_counter.GetAllocations();
+  const uint64_t process_allocated = process_counter.GetAllocations();
+
+  BOOST_CHECK_LT(thread_allocated, process_allocated);
+
+  thread_counter.Reset();
+  BOOST_CHECK_EQUAL(thread_counter.GetAllocations(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( PseudoDNS_FillFromDump )
+{
+  PseudoDNS source;
+  source.SetChecksum(true);
+  source.SetData(Packet::Data(PseudoDNS::MAX_DATA_SIZE, 0x5A));
+  const Packet::Data dump = source.Dump();
+
+  PseudoDNS packet;
+  for (int i = 0; i < WARM_UP_PACKETS; i++)
+    packet.FillFromDump(dump);
+
+  AllocationCounter counter;
+  for (int i = 0; i < PACKETS; i++)
+    packet.FillFromDump(dump);
+
+  CheckNoAllocations("PseudoDNS::FillFromDump", counter.GetAllocations(), PACKETS);
+}
+
+BOOST_AUTO_TEST_CASE( PseudoDNS_Dump )
+{
+  PseudoDNS packet;
+  packet.SetChecksum(true);
+  packet.SetData(Packet::Data(PseudoDNS::MAX_DATA_SIZE, 0x5A));
+
+  Packet::Data dump;
+  for (int i = 0; i < WARM_UP_PACKETS; i++)
+    packet.Dump(dump);
+
+  AllocationCounter counter;
+  for (int i = 0; i < PACKETS; i++)
+    packet.Dump(dump);
+
+  CheckNoAllocations("PseudoDNS::Dump", counter.GetAllocations(), PACKETS);
+}
+
+BOOST_AUTO_TEST_CASE( Encapsulator_EncapsulateAndDecapsulate )
+{
+  Encapsulator encapsulator(unique_ptr<Packet>(new PseudoDNS()));
+  // three fragments
+  const Packet::Data data(3 * PseudoDNS::MAX_DATA_SIZE, 0x5A);
+  const auto fragments = encapsulator.Encapsulate(data);
+
+  AllocationCounter counter;
+  for (int i = 0; i < PACKETS; i++)
+    encapsulator.Encapsulate(data);
+
+  CheckBudget("Encapsulator::Encapsulate", counter.GetAllocations(), PACKETS, ENCAPSULATE_BUDGET);
+
+  counter.Reset();
+  for (int i = 0; i < PACKETS; i++)
+    encapsulator.Decapsulate(fragments);
+
+  CheckBudget("Encapsulator::Decapsulate", counter.GetAllocations(), PACKETS, DECAPSULATE_BUDGET);
+}
+
+BOOST_AUTO_TEST_CASE( Codec_SenderToReceiver )
+{
+  Sender sender(unique_ptr<Packet>(new PseudoDNS()), TunTap::PACKET_INFO_SIZE);
+  Receiver receiver(unique_ptr<Packet>(new PseudoDNS()));
+  const MemoryTun::Packet original = MakeIpPacket(200, 0x5A);
+
+  Packet::Data data;
+  Packet::Data dump;
+  vector<Packet::Data> packets;
+  packets.reserve(1);
+
+  AllocationCounter counter;
+  int delivered = 0;
+
+  for (int i = 0; i < WARM_UP_PACKETS + PACKETS; i++)
+  {
+    if (i == WARM_UP_PACKETS)
+    {
+      counter.Reset();
+      delivered = 0;
+    }
+
+    data.assign(original.begin(), original.end());
+    const auto now = Sender::Clock::now();
+    sender.Push(data, now);
+
+    while (sender.Pull(dump, now))
+      receiver.Push(dump, packets, now);
+
+    delivered += packets.size();
+    packets.clear();
+  }
+
+  BOOST_CHECK_EQUAL(delivered, PACKETS);
+  CheckBudget("Codec::Sender and Codec::Receiver", counter.GetAllocations(), PACKETS, CODEC_BUDGET);
+}
+
+BOOST_AUTO_TEST_CASE( ReaderAndWriter_MemoryTunnel )
+{
+  shared_ptr<Packet> prototype(new PseudoDNS());
+  shared_ptr<MemoryTun> client_device(new MemoryTun());
+  shared_ptr<MemoryTun> server_device(new MemoryTun());
+  shared_ptr<TunTap> client_tun = client_device;
+  shared_ptr<TunTap> server_tun = server_device;
+
+  shared_ptr<Socket> server_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  server_socket->Bind(0, "127.0.0.1");
+  shared_ptr<Socket> client_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  client_socket->Connect(server_socket->GetLocalEndpoint());
+
+  PrimitiveReaderAndWriter client(client_tun, client_socket, prototype);
+  PrimitiveReaderAndWriter server(server_tun, server_socket, prototype);
+  thread client_thread(&PrimitiveReaderAndWriter::Run, &client);
+  thread server_thread(&PrimitiveReaderAndWriter::Run, &server);
+
+  // built before counting, the test thread only moves them around
+  vector<MemoryTun::Packet> sent;
+  for (int i = 0; i < WARM_UP_PACKETS + PACKETS; i++)
+    sent.push_back(MakeIpPacket(200, i));
+
+  MemoryTun::Packet received;
+  received.reserve(TunTap::PACKET_INFO_SIZE + 1500);
+  AllocationCounter counter(AllocationCounter::Scope::PROCESS);
+  int delivered = 0;
+  int injected = 0;
+
+  const auto deadline = chrono::steady_clock::now() + chrono::seconds(20);
+  while (delivered < static_cast<int>(sent.size()) && chrono::steady_clock::now() < deadline)
+  {
+    // one packet in flight, so neither queue overflows
+    if (injected == delivered && client_device->Inject(move(sent[injected])))
+      injected++;
+
+    if (!server_device->Extract(received))
+    {
+      this_thread::yield();
+      continue;
+    }
+
+    if (++delivered == WARM_UP_PACKETS)
+      counter.Reset();
+  }
+
+  const uint64_t allocations = counter.GetAllocations();
+
+  client.Stop();
+  server.Stop();
+  client_thread.join();
+  server_thread.join();
+  client_socket->Close();
+  server_socket->Close();
+
+  BOOST_REQUIRE_EQUAL(delivered, static_cast<int>(sent.size()));
+  CheckBudget("PrimitiveReaderAndWriter", allocations, PACKETS, READER_AND_WRITER_BUDGET);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+
+namespace
+{
+
+// plain integers, so using them doesn't need an initialization of its own
+thread_local uint64_t thread_allocations = 0;
+thread_local uint64_t thread_deallocations = 0;
+
+atomic<uint64_t> process_allocations(0);
+atomic<uint64_t> process_deallocations(0);
+
+void*
+Allocate(const size_t &size)
+{
+  thread_allocations++;
+  process_allocations.fetch_add(1, memory_order_relaxed);
+
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw bad_alloc();
+
+  return p;
+}
+
+void
+Deallocate(void *p)
+{
+  if (!p)
+    return;
+
+  thread_deallocations++;
+  process_deallocations.fetch_add(1, memory_order_relaxed);
+  free(p);
+}
+
+}
+
+
+// every allocation of the test program goes through here
+void*
+operator new(size_t size)
+{
+  return Allocate(size);
+}
+
+
+void*
+operator new[](size_t size)
+{
+  return Allocate(size);
+}
+
+
+void*
+operator new(size_t size, const nothrow_t&) noexcept
+{
+  try
+  {
+    return Allocate(size);
+  }
+  catch (bad_alloc&)
+  {
+    return nullptr;
+  }
+}
+
+
+void*
+operator new[](size_t size, const nothrow_t&) noexcept
+{
+  return operator new(size, nothrow);
+}
+
+
+void
+operator delete(void *p) noexcept
+{
+  Deallocate(p);
+}
+
+
+void
+operator delete[](void *p) noexcept
+{
+  Deallocate(p);
+}
+
+
+void
+operator delete(void *p, size_t) noexcept
+{
+  Deallocate(p);
+}
+
+
+void
+operator delete[](void *p, size_t) noexcept
+{
+  Deallocate(p);
+}
+
+
+AllocationCounter::AllocationCounter(const Scope &scope) :
+  scope(scope),
+  allocations(0),
+  deallocations(0)
+{
+  Reset();
+}
+
+
+void
+AllocationCounter::Reset()
+{
+  allocations = CurrentAllocations();
+  deallocations = CurrentDeallocations();
+}
+
+
+uint64_t
+AllocationCounter::GetAllocations() const
+{
+  return CurrentAllocations() - allocations;
+}
+
+
+uint64_t
+AllocationCounter::GetDeallocations() const
+{
+  return CurrentDeallocations() - deallocations;
+}
+
+
+uint64_t
+AllocationCounter::CurrentAllocations() const
+{
+  if (scope == Scope::THREAD)
+    return thread_allocations;
+
+  return process_allocations.load(memory_order_relaxed);
+}
+
+
+uint64_t
+AllocationCounter::CurrentDeallocations() const
+{
+  if (scope == Scope::THREAD)
+    return thread_deallocations;
+
+  return process_deallocations.load(memory_order_relaxed);
+}
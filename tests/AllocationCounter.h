@@ -0,0 +1,42 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <cstdint>
+
+#ifndef _ALLOCATIONCOUNTER_H_
+#define _ALLOCATIONCOUNTER_H_
+
+
+/*
+ * Counts heap allocations made since it was created, either by the calling
+ * thread only or by the whole test program. Every operator new of the
+ * test program is replaced in AllocationCounter.cpp to keep the counts.
+ */
+class AllocationCounter
+{
+public:
+  enum class Scope
+  {
+    THREAD,
+    PROCESS
+  };
+
+  explicit AllocationCounter(const Scope &scope = Scope::THREAD);
+
+  void Reset();
+
+  std::uint64_t GetAllocations() const;
+  std::uint64_t GetDeallocations() const;
+
+private:
+  Scope scope;
+  std::uint64_t allocations;
+  std::uint64_t deallocations;
+
+  std::uint64_t CurrentAllocations() const;
+  std::uint64_t CurrentDeallocations() const;
+};
+
+#endif
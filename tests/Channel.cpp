@@ -0,0 +1,47 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/Pipeline/Channel.h"
+
+using namespace Pipeline;
+using namespace Packets;
+
+
+BOOST_AUTO_TEST_SUITE( Channel_Tests )
+
+BOOST_AUTO_TEST_CASE( Acquire_ReservedBuffer )
+{
+  Channel channel(4, 1500);
+
+  Packet::Data buffer = channel.Acquire();
+
+  BOOST_CHECK(buffer.empty());
+  BOOST_CHECK_GE(buffer.capacity(), 1500);
+}
+
+
+BOOST_AUTO_TEST_CASE( Release_BufferIsReused )
+{
+  Channel channel(1, 100);
+  Packet::Data buffer = channel.Acquire();
+  buffer.assign({ 0x01, 0x02 });
+  const auto *storage = buffer.data();
+
+  BOOST_CHECK(channel.TryPush(std::move(buffer)));
+  BOOST_CHECK(!channel.IsEmpty());
+
+  Packet::Data received;
+  BOOST_CHECK(channel.TryPop(received));
+  BOOST_CHECK_EQUAL(received.size(), 2);
+  channel.Release(std::move(received));
+
+  Packet::Data reused = channel.Acquire();
+  BOOST_CHECK(reused.empty());
+  BOOST_CHECK(reused.data() == storage);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+
+#include "../src/Scheduling/Classifier.h"
+
+using namespace Packets;
+using namespace Scheduling;
+
+
+namespace
+{
+
+Packet::Data
+MakeIPv4(const std::uint8_t &protocol, const std::size_t &payload_size,
+         const std::uint8_t &dscp = 0)
+{
+  const std::size_t size = 20 + payload_size;
+  Packet::Data packet(size, 0x00);
+
+  packet[0] = 0x45;
+  packet[1] = dscp << 2;
+  packet[2] = size >> 8;
+  packet[3] = size & 0xFF;
+  packet[8] = 64;
+  packet[9] = protocol;
+
+  return packet;
+}
+
+
+Packet::Data
+MakeIPv4Tcp(const std::size_t &tcp_payload_size, const std::uint8_t &dscp = 0)
+{
+  Packet::Data packet = MakeIPv4(6, 20 + tcp_payload_size, dscp);
+
+  packet[20 + 12] = 0x50; // data offset: 5 words
+  packet[20 + 13] = 0x10; // ACK
+
+  return packet;
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( Classifier_Tests )
+
+BOOST_AUTO_TEST_CASE( TcpAckWithoutPayload )
+{
+  Classifier classifier;
+
+  BOOST_CHECK(classifier.Classify(MakeIPv4Tcp(0)) == TrafficClass::ACK);
+}
+
+
+BOOST_AUTO_TEST_CASE( SmallTcpSegment_Interactive )
+{
+  Classifier classifier;
+
+  BOOST_CHECK(classifier.Classify(MakeIPv4Tcp(1)) == TrafficClass::INTERACTIVE);
+}
+
+
+BOOST_AUTO_TEST_CASE( MediumPacket_Default )
+{
+  Classifier classifier;
+
+  BOOST_CHECK(classifier.Classify(MakeIPv4(17, 500)) == TrafficClass::DEFAULT);
+}
+
+
+BOOST_AUTO_TEST_CASE( BigPacket_Bulk )
+{
+  Classifier classifier;
+
+  BOOST_CHECK(classifier.Classify(MakeIPv4Tcp(1400)) == TrafficClass::BULK);
+}
+
+
+BOOST_AUTO_TEST_CASE( DSCP_ExpeditedForwarding_Interactive )
+{
+  Classifier classifier;
+
+  BOOST_CHECK(classifier.Classify(MakeIPv4Tcp(1400, 46)) == TrafficClass::INTERACTIVE);
+}
+
+
+BOOST_AUTO_TEST_CASE( DSCP_CS1_Bulk )
+{
+  Classifier classifier;
+
+  BOOST_CHECK(classifier.Classify(MakeIPv4Tcp(0, 8)) == TrafficClass::BULK);
+}
+
+
+BOOST_AUTO_TEST_CASE( IPv6_TrafficClass )
+{
+  Classifier classifier;
+  Packet::Data packet(40 + 8, 0x00);
+
+  // version 6, DSCP 46
+  packet[0] = 0x6B;
+  packet[1] = 0x80;
+  packet[5] = 8;
+  packet[6] = 17;
+
+  BOOST_CHECK(classifier.Classify(packet) == TrafficClass::INTERACTIVE);
+}
+
+
+BOOST_AUTO_TEST_CASE( HeaderOffset_Skipped )
+{
+  Classifier classifier(4);
+  Packet::Data packet { 0x00, 0x00, 0x08, 0x00 };
+  Packet::Data ack = MakeIPv4Tcp(0);
+  packet.insert(packet.end(), ack.begin(), ack.end());
+
+  BOOST_CHECK(classifier.Classify(packet) == TrafficClass::ACK);
+}
+
+
+BOOST_AUTO_TEST_CASE( TruncatedPacket_Default )
+{
+  Classifier classifier;
+  Packet::Data packet = MakeIPv4Tcp(0);
+  packet.resize(30);
+
+  BOOST_CHECK(classifier.Classify(packet) == TrafficClass::DEFAULT);
+  BOOST_CHECK(classifier.Classify(Packet::Data { 0x45 }) == TrafficClass::DEFAULT);
+}
+
+
+BOOST_AUTO_TEST_CASE( GetFlow_DependsOnPorts )
+{
+  Classifier classifier;
+  Packet::Data first = MakeIPv4Tcp(10);
+  Packet::Data second = MakeIPv4Tcp(100);
+  Packet::Data other_port = MakeIPv4Tcp(10);
+  other_port[20 + 1] = 0x50;
+
+  BOOST_CHECK(classifier.GetFlow(first) != 0);
+  BOOST_CHECK_EQUAL(classifier.GetFlow(first), classifier.GetFlow(second));
+  BOOST_CHECK(classifier.GetFlow(first) != classifier.GetFlow(other_port));
+}
+
+
+BOOST_AUTO_TEST_CASE( GetFlow_UnknownPacket )
+{
+  Classifier classifier;
+
+  BOOST_CHECK_EQUAL(classifier.GetFlow(Packet::Data { 0x45 }), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
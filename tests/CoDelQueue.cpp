@@ -0,0 +1,138 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+
+#include "../src/Scheduling/CoDelQueue.h"
+
+using namespace Packets;
+using namespace Scheduling;
+using std::chrono::milliseconds;
+
+
+namespace
+{
+
+// IPv4 header with given ECN bits and zeroed checksum
+Packet::Data
+MakeIPv4(const std::uint8_t &id, const std::uint8_t &ecn = 0)
+{
+  Packet::Data packet(20, 0x00);
+
+  packet[0] = 0x45;
+  packet[1] = ecn;
+  packet[3] = 20;
+  packet[5] = id;
+
+  return packet;
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( CoDelQueue_Tests )
+
+BOOST_AUTO_TEST_CASE( Fifo )
+{
+  CoDelQueue queue;
+  const auto now = CoDelQueue::Clock::now();
+  Packet::Data packet;
+
+  BOOST_CHECK(queue.Enqueue(MakeIPv4(1), now));
+  BOOST_CHECK(queue.Enqueue(MakeIPv4(2), now));
+
+  BOOST_REQUIRE(queue.Dequeue(packet, now));
+  BOOST_CHECK_EQUAL(packet.at(5), 1);
+  BOOST_REQUIRE(queue.Dequeue(packet, now));
+  BOOST_CHECK_EQUAL(packet.at(5), 2);
+  BOOST_CHECK(!queue.Dequeue(packet, now));
+}
+
+
+BOOST_AUTO_TEST_CASE( TailDropWhenFull )
+{
+  CoDelQueue queue(0, 2);
+  const auto now = CoDelQueue::Clock::now();
+
+  BOOST_CHECK(queue.Enqueue(MakeIPv4(1), now));
+  BOOST_CHECK(queue.Enqueue(MakeIPv4(2), now));
+  BOOST_CHECK(!queue.Enqueue(MakeIPv4(3), now));
+
+  BOOST_CHECK_EQUAL(queue.GetSize(), 2);
+  BOOST_CHECK_EQUAL(queue.GetStats().tail_dropped, 1);
+}
+
+
+BOOST_AUTO_TEST_CASE( SojournTimeInStats )
+{
+  CoDelQueue queue;
+  const auto now = CoDelQueue::Clock::now();
+  Packet::Data packet;
+
+  queue.Enqueue(MakeIPv4(1), now);
+  queue.Dequeue(packet, now + milliseconds(3));
+
+  BOOST_CHECK_EQUAL(queue.GetStats().sojourn_time.count(), 3000);
+}
+
+
+BOOST_AUTO_TEST_CASE( DropWhenDelayAboveTargetForInterval )
+{
+  CoDelQueue queue(0, 100, milliseconds(5), milliseconds(100));
+  const auto now = CoDelQueue::Clock::now();
+  Packet::Data packet;
+
+  for (std::uint8_t i = 1; i <= 10; i++)
+    queue.Enqueue(MakeIPv4(i), now);
+
+  BOOST_REQUIRE(queue.Dequeue(packet, now + milliseconds(10)));
+  BOOST_CHECK_EQUAL(packet.at(5), 1);
+  BOOST_CHECK_EQUAL(queue.GetStats().codel_dropped, 0);
+
+  BOOST_REQUIRE(queue.Dequeue(packet, now + milliseconds(120)));
+  BOOST_CHECK_EQUAL(packet.at(5), 3);
+  BOOST_CHECK_EQUAL(queue.GetStats().codel_dropped, 1);
+}
+
+
+BOOST_AUTO_TEST_CASE( MarkEcnCapablePacketInsteadOfDrop )
+{
+  CoDelQueue queue(0, 100, milliseconds(5), milliseconds(100));
+  const auto now = CoDelQueue::Clock::now();
+  Packet::Data packet;
+
+  for (std::uint8_t i = 1; i <= 10; i++)
+    queue.Enqueue(MakeIPv4(i, 0x02), now);
+
+  queue.Dequeue(packet, now + milliseconds(10));
+
+  BOOST_REQUIRE(queue.Dequeue(packet, now + milliseconds(120)));
+  BOOST_CHECK_EQUAL(packet.at(5), 2);
+  BOOST_CHECK_EQUAL(packet.at(1) & 0x03, 0x03);
+  BOOST_CHECK_EQUAL(queue.GetStats().codel_dropped, 0);
+  BOOST_CHECK_EQUAL(queue.GetStats().ecn_marked, 1);
+}
+
+
+BOOST_AUTO_TEST_CASE( NoDropBelowTarget )
+{
+  CoDelQueue queue(0, 100, milliseconds(5), milliseconds(100));
+  const auto now = CoDelQueue::Clock::now();
+  Packet::Data packet;
+
+  for (int i = 0; i < 1000; i++)
+  {
+    const auto t = now + milliseconds(i);
+    queue.Enqueue(MakeIPv4(1), t);
+    queue.Enqueue(MakeIPv4(2), t);
+    BOOST_REQUIRE(queue.Dequeue(packet, t + milliseconds(1)));
+    BOOST_REQUIRE(queue.Dequeue(packet, t + milliseconds(1)));
+  }
+
+  BOOST_CHECK_EQUAL(queue.GetStats().codel_dropped, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,591 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../src/Codec/Sender.h"
+#include "../src/Codec/Receiver.h"
+#include "../src/Codec/ParallelSender.h"
+#include "../src/Codec/ParallelReceiver.h"
+#include "../src/Metrics/Counter.h"
+#include "../src/Packets/PseudoDNS.h"
+#include "../src/Crypto/Aead.h"
+
+using namespace Codec;
+using namespace Packets;
+
+
+namespace
+{
+
+Packet::Data
+MakeUdpPacket(const std::uint8_t &source, const std::size_t &size)
+{
+  Packet::Data packet(size, 0xAB);
+
+  packet[0] = 0x45;
+  packet[2] = size >> 8;
+  packet[3] = size & 0xFF;
+  packet[9] = 17;
+  packet[12] = 10;
+  packet[15] = source;
+  packet[16] = 10;
+  packet[19] = 1;
+  packet[20] = 0x10;
+  packet[21] = source;
+  packet[22] = 0x00;
+  packet[23] = 53;
+
+  return packet;
+}
+
+
+std::vector<Packet::Data>
+Transfer(Sender &sender, Receiver &receiver)
+{
+  const auto now = Sender::Clock::now();
+  std::vector<Packet::Data> packets;
+  Packet::Data datagram;
+
+  while (sender.Pull(datagram, now))
+    receiver.Push(datagram, packets, now);
+
+  return packets;
+}
+
+
+// dumps of all datagrams of the packet, every new Sender uses the same
+// stream ids
+std::vector<Packet::Data>
+Encode(const Packet::Data &packet, const Sender::Clock::time_point &now)
+{
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Packet::Data p = packet;
+  sender.Push(p, now);
+
+  std::vector<Packet::Data> datagrams;
+  Packet::Data datagram;
+  while (sender.Pull(datagram, now))
+    datagrams.push_back(datagram);
+
+  return datagrams;
+}
+
+
+Packet::Data
+MakeFragment(const std::uint16_t &stream_id, const Packet::Control &control)
+{
+  PseudoDNS fragment;
+  fragment.SetStreamId(stream_id);
+
+  if (control == Packet::Control::NONE)
+    fragment.SetData(Packet::Data(10, stream_id));
+  else
+  {
+    fragment.SetType(Packet::Type::CONTROL);
+    fragment.SetControlType(control);
+  }
+
+  return fragment.Dump();
+}
+
+
+class FailingSender : public Sender
+{
+public:
+  FailingSender() :
+    Sender(std::unique_ptr<Packet>(new PseudoDNS()), 0)
+  {
+  }
+
+  void Encapsulate(Transmission &) override
+  {
+    throw std::runtime_error("encapsulation failed");
+  }
+};
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( Codec_Tests )
+
+BOOST_AUTO_TEST_CASE( Pull_NothingQueued )
+{
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Packet::Data datagram;
+
+  BOOST_CHECK(!sender.Pull(datagram, Sender::Clock::now()));
+  BOOST_CHECK(!sender.HasPendingData());
+}
+
+
+BOOST_AUTO_TEST_CASE( Push_LeavesEmptyBuffer )
+{
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Packet::Data packet = MakeUdpPacket(1, 100);
+
+  BOOST_CHECK(sender.Push(packet, Sender::Clock::now()));
+  BOOST_CHECK(packet.empty());
+  BOOST_CHECK(sender.HasPendingData());
+}
+
+
+BOOST_AUTO_TEST_CASE( RoundTrip_SinglePacket )
+{
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  const Packet::Data expected = MakeUdpPacket(1, 1400);
+
+  Packet::Data packet = expected;
+  sender.Push(packet, Sender::Clock::now());
+
+  const auto received = Transfer(sender, receiver);
+
+  BOOST_REQUIRE_EQUAL(received.size(), 1);
+  BOOST_CHECK_EQUAL_COLLECTIONS(received[0].begin(), received[0].end(),
+				expected.begin(), expected.end());
+  BOOST_CHECK(!sender.HasPendingData());
+}
+
+
+BOOST_AUTO_TEST_CASE( RoundTrip_InterleavedFlows )
+{
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  std::vector<Packet::Data> expected;
+
+  for (std::uint8_t flow = 1; flow <= 4; flow++)
+  {
+    expected.push_back(MakeUdpPacket(flow, 900 + flow));
+    Packet::Data packet = expected.back();
+    sender.Push(packet, Sender::Clock::now());
+  }
+
+  auto received = Transfer(sender, receiver);
+
+  BOOST_REQUIRE_EQUAL(received.size(), expected.size());
+  for (const auto &e : expected)
+    BOOST_CHECK(std::find(received.begin(), received.end(), e) != received.end());
+}
+
+
+BOOST_AUTO_TEST_CASE( RoundTrip_Aggregated )
+{
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  sender.SetAggregation(512, std::chrono::microseconds(1000));
+  std::vector<Packet::Data> expected;
+
+  const auto now = Sender::Clock::now();
+  for (std::uint8_t flow = 1; flow <= 3; flow++)
+  {
+    expected.push_back(MakeUdpPacket(flow, 40));
+    Packet::Data packet = expected.back();
+    sender.Push(packet, now);
+  }
+
+  Packet::Data datagram;
+  BOOST_CHECK(!sender.Pull(datagram, now));
+
+  std::vector<Packet::Data> received;
+  while (sender.Pull(datagram, now + std::chrono::milliseconds(2)))
+    receiver.Push(datagram, received, now);
+
+  BOOST_REQUIRE_EQUAL(received.size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); i++)
+    BOOST_CHECK_EQUAL_COLLECTIONS(received[i].begin(), received[i].end(),
+				  expected[i].begin(), expected[i].end());
+}
+
+BOOST_AUTO_TEST_CASE( Push_DamagedDatagramIsDropped )
+{
+  std::unique_ptr<PseudoDNS> prototype(new PseudoDNS());
+  prototype->SetChecksum(true);
+  Sender sender(prototype->Clone(), 0);
+  Receiver receiver(prototype->Clone());
+
+  Packet::Data packet = MakeUdpPacket(1, 100);
+  sender.Push(packet, Sender::Clock::now());
+
+  std::vector<Packet::Data> received;
+  Packet::Data datagram;
+  bool damaged = false;
+  const auto now = Sender::Clock::now();
+  while (sender.Pull(datagram, now))
+  {
+    if (!damaged)
+    {
+      datagram[15] ^= 0x80;
+      damaged = true;
+    }
+
+    BOOST_CHECK_NO_THROW(receiver.Push(datagram, received, now));
+  }
+
+  // the damaged fragment is missing, so the packet can't be complete
+  BOOST_CHECK(received.empty() || received[0] != MakeUdpPacket(1, 100));
+}
+
+
+BOOST_AUTO_TEST_CASE( RoundTrip_Encrypted )
+{
+  const auto key = Crypto::Aead::DeriveKey("secret", "test");
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  sender.SetEncryption(std::unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::Algorithm::CHACHA20_POLY1305, key)));
+  receiver.SetEncryption(std::unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::Algorithm::CHACHA20_POLY1305, key)));
+  const Packet::Data expected = MakeUdpPacket(1, 300);
+
+  Packet::Data packet = expected;
+  sender.Push(packet, Sender::Clock::now());
+
+  const auto received = Transfer(sender, receiver);
+
+  BOOST_REQUIRE_EQUAL(received.size(), 1);
+  BOOST_CHECK_EQUAL_COLLECTIONS(received[0].begin(), received[0].end(),
+				expected.begin(), expected.end());
+}
+
+
+BOOST_AUTO_TEST_CASE( RoundTrip_WrongKeyIsDropped )
+{
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  sender.SetEncryption(std::unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::Algorithm::AES_256_GCM, Crypto::Aead::DeriveKey("a", "test"))));
+  receiver.SetEncryption(std::unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::Algorithm::AES_256_GCM, Crypto::Aead::DeriveKey("b", "test"))));
+
+  Packet::Data packet = MakeUdpPacket(1, 300);
+  sender.Push(packet, Sender::Clock::now());
+
+  BOOST_CHECK(Transfer(sender, receiver).empty());
+}
+
+
+BOOST_AUTO_TEST_CASE( RoundTrip_ReplayIsDropped )
+{
+  const auto key = Crypto::Aead::DeriveKey("secret", "test");
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  sender.SetEncryption(std::unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::Algorithm::AES_256_GCM, key)));
+  receiver.SetEncryption(std::unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::Algorithm::AES_256_GCM, key)));
+  const auto now = Sender::Clock::now();
+
+  Packet::Data packet = MakeUdpPacket(1, 300);
+  sender.Push(packet, now);
+
+  std::vector<Packet::Data> datagrams;
+  Packet::Data datagram;
+  while (sender.Pull(datagram, now))
+    datagrams.push_back(datagram);
+
+  std::vector<Packet::Data> received;
+  for (int i = 0; i < 2; i++)
+    for (auto &d : datagrams)
+      receiver.Push(d, received, now);
+
+  BOOST_CHECK_EQUAL(received.size(), 1);
+}
+
+
+BOOST_AUTO_TEST_CASE( RoundTrip_RestartedSenderIsAccepted )
+{
+  const auto key = Crypto::Aead::DeriveKey("secret", "test");
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  receiver.SetEncryption(std::unique_ptr<Crypto::Aead>(
+    new Crypto::Aead(Crypto::Aead::Algorithm::AES_256_GCM, key)));
+
+  // every Sender starts a newer epoch
+  for (int i = 0; i < 2; i++)
+  {
+    Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+    sender.SetEncryption(std::unique_ptr<Crypto::Aead>(
+      new Crypto::Aead(Crypto::Aead::Algorithm::AES_256_GCM, key)));
+
+    Packet::Data packet = MakeUdpPacket(1, 300);
+    sender.Push(packet, Sender::Clock::now());
+
+    BOOST_CHECK_EQUAL(Transfer(sender, receiver).size(), 1);
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( Latency_RecordsStages )
+{
+  std::shared_ptr<Latency> latency(new Latency());
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  sender.SetLatency(latency);
+  receiver.SetLatency(latency);
+
+  Packet::Data first = MakeUdpPacket(1, 300);
+  Packet::Data second = MakeUdpPacket(2, 40);
+  sender.Push(first, Sender::Clock::now());
+  sender.Push(second, Sender::Clock::now());
+
+  BOOST_REQUIRE_EQUAL(Transfer(sender, receiver).size(), 2);
+
+  const Latency::Stats stats = latency->GetStats();
+  BOOST_CHECK_EQUAL(stats.tun_to_socket.count, 2);
+  BOOST_CHECK_EQUAL(stats.reassembly.count, 2);
+  BOOST_CHECK_EQUAL(stats.round_trip.count, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( Echo_RoundTrip )
+{
+  std::shared_ptr<Latency> latency(new Latency());
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver local(std::unique_ptr<Packet>(new PseudoDNS()));
+  Receiver peer(std::unique_ptr<Packet>(new PseudoDNS()));
+  sender.SetEchoInterval(std::chrono::milliseconds(1000));
+  local.SetLatency(latency);
+
+  const auto now = Sender::Clock::now();
+  std::vector<Packet::Data> packets;
+  Packet::Data datagram;
+  Packet::Data reply;
+
+  BOOST_REQUIRE(sender.Pull(datagram, now));
+  BOOST_CHECK(!sender.Pull(datagram, now + std::chrono::milliseconds(10)));
+
+  peer.Push(datagram, packets, now);
+  BOOST_CHECK(packets.empty());
+  BOOST_REQUIRE(peer.PullReply(reply));
+  BOOST_CHECK(!peer.PullReply(reply));
+
+  // measured at the time passed in, not when the test gets to it
+  local.Push(reply, packets, now + std::chrono::milliseconds(50));
+  BOOST_CHECK(packets.empty());
+  BOOST_CHECK(!local.PullReply(reply));
+  BOOST_CHECK_EQUAL(latency->GetStats().round_trip.count, 1);
+  BOOST_CHECK(latency->GetStats().round_trip.max == std::chrono::milliseconds(50));
+}
+
+BOOST_AUTO_TEST_CASE( PendingFragments_RestoreReassembly )
+{
+  Sender sender(std::unique_ptr<Packet>(new PseudoDNS()), 0);
+  Receiver stopped(std::unique_ptr<Packet>(new PseudoDNS()));
+  Receiver taking_over(std::unique_ptr<Packet>(new PseudoDNS()));
+
+  const Packet::Data original = MakeUdpPacket(1, 300);
+  Packet::Data packet = original;
+  const auto now = Sender::Clock::now();
+  sender.Push(packet, now);
+
+  std::vector<Packet::Data> datagrams;
+  Packet::Data datagram;
+  while (sender.Pull(datagram, now))
+    datagrams.push_back(datagram);
+  BOOST_REQUIRE(datagrams.size() > 2);
+
+  // first half reaches the stopped receiver
+  std::vector<Packet::Data> packets;
+  const std::size_t half = datagrams.size() / 2;
+  for (std::size_t i = 0; i < half; i++)
+    stopped.Push(datagrams[i], packets, now);
+
+  const auto fragments = stopped.GetPendingFragments();
+  BOOST_CHECK_EQUAL(fragments.size(), half);
+
+  for (auto &f : fragments)
+    taking_over.Push(f, packets, now);
+  for (std::size_t i = half; i < datagrams.size(); i++)
+    taking_over.Push(datagrams[i], packets, now);
+
+  BOOST_REQUIRE_EQUAL(packets.size(), 1);
+  BOOST_CHECK(packets[0] == original);
+  BOOST_CHECK(taking_over.GetPendingFragments().empty());
+}
+
+BOOST_AUTO_TEST_CASE( Reassembly_IdleStreamExpires )
+{
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  const auto now = Sender::Clock::now();
+
+  const auto end_lost = Encode(MakeUdpPacket(1, 300), now);
+  const Packet::Data next = MakeUdpPacket(2, 300);
+  const auto complete = Encode(next, now);
+  BOOST_REQUIRE(end_lost.size() > 2);
+
+  std::vector<Packet::Data> packets;
+  for (std::size_t i = 0; i + 1 < end_lost.size(); i++)
+    receiver.Push(end_lost[i], packets, now);
+  BOOST_CHECK_EQUAL(receiver.GetStreamCount(), 1);
+
+  // the next train of the same stream doesn't get the stale fragments
+  const auto later = now + Receiver::DEFAULT_STREAM_TIMEOUT + std::chrono::milliseconds(1);
+  for (auto &d : complete)
+    receiver.Push(d, packets, later);
+
+  BOOST_REQUIRE_EQUAL(packets.size(), 1);
+  BOOST_CHECK(packets[0] == next);
+  BOOST_CHECK_EQUAL(receiver.GetStreamCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( Reassembly_LongStreamIsDropped )
+{
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  receiver.SetReassemblyLimits(Receiver::DEFAULT_STREAM_TIMEOUT, 2 * PseudoDNS::MAX_DATA_SIZE,
+                               Receiver::DEFAULT_MAX_STREAMS);
+  const auto now = Sender::Clock::now();
+
+  const auto too_long = Encode(MakeUdpPacket(1, 300), now);
+  const Packet::Data short_one = MakeUdpPacket(2, 100);
+  const auto fits = Encode(short_one, now);
+  BOOST_REQUIRE(too_long.size() > 3);
+  BOOST_REQUIRE_EQUAL(fits.size(), 3);
+
+  std::vector<Packet::Data> packets;
+  for (auto &d : too_long)
+    receiver.Push(d, packets, now);
+
+  BOOST_CHECK(packets.empty());
+  BOOST_CHECK_EQUAL(receiver.GetStreamCount(), 0);
+
+  for (auto &d : fits)
+    receiver.Push(d, packets, now);
+
+  BOOST_REQUIRE_EQUAL(packets.size(), 1);
+  BOOST_CHECK(packets[0] == short_one);
+}
+
+BOOST_AUTO_TEST_CASE( Reassembly_OldestStreamMakesRoom )
+{
+  Receiver receiver(std::unique_ptr<Packet>(new PseudoDNS()));
+  receiver.SetReassemblyLimits(Receiver::DEFAULT_STREAM_TIMEOUT, Receiver::DEFAULT_MAX_STREAM_SIZE, 2);
+  const auto now = Sender::Clock::now();
+
+  std::vector<Packet::Data> packets;
+  for (std::uint16_t id = 1; id <= 3; id++)
+    receiver.Push(MakeFragment(id, Packet::Control::NONE), packets,
+                  now + std::chrono::milliseconds(id));
+  BOOST_CHECK_EQUAL(receiver.GetStreamCount(), 2);
+
+  for (std::uint16_t id = 1; id <= 3; id++)
+    receiver.Push(MakeFragment(id, Packet::Control::END_OF_TRANSMISSION), packets,
+                  now + std::chrono::milliseconds(10));
+
+  // the first stream was dropped
+  BOOST_REQUIRE_EQUAL(packets.size(), 2);
+  BOOST_CHECK(packets[0] == Packet::Data(10, 2));
+  BOOST_CHECK(packets[1] == Packet::Data(10, 3));
+  BOOST_CHECK_EQUAL(receiver.GetStreamCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( Parallel_RoundTripKeepsOrder )
+{
+  const auto key = Crypto::Aead::DeriveKey("secret", "test");
+  auto create_sender = [&key]() {
+    std::unique_ptr<Sender> sender(new Sender(std::unique_ptr<Packet>(new PseudoDNS()), 0));
+    sender->SetEncryption(std::unique_ptr<Crypto::Aead>(
+      new Crypto::Aead(Crypto::Aead::Algorithm::AES_256_GCM, key)));
+    return sender;
+  };
+  auto create_receiver = [&key]() {
+    std::unique_ptr<Receiver> receiver(new Receiver(std::unique_ptr<Packet>(new PseudoDNS())));
+    receiver->SetEncryption(std::unique_ptr<Crypto::Aead>(
+      new Crypto::Aead(Crypto::Aead::Algorithm::AES_256_GCM, key)));
+    return receiver;
+  };
+  ParallelSender encoder(create_sender, 3);
+  ParallelReceiver decoder(create_receiver, 3);
+
+  // a single flow and traffic class, so packets keep their order
+  std::vector<Packet::Data> sent;
+  const auto now = Sender::Clock::now();
+  for (std::size_t i = 0; i < 100; i++)
+  {
+    sent.push_back(MakeUdpPacket(1, 400));
+    sent.back()[30] = static_cast<std::uint8_t>(i);
+    Packet::Data p = sent.back();
+    BOOST_REQUIRE(encoder.GetSender().Push(p, now));
+  }
+
+  std::vector<Packet::Data> datagrams;
+  std::vector<Packet::Data> received;
+  std::size_t next = 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+  while ((encoder.HasPendingData() || next < datagrams.size() || decoder.HasPendingData())
+         && std::chrono::steady_clock::now() < deadline)
+  {
+    encoder.Poll(datagrams, now);
+
+    while (next < datagrams.size() && decoder.Push(Packet::Data(datagrams[next])))
+      next++;
+
+    decoder.Poll(received, now);
+    std::this_thread::yield();
+  }
+
+  BOOST_REQUIRE_EQUAL(received.size(), sent.size());
+  BOOST_CHECK(received == sent);
+}
+
+
+BOOST_AUTO_TEST_CASE( Parallel_FailedTransmissionsAreReleased )
+{
+  ParallelSender encoder([]() {
+    return std::unique_ptr<Sender>(new FailingSender());
+  }, 2);
+
+  // more than fit in flight, failed ones have to make room
+  const auto now = Sender::Clock::now();
+  for (std::size_t i = 0; i < 3 * Sender::MAX_TRAINS_IN_FLIGHT; i++)
+  {
+    Packet::Data p = MakeUdpPacket(1, 400);
+    BOOST_REQUIRE(encoder.GetSender().Push(p, now));
+  }
+
+  std::vector<Packet::Data> datagrams;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (encoder.HasPendingData() && std::chrono::steady_clock::now() < deadline)
+  {
+    encoder.Poll(datagrams, now);
+    std::this_thread::yield();
+  }
+
+  BOOST_CHECK(!encoder.HasPendingData());
+  BOOST_CHECK(datagrams.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE( Parallel_DamagedDatagramIsCounted )
+{
+  Metrics::Counter corrupted("sdnst_dropped_datagrams_total",
+                             "Received datagrams and transmissions dropped by the decoder.",
+                             "reason=\"corrupted\"");
+  const std::int64_t before = corrupted.GetValue();
+
+  ParallelReceiver decoder([]() {
+    return std::unique_ptr<Receiver>(new Receiver(std::unique_ptr<Packet>(new PseudoDNS())));
+  }, 2);
+  BOOST_REQUIRE(decoder.Push(Packet::Data(20, 0x00)));
+
+  std::vector<Packet::Data> packets;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (decoder.HasPendingData() && std::chrono::steady_clock::now() < deadline)
+  {
+    decoder.Poll(packets, Receiver::Clock::now());
+    std::this_thread::yield();
+  }
+
+  BOOST_CHECK(packets.empty());
+  BOOST_CHECK_EQUAL(corrupted.GetValue(), before + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
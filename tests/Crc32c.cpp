@@ -0,0 +1,83 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../src/Packets/Crc32c.h"
+
+using namespace Packets;
+
+
+namespace
+{
+
+const std::string check_input = "123456789";
+constexpr std::uint32_t check_value = 0xE3069283;
+
+
+const std::uint8_t*
+Bytes(const std::string &s)
+{
+  return reinterpret_cast<const std::uint8_t*>(s.data());
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( Crc32c_Tests )
+
+BOOST_AUTO_TEST_CASE( Compute_CheckValue )
+{
+  BOOST_CHECK_EQUAL(Crc32c::Compute(Bytes(check_input), check_input.size()), check_value);
+  BOOST_CHECK_EQUAL(Crc32c::ComputeSoftware(Bytes(check_input), check_input.size()), check_value);
+}
+
+
+BOOST_AUTO_TEST_CASE( Compute_Zeros )
+{
+  const std::vector<std::uint8_t> zeros(32, 0x00);
+
+  BOOST_CHECK_EQUAL(Crc32c::Compute(zeros.data(), zeros.size()), 0x8A9136AA);
+}
+
+
+BOOST_AUTO_TEST_CASE( Compute_Empty )
+{
+  BOOST_CHECK_EQUAL(Crc32c::Compute(nullptr, 0), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( Compute_InParts )
+{
+  const std::uint32_t first = Crc32c::Compute(Bytes(check_input), 4);
+
+  BOOST_CHECK_EQUAL(Crc32c::Compute(Bytes(check_input) + 4, check_input.size() - 4, first),
+                    check_value);
+}
+
+
+BOOST_AUTO_TEST_CASE( ComputeHardware_SameAsSoftware )
+{
+  if (!Crc32c::IsHardwareSupported())
+    return;
+
+  std::vector<std::uint8_t> data;
+  for (int i = 0; i < 1500; i++)
+    data.push_back(i * 7);
+
+  // all alignments and tail lengths
+  for (std::size_t offset = 0; offset < 16; offset++)
+    for (std::size_t size = 0; size < 40; size++)
+      BOOST_CHECK_EQUAL(Crc32c::ComputeHardware(data.data() + offset, size),
+                        Crc32c::ComputeSoftware(data.data() + offset, size));
+
+  BOOST_CHECK_EQUAL(Crc32c::ComputeHardware(data.data(), data.size()),
+                    Crc32c::ComputeSoftware(data.data(), data.size()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
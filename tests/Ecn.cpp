@@ -0,0 +1,96 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/Scheduling/Ecn.h"
+
+using namespace Packets;
+using namespace Scheduling;
+
+
+namespace
+{
+
+std::uint16_t
+IPv4Checksum(const Packet::Data &packet)
+{
+  std::uint32_t sum = 0;
+
+  for (std::size_t i = 0; i < 20; i += 2)
+    sum += (packet[i] << 8) | packet[i + 1];
+
+  while (sum >> 16)
+    sum = (sum & 0xFFFF) + (sum >> 16);
+
+  return ~sum;
+}
+
+
+Packet::Data
+MakeIPv4(const std::uint8_t &ecn)
+{
+  Packet::Data packet {
+    0x45, ecn, 0x00, 0x14,
+    0x12, 0x34, 0x40, 0x00,
+    0x40, 0x06, 0x00, 0x00,
+    0x0A, 0x00, 0x00, 0x01,
+    0x0A, 0x00, 0x00, 0x02
+  };
+
+  const std::uint16_t checksum = IPv4Checksum(packet);
+  packet[10] = checksum >> 8;
+  packet[11] = checksum & 0xFF;
+
+  return packet;
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( Ecn_Tests )
+
+BOOST_AUTO_TEST_CASE( IPv4_NotEct_NotMarked )
+{
+  Packet::Data packet = MakeIPv4(0x00);
+  const Packet::Data original = packet;
+
+  BOOST_CHECK(!Ecn::MarkCongestionExperienced(packet, 0));
+  BOOST_CHECK(packet == original);
+}
+
+
+BOOST_AUTO_TEST_CASE( IPv4_Ect_MarkedAndChecksumUpdated )
+{
+  Packet::Data packet = MakeIPv4(0x02);
+
+  BOOST_CHECK(Ecn::MarkCongestionExperienced(packet, 0));
+  BOOST_CHECK_EQUAL(packet[1] & 0x03, 0x03);
+  BOOST_CHECK_EQUAL(IPv4Checksum(packet), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( IPv6_Ect_Marked )
+{
+  Packet::Data packet(40, 0x00);
+  packet[0] = 0x60;
+  packet[1] = 0x10; // ECT(1)
+
+  BOOST_CHECK(Ecn::MarkCongestionExperienced(packet, 0));
+  BOOST_CHECK_EQUAL((packet[1] >> 4) & 0x03, 0x03);
+}
+
+
+BOOST_AUTO_TEST_CASE( HeaderOffset )
+{
+  Packet::Data packet { 0x00, 0x00, 0x08, 0x00 };
+  Packet::Data ip = MakeIPv4(0x01);
+  packet.insert(packet.end(), ip.begin(), ip.end());
+
+  BOOST_CHECK(Ecn::MarkCongestionExperienced(packet, 4));
+  BOOST_CHECK_EQUAL(packet[5] & 0x03, 0x03);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -42,6 +42,17 @@ public:
   }
 
 
+  virtual void SetStreamId(const std::uint16_t &stream_id)
+  {
+    throw std::logic_error("RawDataTests::SetStreamId not implemented.");
+  }
+
+  virtual std::uint16_t GetStreamId() const
+  {
+    throw std::logic_error("RawDataTests::GetStreamId not implemented.");
+  }
+
+
   virtual void SetData(const Data &data)
   {
     this->data = data;
@@ -62,11 +73,21 @@ public:
     throw std::logic_error("RawDataTests::Dump not implemented.");
   }
 
+  virtual void Dump(Data &dump) const
+  {
+    throw std::logic_error("RawDataTests::Dump not implemented.");
+  }
+
   virtual int GetMaximumDataSize() const
   {
     return 3;
   }
 
+  virtual Signature GetSignature() const
+  {
+    throw std::logic_error("RawDataTests::GetSignature not implemented.");
+  }
+
   virtual std::unique_ptr<Packet> Clone() const
   {
     std::unique_ptr<Packet> p(new RawDataTests());
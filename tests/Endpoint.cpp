@@ -0,0 +1,134 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <netinet/in.h>
+
+#include "../src/Interfaces/Endpoint.h"
+#include "../src/Interfaces/Socket.h"
+#include "../src/Interfaces/InterfaceException.h"
+
+using namespace Interfaces;
+
+
+BOOST_AUTO_TEST_SUITE( Endpoint_Tests )
+
+BOOST_AUTO_TEST_CASE( Constructor_Empty )
+{
+  Endpoint endpoint;
+
+  BOOST_CHECK(!endpoint.IsValid());
+  BOOST_CHECK_EQUAL(endpoint.GetLength(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( Constructor_IPv4 )
+{
+  Endpoint endpoint("10.1.2.3", 53);
+
+  BOOST_CHECK(endpoint.IsValid());
+  BOOST_CHECK_EQUAL(endpoint.GetFamily(), AF_INET);
+  BOOST_CHECK_EQUAL(endpoint.GetPort(), 53);
+  BOOST_CHECK_EQUAL(endpoint.GetLength(), sizeof(sockaddr_in));
+  BOOST_CHECK_EQUAL(endpoint.GetAddress(), "10.1.2.3");
+  BOOST_CHECK_EQUAL(endpoint.ToString(), "10.1.2.3:53");
+}
+
+
+BOOST_AUTO_TEST_CASE( Constructor_IPv6 )
+{
+  Endpoint endpoint("::1", 5353);
+
+  BOOST_CHECK_EQUAL(endpoint.GetFamily(), AF_INET6);
+  BOOST_CHECK_EQUAL(endpoint.GetPort(), 5353);
+  BOOST_CHECK_EQUAL(endpoint.GetLength(), sizeof(sockaddr_in6));
+  BOOST_CHECK_EQUAL(endpoint.ToString(), "[::1]:5353");
+}
+
+
+BOOST_AUTO_TEST_CASE( Constructor_InvalidAddress )
+{
+  BOOST_CHECK_THROW(Endpoint("10.1.2.x", 53), InterfaceException);
+  BOOST_CHECK_THROW(Endpoint("::x", 53), InterfaceException);
+}
+
+
+BOOST_AUTO_TEST_CASE( Constructor_FromSockaddr )
+{
+  sockaddr_in s;
+  std::memset(&s, 0, sizeof(s));
+  s.sin_family = AF_INET;
+  s.sin_port = htons(1234);
+  s.sin_addr.s_addr = htonl(0x7F000001);
+
+  Endpoint endpoint(reinterpret_cast<sockaddr*>(&s), sizeof(s));
+
+  BOOST_CHECK(endpoint == Endpoint("127.0.0.1", 1234));
+}
+
+
+BOOST_AUTO_TEST_CASE( Compare_EqualityAndOrder )
+{
+  const Endpoint a("10.0.0.1", 53);
+  const Endpoint b("10.0.0.1", 54);
+  const Endpoint c("10.0.0.2", 53);
+  const Endpoint d("::1", 53);
+
+  BOOST_CHECK(a == Endpoint("10.0.0.1", 53));
+  BOOST_CHECK(a != b);
+  BOOST_CHECK(a != c);
+  BOOST_CHECK(a != d);
+
+  BOOST_CHECK(a < b || b < a);
+  BOOST_CHECK(!(a < a));
+
+  std::map<Endpoint, int> sessions { {a, 1}, {b, 2}, {c, 3}, {d, 4} };
+  BOOST_CHECK_EQUAL(sessions.size(), 4);
+  BOOST_CHECK_EQUAL(sessions[Endpoint("10.0.0.2", 53)], 3);
+}
+
+
+BOOST_AUTO_TEST_CASE( Hash_EqualEndpointsEqualHashes )
+{
+  BOOST_CHECK_EQUAL(Endpoint("10.0.0.1", 53).Hash(), Endpoint("10.0.0.1", 53).Hash());
+
+  std::unordered_set<Endpoint> endpoints;
+  endpoints.insert(Endpoint("10.0.0.1", 53));
+  endpoints.insert(Endpoint("10.0.0.1", 53));
+  endpoints.insert(Endpoint("10.0.0.1", 54));
+
+  BOOST_CHECK_EQUAL(endpoints.size(), 2);
+}
+
+
+BOOST_AUTO_TEST_CASE( Socket_SendToAndRecvFrom )
+{
+  auto server = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  auto client = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  server->Bind(Endpoint("127.0.0.1", 0));
+  client->Bind(Endpoint("127.0.0.1", 0));
+
+  // ports were chosen by the kernel
+  const Endpoint server_address = server->GetLocalEndpoint();
+  BOOST_CHECK(server_address.GetPort() != 0);
+
+  const char message[] = "datagram";
+  client->SendTo(message, sizeof(message), server_address);
+
+  char buffer[32];
+  Endpoint source;
+  BOOST_CHECK_EQUAL(server->RecvFrom(buffer, sizeof(buffer), source), sizeof(message));
+  BOOST_CHECK_EQUAL(source.GetAddress(), "127.0.0.1");
+  BOOST_CHECK(source.GetPort() != 0);
+
+  server->Close();
+  client->Close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <set>
+
+#include "../src/Scheduling/FlowScheduler.h"
+#include "../src/Packets/PseudoDNS.h"
+
+using namespace Packets;
+using namespace Scheduling;
+
+
+namespace
+{
+
+FlowScheduler::Train
+MakeTrain(const std::uint8_t &tag, const unsigned &fragments)
+{
+  FlowScheduler::Train train;
+
+  for (unsigned i = 0; i < fragments; i++)
+  {
+    std::unique_ptr<Packet> p(new PseudoDNS());
+    p->SetData({ tag });
+    train.push_back(std::move(p));
+  }
+
+  return train;
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( FlowScheduler_Tests )
+
+BOOST_AUTO_TEST_CASE( Empty_DequeueReturnsNull )
+{
+  FlowScheduler scheduler;
+
+  BOOST_CHECK(scheduler.IsEmpty());
+  BOOST_CHECK(scheduler.Dequeue() == nullptr);
+}
+
+
+BOOST_AUTO_TEST_CASE( FragmentsOfFlowsAreInterleaved )
+{
+  FlowScheduler scheduler;
+
+  scheduler.Enqueue(1, MakeTrain(0xAA, 3));
+  scheduler.Enqueue(2, MakeTrain(0xBB, 1));
+
+  std::vector<std::uint8_t> expected { 0xAA, 0xBB, 0xAA, 0xAA };
+  for (auto tag : expected)
+  {
+    auto packet = scheduler.Dequeue();
+    BOOST_REQUIRE(packet != nullptr);
+    BOOST_CHECK_EQUAL(packet->GetData().at(0), tag);
+  }
+
+  BOOST_CHECK(scheduler.IsEmpty());
+}
+
+
+BOOST_AUTO_TEST_CASE( Quantum_SendsSeveralFragmentsPerTurn )
+{
+  FlowScheduler scheduler(2);
+
+  scheduler.Enqueue(1, MakeTrain(0xAA, 3));
+  scheduler.Enqueue(2, MakeTrain(0xBB, 3));
+
+  std::vector<std::uint8_t> expected { 0xAA, 0xAA, 0xBB, 0xBB, 0xAA, 0xBB };
+  for (auto tag : expected)
+    BOOST_CHECK_EQUAL(scheduler.Dequeue()->GetData().at(0), tag);
+}
+
+
+BOOST_AUTO_TEST_CASE( FlowsGetDifferentStreamIds )
+{
+  FlowScheduler scheduler;
+  std::set<std::uint16_t> flow1, flow2;
+
+  scheduler.Enqueue(1, MakeTrain(0xAA, 2));
+  scheduler.Enqueue(2, MakeTrain(0xBB, 2));
+
+  while (!scheduler.IsEmpty())
+  {
+    auto packet = scheduler.Dequeue();
+    BOOST_CHECK(packet->GetStreamId() != 0);
+
+    if (packet->GetData().at(0) == 0xAA)
+      flow1.insert(packet->GetStreamId());
+    else
+      flow2.insert(packet->GetStreamId());
+  }
+
+  BOOST_REQUIRE_EQUAL(flow1.size(), 1);
+  BOOST_REQUIRE_EQUAL(flow2.size(), 1);
+  BOOST_CHECK(*flow1.begin() != *flow2.begin());
+}
+
+
+BOOST_AUTO_TEST_CASE( TrainsOfOneFlowAreNotInterleaved )
+{
+  FlowScheduler scheduler;
+
+  scheduler.Enqueue(1, MakeTrain(0xAA, 2));
+  scheduler.Enqueue(1, MakeTrain(0xBB, 2));
+  BOOST_CHECK_EQUAL(scheduler.GetTrainCount(), 2);
+  BOOST_CHECK_EQUAL(scheduler.GetFlowCount(), 1);
+
+  std::vector<std::uint8_t> expected { 0xAA, 0xAA, 0xBB, 0xBB };
+  for (auto tag : expected)
+    BOOST_CHECK_EQUAL(scheduler.Dequeue()->GetData().at(0), tag);
+
+  BOOST_CHECK_EQUAL(scheduler.GetTrainCount(), 0);
+  BOOST_CHECK_EQUAL(scheduler.GetFlowCount(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/Metrics/Histogram.h"
+#include "../src/Metrics/Registry.h"
+
+using namespace Metrics;
+
+
+BOOST_AUTO_TEST_SUITE( Histogram_Tests )
+
+BOOST_AUTO_TEST_CASE( BucketIndex_SmallValuesAreExact )
+{
+  for (std::uint64_t v = 0; v < 2 * Histogram::SUB_BUCKETS; v++)
+  {
+    BOOST_CHECK_EQUAL(Histogram::GetBucketIndex(v), v);
+    BOOST_CHECK_EQUAL(Histogram::GetBucketUpperBound(v), v);
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( BucketIndex_RelativeErrorIsBounded )
+{
+  std::size_t previous = 0;
+
+  for (std::uint64_t v = 1; v < (std::uint64_t(1) << 40); v = v * 3 / 2 + 1)
+  {
+    const std::size_t index = Histogram::GetBucketIndex(v);
+    const std::uint64_t upper = Histogram::GetBucketUpperBound(index);
+
+    BOOST_CHECK(index >= previous);
+    BOOST_CHECK(upper >= v);
+    BOOST_CHECK(upper - v <= v / Histogram::SUB_BUCKETS);
+    previous = index;
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( BucketIndex_FullRange )
+{
+  const std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+
+  BOOST_CHECK_EQUAL(Histogram::GetBucketIndex(max), Histogram::BUCKET_COUNT - 1);
+  BOOST_CHECK_EQUAL(Histogram::GetBucketUpperBound(Histogram::BUCKET_COUNT - 1), max);
+}
+
+
+BOOST_AUTO_TEST_CASE( Snapshot_Empty )
+{
+  Histogram histogram("test_histogram_empty", "Test histogram.");
+  const Histogram::Snapshot snapshot = histogram.GetSnapshot();
+
+  BOOST_CHECK_EQUAL(snapshot.GetCount(), 0);
+  BOOST_CHECK_EQUAL(snapshot.GetValueAtQuantile(0.99), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( Snapshot_Quantiles )
+{
+  Histogram histogram("test_histogram_quantiles", "Test histogram.");
+
+  for (std::uint64_t v = 1; v <= 100000; v++)
+    histogram.Record(v);
+
+  const Histogram::Snapshot snapshot = histogram.GetSnapshot();
+  BOOST_CHECK_EQUAL(snapshot.GetCount(), 100000);
+  BOOST_CHECK_EQUAL(snapshot.GetMax(), 100000);
+  BOOST_CHECK_EQUAL(snapshot.GetSum(), std::uint64_t(100000) * 100001 / 2);
+
+  const double quantiles[] { 0.5, 0.9, 0.99, 0.999 };
+  for (auto q : quantiles)
+  {
+    const double value = snapshot.GetValueAtQuantile(q);
+    BOOST_CHECK_GE(value, q * 100000);
+    BOOST_CHECK_LE(value, q * 100000 * (1.0 + 1.0 / Histogram::SUB_BUCKETS));
+  }
+
+  BOOST_CHECK_EQUAL(snapshot.GetValueAtQuantile(1.0), 100000);
+
+  const Histogram::Summary summary = snapshot.Summarize();
+  BOOST_CHECK_EQUAL(summary.count, 100000);
+  BOOST_CHECK(summary.p50 <= summary.p90);
+  BOOST_CHECK(summary.p99 <= summary.p999);
+  BOOST_CHECK_EQUAL(summary.max.count(), 100000);
+}
+
+
+BOOST_AUTO_TEST_CASE( Snapshot_Merge )
+{
+  Histogram fast("test_histogram_merge", "Test histogram.", "kind=\"fast\"");
+  Histogram slow("test_histogram_merge", "Test histogram.", "kind=\"slow\"");
+
+  for (int i = 0; i < 90; i++)
+    fast.Record(std::uint64_t(100));
+  for (int i = 0; i < 10; i++)
+    slow.Record(std::uint64_t(1000000));
+
+  Histogram::Snapshot merged = fast.GetSnapshot();
+  merged.Merge(slow.GetSnapshot());
+
+  BOOST_CHECK_EQUAL(merged.GetCount(), 100);
+  BOOST_CHECK_EQUAL(merged.GetMax(), 1000000);
+  BOOST_CHECK_GE(merged.GetValueAtQuantile(0.9), 100);
+  BOOST_CHECK_LE(merged.GetValueAtQuantile(0.9), 100 + 100 / Histogram::SUB_BUCKETS);
+  BOOST_CHECK_GE(merged.GetValueAtQuantile(0.91), 1000000);
+}
+
+
+BOOST_AUTO_TEST_CASE( Record_FromManyThreads )
+{
+  Histogram histogram("test_histogram_threads", "Test histogram.");
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++)
+    threads.emplace_back([&histogram, t]() {
+      for (int i = 0; i < 1000; i++)
+        histogram.Record(std::chrono::nanoseconds(1000 * (t + 1)));
+    });
+
+  for (auto &t : threads)
+    t.join();
+
+  const Histogram::Snapshot snapshot = histogram.GetSnapshot();
+  BOOST_CHECK_EQUAL(snapshot.GetCount(), 4000);
+  BOOST_CHECK_EQUAL(snapshot.GetMax(), 4000);
+}
+
+
+BOOST_AUTO_TEST_CASE( Registry_RendersMergedSummary )
+{
+  Histogram first("test_histogram_render_seconds", "Rendered histogram.", "stage=\"a\"");
+  Histogram second("test_histogram_render_seconds", "Rendered histogram.", "stage=\"a\"");
+
+  first.Record(std::uint64_t(2000000000));
+  second.Record(std::uint64_t(2000000000));
+
+  const std::string text = Registry::GetInstance().Render();
+
+  BOOST_CHECK(text.find("# HELP test_histogram_render_seconds Rendered histogram.\n"
+                        "# TYPE test_histogram_render_seconds summary\n"
+                        "test_histogram_render_seconds{stage=\"a\",quantile=\"0.5\"} 2\n")
+              != std::string::npos);
+  BOOST_CHECK(text.find("test_histogram_render_seconds_sum{stage=\"a\"} 4\n"
+                        "test_histogram_render_seconds_count{stage=\"a\"} 2\n")
+              != std::string::npos);
+}
+
+
+BOOST_AUTO_TEST_CASE( Registry_ForgetsDestroyedHistogram )
+{
+  {
+    Histogram histogram("test_histogram_destroyed", "Destroyed histogram.");
+    histogram.Record(std::uint64_t(1));
+  }
+
+  BOOST_CHECK(Registry::GetInstance().Render().find("test_histogram_destroyed") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "IpPacket.h"
+#include "../src/Restart/HotRestart.h"
+#include "../src/Restart/State.h"
+#include "../src/Restart/HandoffException.h"
+#include "../src/Interfaces/Socket.h"
+#include "../src/Interfaces/MemoryTun.h"
+#include "../src/PrimitiveReaderAndWriter.h"
+#include "../src/Codec/Sender.h"
+#include "../src/Crypto/Aead.h"
+#include "../src/Packets/PseudoDNS.h"
+
+using namespace Restart;
+using namespace Interfaces;
+using namespace Packets;
+
+
+BOOST_AUTO_TEST_SUITE( HotRestart_Tests )
+
+BOOST_AUTO_TEST_CASE( State_SerializeAndDeserialize )
+{
+  State state;
+  state.peer = Endpoint("10.1.2.3", 5353);
+  state.session_id = 0xBEEF;
+  state.fragments = { { 0x14, 0x1D, 0x00 }, {}, Packet::Data(300, 0xAB) };
+  state.next_stream_id = 0x1234;
+  state.replay_epoch = 0x0123456789ABCDEF;
+  state.replay_highest = 0xFEDCBA9876543210;
+  state.replay_seen.set(0);
+  state.replay_seen.set(9);
+  state.replay_seen.set(Crypto::ReplayWindow::SIZE - 1);
+
+  const State restored = State::Deserialize(state.Serialize());
+
+  BOOST_CHECK(restored.peer == state.peer);
+  BOOST_CHECK_EQUAL(restored.session_id, 0xBEEF);
+  BOOST_CHECK(restored.fragments == state.fragments);
+  BOOST_CHECK_EQUAL(restored.next_stream_id, 0x1234);
+  BOOST_CHECK_EQUAL(restored.replay_epoch, state.replay_epoch);
+  BOOST_CHECK_EQUAL(restored.replay_highest, state.replay_highest);
+  BOOST_CHECK(restored.replay_seen == state.replay_seen);
+}
+
+
+BOOST_AUTO_TEST_CASE( State_WithoutPeer )
+{
+  const State restored = State::Deserialize(State().Serialize());
+
+  BOOST_CHECK(!restored.peer.IsValid());
+  BOOST_CHECK(restored.fragments.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE( State_DeserializeDamaged )
+{
+  State state;
+  state.fragments = { { 0x01, 0x02, 0x03 } };
+  Packet::Data data = state.Serialize();
+
+  Packet::Data truncated(data.begin(), data.end() - 1);
+  BOOST_CHECK_THROW(State::Deserialize(truncated), HandoffException);
+
+  Packet::Data trailing = data;
+  trailing.push_back(0x00);
+  BOOST_CHECK_THROW(State::Deserialize(trailing), HandoffException);
+
+  data[0] = 0x00;
+  BOOST_CHECK_THROW(State::Deserialize(data), HandoffException);
+}
+
+
+BOOST_AUTO_TEST_CASE( TakeOver_NoRunningProcess )
+{
+  HotRestart hot_restart("/tmp/sdnst-test-missing-" + std::to_string(getpid()) + ".sock");
+  std::vector<int> descriptors;
+  Packet::Data state;
+
+  BOOST_CHECK_THROW(hot_restart.TakeOver(descriptors, state), HandoffException);
+}
+
+
+BOOST_AUTO_TEST_CASE( Handoff_PassesSocketAndState )
+{
+  const std::string path = "/tmp/sdnst-test-" + std::to_string(getpid()) + ".sock";
+
+  auto server = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  auto client = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  server->Bind(Endpoint("127.0.0.1", 0));
+  const Endpoint server_address = server->GetLocalEndpoint();
+
+  HotRestart running(path);
+  running.Listen();
+  BOOST_CHECK(!running.WaitForRequest(std::chrono::milliseconds(0)));
+
+  // new process
+  std::vector<int> descriptors;
+  Packet::Data state;
+  std::thread taking_over([&]() {
+    HotRestart hot_restart(path);
+    hot_restart.TakeOver(descriptors, state);
+  });
+
+  BOOST_REQUIRE(running.WaitForRequest(std::chrono::milliseconds(2000)));
+
+  // datagram sent during the switchover waits in the socket
+  const char message[] = "in flight";
+  client->SendTo(message, sizeof(message), server_address);
+
+  const Packet::Data sent_state { 0x01, 0x02, 0x03 };
+  running.Handoff({ server->GetDescriptor() }, sent_state);
+  taking_over.join();
+  server->Close();
+
+  BOOST_REQUIRE_EQUAL(descriptors.size(), 1);
+  BOOST_CHECK(state == sent_state);
+
+  auto taken_over = Socket::FromDescriptor(descriptors[0]);
+  BOOST_CHECK(taken_over->GetLocalEndpoint() == server_address);
+  BOOST_CHECK(!taken_over->IsConnected());
+
+  char buffer[32];
+  Endpoint source;
+  BOOST_CHECK_EQUAL(taken_over->RecvFrom(buffer, sizeof(buffer), source), sizeof(message));
+  BOOST_CHECK_EQUAL(std::string(buffer), message);
+
+  taken_over->Close();
+  client->Close();
+  running.Close();
+  unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( Handoff_SequenceStateContinues )
+{
+  const auto algorithm = Crypto::Aead::Algorithm::CHACHA20_POLY1305;
+  const auto to_server = Crypto::Aead::DeriveKey("secret", "to server");
+  const auto to_client = Crypto::Aead::DeriveKey("secret", "to client");
+
+  std::shared_ptr<Packet> prototype(new PseudoDNS());
+  std::shared_ptr<MemoryTun> device(new MemoryTun());
+  std::shared_ptr<TunTap> tun = device;
+  std::shared_ptr<Socket> server_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  server_socket->Bind(0, "127.0.0.1");
+  std::shared_ptr<Socket> client_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  client_socket->Connect(server_socket->GetLocalEndpoint());
+
+  // client driven by hand, so its datagrams can be sent again
+  Codec::Sender client(std::unique_ptr<Packet>(new PseudoDNS()), TunTap::PACKET_INFO_SIZE);
+  client.SetEncryption(std::unique_ptr<Crypto::Aead>(new Crypto::Aead(algorithm, to_server)));
+
+  auto send = [&](const MemoryTun::Packet &packet) {
+    std::vector<Packet::Data> datagrams;
+    Packet::Data p(packet.begin(), packet.end());
+    Packet::Data datagram;
+    const auto now = Codec::Sender::Clock::now();
+
+    client.Push(p, now);
+    while (client.Pull(datagram, now))
+    {
+      client_socket->Write(datagram.data(), datagram.size());
+      datagrams.push_back(datagram);
+    }
+
+    return datagrams;
+  };
+
+  auto extract = [&](const std::size_t &count) {
+    std::vector<MemoryTun::Packet> received;
+    MemoryTun::Packet p;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (received.size() < count && std::chrono::steady_clock::now() < deadline)
+      if (device->Extract(p))
+        received.push_back(p);
+      else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return received;
+  };
+
+  // stream id of the next train the server sends
+  auto receive_stream_id = [&]() {
+    Packet::Data datagram(512);
+    Endpoint source;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (std::chrono::steady_clock::now() < deadline)
+      if (client_socket->IsReadyToRead())
+      {
+        datagram.resize(512);
+        datagram.resize(client_socket->RecvFrom(datagram.data(), datagram.size(), source));
+
+        // the train ends with a control fragment
+        PseudoDNS fragment;
+        fragment.FillFromDump(datagram);
+        if (fragment.GetType() == Packet::Type::CONTROL)
+          return static_cast<int>(fragment.GetStreamId());
+      }
+      else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return -1;
+  };
+
+  auto start = [&](PrimitiveReaderAndWriter &server, const State &state) {
+    server.SetEncryption(algorithm, to_client, to_server);
+    server.SetHandoffState(state);
+    return std::thread(&PrimitiveReaderAndWriter::Run, &server);
+  };
+
+  PrimitiveReaderAndWriter running(tun, server_socket, prototype);
+  std::thread running_thread = start(running, State());
+
+  const std::vector<Packet::Data> before = send(MakeIpPacket(40, 0x11));
+  const std::vector<MemoryTun::Packet> received_before = extract(1);
+  BOOST_REQUIRE(device->Inject(MakeIpPacket(40, 0x21)));
+  const int stream_before = receive_stream_id();
+
+  running.StopForHandoff();
+  running_thread.join();
+  const State state = State::Deserialize(running.GetHandoffState().Serialize());
+
+  PrimitiveReaderAndWriter taking_over(tun, server_socket, prototype);
+  std::thread taking_over_thread = start(taking_over, state);
+
+  // replayed datagrams of the stopped process, then a new one
+  for (auto &d : before)
+    client_socket->Write(d.data(), d.size());
+  send(MakeIpPacket(40, 0x12));
+  const std::vector<MemoryTun::Packet> received_after = extract(2);
+  BOOST_REQUIRE(device->Inject(MakeIpPacket(40, 0x22)));
+  const int stream_after = receive_stream_id();
+
+  taking_over.Stop();
+  taking_over_thread.join();
+  client_socket->Close();
+  server_socket->Close();
+
+  BOOST_CHECK(received_before == std::vector<MemoryTun::Packet>{ MakeIpPacket(40, 0x11) });
+  BOOST_CHECK(received_after == std::vector<MemoryTun::Packet>{ MakeIpPacket(40, 0x12) });
+  BOOST_CHECK_NE(stream_before, -1);
+  BOOST_CHECK_NE(stream_after, -1);
+  BOOST_CHECK_NE(stream_after, stream_before);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
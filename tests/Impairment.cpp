@@ -0,0 +1,231 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../src/Interfaces/Impairment.h"
+#include "../src/Interfaces/ImpairedInterface.h"
+#include "../src/Interfaces/MemoryTun.h"
+
+using namespace std;
+using namespace Interfaces;
+
+typedef Impairment::Clock Clock;
+
+
+namespace
+{
+
+const Clock::time_point START = Clock::time_point() + chrono::hours(1);
+
+Impairment::Data
+MakePacket(const uint32_t &number, const size_t &size = 100)
+{
+  Impairment::Data packet(size, 0);
+  packet[0] = number >> 8;
+  packet[1] = number;
+  return packet;
+}
+
+uint32_t
+GetNumber(const Impairment::Data &packet)
+{
+  return packet[0] << 8 | packet[1];
+}
+
+// numbers of the delivered packets, pushing one packet every millisecond
+vector<uint32_t>
+Run(const Impairment::Profile &profile, const uint32_t &seed, const uint32_t &count)
+{
+  Impairment impairment(profile, seed);
+  vector<uint32_t> delivered;
+  Impairment::Data packet;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const Clock::time_point now = START + chrono::milliseconds(i);
+    impairment.Push(MakePacket(i), now);
+
+    while (impairment.Pull(packet, now))
+      delivered.push_back(GetNumber(packet));
+  }
+
+  while (impairment.Pull(packet, Clock::time_point::max()))
+    delivered.push_back(GetNumber(packet));
+
+  return delivered;
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( Impairment_Tests )
+
+BOOST_AUTO_TEST_CASE( DefaultProfile_PassesEverythingInOrder )
+{
+  const vector<uint32_t> delivered = Run(Impairment::Profile(), 1, 100);
+
+  BOOST_REQUIRE_EQUAL(delivered.size(), 100);
+  for (uint32_t i = 0; i < delivered.size(); i++)
+    BOOST_CHECK_EQUAL(delivered[i], i);
+}
+
+BOOST_AUTO_TEST_CASE( SameSeed_GivesSameResult )
+{
+  Impairment::Profile profile;
+  profile.loss = 0.2;
+  profile.duplicate = 0.1;
+  profile.delay = chrono::milliseconds(5);
+  profile.jitter = chrono::milliseconds(3);
+
+  BOOST_CHECK(Run(profile, 7, 1000) == Run(profile, 7, 1000));
+  BOOST_CHECK(Run(profile, 7, 1000) != Run(profile, 8, 1000));
+}
+
+BOOST_AUTO_TEST_CASE( Loss_DropsAboutTheProbability )
+{
+  Impairment::Profile profile;
+  profile.loss = 0.1;
+
+  const size_t delivered = Run(profile, 1, 10000).size();
+
+  BOOST_CHECK_GT(delivered, 8800);
+  BOOST_CHECK_LT(delivered, 9200);
+}
+
+BOOST_AUTO_TEST_CASE( GilbertElliott_LosesInBursts )
+{
+  // one in ten packets in the bad state, bursts of five on average
+  Impairment::Profile profile;
+  profile.good_to_bad = 0.025;
+  profile.bad_to_good = 0.2;
+  profile.bad_loss = 1.0;
+
+  const vector<uint32_t> delivered = Run(profile, 1, 20000);
+
+  size_t bursts = 0;
+  for (size_t i = 1; i < delivered.size(); i++)
+    if (delivered[i] != delivered[i - 1] + 1)
+      bursts++;
+
+  const size_t lost = 20000 - delivered.size();
+  BOOST_CHECK_GT(lost, 1400);
+  BOOST_CHECK_LT(lost, 2600);
+  // average burst length is 1 / bad_to_good
+  BOOST_CHECK_GT(static_cast<double>(lost) / bursts, 4.0);
+  BOOST_CHECK_LT(static_cast<double>(lost) / bursts, 6.0);
+}
+
+BOOST_AUTO_TEST_CASE( Duplicate_DeliversCopyAfterOriginal )
+{
+  Impairment::Profile profile;
+  profile.duplicate = 1.0;
+
+  const vector<uint32_t> delivered = Run(profile, 1, 3);
+
+  BOOST_CHECK(delivered == vector<uint32_t>({0, 0, 1, 1, 2, 2}));
+}
+
+BOOST_AUTO_TEST_CASE( Delay_HoldsPacketUntilDue )
+{
+  Impairment::Profile profile;
+  profile.delay = chrono::milliseconds(10);
+  Impairment impairment(profile, 1);
+  Impairment::Data packet;
+
+  impairment.Push(MakePacket(1), START);
+
+  BOOST_CHECK(!impairment.Pull(packet, START + chrono::microseconds(9999)));
+  BOOST_CHECK(impairment.Pull(packet, START + chrono::milliseconds(10)));
+  BOOST_CHECK_EQUAL(GetNumber(packet), 1);
+}
+
+BOOST_AUTO_TEST_CASE( Jitter_StaysInRangeAndReorders )
+{
+  Impairment::Profile profile;
+  profile.delay = chrono::milliseconds(10);
+  profile.jitter = chrono::milliseconds(5);
+  Impairment impairment(profile, 1);
+  Impairment::Data packet;
+
+  // all pushed at once, each leaves between 5 and 15 ms later
+  for (uint32_t i = 0; i < 100; i++)
+    impairment.Push(MakePacket(i), START);
+
+  BOOST_CHECK(!impairment.HasDue(START + chrono::microseconds(4999)));
+
+  vector<uint32_t> delivered;
+  while (impairment.Pull(packet, START + chrono::milliseconds(15)))
+    delivered.push_back(GetNumber(packet));
+
+  BOOST_CHECK_EQUAL(delivered.size(), 100);
+  BOOST_CHECK(!is_sorted(delivered.begin(), delivered.end()));
+}
+
+BOOST_AUTO_TEST_CASE( Reorder_OvertakesDelayedPackets )
+{
+  Impairment::Profile profile;
+  profile.delay = chrono::milliseconds(10);
+  profile.reorder = 0.25;
+
+  const vector<uint32_t> delivered = Run(profile, 1, 1000);
+
+  BOOST_CHECK_EQUAL(delivered.size(), 1000);
+  BOOST_CHECK(!is_sorted(delivered.begin(), delivered.end()));
+}
+
+BOOST_AUTO_TEST_CASE( TokenBucket_PolicesAboveRate )
+{
+  // 100 byte packets every millisecond, rate allows half of them
+  Impairment::Profile profile;
+  profile.rate = 50000;
+  profile.burst = 1000;
+
+  Impairment impairment(profile, 1);
+  for (uint32_t i = 0; i < 1000; i++)
+    impairment.Push(MakePacket(i), START + chrono::milliseconds(i));
+
+  const Impairment::Stats stats = impairment.GetStats();
+  BOOST_CHECK_EQUAL(stats.received, 1000);
+  // burst and one packet of rounding
+  BOOST_CHECK_GE(stats.rate_dropped, 1000 / 2 - 10 - 1);
+  BOOST_CHECK_LE(stats.rate_dropped, 1000 / 2);
+  BOOST_CHECK_EQUAL(impairment.GetPendingCount(), 1000 - stats.rate_dropped);
+}
+
+BOOST_AUTO_TEST_CASE( ImpairedInterface_DelaysPacketsOfWrappedInterface )
+{
+  shared_ptr<MemoryTun> tun(new MemoryTun());
+  Impairment::Profile profile;
+  profile.delay = chrono::milliseconds(10);
+
+  ImpairedInterface impaired(tun, profile, 1);
+  Clock::time_point now = START;
+  impaired.SetTimeSource([&now]() { return now; });
+
+  tun->Inject(MemoryTun::Packet{1, 2, 3});
+  BOOST_CHECK(!impaired.IsReadyToRead());
+  BOOST_CHECK(!tun->IsReadyToRead());
+
+  now += chrono::milliseconds(10);
+  BOOST_REQUIRE(impaired.IsReadyToRead());
+
+  uint8_t buffer[8];
+  BOOST_CHECK_EQUAL(impaired.Read(buffer, sizeof(buffer)), 3);
+  BOOST_CHECK_EQUAL(buffer[2], 3);
+  BOOST_CHECK_EQUAL(impaired.GetStats().delivered, 1);
+
+  // writes aren't impaired
+  impaired.Write(buffer, 3);
+  MemoryTun::Packet written;
+  BOOST_CHECK(tun->Extract(written));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#include "../src/Interfaces/TunTap.h"
+#include "../src/Interfaces/MemoryTun.h"
+
+#ifndef _IPPACKET_H_
+#define _IPPACKET_H_
+
+
+// packet info and an IPv4 header of a packet with the given total length,
+// as read from a TUN device
+inline Interfaces::MemoryTun::Packet
+MakeIpPacket(const std::uint16_t &total_length, const std::uint8_t &fill)
+{
+  Interfaces::MemoryTun::Packet p(Interfaces::TunTap::PACKET_INFO_SIZE + total_length, fill);
+  const std::uint8_t header[] = { 0x00, 0x00, 0x08, 0x00,
+                                  0x45, 0x00, std::uint8_t(total_length >> 8), std::uint8_t(total_length),
+                                  0x00, 0x00, 0x40, 0x00, 0x40, 0x11, 0x00, 0x00,
+                                  10, 0, 0, 1, 10, 0, 0, 2 };
+  std::copy(std::begin(header), std::end(header), p.begin());
+
+  return p;
+}
+
+#endif
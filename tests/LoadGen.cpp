@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "../src/LoadGen/Generator.h"
+#include "../src/LoadGen/Reflector.h"
+#include "../src/Interfaces/Socket.h"
+
+using namespace std;
+using namespace Interfaces;
+using namespace LoadGen;
+
+
+namespace
+{
+
+struct ReflectorFixture
+{
+  shared_ptr<Socket> socket;
+  unique_ptr<Reflector> reflector;
+  thread reflector_thread;
+
+  ReflectorFixture(const SessionFactory &factory) :
+    socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM))
+  {
+    socket->Bind(0, "127.0.0.1");
+    reflector.reset(new Reflector(socket, factory));
+    reflector_thread = thread(&Reflector::Run, reflector.get());
+  }
+
+  ~ReflectorFixture()
+  {
+    Stop();
+    socket->Close();
+  }
+
+  Reflector::Stats Stop()
+  {
+    reflector->Stop();
+    if (reflector_thread.joinable())
+      reflector_thread.join();
+
+    return reflector->GetStats();
+  }
+};
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( LoadGen_Tests )
+
+BOOST_AUTO_TEST_CASE( Generator_GetsEveryPacketReflected )
+{
+  SessionFactory factory(false);
+  ReflectorFixture server(factory);
+
+  Generator::Config config;
+  config.clients = 100;
+  config.rate = 2000;
+  config.duration = chrono::milliseconds(200);
+
+  Generator generator(server.socket->GetLocalEndpoint(), factory, config);
+  const Generator::Report report = generator.Run();
+
+  BOOST_CHECK_EQUAL(report.clients, 100);
+  BOOST_CHECK_GT(report.sent, 300);
+  BOOST_CHECK_EQUAL(report.received, report.sent);
+  BOOST_CHECK_EQUAL(report.received_bytes, report.sent_bytes);
+  BOOST_CHECK_EQUAL(report.malformed, 0);
+  BOOST_CHECK_EQUAL(report.round_trip.count, report.received);
+}
+
+BOOST_AUTO_TEST_CASE( Reflector_KeepsSessionsOfOneSocketApart )
+{
+  SessionFactory factory(true);
+  ReflectorFixture server(factory);
+
+  // more clients than sockets, so sockets are shared
+  Generator::Config config;
+  config.clients = Generator::MAX_SOCKETS + 36;
+  config.rate = 1000;
+  config.sizes = { {1500, 1} };
+  config.duration = chrono::milliseconds(200);
+
+  Generator generator(server.socket->GetLocalEndpoint(), factory, config);
+  const Generator::Report report = generator.Run();
+  BOOST_CHECK_EQUAL(report.received, report.sent);
+
+  const Reflector::Stats stats = server.Stop();
+  BOOST_CHECK_EQUAL(stats.clients, config.clients);
+  BOOST_CHECK_EQUAL(stats.packets, report.sent);
+  BOOST_CHECK_EQUAL(stats.bytes, report.sent_bytes);
+}
+
+BOOST_AUTO_TEST_CASE( Encryption_KeysOfBothSidesMatch )
+{
+  const auto client_key = Crypto::Aead::DeriveKey("secret", "client to server");
+  const auto server_key = Crypto::Aead::DeriveKey("secret", "server to client");
+
+  SessionFactory client_factory(false);
+  client_factory.SetEncryption(Crypto::Aead::Algorithm::CHACHA20_POLY1305, client_key, server_key);
+  SessionFactory server_factory(false);
+  server_factory.SetEncryption(Crypto::Aead::Algorithm::CHACHA20_POLY1305, server_key, client_key);
+
+  ReflectorFixture server(server_factory);
+
+  Generator::Config config;
+  config.clients = 10;
+  config.rate = 1000;
+  config.duration = chrono::milliseconds(100);
+
+  Generator generator(server.socket->GetLocalEndpoint(), client_factory, config);
+  const Generator::Report report = generator.Run();
+
+  BOOST_CHECK_GT(report.sent, 0);
+  BOOST_CHECK_EQUAL(report.received, report.sent);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/Logging/Log.h"
+#include "../src/Logging/Logger.h"
+
+using namespace Logging;
+
+
+namespace
+{
+
+// collects records instead of writing them, restores the default sink
+struct CapturedRecords
+{
+  std::vector<std::pair<Level, std::string>> records;
+
+  CapturedRecords()
+  {
+    Logger::GetInstance().SetSink([this](const Entry &entry) {
+      records.push_back(std::make_pair(entry.level, std::string(entry.text, entry.length)));
+    });
+  }
+
+  ~CapturedRecords()
+  {
+    Logger::GetInstance().Stop();
+    Logger::GetInstance().SetSink(Logger::Sink());
+  }
+};
+
+
+int evaluated = 0;
+
+int
+CountEvaluation()
+{
+  return ++evaluated;
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( Logging_Tests )
+
+BOOST_AUTO_TEST_CASE( Stream_FormatsValues )
+{
+  CapturedRecords captured;
+
+  LOG(warning) << "text " << std::string("string ") << 'c' << ' ' << -1 << ' '
+               << 2u << ' ' << std::int64_t(-3) << ' ' << std::uint64_t(4) << ' '
+               << 0.5 << ' ' << true;
+
+  BOOST_REQUIRE_EQUAL(captured.records.size(), 1);
+  BOOST_CHECK(captured.records[0].first == Level::WARNING);
+  BOOST_CHECK_EQUAL(captured.records[0].second, "text string c -1 2 -3 4 0.5 true");
+}
+
+
+BOOST_AUTO_TEST_CASE( Stream_TruncatesLongMessage )
+{
+  CapturedRecords captured;
+
+  LOG(info) << std::string(Entry::MAX_TEXT_SIZE, 'a') << "tail";
+
+  BOOST_REQUIRE_EQUAL(captured.records.size(), 1);
+  BOOST_CHECK_EQUAL(captured.records[0].second, std::string(Entry::MAX_TEXT_SIZE, 'a'));
+}
+
+
+BOOST_AUTO_TEST_CASE( Log_BelowMinimumLevelIsNotEvaluated )
+{
+  CapturedRecords captured;
+  evaluated = 0;
+
+  LOG(trace) << CountEvaluation();
+
+  if (MIN_LEVEL > Level::TRACE)
+  {
+    BOOST_CHECK_EQUAL(evaluated, 0);
+    BOOST_CHECK(captured.records.empty());
+  }
+  else
+    BOOST_CHECK_EQUAL(evaluated, 1);
+}
+
+
+BOOST_AUTO_TEST_CASE( Logger_BackgroundThreadWritesEveryRecord )
+{
+  CapturedRecords captured;
+  const std::uint64_t dropped = Logger::GetInstance().GetDroppedCount();
+  Logger::GetInstance().Start();
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++)
+    threads.emplace_back([t]() {
+      for (int i = 0; i < 100; i++)
+        LOG(info) << "thread " << t << " record " << i;
+    });
+
+  for (auto &t : threads)
+    t.join();
+
+  Logger::GetInstance().Stop();
+
+  std::size_t written = 0;
+  for (auto &record : captured.records)
+    written += record.second.compare(0, 7, "thread ") == 0;
+
+  // the ring may overflow on a slow machine, but nothing gets lost silently
+  BOOST_CHECK_EQUAL(written + Logger::GetInstance().GetDroppedCount() - dropped, 400);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
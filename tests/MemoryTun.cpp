@@ -0,0 +1,193 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IpPacket.h"
+#include "../src/PrimitiveReaderAndWriter.h"
+#include "../src/Interfaces/MemoryTun.h"
+#include "../src/Interfaces/Socket.h"
+#include "../src/Interfaces/InterfaceException.h"
+#include "../src/Packets/PseudoDNS.h"
+
+using namespace std;
+using namespace Interfaces;
+using namespace Packets;
+
+
+BOOST_AUTO_TEST_SUITE( MemoryTun_Tests )
+
+BOOST_AUTO_TEST_CASE( InjectedPacket_IsRead )
+{
+  MemoryTun tun;
+  BOOST_CHECK(!tun.IsReadyToRead());
+
+  BOOST_REQUIRE(tun.Inject(MemoryTun::Packet{1, 2, 3}));
+  BOOST_CHECK(tun.IsReadyToRead());
+
+  uint8_t buffer[8];
+  BOOST_CHECK_EQUAL(tun.Read(buffer, sizeof(buffer)), 3);
+  BOOST_CHECK_EQUAL(buffer[2], 3);
+  BOOST_CHECK(!tun.IsReadyToRead());
+
+  BOOST_CHECK_THROW(tun.Read(buffer, sizeof(buffer)), InterfaceException);
+}
+
+BOOST_AUTO_TEST_CASE( Read_TruncatesLongPacket )
+{
+  MemoryTun tun;
+  tun.Inject(MemoryTun::Packet{1, 2, 3, 4});
+
+  uint8_t buffer[2];
+  BOOST_CHECK_EQUAL(tun.Read(buffer, sizeof(buffer)), 2);
+  BOOST_CHECK_EQUAL(buffer[1], 2);
+}
+
+BOOST_AUTO_TEST_CASE( WrittenPacket_IsExtracted )
+{
+  MemoryTun tun;
+  MemoryTun::Packet p;
+  BOOST_CHECK(!tun.Extract(p));
+
+  const uint8_t data[] = {5, 6, 7};
+  tun.Write(data, sizeof(data));
+
+  BOOST_REQUIRE(tun.Extract(p));
+  BOOST_CHECK(p == MemoryTun::Packet({5, 6, 7}));
+}
+
+BOOST_AUTO_TEST_CASE( FullQueue_DropsWrittenAndRefusesInjected )
+{
+  MemoryTun tun(TunTap::InterfaceType::TUN, 2);
+  const uint8_t data[] = {1};
+
+  for (int i = 0; i < 3; i++)
+    tun.Write(data, sizeof(data));
+  BOOST_CHECK_EQUAL(tun.GetDroppedCount(), 1);
+
+  BOOST_CHECK(tun.Inject(MemoryTun::Packet{1}));
+  BOOST_CHECK(tun.Inject(MemoryTun::Packet{2}));
+  BOOST_CHECK(!tun.Inject(MemoryTun::Packet{3}));
+  BOOST_CHECK_EQUAL(tun.GetKernelDropCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( Tunnel_CarriesPacketsBetweenMemoryDevices )
+{
+  shared_ptr<Packet> prototype(new PseudoDNS());
+  shared_ptr<MemoryTun> client_device(new MemoryTun());
+  shared_ptr<MemoryTun> server_device(new MemoryTun());
+  shared_ptr<TunTap> client_tun = client_device;
+  shared_ptr<TunTap> server_tun = server_device;
+
+  shared_ptr<Socket> server_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  server_socket->Bind(0, "127.0.0.1");
+  shared_ptr<Socket> client_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  client_socket->Connect(server_socket->GetLocalEndpoint());
+
+  PrimitiveReaderAndWriter client(client_tun, client_socket, prototype);
+  PrimitiveReaderAndWriter server(server_tun, server_socket, prototype);
+  thread client_thread(&PrimitiveReaderAndWriter::Run, &client);
+  thread server_thread(&PrimitiveReaderAndWriter::Run, &server);
+
+  // one packet of a single fragment, one of several
+  const vector<MemoryTun::Packet> sent = { MakeIpPacket(40, 0x11), MakeIpPacket(200, 0x22) };
+  for (auto p : sent)
+  {
+    BOOST_REQUIRE(client_device->Inject(move(p)));
+    this_thread::sleep_for(chrono::milliseconds(20));
+  }
+
+  vector<MemoryTun::Packet> received;
+  MemoryTun::Packet p;
+  const auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+  while (received.size() < sent.size() && chrono::steady_clock::now() < deadline)
+    if (server_device->Extract(p))
+      received.push_back(p);
+    else
+      this_thread::sleep_for(chrono::milliseconds(1));
+
+  client.Stop();
+  server.Stop();
+  client_thread.join();
+  server_thread.join();
+  client_socket->Close();
+  server_socket->Close();
+
+  BOOST_CHECK(received == sent);
+}
+
+BOOST_AUTO_TEST_CASE( ReusePortServer_DropsDatagramsOfOtherClients )
+{
+  shared_ptr<Packet> prototype(new PseudoDNS());
+  shared_ptr<MemoryTun> client_device(new MemoryTun());
+  shared_ptr<MemoryTun> intruder_device(new MemoryTun());
+  shared_ptr<MemoryTun> server_device(new MemoryTun());
+  shared_ptr<TunTap> client_tun = client_device;
+  shared_ptr<TunTap> intruder_tun = intruder_device;
+  shared_ptr<TunTap> server_tun = server_device;
+
+  // socket of a reuseport group stays unconnected
+  shared_ptr<Socket> server_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  server_socket->EnableReusePort();
+  server_socket->Bind(0, "127.0.0.1");
+  shared_ptr<Socket> client_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  client_socket->Connect(server_socket->GetLocalEndpoint());
+  shared_ptr<Socket> intruder_socket(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  intruder_socket->Connect(server_socket->GetLocalEndpoint());
+
+  PrimitiveReaderAndWriter client(client_tun, client_socket, prototype);
+  PrimitiveReaderAndWriter intruder(intruder_tun, intruder_socket, prototype);
+  PrimitiveReaderAndWriter server(server_tun, server_socket, prototype);
+  thread client_thread(&PrimitiveReaderAndWriter::Run, &client);
+  thread intruder_thread(&PrimitiveReaderAndWriter::Run, &intruder);
+  thread server_thread(&PrimitiveReaderAndWriter::Run, &server);
+
+  auto extract = [&](size_t count) {
+    vector<MemoryTun::Packet> received;
+    MemoryTun::Packet p;
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+    while (received.size() < count && chrono::steady_clock::now() < deadline)
+      if (server_device->Extract(p))
+        received.push_back(p);
+      else
+        this_thread::sleep_for(chrono::milliseconds(1));
+    return received;
+  };
+
+  // the first client becomes the peer
+  BOOST_REQUIRE(client_device->Inject(MakeIpPacket(40, 0x11)));
+  const vector<MemoryTun::Packet> from_client = extract(1);
+
+  BOOST_REQUIRE(intruder_device->Inject(MakeIpPacket(40, 0x33)));
+  const vector<MemoryTun::Packet> from_intruder = extract(1);
+
+  BOOST_REQUIRE(client_device->Inject(MakeIpPacket(40, 0x22)));
+  const vector<MemoryTun::Packet> again_from_client = extract(1);
+
+  client.Stop();
+  intruder.Stop();
+  server.Stop();
+  client_thread.join();
+  intruder_thread.join();
+  server_thread.join();
+  const string peer = server_socket->GetRemoteEndpoint().ToString();
+  const string client_address = client_socket->GetLocalEndpoint().ToString();
+  client_socket->Close();
+  intruder_socket->Close();
+  server_socket->Close();
+
+  BOOST_CHECK(from_client == vector<MemoryTun::Packet>{ MakeIpPacket(40, 0x11) });
+  BOOST_CHECK(from_intruder.empty());
+  BOOST_CHECK(again_from_client == vector<MemoryTun::Packet>{ MakeIpPacket(40, 0x22) });
+  BOOST_CHECK_EQUAL(peer, client_address);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/Metrics/Counter.h"
+#include "../src/Metrics/Gauge.h"
+#include "../src/Metrics/HttpExporter.h"
+
+using namespace Metrics;
+
+
+BOOST_AUTO_TEST_SUITE( Metrics_Tests )
+
+BOOST_AUTO_TEST_CASE( Counter_SumOfAllThreads )
+{
+  Counter counter("test_counter_threads_total", "Test counter.");
+  const auto before = counter.GetValue();
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++)
+    threads.emplace_back([&counter]() {
+      for (int i = 0; i < 1000; i++)
+        counter.Add();
+    });
+
+  for (auto &t : threads)
+    t.join();
+
+  counter.Add(5);
+
+  BOOST_CHECK_EQUAL(counter.GetValue() - before, 4005);
+}
+
+
+BOOST_AUTO_TEST_CASE( Counter_SameNameSharesValue )
+{
+  Counter first("test_counter_shared_total", "Test counter.", "kind=\"a\"");
+  Counter second("test_counter_shared_total", "Test counter.", "kind=\"a\"");
+  Counter other("test_counter_shared_total", "Test counter.", "kind=\"b\"");
+
+  first.Add(2);
+  second.Add(3);
+
+  BOOST_CHECK_EQUAL(first.GetValue(), 5);
+  BOOST_CHECK_EQUAL(other.GetValue(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( Gauge_SetAndAdd )
+{
+  Gauge gauge("test_gauge", "Test gauge.");
+
+  gauge.Set(10);
+  gauge.Add(-3);
+
+  BOOST_CHECK_EQUAL(gauge.GetValue(), 7);
+}
+
+
+BOOST_AUTO_TEST_CASE( Registry_Render )
+{
+  Counter a("test_render_total", "Rendered counter.", "kind=\"a\"");
+  Gauge g("test_render_gauge", "Rendered gauge.");
+  Counter b("test_render_total", "Rendered counter.", "kind=\"b\"");
+  a.Add(1);
+  b.Add(2);
+  g.Set(3);
+
+  const std::string text = Registry::GetInstance().Render();
+
+  BOOST_CHECK(text.find("# HELP test_render_total Rendered counter.\n"
+                        "# TYPE test_render_total counter\n"
+                        "test_render_total{kind=\"a\"} 1\n"
+                        "test_render_total{kind=\"b\"} 2\n") != std::string::npos);
+  BOOST_CHECK(text.find("# TYPE test_render_gauge gauge\n"
+                        "test_render_gauge 3\n") != std::string::npos);
+}
+
+
+BOOST_AUTO_TEST_CASE( HttpExporter_Respond )
+{
+  Counter counter("test_http_total", "Exported counter.");
+  counter.Add();
+
+  const std::string ok = HttpExporter::Respond("GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+  const std::string missing = HttpExporter::Respond("GET /other HTTP/1.1\r\n\r\n");
+
+  BOOST_CHECK_EQUAL(ok.compare(0, 15, "HTTP/1.0 200 OK"), 0);
+  BOOST_CHECK(ok.find("\r\n\r\n# HELP") != std::string::npos);
+  BOOST_CHECK(ok.find("test_http_total 1\n") != std::string::npos);
+  BOOST_CHECK_EQUAL(missing.compare(0, 12, "HTTP/1.0 404"), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
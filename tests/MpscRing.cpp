@@ -0,0 +1,98 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+
+#include "../src/Pipeline/MpscRing.h"
+
+using namespace Pipeline;
+
+
+BOOST_AUTO_TEST_SUITE( MpscRing_Tests )
+
+BOOST_AUTO_TEST_CASE( Constructor_CapacityRoundedUp )
+{
+  MpscRing<int> ring(5);
+
+  BOOST_CHECK_EQUAL(ring.GetCapacity(), 8);
+}
+
+
+BOOST_AUTO_TEST_CASE( TryPop_EmptyRing )
+{
+  MpscRing<int> ring(4);
+  int item = 7;
+
+  BOOST_CHECK(!ring.TryPop(item));
+  BOOST_CHECK_EQUAL(item, 7);
+}
+
+
+BOOST_AUTO_TEST_CASE( TryPush_FullRing )
+{
+  MpscRing<int> ring(4);
+
+  for (int i = 0; i < 4; i++)
+    BOOST_CHECK(ring.TryPush(int(i)));
+
+  BOOST_CHECK(!ring.TryPush(4));
+
+  int item;
+  BOOST_CHECK(ring.TryPop(item));
+  BOOST_CHECK_EQUAL(item, 0);
+  BOOST_CHECK(ring.TryPush(4));
+
+  for (int i = 1; i <= 4; i++)
+  {
+    BOOST_CHECK(ring.TryPop(item));
+    BOOST_CHECK_EQUAL(item, i);
+  }
+
+  BOOST_CHECK(!ring.TryPop(item));
+}
+
+
+BOOST_AUTO_TEST_CASE( ManyProducers_EveryItemOnceInProducerOrder )
+{
+  const int producers = 4;
+  const int count = 50000;
+  MpscRing<int> ring(64);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++)
+    threads.emplace_back([&ring, p, count]() {
+      for (int i = 0; i < count; i++)
+        while (!ring.TryPush(p * count + i))
+          std::this_thread::yield();
+    });
+
+  std::vector<int> next(producers, 0);
+  bool ordered = true;
+  int item;
+
+  for (int received = 0; received < producers * count; )
+  {
+    if (!ring.TryPop(item))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    const int p = item / count;
+    ordered &= (item % count == next[p]);
+    next[p]++;
+    received++;
+  }
+
+  for (auto &t : threads)
+    t.join();
+
+  BOOST_CHECK(ordered);
+  BOOST_CHECK(!ring.TryPop(item));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "../src/Capture/PcapReader.h"
+#include "../src/Capture/CaptureException.h"
+
+using namespace std;
+using namespace Capture;
+
+typedef vector<uint8_t> Bytes;
+
+
+namespace
+{
+
+void
+Put32(Bytes &b, const uint32_t &value, const bool &big_endian)
+{
+  for (int i = 0; i < 4; i++)
+    b.push_back(value >> (big_endian ? 24 - 8 * i : 8 * i));
+}
+
+Bytes
+FileHeader(const uint32_t &magic, const uint32_t &link_type, const bool &big_endian = false)
+{
+  Bytes b;
+  Put32(b, magic, big_endian);
+  // version 2.4, zone, sigfigs, snaplen
+  const Bytes version = big_endian ? Bytes { 0, 2, 0, 4 } : Bytes { 2, 0, 4, 0 };
+  b.insert(b.end(), version.begin(), version.end());
+  Put32(b, 0, big_endian);
+  Put32(b, 0, big_endian);
+  Put32(b, 65535, big_endian);
+  Put32(b, link_type, big_endian);
+  return b;
+}
+
+void
+AddRecord(Bytes &file, const Bytes &data, const uint32_t &seconds, const uint32_t &fraction,
+          const bool &big_endian = false, const size_t &original_length = 0)
+{
+  Put32(file, seconds, big_endian);
+  Put32(file, fraction, big_endian);
+  Put32(file, data.size(), big_endian);
+  Put32(file, original_length ? original_length : data.size(), big_endian);
+  file.insert(file.end(), data.begin(), data.end());
+}
+
+// IPv4 UDP from 10.0.0.1:1000 to 10.0.0.2:53
+Bytes
+UdpPacket(const Bytes &payload, const uint16_t &flags_and_offset = 0)
+{
+  const size_t total = 20 + 8 + payload.size();
+  Bytes p = {
+    0x45, 0, uint8_t(total >> 8), uint8_t(total), 0, 0, uint8_t(flags_and_offset >> 8), uint8_t(flags_and_offset),
+    64, 17, 0, 0, 10, 0, 0, 1, 10, 0, 0, 2,
+    0x03, 0xE8, 0x00, 0x35, uint8_t((total - 20) >> 8), uint8_t(total - 20), 0, 0
+  };
+  p.insert(p.end(), payload.begin(), payload.end());
+  return p;
+}
+
+Bytes
+Ethernet(const Bytes &ip)
+{
+  Bytes frame(12, 0xAA);
+  frame.push_back(0x08);
+  frame.push_back(0x00);
+  frame.insert(frame.end(), ip.begin(), ip.end());
+  return frame;
+}
+
+struct TemporaryFile
+{
+  string path;
+
+  TemporaryFile(const Bytes &content)
+  {
+    char name[] = "/tmp/sdnst-pcap-XXXXXX";
+    const int fd = mkstemp(name);
+    close(fd);
+    path = name;
+
+    ofstream file(path, ios::binary);
+    file.write(reinterpret_cast<const char*>(content.data()), content.size());
+  }
+
+  ~TemporaryFile()
+  {
+    remove(path.c_str());
+  }
+};
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( PcapReader_Tests )
+
+BOOST_AUTO_TEST_CASE( Ethernet_UdpPayloadIsFound )
+{
+  Bytes file = FileHeader(0xA1B2C3D4, PcapReader::LINKTYPE_ETHERNET);
+  AddRecord(file, Ethernet(UdpPacket({1, 2, 3})), 10, 500);
+  TemporaryFile capture(file);
+
+  PcapReader reader(capture.path);
+  BOOST_CHECK_EQUAL(reader.GetLinkType(), PcapReader::LINKTYPE_ETHERNET);
+
+  PcapReader::Record record;
+  BOOST_REQUIRE(reader.Next(record));
+  BOOST_CHECK_EQUAL(record.timestamp_ns, 10000500000);
+
+  PcapReader::Datagram datagram;
+  BOOST_REQUIRE(reader.FindUdpDatagram(record, datagram));
+  BOOST_CHECK_EQUAL(datagram.source_port, 1000);
+  BOOST_CHECK_EQUAL(datagram.destination_port, 53);
+  BOOST_CHECK(Bytes(datagram.payload, datagram.payload + datagram.payload_length) == Bytes({1, 2, 3}));
+
+  BOOST_CHECK(!reader.Next(record));
+  BOOST_CHECK(!reader.IsTruncated());
+}
+
+BOOST_AUTO_TEST_CASE( SwappedNanosecondFile_IsRead )
+{
+  Bytes file = FileHeader(0xA1B23C4D, PcapReader::LINKTYPE_RAW, true);
+  AddRecord(file, UdpPacket({7}), 1, 2, true);
+  AddRecord(file, UdpPacket({8}), 1, 3, true);
+  TemporaryFile capture(file);
+
+  PcapReader reader(capture.path);
+  BOOST_CHECK_EQUAL(reader.GetLinkType(), PcapReader::LINKTYPE_RAW);
+
+  PcapReader::Record record;
+  BOOST_REQUIRE(reader.Next(record));
+  BOOST_CHECK_EQUAL(record.timestamp_ns, 1000000002);
+  BOOST_REQUIRE(reader.Next(record));
+  BOOST_CHECK_EQUAL(record.timestamp_ns, 1000000003);
+  BOOST_CHECK(!reader.Next(record));
+
+  // from the start again
+  reader.Rewind();
+  BOOST_REQUIRE(reader.Next(record));
+  BOOST_CHECK_EQUAL(record.timestamp_ns, 1000000002);
+}
+
+BOOST_AUTO_TEST_CASE( TruncatedRecord_EndsTheCapture )
+{
+  Bytes file = FileHeader(0xA1B2C3D4, PcapReader::LINKTYPE_RAW);
+  AddRecord(file, UdpPacket({1}), 0, 0);
+  AddRecord(file, UdpPacket({2}), 0, 0);
+  file.resize(file.size() - 5);
+  TemporaryFile capture(file);
+
+  PcapReader reader(capture.path);
+  PcapReader::Record record;
+  BOOST_CHECK(reader.Next(record));
+  BOOST_CHECK(!reader.Next(record));
+  BOOST_CHECK(reader.IsTruncated());
+}
+
+BOOST_AUTO_TEST_CASE( FragmentsAndSnappedDatagrams_AreNotUdpDatagrams )
+{
+  Bytes file = FileHeader(0xA1B2C3D4, PcapReader::LINKTYPE_RAW);
+  // more fragments flag
+  AddRecord(file, UdpPacket({1, 2}, 0x2000), 0, 0);
+  Bytes snapped = UdpPacket(Bytes(100, 0));
+  snapped.resize(60);
+  AddRecord(file, snapped, 0, 0, false, 128);
+  TemporaryFile capture(file);
+
+  PcapReader reader(capture.path);
+  PcapReader::Record record;
+  PcapReader::Datagram datagram;
+
+  BOOST_REQUIRE(reader.Next(record));
+  BOOST_CHECK(!reader.FindUdpDatagram(record, datagram));
+
+  BOOST_REQUIRE(reader.Next(record));
+  BOOST_CHECK_EQUAL(record.original_length, 128);
+  BOOST_CHECK(!reader.FindUdpDatagram(record, datagram));
+}
+
+BOOST_AUTO_TEST_CASE( NotPcap_Throws )
+{
+  TemporaryFile pcapng(Bytes { 0x0A, 0x0D, 0x0D, 0x0A, 0x1C, 0, 0, 0, 0x4D, 0x3C, 0x2B, 0x1A,
+                               1, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF });
+
+  BOOST_CHECK_THROW(PcapReader(pcapng.path), CaptureException);
+  BOOST_CHECK_THROW(PcapReader("/nonexistent/capture.pcap"), CaptureException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
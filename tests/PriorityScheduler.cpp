@@ -0,0 +1,78 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/Scheduling/PriorityScheduler.h"
+
+using namespace Packets;
+using namespace Scheduling;
+
+
+BOOST_AUTO_TEST_SUITE( PriorityScheduler_Tests )
+
+BOOST_AUTO_TEST_CASE( Empty_DequeueFails )
+{
+  PriorityScheduler scheduler;
+  Packet::Data packet;
+
+  BOOST_CHECK(scheduler.IsEmpty());
+  BOOST_CHECK(!scheduler.Dequeue(packet));
+}
+
+
+BOOST_AUTO_TEST_CASE( HigherClassGoesFirst )
+{
+  PriorityScheduler scheduler;
+  Packet::Data packet;
+
+  scheduler.Enqueue(TrafficClass::BULK, { 0x03 });
+  scheduler.Enqueue(TrafficClass::ACK, { 0x02 });
+  scheduler.Enqueue(TrafficClass::INTERACTIVE, { 0x01 });
+
+  for (std::uint8_t expected = 0x01; expected <= 0x03; expected++)
+  {
+    BOOST_REQUIRE(scheduler.Dequeue(packet));
+    BOOST_CHECK_EQUAL(packet.at(0), expected);
+  }
+
+  BOOST_CHECK(scheduler.IsEmpty());
+}
+
+
+BOOST_AUTO_TEST_CASE( FifoInsideClass )
+{
+  PriorityScheduler scheduler;
+  Packet::Data packet;
+
+  scheduler.Enqueue(TrafficClass::DEFAULT, { 0x01 });
+  scheduler.Enqueue(TrafficClass::DEFAULT, { 0x02 });
+
+  BOOST_REQUIRE(scheduler.Dequeue(packet));
+  BOOST_CHECK_EQUAL(packet.at(0), 0x01);
+  BOOST_REQUIRE(scheduler.Dequeue(packet));
+  BOOST_CHECK_EQUAL(packet.at(0), 0x02);
+}
+
+
+BOOST_AUTO_TEST_CASE( LowerClassNotStarved )
+{
+  PriorityScheduler scheduler(PriorityScheduler::Weights {{ 2, 2, 2, 1 }});
+  Packet::Data packet;
+
+  for (int i = 0; i < 10; i++)
+    scheduler.Enqueue(TrafficClass::INTERACTIVE, { 0x01 });
+  scheduler.Enqueue(TrafficClass::BULK, { 0x04 });
+
+  BOOST_REQUIRE(scheduler.Dequeue(packet));
+  BOOST_CHECK_EQUAL(packet.at(0), 0x01);
+  BOOST_REQUIRE(scheduler.Dequeue(packet));
+  BOOST_CHECK_EQUAL(packet.at(0), 0x01);
+  BOOST_REQUIRE(scheduler.Dequeue(packet));
+  BOOST_CHECK_EQUAL(packet.at(0), 0x04);
+  BOOST_CHECK_EQUAL(scheduler.GetSize(TrafficClass::INTERACTIVE), 8);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
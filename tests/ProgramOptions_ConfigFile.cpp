@@ -4,6 +4,9 @@
  */
 
 #include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
 
 #include "../src/Options/ProgramOptions.h"
 #include "../src/Options/BadOptionValueException.h"
@@ -11,6 +14,31 @@
 using namespace Options;
 
 
+namespace
+{
+
+// key file of a test, removed with it
+class KeyFile
+{
+public:
+  KeyFile(const std::string &contents) :
+    path("ProgramOptions_test.key")
+  {
+    std::ofstream file(path.c_str());
+    file << contents;
+  }
+
+  ~KeyFile()
+  {
+    std::remove(path.c_str());
+  }
+
+  const std::string path;
+};
+
+}
+
+
 BOOST_AUTO_TEST_SUITE( ProgramOptions_ConfigFile )
 
 BOOST_AUTO_TEST_CASE( CommandLine_DefaultValues )
@@ -21,6 +49,8 @@ BOOST_AUTO_TEST_CASE( CommandLine_DefaultValues )
   BOOST_CHECK(options.GetMode() == ProgramOptions::Mode::SERVER);
   BOOST_CHECK_EQUAL(options.GetAddress(), "127.0.0.1");
   BOOST_CHECK_EQUAL(options.GetPort(), 53);
+  BOOST_CHECK_EQUAL(options.GetAggregateDelay(), 0);
+  BOOST_CHECK_EQUAL(options.GetAggregateSize(), 512);
   BOOST_CHECK_EQUAL(options.GetShowHelp(), false);
 }
 
@@ -141,6 +171,393 @@ BOOST_AUTO_TEST_CASE( CommandLine_ServerModeBadAddress )
 }
 
 
+BOOST_AUTO_TEST_CASE( CommandLine_Aggregation )
+{
+  int argc = 5;
+  const char *argv[] = {"program_name", "--aggregate-delay", "2000", "--aggregate-size", "256"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK_EQUAL(options.GetAggregateDelay(), 2000);
+  BOOST_CHECK_EQUAL(options.GetAggregateSize(), 256);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_AggregateSizeZero )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--aggregate-size", "0"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_QueueManagement )
+{
+  int argc = 7;
+  const char *argv[] = {"program_name", "--queue-size", "64",
+                        "--codel-target", "20000", "--codel-interval", "400000"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK_EQUAL(options.GetQueueSize(), 64);
+  BOOST_CHECK_EQUAL(options.GetCoDelTarget(), 20000);
+  BOOST_CHECK_EQUAL(options.GetCoDelInterval(), 400000);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_Pipeline )
+{
+  int argc = 4;
+  const char *argv[] = {"program_name", "--pipeline", "--cpu-affinity", "0,2,13"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  const std::vector<int> expected { 0, 2, 13 };
+  const auto cpus = options.GetCpuAffinity();
+
+  BOOST_CHECK(options.GetPipeline());
+  BOOST_CHECK_EQUAL_COLLECTIONS(cpus.begin(), cpus.end(),
+				expected.begin(), expected.end());
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_PipelineDisabledByDefault )
+{
+  int argc = 1;
+  const char *argv[] = {"program_name"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK(!options.GetPipeline());
+  BOOST_CHECK(options.GetCpuAffinity().empty());
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_BadCpuAffinity )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--cpu-affinity", "0,,1"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_CodecWorkers )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--codec-workers", "4"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK_EQUAL(options.GetCodecWorkers(), 4);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_TooManyCodecWorkers )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--codec-workers", "65"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_NoKey_NoEncryption )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--cipher", "aes-256-gcm"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK(options.GetCipher() == ProgramOptions::Cipher::NONE);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_KeyFile )
+{
+  KeyFile key("secret\nignored\n");
+  int argc = 5;
+  const char *argv[] = {"program_name", "--key-file", key.path.c_str(), "--cipher", "aes-256-gcm"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK_EQUAL(options.GetKey(), "secret");
+  BOOST_CHECK(options.GetCipher() == ProgramOptions::Cipher::AES_256_GCM);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_KeyWithDefaultCipher )
+{
+  KeyFile key("secret");
+  int argc = 3;
+  const char *argv[] = {"program_name", "--key-file", key.path.c_str()};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  // the same on every CPU
+  BOOST_CHECK(options.GetCipher() == ProgramOptions::Cipher::CHACHA20_POLY1305);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_KeyIsRefused )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--key", "secret"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), std::exception);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_MissingKeyFile )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--key-file", "no such file"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_EmptyKeyFile )
+{
+  KeyFile key("");
+  int argc = 3;
+  const char *argv[] = {"program_name", "--key-file", key.path.c_str()};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_BadCipher )
+{
+  KeyFile key("secret");
+  int argc = 5;
+  const char *argv[] = {"program_name", "--key-file", key.path.c_str(), "--cipher", "des"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_Checksum )
+{
+  int argc = 2;
+  const char *argv[] = {"program_name", "--checksum"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK(options.GetChecksum());
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_SocketFilter )
+{
+  int argc = 2;
+  const char *argv[] = {"program_name", "--socket-filter"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK(options.GetSocketFilter());
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_Processes )
+{
+  int argc = 5;
+  const char *argv[] = {"program_name", "--processes", "4", "--session-id", "7"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK_EQUAL(options.GetProcesses(), 4);
+  BOOST_CHECK_EQUAL(options.GetSessionId(), 7);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_ProcessesOutOfRange )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--processes", "0"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_Takeover )
+{
+  int argc = 4;
+  const char *argv[] = {"program_name", "--handoff-socket", "/run/sdnst.sock", "--takeover"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK_EQUAL(options.GetHandoffSocket(), "/run/sdnst.sock");
+  BOOST_CHECK(options.GetTakeover());
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_TakeoverWithoutHandoffSocket )
+{
+  int argc = 2;
+  const char *argv[] = {"program_name", "--takeover"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_EchoInterval )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--echo-interval", "1000"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK_EQUAL(options.GetEchoInterval(), 1000);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_SocketBuffers )
+{
+  int argc = 5;
+  const char *argv[] = {"program_name", "--socket-receive-buffer", "8388608",
+                        "--socket-send-buffer", "4194304"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK_EQUAL(options.GetSocketReceiveBuffer(), 8388608);
+  BOOST_CHECK_EQUAL(options.GetSocketSendBuffer(), 4194304);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_SocketBufferTooLarge )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--socket-receive-buffer", "2147483648"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_LoadGen )
+{
+  int argc = 11;
+  const char *argv[] = {"program_name", "--mode", "loadgen", "--loadgen-clients", "5000",
+                        "--loadgen-rate", "50000", "--loadgen-sizes", "64:3,1500",
+                        "--loadgen-duration", "30"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK(options.GetMode() == ProgramOptions::Mode::LOADGEN);
+  BOOST_CHECK_EQUAL(options.GetLoadGenClients(), 5000);
+  BOOST_CHECK_EQUAL(options.GetLoadGenRate(), 50000);
+  BOOST_REQUIRE_EQUAL(options.GetLoadGenSizes().size(), 2);
+  BOOST_CHECK_EQUAL(options.GetLoadGenSizes()[0].first, 64);
+  BOOST_CHECK_EQUAL(options.GetLoadGenSizes()[0].second, 3);
+  BOOST_CHECK_EQUAL(options.GetLoadGenSizes()[1].first, 1500);
+  BOOST_CHECK_EQUAL(options.GetLoadGenSizes()[1].second, 1);
+  BOOST_CHECK_EQUAL(options.GetLoadGenDuration(), 30);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_ReflectorMode )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--mode", "reflector"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+  options.Parse();
+
+  BOOST_CHECK(options.GetMode() == ProgramOptions::Mode::REFLECTOR);
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_BadLoadGenSizes )
+{
+  const char *sizes[] = {"20", "1501", "64:0", "64;576", ""};
+
+  for (auto &s : sizes)
+  {
+    int argc = 3;
+    const char *argv[] = {"program_name", "--loadgen-sizes", s};
+
+    ProgramOptions options;
+    options.SetCommandLineOptions(argc, argv);
+
+    BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( CommandLine_LoadGenClientsOutOfRange )
+{
+  int argc = 3;
+  const char *argv[] = {"program_name", "--loadgen-clients", "65536"};
+
+  ProgramOptions options;
+  options.SetCommandLineOptions(argc, argv);
+
+  BOOST_CHECK_THROW(options.Parse(), BadOptionValueException);
+}
+
+
 BOOST_AUTO_TEST_CASE( CommandLine_ShowHelp_LongOption )
 {
   int argc = 2;
@@ -180,6 +597,24 @@ BOOST_AUTO_TEST_CASE( ConfigFile_ReadAllOptions )
 }
 
 
+BOOST_AUTO_TEST_CASE( ConfigFile_Key )
+{
+  const std::string path = "ProgramOptions_test.conf";
+  {
+    std::ofstream file(path.c_str());
+    file << "key = secret\n";
+  }
+
+  ProgramOptions options;
+  options.SetConfigFilePath(path);
+  options.Parse();
+  std::remove(path.c_str());
+
+  BOOST_CHECK_EQUAL(options.GetKey(), "secret");
+  BOOST_CHECK(options.GetCipher() == ProgramOptions::Cipher::CHACHA20_POLY1305);
+}
+
+
 BOOST_AUTO_TEST_CASE( ConfigFile_And_CommandLine )
 {
   int argc = 3;
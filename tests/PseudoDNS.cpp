@@ -11,6 +11,8 @@
 #include "../src/Packets/CantSetControlTypeException.h"
 #include "../src/Packets/CorruptedPacketException.h"
 #include "../src/Packets/WrongMagicNumberException.h"
+#include "../src/Packets/ChecksumMismatchException.h"
+#include "../src/Packets/Crc32c.h"
 
 using namespace Packets;
 
@@ -233,6 +235,219 @@ BOOST_AUTO_TEST_CASE( FillPacketFromDump_CorrectDataPacket )
 }
 
 
+BOOST_AUTO_TEST_CASE( DataPacket_DumpStreamId )
+{
+  PseudoDNS packet(Packet::Type::DATA);
+  packet.SetStreamId(0x1234);
+
+  Packet::Data dumped_packet = packet.Dump();
+
+  Packet::Data expected_dump {
+    0x14, 0x1D,          // Magic number
+    0x00, 0x00,          // DC = 0, Control type = 0
+    0x00, 0x01,
+    0x12, 0x34,          // Stream id
+    0x00, 0x00,
+    0x00, 0x00,
+    0x00,                // zeros
+    0x00, 0x01,
+    0x00, 0x01
+  };
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(dumped_packet.begin(), dumped_packet.end(),
+				expected_dump.begin(), expected_dump.end());
+}
+
+
+BOOST_AUTO_TEST_CASE( FillPacketFromDump_StreamId )
+{
+  Packet::Data packet_dump {
+    0x14, 0x1D,          // Magic number
+    0x01, 0x02,          // DC = 1 (Control), Control type = 2 (END_OF_TRANSMISSION)
+    0x00, 0x01,
+    0xAB, 0xCD,          // Stream id
+    0x00, 0x00,
+    0x00, 0x00,
+    0x00,                // zeros
+    0x00, 0x01,
+    0x00, 0x01
+  };
+
+  PseudoDNS packet;
+  packet.FillFromDump(packet_dump);
+
+  BOOST_CHECK_EQUAL(packet.GetStreamId(), 0xABCD);
+  BOOST_CHECK_EQUAL(packet.Clone()->GetStreamId(), 0xABCD);
+}
+
+
+BOOST_AUTO_TEST_CASE( DataPacket_DumpSessionId )
+{
+  PseudoDNS packet(Packet::Type::DATA);
+  packet.SetSessionId(0x1234);
+
+  Packet::Data dumped_packet = packet.Dump();
+
+  Packet::Data expected_dump {
+    0x14, 0x1D,          // Magic number
+    0x00, 0x00,          // DC = 0, Control type = 0
+    0x00, 0x01,
+    0x00, 0x00,
+    0x00, 0x00,
+    0x12, 0x34,          // Session id
+    0x00,                // zeros
+    0x00, 0x01,
+    0x00, 0x01
+  };
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(dumped_packet.begin(), dumped_packet.end(),
+				expected_dump.begin(), expected_dump.end());
+}
+
+
+BOOST_AUTO_TEST_CASE( FillPacketFromDump_SessionId )
+{
+  Packet::Data packet_dump {
+    0x14, 0x1D,          // Magic number
+    0x01, 0x02,          // DC = 1 (Control), Control type = 2 (END_OF_TRANSMISSION)
+    0x00, 0x01,
+    0x00, 0x00,
+    0x00, 0x00,
+    0xAB, 0xCD,          // Session id
+    0x00,                // zeros
+    0x00, 0x01,
+    0x00, 0x01
+  };
+
+  PseudoDNS packet;
+  packet.FillFromDump(packet_dump);
+
+  BOOST_CHECK_EQUAL(packet.GetSessionId(), 0xABCD);
+  BOOST_CHECK_EQUAL(dynamic_cast<PseudoDNS&>(*packet.Clone()).GetSessionId(), 0xABCD);
+}
+
+
+BOOST_AUTO_TEST_CASE( FillPacketFromDump_ReplacesData )
+{
+  Packet::Data packet_dump {
+    0x14, 0x1D,          // Magic number
+    0x00, 0x00,          // DC = 0, Control type = 0
+    0x00, 0x01,
+    0x00, 0x00,
+    0x00, 0x00,
+    0x00, 0x00,
+    0x02,                // Data length
+    0xAA, 0xBB,
+    0x00,                // zeros
+    0x00, 0x01,
+    0x00, 0x01
+  };
+  Packet::Data expected_data { 0xAA, 0xBB };
+
+  PseudoDNS packet;
+  packet.FillFromDump(packet_dump);
+  packet.FillFromDump(packet_dump);
+
+  Packet::Data data = packet.GetData();
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected_data.begin(), expected_data.end(),
+				data.begin(), data.end());
+}
+
+
+BOOST_AUTO_TEST_CASE( DataPacket_DumpChecksum )
+{
+  PseudoDNS packet(Packet::Type::DATA);
+  packet.SetChecksum(true);
+  packet.SetData({ 0x31, 0x32, 0x33 });
+
+  Packet::Data dumped_packet = packet.Dump();
+
+  // CRC32C of the first 12 bytes and data
+  const std::uint8_t covered[] {
+    0x14, 0x1D, 0x04, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x31, 0x32, 0x33
+  };
+  const std::uint32_t crc = Crc32c::Compute(covered, sizeof(covered));
+
+  Packet::Data expected_dump {
+    0x14, 0x1D,          // Magic number
+    0x04, 0x00,          // CF = 1, DC = 0, Control type = 0
+    0x00, 0x01,
+    0x00, 0x00,
+    0x00, 0x00,
+    0x00, 0x00,
+    0x03,                // Data length
+    0x31, 0x32, 0x33,
+    0x04,                // Checksum length
+    static_cast<unsigned char>(crc >> 24),
+    static_cast<unsigned char>(crc >> 16),
+    static_cast<unsigned char>(crc >> 8),
+    static_cast<unsigned char>(crc),
+    0x00,                // zeros
+    0x00, 0x01,
+    0x00, 0x01
+  };
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(dumped_packet.begin(), dumped_packet.end(),
+				expected_dump.begin(), expected_dump.end());
+}
+
+
+BOOST_AUTO_TEST_CASE( FillPacketFromDump_Checksum )
+{
+  for (const Packet::Data &data : { Packet::Data(), Packet::Data(63, 0xFA) })
+  {
+    PseudoDNS sent(Packet::Type::CONTROL);
+    sent.SetChecksum(true);
+    sent.SetControlType(Packet::Control::END_OF_TRANSMISSION);
+    sent.SetStreamId(7);
+    sent.SetData(data);
+
+    PseudoDNS packet;
+    packet.FillFromDump(sent.Dump());
+
+    Packet::Data received = packet.GetData();
+
+    BOOST_CHECK(packet.HasChecksum());
+    BOOST_CHECK(packet.GetControlType() == Packet::Control::END_OF_TRANSMISSION);
+    BOOST_CHECK_EQUAL(packet.GetStreamId(), 7);
+    BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(),
+				  data.begin(), data.end());
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( FillPacketFromDump_ChecksumMismatch )
+{
+  PseudoDNS sent(Packet::Type::DATA);
+  sent.SetChecksum(true);
+  sent.SetData({ 0x01, 0x02, 0x03 });
+
+  const Packet::Data dump = sent.Dump();
+
+  // every payload or header bit flip is detected
+  for (std::size_t position : { 6, 7, 13, 14, 15, 17, 20 })
+  {
+    Packet::Data damaged = dump;
+    damaged[position] ^= 0x01;
+
+    PseudoDNS packet;
+    BOOST_CHECK_THROW(packet.FillFromDump(damaged), ChecksumMismatchException);
+  }
+}
+
+
+BOOST_AUTO_TEST_CASE( Clone_KeepsChecksum )
+{
+  PseudoDNS packet;
+  packet.SetChecksum(true);
+
+  BOOST_CHECK(packet.Clone()->Dump().at(2) & 0x04);
+}
+
+
 BOOST_AUTO_TEST_CASE( FillPacketFromDump_CorruptedPacket_NonZeros1 )
 {
   constexpr unsigned char any_data = 0xFA;
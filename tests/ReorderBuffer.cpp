@@ -0,0 +1,74 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/Pipeline/ReorderBuffer.h"
+
+using namespace Pipeline;
+
+
+BOOST_AUTO_TEST_SUITE( ReorderBuffer_Tests )
+
+BOOST_AUTO_TEST_CASE( TryPop_Empty )
+{
+  ReorderBuffer<int> buffer(4);
+  int item;
+
+  BOOST_CHECK(!buffer.TryPop(item));
+  BOOST_CHECK_EQUAL(buffer.GetNextSequence(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( TryPop_RestoresOrder )
+{
+  ReorderBuffer<int> buffer(4);
+  int item;
+
+  BOOST_CHECK(buffer.Insert(2, 20));
+  BOOST_CHECK(buffer.Insert(1, 10));
+  BOOST_CHECK(!buffer.TryPop(item));
+
+  BOOST_CHECK(buffer.Insert(0, 0));
+
+  for (int expected : { 0, 10, 20 })
+  {
+    BOOST_CHECK(buffer.TryPop(item));
+    BOOST_CHECK_EQUAL(item, expected);
+  }
+
+  BOOST_CHECK(!buffer.TryPop(item));
+  BOOST_CHECK_EQUAL(buffer.GetNextSequence(), 3);
+}
+
+
+BOOST_AUTO_TEST_CASE( Skip_DoesNotBlock )
+{
+  ReorderBuffer<int> buffer(4);
+  int item;
+
+  BOOST_CHECK(buffer.Insert(1, 10));
+  BOOST_CHECK(buffer.Skip(0));
+
+  BOOST_CHECK(buffer.TryPop(item));
+  BOOST_CHECK_EQUAL(item, 10);
+  BOOST_CHECK_EQUAL(buffer.GetNextSequence(), 2);
+}
+
+
+BOOST_AUTO_TEST_CASE( Insert_OutsideWindow )
+{
+  ReorderBuffer<int> buffer(4);
+  int item;
+
+  BOOST_CHECK(!buffer.Insert(4, 40));
+
+  BOOST_CHECK(buffer.Insert(0, 0));
+  BOOST_CHECK(buffer.TryPop(item));
+  BOOST_CHECK(buffer.Insert(4, 40));
+  BOOST_CHECK(!buffer.Insert(0, 0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
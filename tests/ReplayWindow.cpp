@@ -0,0 +1,92 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/Crypto/ReplayWindow.h"
+
+using namespace Crypto;
+
+
+BOOST_AUTO_TEST_SUITE( ReplayWindow_Tests )
+
+BOOST_AUTO_TEST_CASE( Accept_InOrder )
+{
+  ReplayWindow window;
+
+  for (std::uint64_t s = 100; s < 100 + 3 * ReplayWindow::SIZE; s++)
+    BOOST_CHECK(window.Accept(1, s));
+}
+
+
+BOOST_AUTO_TEST_CASE( Accept_RejectsDuplicate )
+{
+  ReplayWindow window;
+
+  BOOST_CHECK(window.Accept(1, 10));
+  BOOST_CHECK(window.Accept(1, 12));
+  BOOST_CHECK(!window.Accept(1, 10));
+  BOOST_CHECK(!window.Accept(1, 12));
+}
+
+
+BOOST_AUTO_TEST_CASE( Accept_ReorderedWithinWindow )
+{
+  ReplayWindow window;
+
+  BOOST_CHECK(window.Accept(1, 5000));
+  BOOST_CHECK(window.Accept(1, 5000 - ReplayWindow::SIZE + 1));
+  BOOST_CHECK(window.Accept(1, 4999));
+  BOOST_CHECK(!window.Accept(1, 4999));
+}
+
+
+BOOST_AUTO_TEST_CASE( Accept_RejectsTooOld )
+{
+  ReplayWindow window;
+
+  BOOST_CHECK(window.Accept(1, 5000));
+  BOOST_CHECK(!window.Accept(1, 5000 - ReplayWindow::SIZE));
+  BOOST_CHECK(!window.Accept(1, 0));
+}
+
+
+BOOST_AUTO_TEST_CASE( Accept_SlotReusedAfterWindowMoves )
+{
+  ReplayWindow window;
+
+  BOOST_CHECK(window.Accept(1, 1));
+  BOOST_CHECK(window.Accept(1, 2));
+  BOOST_CHECK(window.Accept(1, 3));
+
+  // 1 left the window, its slot is free for 1 + SIZE
+  BOOST_CHECK(window.Accept(1, 2 + ReplayWindow::SIZE));
+  BOOST_CHECK(window.Accept(1, 1 + ReplayWindow::SIZE));
+  BOOST_CHECK(!window.Accept(1, 2 + ReplayWindow::SIZE));
+  BOOST_CHECK(!window.Accept(1, 2));
+}
+
+
+BOOST_AUTO_TEST_CASE( Accept_NewerEpochStartsOver )
+{
+  ReplayWindow window;
+
+  BOOST_CHECK(window.Accept(1, 1000));
+  BOOST_CHECK(window.Accept(2, 5));
+  BOOST_CHECK(window.Accept(2, 4));
+  BOOST_CHECK(!window.Accept(2, 5));
+}
+
+
+BOOST_AUTO_TEST_CASE( Accept_RejectsOlderEpoch )
+{
+  ReplayWindow window;
+
+  BOOST_CHECK(window.Accept(2, 5));
+  BOOST_CHECK(!window.Accept(1, 6));
+  BOOST_CHECK(window.Accept(2, 6));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/Resolver/Emulator.h"
+#include "../src/Resolver/Proxy.h"
+#include "../src/Interfaces/Socket.h"
+
+using namespace std;
+using namespace Interfaces;
+using namespace Resolver;
+
+typedef Emulator::Clock Clock;
+
+
+namespace
+{
+
+const Clock::time_point START = Clock::time_point() + chrono::hours(1);
+const Endpoint CLIENT("127.0.0.1", 5000);
+const Endpoint OTHER_CLIENT("127.0.0.1", 5001);
+
+Emulator::Data
+MakeDatagram(const uint8_t &number, const size_t &size = 20)
+{
+  Emulator::Data datagram(size, number);
+  datagram[0] = 0x14;
+  datagram[1] = 0x1D;
+  datagram[2] = 0x00;
+  return datagram;
+}
+
+size_t
+CountToServer(const vector<Emulator::Datagram> &output)
+{
+  size_t n = 0;
+  for (auto &d : output)
+    n += d.to_server;
+  return n;
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( Resolver_Tests )
+
+BOOST_AUTO_TEST_CASE( Query_IsForwardedAndAnswered )
+{
+  Emulator emulator(Emulator::Config(), 1);
+  vector<Emulator::Datagram> output;
+
+  emulator.OnQuery(CLIENT, MakeDatagram(1), START, output);
+  BOOST_REQUIRE_EQUAL(output.size(), 1);
+  BOOST_CHECK(output[0].to_server);
+  BOOST_CHECK(output[0].client == CLIENT);
+  BOOST_CHECK(output[0].data == MakeDatagram(1));
+
+  output.clear();
+  emulator.OnResponse(CLIENT, MakeDatagram(2), START, output);
+  BOOST_REQUIRE_EQUAL(output.size(), 1);
+  BOOST_CHECK(!output[0].to_server);
+  BOOST_CHECK(output[0].data == MakeDatagram(2));
+  BOOST_CHECK_EQUAL(emulator.GetStats().responses, 1);
+}
+
+BOOST_AUTO_TEST_CASE( UnansweredQuery_IsRetriedThenDropped )
+{
+  Emulator::Config config;
+  config.retry_timeout = chrono::milliseconds(100);
+  config.retries = 2;
+  Emulator emulator(config, 1);
+  vector<Emulator::Datagram> output;
+
+  emulator.OnQuery(CLIENT, MakeDatagram(1), START, output);
+  emulator.OnTimer(START + chrono::milliseconds(99), output);
+  BOOST_CHECK_EQUAL(CountToServer(output), 1);
+
+  emulator.OnTimer(START + chrono::milliseconds(100), output);
+  emulator.OnTimer(START + chrono::milliseconds(200), output);
+  emulator.OnTimer(START + chrono::milliseconds(300), output);
+  emulator.OnTimer(START + chrono::milliseconds(400), output);
+  BOOST_CHECK_EQUAL(CountToServer(output), 3);
+  BOOST_CHECK_EQUAL(emulator.GetStats().retried, 2);
+  BOOST_CHECK_EQUAL(emulator.GetStats().timed_out, 1);
+
+  // nothing outstanding, the next datagram from the server is unsolicited
+  output.clear();
+  emulator.OnResponse(CLIENT, MakeDatagram(2), START, output);
+  BOOST_CHECK_EQUAL(emulator.GetStats().unsolicited, 1);
+  BOOST_CHECK_EQUAL(output.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( Cache_AnswersRepeatedQueryWithinTtl )
+{
+  Emulator::Config config;
+  config.cache_ttl = chrono::seconds(1);
+  Emulator emulator(config, 1);
+  vector<Emulator::Datagram> output;
+
+  emulator.OnQuery(CLIENT, MakeDatagram(1), START, output);
+  emulator.OnResponse(CLIENT, MakeDatagram(2), START, output);
+  output.clear();
+
+  // any client gets the remembered response, the server sees nothing
+  emulator.OnQuery(OTHER_CLIENT, MakeDatagram(1), START + chrono::milliseconds(999), output);
+  BOOST_REQUIRE_EQUAL(output.size(), 1);
+  BOOST_CHECK(!output[0].to_server);
+  BOOST_CHECK(output[0].client == OTHER_CLIENT);
+  BOOST_CHECK(output[0].data == MakeDatagram(2));
+  BOOST_CHECK_EQUAL(emulator.GetStats().cache_hits, 1);
+
+  // expired
+  output.clear();
+  emulator.OnQuery(CLIENT, MakeDatagram(1), START + chrono::seconds(1), output);
+  BOOST_CHECK_EQUAL(CountToServer(output), 1);
+}
+
+BOOST_AUTO_TEST_CASE( RateLimit_DropsQueriesAboveQps )
+{
+  Emulator::Config config;
+  config.qps = 10;
+  Emulator emulator(config, 1);
+  vector<Emulator::Datagram> output;
+
+  for (int i = 0; i < 20; i++)
+    emulator.OnQuery(CLIENT, MakeDatagram(i), START, output);
+  BOOST_CHECK_EQUAL(CountToServer(output), 10);
+
+  // other clients have their own limit, tokens come back with time
+  emulator.OnQuery(OTHER_CLIENT, MakeDatagram(100), START, output);
+  emulator.OnQuery(CLIENT, MakeDatagram(101), START + chrono::milliseconds(100), output);
+  BOOST_CHECK_EQUAL(CountToServer(output), 12);
+  BOOST_CHECK_EQUAL(emulator.GetStats().rate_limited, 10);
+}
+
+BOOST_AUTO_TEST_CASE( LargeResponse_IsTruncated )
+{
+  Emulator::Config config;
+  config.edns_size = 512;
+  Emulator emulator(config, 1);
+  vector<Emulator::Datagram> output;
+
+  emulator.OnQuery(CLIENT, MakeDatagram(1), START, output);
+  output.clear();
+  emulator.OnResponse(CLIENT, MakeDatagram(2, 600), START, output);
+
+  BOOST_REQUIRE_EQUAL(output.size(), 1);
+  BOOST_CHECK_EQUAL(output[0].data.size(), Emulator::HEADER_SIZE);
+  BOOST_CHECK_EQUAL(output[0].data[2], Emulator::TRUNCATED_FLAG);
+  BOOST_CHECK_EQUAL(emulator.GetStats().truncated, 1);
+}
+
+BOOST_AUTO_TEST_CASE( RewrittenId_IsRestoredInResponse )
+{
+  Emulator::Config config;
+  config.rewrite_ids = true;
+  Emulator emulator(config, 1);
+  vector<Emulator::Datagram> output;
+
+  emulator.OnQuery(CLIENT, MakeDatagram(1), START, output);
+  BOOST_REQUIRE_EQUAL(output.size(), 1);
+  Emulator::Data upstream = output[0].data;
+  BOOST_CHECK(upstream != MakeDatagram(1));
+
+  // server answers with the ID it got
+  output.clear();
+  emulator.OnResponse(CLIENT, upstream, START, output);
+  BOOST_REQUIRE_EQUAL(output.size(), 1);
+  BOOST_CHECK(output[0].data == MakeDatagram(1));
+}
+
+BOOST_AUTO_TEST_CASE( Proxy_ForwardsBetweenSockets )
+{
+  unique_ptr<Socket> server(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  server->Bind(0, "127.0.0.1");
+
+  Proxy proxy(Endpoint("127.0.0.1", 0), server->GetLocalEndpoint(), Emulator::Config(), 1);
+  thread proxy_thread(&Proxy::Run, &proxy);
+
+  unique_ptr<Socket> client(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+  client->Connect(proxy.GetLocalEndpoint());
+
+  const Emulator::Data query = MakeDatagram(1);
+  client->Write(query.data(), query.size());
+
+  Emulator::Data buffer(100);
+  Endpoint source;
+  buffer.resize(server->RecvFrom(buffer.data(), buffer.size(), source));
+  BOOST_CHECK(buffer == query);
+
+  const Emulator::Data response = MakeDatagram(2);
+  server->SendTo(response.data(), response.size(), source);
+
+  buffer.resize(100);
+  buffer.resize(client->Read(buffer.data(), buffer.size()));
+  BOOST_CHECK(buffer == response);
+
+  proxy.Stop();
+  proxy_thread.join();
+  client->Close();
+  server->Close();
+
+  BOOST_CHECK_EQUAL(proxy.GetStats().responses, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "../src/Pipeline/SeqLock.h"
+
+using namespace Pipeline;
+
+
+namespace
+{
+
+// odd size, the last word is partly used
+struct Value
+{
+  std::uint64_t a;
+  std::uint64_t b;
+  std::uint32_t c;
+};
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( SeqLock_Tests )
+
+BOOST_AUTO_TEST_CASE( Load_GetsStoredValue )
+{
+  SeqLock<Value> lock;
+
+  Value value = lock.Load();
+  BOOST_CHECK_EQUAL(value.a, 0);
+  BOOST_CHECK_EQUAL(value.c, 0);
+
+  lock.Store(Value { 1, 2, 3 });
+  value = lock.Load();
+  BOOST_CHECK_EQUAL(value.a, 1);
+  BOOST_CHECK_EQUAL(value.b, 2);
+  BOOST_CHECK_EQUAL(value.c, 3);
+}
+
+
+BOOST_AUTO_TEST_CASE( TwoThreads_NoTornValues )
+{
+  const std::uint64_t count = 200000;
+  SeqLock<Value> lock;
+  std::atomic<bool> done(false);
+  bool consistent = true;
+  std::uint64_t last = 0;
+
+  std::thread reader([&]() {
+    while (!done)
+    {
+      const Value value = lock.Load();
+      if (value.a != value.b || value.c != static_cast<std::uint32_t>(value.a) || value.a < last)
+        consistent = false;
+      last = value.a;
+    }
+  });
+
+  for (std::uint64_t i = 1; i <= count; i++)
+    lock.Store(Value { i, i, static_cast<std::uint32_t>(i) });
+
+  done = true;
+  reader.join();
+
+  BOOST_CHECK(consistent);
+  BOOST_CHECK_EQUAL(lock.Load().a, count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "../src/Simulation/EventQueue.h"
+#include "../src/Simulation/Link.h"
+#include "../src/Simulation/TunnelSimulation.h"
+
+using namespace std;
+using namespace Simulation;
+
+
+BOOST_AUTO_TEST_SUITE( Simulation_Tests )
+
+BOOST_AUTO_TEST_CASE( EventQueue_RunsEventsInTimeOrder )
+{
+  EventQueue events;
+  const auto start = events.GetTime();
+  vector<int> order;
+
+  events.ScheduleAfter(chrono::milliseconds(20), [&order]() { order.push_back(3); });
+  events.ScheduleAfter(chrono::milliseconds(10), [&order]() { order.push_back(1); });
+  events.ScheduleAfter(chrono::milliseconds(10), [&order, &events]() {
+    order.push_back(2);
+    // in the past, runs right away
+    events.Schedule(EventQueue::Clock::time_point(), [&order]() { order.push_back(4); });
+  });
+  events.ScheduleAfter(chrono::milliseconds(30), [&order]() { order.push_back(5); });
+
+  BOOST_CHECK_EQUAL(events.RunUntil(start + chrono::milliseconds(25)), 4);
+  BOOST_CHECK(order == vector<int>({1, 2, 4, 3}));
+  BOOST_CHECK(events.GetTime() == start + chrono::milliseconds(25));
+  BOOST_CHECK_EQUAL(events.GetPendingCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( Link_SendsAtItsRateAfterTheDelay )
+{
+  EventQueue events;
+  const auto start = events.GetTime();
+  vector<chrono::milliseconds> arrivals;
+
+  Link::Config config;
+  config.rate = 1000;
+  config.buffer = 250;
+  config.path.delay = chrono::microseconds(50000);
+
+  Link link(events, config, 1, [&](Link::Data &&) {
+    arrivals.push_back(chrono::duration_cast<chrono::milliseconds>(events.GetTime() - start));
+  });
+
+  // the third doesn't fit the buffer
+  for (int i = 0; i < 3; i++)
+    link.Send(Link::Data(100, 0));
+
+  events.RunUntil(start + chrono::seconds(1));
+
+  BOOST_CHECK(arrivals == vector<chrono::milliseconds>({chrono::milliseconds(150), chrono::milliseconds(250)}));
+  const Link::Stats stats = link.GetStats();
+  BOOST_CHECK_EQUAL(stats.sent, 3);
+  BOOST_CHECK_EQUAL(stats.buffer_dropped, 1);
+  BOOST_CHECK_EQUAL(stats.delivered, 2);
+  BOOST_CHECK_EQUAL(stats.delivered_bytes, 200);
+}
+
+BOOST_AUTO_TEST_CASE( Tunnel_LosslessPathDeliversEverything )
+{
+  TunnelSimulation::Config config;
+  config.duration = chrono::milliseconds(2000);
+  config.upstream.rate = 1000;
+  config.upstream.size = 200;
+  config.downstream.rate = 500;
+  config.downstream.size = 1000;
+  config.uplink.path.delay = chrono::microseconds(20000);
+  config.downlink.path.delay = chrono::microseconds(20000);
+  config.checksum = true;
+  config.encryption = true;
+
+  TunnelSimulation simulation(config);
+  const TunnelSimulation::Result r = simulation.Run();
+
+  BOOST_CHECK_EQUAL(r.upstream.offered, 2000);
+  BOOST_CHECK_EQUAL(r.upstream.delivered, 2000);
+  BOOST_CHECK_EQUAL(r.downstream.offered, 1000);
+  BOOST_CHECK_EQUAL(r.downstream.delivered, 1000);
+  BOOST_CHECK_EQUAL(r.upstream.damaged + r.upstream.duplicated, 0);
+  BOOST_CHECK_EQUAL(r.upstream.throughput, 200000);
+
+  // the link delay and at most a poll interval
+  BOOST_CHECK(r.upstream.latency.p50 >= chrono::milliseconds(20));
+  BOOST_CHECK(r.upstream.latency.max < chrono::milliseconds(21));
+
+  // 100 ms samples of 2 s traffic and 1 s drain
+  BOOST_CHECK_EQUAL(r.upstream.timeline.size(), 30);
+  BOOST_CHECK_EQUAL(r.upstream.timeline[5].delivered, 100);
+  BOOST_CHECK_EQUAL(r.upstream.timeline[25].delivered, 0);
+}
+
+BOOST_AUTO_TEST_CASE( Tunnel_SameConfigurationGivesSameResult )
+{
+  TunnelSimulation::Config config;
+  config.duration = chrono::milliseconds(1000);
+  config.upstream.rate = 2000;
+  config.upstream.poisson = true;
+  config.uplink.path.loss = 0.01;
+  config.uplink.path.delay = chrono::microseconds(30000);
+  config.uplink.path.jitter = chrono::microseconds(10000);
+  config.seed = 7;
+
+  TunnelSimulation first(config);
+  TunnelSimulation second(config);
+  const TunnelSimulation::Result a = first.Run();
+  const TunnelSimulation::Result b = second.Run();
+
+  BOOST_CHECK_EQUAL(a.events, b.events);
+  BOOST_CHECK_EQUAL(a.upstream.offered, b.upstream.offered);
+  BOOST_CHECK_EQUAL(a.upstream.delivered, b.upstream.delivered);
+  BOOST_CHECK_EQUAL(a.uplink.path.lost, b.uplink.path.lost);
+  BOOST_CHECK(a.upstream.latency.p99 == b.upstream.latency.p99);
+
+  // a lost fragment loses its whole packet
+  BOOST_CHECK_GT(a.uplink.path.lost, 0);
+  BOOST_CHECK_LT(a.upstream.delivered, a.upstream.offered);
+}
+
+BOOST_AUTO_TEST_CASE( Tunnel_PacingAvoidsBottleneckDrops )
+{
+  TunnelSimulation::Config config;
+  config.duration = chrono::milliseconds(2000);
+  config.upstream.rate = 1000;
+  config.upstream.size = 500;
+  config.uplink.rate = 100000;
+  config.uplink.buffer = 4096;
+
+  TunnelSimulation unpaced(config);
+  const TunnelSimulation::Result a = unpaced.Run();
+
+  // a datagram every millisecond is a bit less than the link takes
+  config.poll_interval = chrono::microseconds(1000);
+  config.datagrams_per_poll = 1;
+  TunnelSimulation paced(config);
+  const TunnelSimulation::Result b = paced.Run();
+
+  // the link drops fragments of many packets, the paced sender's queue
+  // drops whole packets
+  BOOST_CHECK_GT(a.uplink.buffer_dropped, 0);
+  BOOST_CHECK_EQUAL(b.uplink.buffer_dropped, 0);
+  BOOST_CHECK_GT(b.upstream.queue.tail_dropped + b.upstream.queue.codel_dropped, 0);
+
+  BOOST_CHECK_LT(b.upstream.throughput, config.uplink.rate);
+  BOOST_CHECK_GT(b.upstream.throughput, 2 * a.upstream.throughput);
+}
+
+BOOST_AUTO_TEST_CASE( Tunnel_FlowSchedulingShortensInteractiveLatency )
+{
+  TunnelSimulation::Config config;
+  config.duration = chrono::milliseconds(2000);
+  config.upstream.rate = 180;
+  config.upstream.size = 1400;
+  config.upstream.poisson = true;
+  config.interactive.rate = 50;
+  // 5000 datagrams per second, bulk packets take 24 of them
+  config.poll_interval = chrono::microseconds(200);
+  config.datagrams_per_poll = 1;
+
+  config.flow_scheduling = false;
+  TunnelSimulation fifo(config);
+  const TunnelSimulation::Result a = fifo.Run();
+
+  config.flow_scheduling = true;
+  TunnelSimulation drr(config);
+  const TunnelSimulation::Result b = drr.Run();
+
+  BOOST_CHECK_EQUAL(a.interactive.offered, 100);
+  BOOST_CHECK_EQUAL(a.interactive.delivered, 100);
+  BOOST_CHECK_EQUAL(b.interactive.delivered, 100);
+
+  // behind whole bulk trains, or behind one fragment of each
+  BOOST_CHECK(b.interactive.latency.p50 * 4 < a.interactive.latency.p50);
+  BOOST_CHECK(b.interactive.latency.p99 < a.interactive.latency.p99);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../src/Interfaces/Socket.h"
+#include "../src/Interfaces/Endpoint.h"
+#include "../src/Metrics/Counter.h"
+
+using namespace std;
+using namespace Interfaces;
+
+
+BOOST_AUTO_TEST_SUITE( Socket_Tests )
+
+BOOST_AUTO_TEST_CASE( Buffers_SizeIsDoubledByTheKernel )
+{
+  auto socket = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+
+  socket->SetReceiveBufferSize(65536);
+  socket->SetSendBufferSize(32768);
+
+  const Socket::BufferStats stats = socket->GetBufferStats();
+  BOOST_CHECK_EQUAL(stats.receive_buffer, 2 * 65536);
+  BOOST_CHECK_EQUAL(stats.send_buffer, 2 * 32768);
+  BOOST_CHECK_EQUAL(stats.receive_queued, 0);
+  BOOST_CHECK_EQUAL(stats.send_queued, 0);
+
+  socket->Close();
+}
+
+
+BOOST_AUTO_TEST_CASE( Buffers_ReceiveQueueHasAllDatagrams )
+{
+  auto server = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  auto client = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  server->Bind(Endpoint("127.0.0.1", 0));
+  client->Connect(server->GetLocalEndpoint());
+
+  const vector<uint8_t> datagram(100, 0x5A);
+  for (int i = 0; i < 3; i++)
+    client->Write(datagram.data(), datagram.size());
+
+  // the kernel accounts a bit more than the data
+  BOOST_CHECK_GE(server->GetBufferStats().receive_queued, 3 * datagram.size());
+
+  vector<uint8_t> buffer(256);
+  Endpoint source;
+  while (server->IsReadyToRead())
+    server->RecvFrom(buffer.data(), buffer.size(), source);
+
+  BOOST_CHECK_EQUAL(server->GetBufferStats().receive_queued, 0);
+
+  client->Close();
+  server->Close();
+}
+
+
+BOOST_AUTO_TEST_CASE( DropReporting_DatagramsCarryTheDropCount )
+{
+  auto server = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  auto client = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  // the smallest buffer the kernel allows
+  server->SetReceiveBufferSize(1);
+  server->Bind(Endpoint("127.0.0.1", 0));
+  server->EnableDropReporting();
+  client->Connect(server->GetLocalEndpoint());
+
+  BOOST_CHECK_EQUAL(server->GetReportedDropCount(), 0);
+
+  const vector<uint8_t> datagram(500, 0x5A);
+  for (int i = 0; i < 100; i++)
+    client->Write(datagram.data(), datagram.size());
+
+  vector<uint8_t> buffer(1024);
+  Endpoint source;
+  while (server->IsReadyToRead())
+    server->RecvFrom(buffer.data(), buffer.size(), source);
+
+  // a datagram queued after all drops knows all of them
+  client->Write(datagram.data(), datagram.size());
+  BOOST_CHECK_EQUAL(server->Read(buffer.data(), buffer.size()), datagram.size());
+
+  const uint32_t dropped = server->GetDropCount();
+  BOOST_CHECK_GT(dropped, 0);
+  BOOST_CHECK_EQUAL(server->GetReportedDropCount(), dropped);
+
+  client->Close();
+  server->Close();
+}
+
+BOOST_AUTO_TEST_CASE( Stats_OnlyEnabledSocketIsCounted )
+{
+  Metrics::Counter sent("sdnst_socket_sent_datagrams_total",
+                        "Datagrams sent to the tunnel socket.");
+  Metrics::Counter received("sdnst_socket_received_datagrams_total",
+                            "Datagrams received from the tunnel socket.");
+  const int64_t sent_before = sent.GetValue();
+  const int64_t received_before = received.GetValue();
+
+  auto server = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  auto client = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  server->Bind(Endpoint("127.0.0.1", 0));
+  server->EnableStats();
+  client->Connect(server->GetLocalEndpoint());
+
+  const vector<uint8_t> datagram(100, 0x5A);
+  vector<uint8_t> buffer(1024);
+  client->Write(datagram.data(), datagram.size());
+  client->Write(datagram.data(), datagram.size());
+  server->Read(buffer.data(), buffer.size());
+  server->Read(buffer.data(), buffer.size());
+
+  BOOST_CHECK_EQUAL(sent.GetValue(), sent_before);
+  BOOST_CHECK_EQUAL(received.GetValue(), received_before + 2);
+
+  client->Close();
+  server->Close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
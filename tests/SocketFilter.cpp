@@ -0,0 +1,211 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/Interfaces/SocketFilter.h"
+#include "../src/Interfaces/Socket.h"
+#include "../src/Interfaces/InterfaceException.h"
+#include "../src/Packets/PseudoDNS.h"
+
+using namespace Interfaces;
+using namespace Packets;
+
+
+BOOST_AUTO_TEST_SUITE( SocketFilter_Tests )
+
+BOOST_AUTO_TEST_CASE( Program_ChecksLengthAndEveryByte )
+{
+  Packet::Signature signature { 4, { {0, 0xFF, 0x14}, {2, 0xF0, 0x00} } };
+  SocketFilter filter(signature);
+
+  const std::vector<sock_filter> &program = filter.GetProgram();
+  BOOST_REQUIRE_EQUAL(program.size(), 9);
+
+  // minimum size includes the UDP header
+  BOOST_CHECK_EQUAL(program[1].k, SocketFilter::UDP_HEADER_SIZE + 4);
+  BOOST_CHECK_EQUAL(program[2].k, SocketFilter::UDP_HEADER_SIZE + 0);
+  BOOST_CHECK_EQUAL(program[5].k, 0xF0);
+
+  // failed checks jump to the last instruction, which drops the datagram
+  BOOST_CHECK_EQUAL(1 + 1 + program[1].jf, 8);
+  BOOST_CHECK_EQUAL(3 + 1 + program[3].jf, 8);
+  BOOST_CHECK_EQUAL(6 + 1 + program[6].jf, 8);
+  BOOST_CHECK_EQUAL(program[8].k, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( Program_TooLong )
+{
+  Packet::Signature signature { 0, std::vector<Packet::Signature::Byte>(200, {0, 0x0F, 0x00}) };
+
+  BOOST_CHECK_THROW(SocketFilter filter(signature), InterfaceException);
+}
+
+
+BOOST_AUTO_TEST_CASE( Socket_DropsForeignDatagrams )
+{
+  auto server = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  auto client = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+  server->Bind(Endpoint("127.0.0.1", 0));
+  client->Bind(Endpoint("127.0.0.1", 0));
+
+  PseudoDNS packet;
+  packet.SetChecksum(true);
+  packet.SetData({ 0x01, 0x02, 0x03 });
+  const Packet::Data dump = packet.Dump();
+
+  server->AttachFilter(SocketFilter(packet.GetSignature()));
+  const std::uint32_t dropped = server->GetDropCount();
+
+  // a real DNS query, wrong magic number, and a truncated header
+  const Packet::Data query { 0xAB, 0xCD, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00,
+                             0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01 };
+  const Packet::Data truncated(dump.begin(), dump.begin() + 8);
+
+  const Endpoint server_address = server->GetLocalEndpoint();
+  client->SendTo(query.data(), query.size(), server_address);
+  client->SendTo(truncated.data(), truncated.size(), server_address);
+  client->SendTo(dump.data(), dump.size(), server_address);
+
+  Packet::Data buffer(256);
+  Endpoint source;
+  const size_t r = server->RecvFrom(buffer.data(), buffer.size(), source, MSG_DONTWAIT);
+  buffer.resize(r);
+
+  BOOST_CHECK(buffer == dump);
+  BOOST_CHECK_EQUAL(server->GetDropCount() - dropped, 2);
+  BOOST_CHECK(!server->IsReadyToRead());
+
+  server->Close();
+  client->Close();
+}
+
+BOOST_AUTO_TEST_CASE( Steering_SessionIdModuloSockets )
+{
+  const SocketFilter steering = SocketFilter::CreateSteering(10, 3);
+  const std::vector<sock_filter> &program = steering.GetProgram();
+
+  BOOST_REQUIRE_EQUAL(program.size(), 3);
+  BOOST_CHECK_EQUAL(program[0].code, BPF_LD | BPF_H | BPF_ABS);
+  BOOST_CHECK_EQUAL(program[0].k, 10);
+  BOOST_CHECK_EQUAL(program[1].code, BPF_ALU | BPF_MOD | BPF_K);
+  BOOST_CHECK_EQUAL(program[1].k, 3);
+
+  BOOST_CHECK_THROW(SocketFilter::CreateSteering(10, 0), InterfaceException);
+}
+
+
+namespace
+{
+
+// session ids of datagrams which arrive at the socket within the timeout
+std::vector<std::uint16_t>
+ReceiveSessionIds(Socket &socket, const int &count)
+{
+  std::vector<std::uint16_t> ids;
+  Packet::Data buffer(256);
+  Endpoint source;
+
+  for (int wait = 0; wait < 2000 && static_cast<int>(ids.size()) < count; wait++)
+  {
+    if (!socket.IsReadyToRead())
+    {
+      usleep(1000);
+      continue;
+    }
+
+    buffer.resize(256);
+    buffer.resize(socket.RecvFrom(buffer.data(), buffer.size(), source));
+
+    PseudoDNS packet;
+    packet.FillFromDump(buffer);
+    ids.push_back(packet.GetSessionId());
+  }
+
+  return ids;
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE( Socket_SteersSessionsToProcesses )
+{
+  constexpr int SESSIONS = 8;
+
+  std::vector<std::unique_ptr<Socket>> servers;
+  for (int i = 0; i < 2; i++)
+  {
+    servers.push_back(Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM));
+    servers.back()->EnableReusePort();
+  }
+
+  servers[0]->Bind(Endpoint("127.0.0.1", 0));
+  const Endpoint server_address = servers[0]->GetLocalEndpoint();
+  servers[1]->Bind(server_address);
+  servers[0]->AttachSteeringProgram(SocketFilter::CreateSteering(PseudoDNS::SESSION_ID_OFFSET, 2));
+
+  int results[2];
+  BOOST_REQUIRE_EQUAL(pipe(results), 0);
+
+  // second process gets odd session ids
+  const pid_t pid = fork();
+  BOOST_REQUIRE(pid >= 0);
+  if (pid == 0)
+  {
+    const auto ids = ReceiveSessionIds(*servers[1], SESSIONS);
+
+    std::uint8_t odd = 0;
+    for (auto &id : ids)
+      odd += id % 2;
+
+    const std::uint8_t result[] { static_cast<std::uint8_t>(ids.size()), odd };
+    _exit(write(results[1], result, sizeof(result)) == sizeof(result) ? 0 : 1);
+  }
+
+  // every client sends from its own port, all its datagrams land in
+  // the same process
+  for (std::uint16_t session_id = 1; session_id <= SESSIONS; session_id++)
+  {
+    auto client = Socket::Create(Socket::DomainType::INET, Socket::SocketType::DGRAM);
+
+    PseudoDNS packet;
+    packet.SetSessionId(session_id);
+    const Packet::Data dump = packet.Dump();
+
+    for (int i = 0; i < 2; i++)
+      client->SendTo(dump.data(), dump.size(), server_address);
+
+    client->Close();
+  }
+
+  const auto ids = ReceiveSessionIds(*servers[0], SESSIONS);
+  BOOST_CHECK_EQUAL(ids.size(), SESSIONS);
+  for (auto &id : ids)
+    BOOST_CHECK_EQUAL(id % 2, 0);
+
+  std::uint8_t result[2] = {0, 0};
+  BOOST_CHECK_EQUAL(read(results[0], result, sizeof(result)), sizeof(result));
+  BOOST_CHECK_EQUAL(result[0], SESSIONS);
+  BOOST_CHECK_EQUAL(result[1], SESSIONS);
+
+  int status = -1;
+  waitpid(pid, &status, 0);
+  BOOST_CHECK_EQUAL(status, 0);
+
+  close(results[0]);
+  close(results[1]);
+  for (auto &server : servers)
+    server->Close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
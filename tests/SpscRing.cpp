@@ -0,0 +1,95 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "../src/Pipeline/SpscRing.h"
+
+using namespace Pipeline;
+
+
+BOOST_AUTO_TEST_SUITE( SpscRing_Tests )
+
+BOOST_AUTO_TEST_CASE( Constructor_CapacityRoundedUp )
+{
+  SpscRing<int> ring(5);
+
+  BOOST_CHECK_EQUAL(ring.GetCapacity(), 8);
+  BOOST_CHECK(ring.IsEmpty());
+}
+
+
+BOOST_AUTO_TEST_CASE( New_AlignedToCacheLine )
+{
+  std::unique_ptr<SpscRing<int>> ring(new SpscRing<int>(4));
+
+  BOOST_CHECK_EQUAL(alignof(SpscRing<int>), SpscRing<int>::CACHE_LINE_SIZE);
+  BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(ring.get()) % SpscRing<int>::CACHE_LINE_SIZE, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( TryPop_EmptyRing )
+{
+  SpscRing<int> ring(4);
+  int item = 7;
+
+  BOOST_CHECK(!ring.TryPop(item));
+  BOOST_CHECK_EQUAL(item, 7);
+}
+
+
+BOOST_AUTO_TEST_CASE( TryPush_FullRing )
+{
+  SpscRing<int> ring(4);
+
+  for (int i = 0; i < 4; i++)
+    BOOST_CHECK(ring.TryPush(int(i)));
+
+  BOOST_CHECK(!ring.TryPush(4));
+
+  int item;
+  BOOST_CHECK(ring.TryPop(item));
+  BOOST_CHECK_EQUAL(item, 0);
+  BOOST_CHECK(ring.TryPush(4));
+}
+
+
+BOOST_AUTO_TEST_CASE( TwoThreads_OrderIsKept )
+{
+  const int count = 100000;
+  SpscRing<int> ring(64);
+  bool ordered = true;
+
+  std::thread consumer([&ring, &ordered, count]() {
+    int expected = 0;
+    int item;
+
+    while (expected < count)
+      if (ring.TryPop(item))
+      {
+        if (item != expected)
+          ordered = false;
+        expected++;
+      }
+      else
+        std::this_thread::yield();
+  });
+
+  for (int i = 0; i < count; )
+    if (ring.TryPush(int(i)))
+      i++;
+    else
+      std::this_thread::yield();
+
+  consumer.join();
+
+  BOOST_CHECK(ordered);
+  BOOST_CHECK(ring.IsEmpty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
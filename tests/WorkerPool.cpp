@@ -0,0 +1,123 @@
+/*
+ * Copyright 2014-2015 Adam Chyła, adam@chyla.org
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../src/Pipeline/WorkerPool.h"
+
+using namespace Pipeline;
+
+
+namespace
+{
+
+typedef WorkerPool<int, int> Pool;
+
+
+std::vector<int>
+Process(Pool &pool, const int &count)
+{
+  std::vector<int> results;
+  int item;
+
+  for (int i = 0; i < count; )
+  {
+    int in = i;
+    if (pool.TrySubmit(std::move(in)))
+      i++;
+
+    while (pool.TryCollect(item))
+      results.push_back(item);
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (std::chrono::steady_clock::now() < deadline)
+    if (pool.TryCollect(item))
+      results.push_back(item);
+    else if (pool.GetInFlightCount() == 0)
+      break;
+    else
+      std::this_thread::yield();
+
+  return results;
+}
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( WorkerPool_Tests )
+
+BOOST_AUTO_TEST_CASE( TrySubmit_ResultsInOrder )
+{
+  Pool pool(4, 8, []() {
+    return [](int &in, int &out) {
+      // uneven work, so workers finish out of order
+      if (in % 3 == 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+      out = in * 2;
+      return true;
+    };
+  });
+
+  const auto results = Process(pool, 1000);
+
+  BOOST_CHECK_EQUAL(pool.GetWorkerCount(), 4);
+  BOOST_REQUIRE_EQUAL(results.size(), 1000);
+  for (int i = 0; i < 1000; i++)
+    BOOST_CHECK_EQUAL(results[i], i * 2);
+}
+
+
+BOOST_AUTO_TEST_CASE( TrySubmit_FailedJobsAreDropped )
+{
+  Pool pool(3, 4, []() {
+    return [](int &in, int &out) {
+      if (in % 5 == 0)
+        throw std::runtime_error("bad item");
+
+      out = in;
+      return in % 2 == 0;
+    };
+  });
+
+  const auto results = Process(pool, 100);
+
+  std::vector<int> expected;
+  for (int i = 0; i < 100; i++)
+    if (i % 5 != 0 && i % 2 == 0)
+      expected.push_back(i);
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(results.begin(), results.end(),
+				expected.begin(), expected.end());
+}
+
+
+BOOST_AUTO_TEST_CASE( TrySubmit_RefusedWhenFull )
+{
+  Pool pool(1, 2, []() {
+    return [](int &in, int &out) {
+      out = in;
+      return true;
+    };
+  });
+
+  // nothing is collected, so the reorder window fills up
+  int submitted = 0;
+  for (int i = 0; i < 100; i++)
+  {
+    int in = i;
+    if (pool.TrySubmit(std::move(in)))
+      submitted++;
+  }
+
+  BOOST_CHECK_EQUAL(submitted, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()